@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+
+# Generates the perfect hash tables used by gmpv_uri_classifier.c from the
+# lists of extensions, protocols and MIME types in gmpv_def.h.
+#
+# Each table is built with the hash and displace method. Keys are hashed
+# once with 64-bit FNV-1a over their lowercase form. The upper half of the
+# hash selects a bucket, and the seed of that bucket is mixed with the lower
+# half to select a slot. Seeds are chosen bucket by bucket, largest first,
+# so that every key ends up in its own slot.
+
+import re
+import sys
+
+FNV_OFFSET = 0xcbf29ce484222325
+FNV_PRIME = 0x100000001b3
+MASK32 = 0xffffffff
+MASK64 = 0xffffffffffffffff
+MAX_SEED = 1 << 20
+
+# Lists that appear earlier take precedence for keys that are in several
+EXTENSION_LISTS = [
+    ('SUBTITLE_EXTS', 'URI_CLASS_SUBTITLE'),
+    ('AUDIO_TRACK_EXTS', 'URI_CLASS_AUDIO_TRACK'),
+    ('PLAYLIST_EXTS', 'URI_CLASS_PLAYLIST'),
+]
+
+
+def parse_list(source, name):
+    match = re.search(r'#define\s+' + name + r'\s*\{(.*?)NULL\s*\}',
+                      source, re.S)
+
+    if not match:
+        sys.exit('{} not found'.format(name))
+
+    return re.findall(r'"([^"]*)"', match.group(1))
+
+
+def fnv1a(key):
+    value = FNV_OFFSET
+
+    for byte in key.lower().encode():
+        value = ((value ^ byte) * FNV_PRIME) & MASK64
+
+    return value
+
+
+def mix(value):
+    value ^= value >> 16
+    value = (value * 0x85ebca6b) & MASK32
+    value ^= value >> 13
+    value = (value * 0xc2b2ae35) & MASK32
+    value ^= value >> 16
+
+    return value
+
+
+def next_pow2(value):
+    result = 1
+
+    while result < value:
+        result <<= 1
+
+    return result
+
+
+def build_table(keys):
+    table_size = next_pow2(max(2 * len(keys), 2))
+    bucket_count = next_pow2(max(len(keys) // 2, 1))
+    buckets = [[] for _ in range(bucket_count)]
+    slots = [None] * table_size
+    seeds = [0] * bucket_count
+
+    for key in keys:
+        hash_value = fnv1a(key)
+        buckets[(hash_value >> 32) & (bucket_count - 1)].append(key)
+
+    order = sorted(range(bucket_count), key=lambda b: -len(buckets[b]))
+
+    for bucket in order:
+        if not buckets[bucket]:
+            continue
+
+        for seed in range(MAX_SEED):
+            positions = [mix((fnv1a(key) & MASK32) ^ seed) & (table_size - 1)
+                         for key in buckets[bucket]]
+
+            if (len(set(positions)) == len(positions) and
+                    all(slots[p] is None for p in positions)):
+                break
+        else:
+            sys.exit('No seed found for {}'.format(buckets[bucket]))
+
+        seeds[bucket] = seed
+
+        for key, position in zip(buckets[bucket], positions):
+            slots[position] = key
+
+    return seeds, slots
+
+
+def write_table(out, name, entries):
+    seeds, slots = build_table(list(entries))
+    prefix = name.upper()
+
+    out.write('#define {}_BUCKET_MASK {}u\n'.format(prefix, len(seeds) - 1))
+    out.write('#define {}_TABLE_MASK {}u\n\n'.format(prefix, len(slots) - 1))
+    out.write('static const guint32 {}_seeds[] =\n\t{{\t'.format(name))
+    out.write(',\n\t\t'.join(str(seed) for seed in seeds))
+    out.write(' };\n\n')
+    out.write('static const UriTableEntry {}_table[] =\n\t{{\t'.format(name))
+
+    rows = []
+
+    for key in slots:
+        if key is None:
+            rows.append('{NULL, 0, URI_CLASS_UNSUPPORTED}')
+        else:
+            rows.append('{{"{}", {}, {}}}'.format(key.lower(),
+                                                  len(key.encode()),
+                                                  entries[key]))
+
+    out.write(',\n\t\t'.join(rows))
+    out.write(' };\n\n')
+
+
+def main():
+    in_file = sys.argv[1]
+    out_file = sys.argv[2]
+
+    with open(in_file) as i:
+        source = i.read()
+
+    extensions = {}
+
+    for list_name, uri_class in EXTENSION_LISTS:
+        for ext in parse_list(source, list_name):
+            extensions.setdefault(ext.lower(), uri_class)
+
+    protocols = {key.lower(): 'URI_CLASS_MEDIA'
+                 for key in parse_list(source, 'SUPPORTED_PROTOCOLS')}
+    mime_types = {key.lower(): 'URI_CLASS_MEDIA'
+                  for key in parse_list(source, 'SUPPORTED_MIME_TYPES')}
+
+    with open(out_file, 'w') as o:
+        o.write('/* Generated by generate_uri_tables.py. Do not edit. */\n\n')
+        o.write('#ifndef URI_TABLES_H\n#define URI_TABLES_H\n\n')
+        write_table(o, 'extension', extensions)
+        write_table(o, 'protocol', protocols)
+        write_table(o, 'mime_type', mime_types)
+        o.write('#endif\n')
+
+
+if __name__ == '__main__':
+    main()
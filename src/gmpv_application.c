@@ -25,6 +25,8 @@
 
 #include "gmpv_application.h"
 #include "gmpv_controller.h"
+#include "gmpv_session.h"
+#include "gmpv_settings_cache.h"
 #include "gmpv_mpv_wrapper.h"
 #include "gmpv_common.h"
 #include "gmpv_def.h"
@@ -35,7 +37,11 @@ struct _GmpvApplication
 	GSList *controllers;
 	gboolean enqueue;
 	gboolean new_window;
+	gboolean headless;
+	gboolean opening;
 	guint inhibit_cookie;
+	guint session_source_id;
+	guint64 session_version;
 };
 
 struct _GmpvApplicationClass
@@ -43,9 +49,16 @@ struct _GmpvApplicationClass
 	GtkApplicationClass parent_class;
 };
 
+static void startup(GApplication *gapp);
+static void shutdown(GApplication *gapp);
+static void before_emit(GApplication *gapp, GVariant *platform_data);
+static void after_emit(GApplication *gapp, GVariant *platform_data);
 static void migrate_config(void);
 static void initialize_gui(GmpvApplication *app);
 static void create_dirs(void);
+static void restore_session(GmpvController *controller);
+static void save_session(GmpvApplication *app);
+static gboolean save_session_handler(gpointer data);
 static gboolean shutdown_signal_handler(gpointer data);
 static void new_window_handler(	GSimpleAction *simple,
 				GVariant *parameter,
@@ -72,6 +85,89 @@ static void gmpv_application_init(GmpvApplication *app);
 
 G_DEFINE_TYPE(GmpvApplication, gmpv_application, GTK_TYPE_APPLICATION)
 
+/* In headless mode, the GtkApplication implementations of these vfuncs are
+ * skipped in favor of the GApplication ones so that GTK is never initialized
+ * and no display connection is required.
+ */
+static void startup(GApplication *gapp)
+{
+	GApplicationClass *klass = G_APPLICATION_CLASS(gmpv_application_parent_class);
+
+	if(GMPV_APPLICATION(gapp)->headless)
+	{
+		klass = g_type_class_peek(G_TYPE_APPLICATION);
+	}
+
+	klass->startup(gapp);
+
+	/* Without a window to keep the application alive, hold it until the
+	 * player quits. The hold is released in shutdown().
+	 */
+	if(GMPV_APPLICATION(gapp)->headless)
+	{
+		g_application_hold(gapp);
+	}
+}
+
+static void shutdown(GApplication *gapp)
+{
+	GApplicationClass *klass = G_APPLICATION_CLASS(gmpv_application_parent_class);
+	GmpvApplication *app = GMPV_APPLICATION(gapp);
+
+	if(app->headless)
+	{
+		klass = g_type_class_peek(G_TYPE_APPLICATION);
+	}
+
+	/* Windows are still open if quitting was requested by a signal */
+	save_session(app);
+
+	if(app->session_source_id > 0)
+	{
+		g_source_remove(app->session_source_id);
+		app->session_source_id = 0;
+	}
+
+	if(app->headless)
+	{
+		g_application_release(gapp);
+	}
+
+	klass->shutdown(gapp);
+
+	/* Give mpv instances that are still shutting down in the background a
+	 * chance to write their watch later configs before exiting.
+	 */
+	if(!gmpv_mpv_wait_for_termination(MPV_TERMINATE_TIMEOUT))
+	{
+		g_warning("Timed out waiting for mpv to terminate");
+	}
+}
+
+static void before_emit(GApplication *gapp, GVariant *platform_data)
+{
+	GApplicationClass *klass = G_APPLICATION_CLASS(gmpv_application_parent_class);
+
+	if(GMPV_APPLICATION(gapp)->headless)
+	{
+		klass = g_type_class_peek(G_TYPE_APPLICATION);
+	}
+
+	klass->before_emit(gapp, platform_data);
+}
+
+static void after_emit(GApplication *gapp, GVariant *platform_data)
+{
+	GApplicationClass *klass = G_APPLICATION_CLASS(gmpv_application_parent_class);
+
+	if(GMPV_APPLICATION(gapp)->headless)
+	{
+		klass = g_type_class_peek(G_TYPE_APPLICATION);
+	}
+
+	klass->after_emit(gapp, platform_data);
+}
+
 static void migrate_config()
 {
 	const gchar *keys[] = {	"dark-theme-enable",
@@ -115,14 +211,32 @@ static void initialize_gui(GmpvApplication *app)
 	GmpvController *controller;
 	GmpvView *view;
 	GSettings *settings;
+	gboolean first;
 
 	migrate_config();
 
 	controller = gmpv_controller_new(app);
 	view = gmpv_controller_get_view(controller);
 	settings = g_settings_new(CONFIG_ROOT);
+	first = !app->controllers;
 	app->controllers = g_slist_prepend(app->controllers, controller);
 
+	/* The session belongs to the first window. It is only restored if
+	 * there are no files to open in its place.
+	 */
+	if(first && !app->headless)
+	{
+		if(!app->opening)
+		{
+			restore_session(controller);
+		}
+
+		app->session_source_id =	g_timeout_add_seconds
+						(	SESSION_SAVE_INTERVAL,
+							save_session_handler,
+							app );
+	}
+
 	g_unix_signal_add(SIGHUP, shutdown_signal_handler, app);
 	g_unix_signal_add(SIGINT, shutdown_signal_handler, app);
 	g_unix_signal_add(SIGTERM, shutdown_signal_handler, app);
@@ -136,16 +250,19 @@ static void initialize_gui(GmpvApplication *app)
 				G_CALLBACK(shutdown_handler),
 				app );
 
-	g_settings_bind(	settings,
-				"always-use-floating-controls",
-				gmpv_view_get_main_window(view),
-				"always-use-floating-controls",
-				G_SETTINGS_BIND_GET );
-	g_settings_bind(	settings,
-				"dark-theme-enable",
-				gtk_settings_get_default(),
-				"gtk-application-prefer-dark-theme",
-				G_SETTINGS_BIND_GET );
+	if(view)
+	{
+		g_settings_bind(	settings,
+					"always-use-floating-controls",
+					gmpv_view_get_main_window(view),
+					"always-use-floating-controls",
+					G_SETTINGS_BIND_GET );
+		g_settings_bind(	settings,
+					"dark-theme-enable",
+					gtk_settings_get_default(),
+					"gtk-application-prefer-dark-theme",
+					G_SETTINGS_BIND_GET );
+	}
 
 	g_object_unref(settings);
 }
@@ -165,6 +282,73 @@ static void create_dirs()
 	g_free(watch_dir);
 }
 
+static void restore_session(GmpvController *controller)
+{
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	GmpvSession *session = NULL;
+	GError *error = NULL;
+
+	if(settings->restore_session)
+	{
+		session = gmpv_session_load(&error);
+	}
+
+	if(session && session->playlist->len > 0)
+	{
+		GmpvModel *model = gmpv_controller_get_model(controller);
+
+		gmpv_model_restore_session(model, session);
+	}
+
+	if(error)
+	{
+		g_warning("Failed to load session: %s", error->message);
+		g_error_free(error);
+	}
+
+	gmpv_session_free(session);
+}
+
+/* The oldest remaining window is the one whose session is saved */
+static void save_session(GmpvApplication *app)
+{
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	GSList *last = g_slist_last(app->controllers);
+
+	if(last && !app->headless && settings->restore_session)
+	{
+		GmpvModel *model = gmpv_controller_get_model(last->data);
+		guint64 version = gmpv_model_get_playlist_version(model);
+		GmpvSession *session = NULL;
+		GError *error = NULL;
+
+		/* Copying the playlist costs as much as it is long, so it is
+		 * skipped if it did not change since it was last saved.
+		 */
+		session =	gmpv_model_get_session
+				(model, version != app->session_version);
+
+		if(gmpv_session_save(session, &error))
+		{
+			app->session_version = version;
+		}
+		else
+		{
+			g_warning("Failed to save session: %s", error->message);
+			g_error_free(error);
+		}
+
+		gmpv_session_free(session);
+	}
+}
+
+static gboolean save_session_handler(gpointer data)
+{
+	save_session(data);
+
+	return G_SOURCE_CONTINUE;
+}
+
 static gboolean shutdown_signal_handler(gpointer data)
 {
 	g_info("Shutdown signal received. Shutting down...");
@@ -197,35 +381,61 @@ static void open_handler(	GApplication *gapp,
 				gpointer data )
 {
 	GmpvApplication *app = data;
-	GSettings *settings = g_settings_new(CONFIG_ROOT);
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
 
 	/* Only activate new-window if always-open-new-window is set. It is not
 	 * necessary to handle --new-window here since options_handler() would
 	 * have activated new-window already if it were set.
 	 */
-	if(g_settings_get_boolean(settings, "always-open-new-window"))
+	if(!app->headless && settings->always_open_new_window)
 	{
 		activate_action_string(G_ACTION_MAP(gapp), "new-window");
 	}
 
+	app->opening = (n_files > 0);
 	g_application_activate(gapp);
+	app->opening = FALSE;
 
-	for(gint i = 0; i < n_files; i++)
+	/* Open all files at once so that they are added to the playlist in a
+	 * single step.
+	 */
+	if(n_files > 0)
 	{
-		GtkApplication *gtkapp = GTK_APPLICATION(gapp);
-		GtkWindow *window = gtk_application_get_active_window(gtkapp);
-		GActionMap *map = G_ACTION_MAP(window);
-		gchar *uri = g_file_get_uri(((GFile **)files)[i]);
-		gboolean append = i != 0 || app->enqueue;
-		GVariant *param = g_variant_new("(sb)", uri, append);
-		GAction *action = g_action_map_lookup_action(map, "open");
+		gchar **uris = g_new0(gchar *, (gsize)n_files + 1);
 
-		g_action_activate(action, param);
+		for(gint i = 0; i < n_files; i++)
+		{
+			uris[i] = g_file_get_uri(files[i]);
+		}
 
-		g_free(uri);
-	}
+		/* There are no windows, and therefore no window actions, in
+		 * headless mode, so let the controller open the files
+		 * directly.
+		 */
+		if(app->headless)
+		{
+			gmpv_controller_open_files(	app->controllers->data,
+							(const gchar **)uris,
+							app->enqueue );
+		}
+		else
+		{
+			GtkApplication *gtkapp = GTK_APPLICATION(gapp);
+			GtkWindow *window =	gtk_application_get_active_window
+						(gtkapp);
+			GActionMap *map = G_ACTION_MAP(window);
+			GVariant *param =	g_variant_new
+						(	"(^asb)",
+							uris,
+							app->enqueue );
+			GAction *action =	g_action_map_lookup_action
+						(map, "open-list");
+
+			g_action_activate(action, param);
+		}
 
-	g_object_unref(settings);
+		g_strfreev(uris);
+	}
 }
 
 static gint options_handler(	GApplication *gapp,
@@ -257,6 +467,16 @@ static gint options_handler(	GApplication *gapp,
 			g_application_set_flags
 				(gapp, flags|G_APPLICATION_NON_UNIQUE);
 		}
+
+		g_variant_dict_lookup(	options,
+					"headless",
+					"b",
+					&GMPV_APPLICATION(gapp)->headless );
+
+		if(GMPV_APPLICATION(gapp)->headless)
+		{
+			g_info("Running in headless mode");
+		}
 	}
 
 	return version?0:-1;
@@ -270,15 +490,14 @@ static gint command_line_handler(	GApplication *gapp,
 	gint argc = 1;
 	gchar **argv = g_application_command_line_get_arguments(cli, &argc);
 	GVariantDict *options = g_application_command_line_get_options_dict(cli);
-	GSettings *settings = g_settings_new(CONFIG_ROOT);
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
 	gboolean always_open_new_window = FALSE;
 	const gint n_files = argc-1;
 	GFile *files[n_files];
 
 	app->enqueue = FALSE;
 	app->new_window = FALSE;
-	always_open_new_window =	g_settings_get_boolean
-					(settings, "always-open-new-window");
+	always_open_new_window = settings->always_open_new_window;
 
 	g_variant_dict_lookup(options, "enqueue", "b", &app->enqueue);
 	g_variant_dict_lookup(options, "new-window", "b", &app->new_window);
@@ -295,7 +514,10 @@ static gint command_line_handler(	GApplication *gapp,
 	 * opening files from file managers, files to be opened may be sent in
 	 * the form of DBus message, bypassing this function entirely.
 	 */
-	if(app->new_window || (n_files == 0 && always_open_new_window))
+	app->opening = (n_files > 0);
+
+	if(	!app->headless &&
+		(app->new_window || (n_files == 0 && always_open_new_window)) )
 	{
 		activate_action_string(G_ACTION_MAP(gapp), "new-window");
 	}
@@ -304,6 +526,8 @@ static gint command_line_handler(	GApplication *gapp,
 		g_application_activate(gapp);
 	}
 
+	app->opening = FALSE;
+
 	if(n_files > 0)
 	{
 		g_application_open
@@ -315,9 +539,11 @@ static gint command_line_handler(	GApplication *gapp,
 		g_object_unref(files[i]);
 	}
 
-	gdk_notify_startup_complete();
+	if(!app->headless)
+	{
+		gdk_notify_startup_complete();
+	}
 
-	g_object_unref(settings);
 	g_strfreev(argv);
 
 	return 0;
@@ -327,7 +553,11 @@ static void startup_handler(GApplication *gapp, gpointer data)
 {
 	setlocale(LC_NUMERIC, "C");
 	g_set_application_name(_("GNOME MPV"));
-	gtk_window_set_default_icon_name(ICON_NAME);
+
+	if(!GMPV_APPLICATION(gapp)->headless)
+	{
+		gtk_window_set_default_icon_name(ICON_NAME);
+	}
 
 	bindtextdomain(GETTEXT_PACKAGE, PACKAGE_LOCALEDIR);
 	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
@@ -345,6 +575,12 @@ static void idle_handler(	GObject *object,
 	GmpvController *controller = NULL;
 	gboolean idle = TRUE;
 
+	/* Without a window, there is no session to inhibit */
+	if(app->headless)
+	{
+		return;
+	}
+
 	for(	GSList *iter = app->controllers;
 		iter && idle;
 		iter = g_slist_next(iter) )
@@ -381,17 +617,35 @@ static void shutdown_handler(GmpvController *controller, gpointer data)
 {
 	GmpvApplication *app = data;
 
+	/* Save the session while the last window still has its state */
+	if(app->controllers && !app->controllers->next)
+	{
+		save_session(app);
+	}
+
 	app->controllers = g_slist_remove(app->controllers, controller);
 	g_object_unref(controller);
 
 	if(!app->controllers)
 	{
+		if(app->session_source_id > 0)
+		{
+			g_source_remove(app->session_source_id);
+			app->session_source_id = 0;
+		}
+
 		gmpv_application_quit(data);
 	}
 }
 
 static void gmpv_application_class_init(GmpvApplicationClass *klass)
 {
+	GApplicationClass *app_class = G_APPLICATION_CLASS(klass);
+
+	app_class->startup = startup;
+	app_class->shutdown = shutdown;
+	app_class->before_emit = before_emit;
+	app_class->after_emit = after_emit;
 }
 
 static void gmpv_application_init(GmpvApplication *app)
@@ -401,7 +655,11 @@ static void gmpv_application_init(GmpvApplication *app)
 	app->controllers = NULL;
 	app->enqueue = FALSE;
 	app->new_window = FALSE;
+	app->headless = FALSE;
+	app->opening = FALSE;
 	app->inhibit_cookie = 0;
+	app->session_source_id = 0;
+	app->session_version = 0;
 
 	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(new_window));
 
@@ -429,6 +687,14 @@ static void gmpv_application_init(GmpvApplication *app)
 			G_OPTION_ARG_NONE,
 			_("Create a new window"),
 			NULL );
+	g_application_add_main_option
+		(	G_APPLICATION(app),
+			"headless",
+			'\0',
+			G_OPTION_FLAG_NONE,
+			G_OPTION_ARG_NONE,
+			_("Play without creating a window"),
+			NULL );
 	g_application_add_main_option
 		(	G_APPLICATION(app),
 			"no-existing-session",
@@ -465,3 +731,8 @@ void gmpv_application_quit(GmpvApplication *app)
 	g_application_quit(G_APPLICATION(app));
 }
 
+gboolean gmpv_application_get_headless(GmpvApplication *app)
+{
+	return app->headless;
+}
+
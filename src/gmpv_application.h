@@ -33,6 +33,7 @@ G_DECLARE_FINAL_TYPE(GmpvApplication, gmpv_application, GMPV, APPLICATION, GtkAp
 
 GmpvApplication *gmpv_application_new(gchar *id, GApplicationFlags flags);
 void gmpv_application_quit(GmpvApplication *app);
+gboolean gmpv_application_get_headless(GmpvApplication *app);
 
 G_END_DECLS
 
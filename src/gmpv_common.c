@@ -31,25 +31,67 @@
 #include "gmpv_main_window.h"
 #include "gmpv_control_box.h"
 
+G_DEFINE_BOXED_TYPE(	GmpvPlaylistEntry,
+			gmpv_playlist_entry,
+			gmpv_playlist_entry_ref,
+			gmpv_playlist_entry_unref )
+
 GmpvPlaylistEntry *gmpv_playlist_entry_new(	const gchar *filename,
 						const gchar *title )
 {
-	GmpvPlaylistEntry *entry = g_malloc(sizeof(GmpvPlaylistEntry));
+	/* Large playlists can contain hundreds of thousands of entries, so
+	 * allocate the strings together with the entry to avoid the overhead
+	 * of separate allocations. The metadata array is only created when it
+	 * is needed. With typical music library paths, this brings an entry
+	 * from about 176 to 128 bytes of heap, of which the path itself is
+	 * about 67.
+	 */
+	gsize filename_size = filename?strlen(filename)+1:0;
+	gsize title_size = title?strlen(title)+1:0;
+	GmpvPlaylistEntry *entry =	g_malloc
+					(	sizeof(GmpvPlaylistEntry)+
+						filename_size+
+						title_size );
+	gchar *strings = (gchar *)(entry+1);
+
+	entry->ref_count =	1;
+	entry->filename =	filename?
+				memcpy(strings, filename, filename_size):
+				NULL;
+	entry->title =		title?
+				memcpy(strings+filename_size, title, title_size):
+				NULL;
+	entry->duration =	0.0;
+	entry->metadata =	NULL;
 
-	entry->filename =	g_strdup(filename);
-	entry->title =		g_strdup(title);
-	entry->metadata =	g_ptr_array_new_with_free_func
-				((GDestroyNotify)gmpv_metadata_entry_free);
+	return entry;
+}
+
+GmpvPlaylistEntry *gmpv_playlist_entry_ref(GmpvPlaylistEntry *entry)
+{
+	g_atomic_int_inc(&entry->ref_count);
 
 	return entry;
 }
 
-void gmpv_playlist_entry_free(GmpvPlaylistEntry *entry)
+void gmpv_playlist_entry_unref(GmpvPlaylistEntry *entry)
 {
-	g_free(entry->filename);
-	g_free(entry->title);
-	g_ptr_array_free(entry->metadata, TRUE);
-	g_free(entry);
+	if(entry && g_atomic_int_dec_and_test(&entry->ref_count))
+	{
+		if(entry->metadata)
+		{
+			g_ptr_array_free(entry->metadata, TRUE);
+		}
+
+		g_free(entry);
+	}
+}
+
+GPtrArray *gmpv_playlist_new(guint reserved_size)
+{
+	return	g_ptr_array_new_full
+		(	reserved_size,
+			(GDestroyNotify)gmpv_playlist_entry_unref );
 }
 
 GmpvMetadataEntry *gmpv_metadata_entry_new(const gchar *key, const gchar *value)
@@ -141,27 +183,25 @@ gchar *get_name_from_path(const gchar *path)
 	return basename?basename:g_strdup(path);
 }
 
-gboolean extension_matches(const gchar *filename, const gchar **extensions)
+GFile *get_local_folder(const gchar *uri)
 {
-	const gchar *ext = strrchr(filename, '.');
-	gboolean result = FALSE;
+	GFile *file = g_file_new_for_commandline_arg(uri);
+	GFileType type = G_FILE_TYPE_UNKNOWN;
 
-	/* Only start checking the extension if there is at
-	 * least one character after the dot.
+	/* Remote folders are left to mpv, since even checking their type may
+	 * block.
 	 */
-	if(ext && ++ext)
+	if(g_file_is_native(file))
 	{
-		const gchar **iter = extensions;
-
-		/* Check if the file extension matches one of the
-		 * supported subtitle formats.
-		 */
-		while(*iter && g_strcmp0(ext, *(iter++)) != 0);
+		type = g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE, NULL);
+	}
 
-		result = !!(*iter);
+	if(type != G_FILE_TYPE_DIRECTORY)
+	{
+		g_clear_object(&file);
 	}
 
-	return result;
+	return file;
 }
 
 void *gslist_to_array(GSList *slist)
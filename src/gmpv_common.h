@@ -25,6 +25,8 @@
 
 G_BEGIN_DECLS
 
+#define GMPV_TYPE_PLAYLIST_ENTRY (gmpv_playlist_entry_get_type())
+
 typedef struct _GmpvPlaylistEntry GmpvPlaylistEntry;
 typedef struct _GmpvMetadataEntry GmpvMetadataEntry;
 
@@ -40,10 +42,18 @@ enum TrackType
 	TRACK_TYPE_N
 };
 
+/* Playlist entries are immutable once created and shared by reference
+ * between the player, the model, the playlist widget and MPRIS. Arrays of
+ * entries published by the player are never modified either, so a new
+ * version of the playlist only costs an array of pointers.
+ *
+ * The strings are stored in the same allocation as the entry itself.
+ */
 struct _GmpvPlaylistEntry
 {
-	gchar *filename;
-	gchar *title;
+	gint ref_count;
+	const gchar *filename;
+	const gchar *title;
 	gdouble duration;
 	GPtrArray *metadata;
 };
@@ -62,9 +72,12 @@ struct GmpvTrack
 	gchar *lang;
 };
 
+GType gmpv_playlist_entry_get_type(void);
 GmpvPlaylistEntry *gmpv_playlist_entry_new(	const gchar *filename,
 						const gchar *title );
-void gmpv_playlist_entry_free(GmpvPlaylistEntry *entry);
+GmpvPlaylistEntry *gmpv_playlist_entry_ref(GmpvPlaylistEntry *entry);
+void gmpv_playlist_entry_unref(GmpvPlaylistEntry *entry);
+GPtrArray *gmpv_playlist_new(guint reserved_size);
 
 GmpvMetadataEntry *gmpv_metadata_entry_new(	const gchar *key,
 						const gchar *value );
@@ -78,7 +91,7 @@ gchar *get_scripts_dir_path(void);
 gchar *get_watch_dir_path(void);
 gchar *get_path_from_uri(const gchar *uri);
 gchar *get_name_from_path(const gchar *path);
-gboolean extension_matches(const gchar *filename, const gchar **extensions);
+GFile *get_local_folder(const gchar *uri);
 void *gslist_to_array(GSList *slist);
 gchar *strnjoinv(const gchar *separator, const gchar **str_array, gsize count);
 void activate_action_string(GActionMap *map, const gchar *str);
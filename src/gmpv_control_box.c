@@ -532,6 +532,12 @@ void gmpv_control_box_set_seek_bar_duration(GmpvControlBox *box, gint duration)
 	gmpv_seek_bar_set_duration(GMPV_SEEK_BAR(box->seek_bar), duration);
 }
 
+void gmpv_control_box_set_seek_bar_waveform(	GmpvControlBox *box,
+						GBytes *waveform )
+{
+	gmpv_seek_bar_set_waveform(GMPV_SEEK_BAR(box->seek_bar), waveform);
+}
+
 void gmpv_control_box_set_volume(GmpvControlBox *box, gdouble volume)
 {
 	g_signal_handlers_block_by_func(box, volume_changed_handler, box);
@@ -573,6 +579,7 @@ void gmpv_control_box_reset(GmpvControlBox *box)
 {
 	gmpv_control_box_set_seek_bar_pos(box, 0);
 	gmpv_control_box_set_seek_bar_duration(box, 0);
+	gmpv_control_box_set_seek_bar_waveform(box, NULL);
 	set_playing_state(box, FALSE);
 	set_chapter_enabled(box, FALSE);
 	gmpv_control_box_set_fullscreen_state(box, FALSE);
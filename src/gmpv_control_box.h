@@ -34,6 +34,8 @@ GtkWidget *gmpv_control_box_new(void);
 void gmpv_control_box_set_enabled(GmpvControlBox *box, gboolean enabled);
 void gmpv_control_box_set_seek_bar_pos(GmpvControlBox *box, gdouble pos);
 void gmpv_control_box_set_seek_bar_duration(GmpvControlBox *box, gint duration);
+void gmpv_control_box_set_seek_bar_waveform(	GmpvControlBox *box,
+						GBytes *waveform );
 void gmpv_control_box_set_volume(GmpvControlBox *box, gdouble volume);
 gdouble gmpv_control_box_get_volume(GmpvControlBox *box);
 gboolean gmpv_control_box_get_volume_popup_visible(GmpvControlBox *box);
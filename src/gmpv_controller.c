@@ -67,12 +67,17 @@ static void playlist_item_activated_handler(	GmpvView *view,
 static void playlist_item_deleted_handler(	GmpvView *view,
 						gint pos,
 						gpointer data );
-static void playlist_reordered_handler(	GmpvView *view,
-					gint src,
-					gint dst,
-					gpointer data );
+static void playlist_items_deleted_handler(	GmpvView *view,
+						GArray *indices,
+						gpointer data );
+static void playlist_items_moved_handler(	GmpvView *view,
+						GArray *indices,
+						gint dest,
+						gpointer data );
 static void connect_signals(GmpvController *controller);
+static void connect_view_signals(GmpvController *controller);
 static gboolean update_seek_bar(gpointer data);
+static void update_playlist_duration(GmpvController *controller);
 static gboolean is_more_than_one(	GBinding *binding,
 					const GValue *from_value,
 					GValue *to_value,
@@ -86,11 +91,16 @@ static void playlist_handler(		GObject *object,
 static void vid_handler(		GObject *object,
 					GParamSpec *pspec,
 					gpointer data);
+static void path_handler(		GObject *object,
+					GParamSpec *pspec,
+					gpointer data);
+static void waveform_ready_handler(	GmpvWaveformService *service,
+					const gchar *uri,
+					gpointer data );
 static void model_ready_handler(	GObject *object,
 					GParamSpec *pspec,
 					gpointer data );
 static void frame_ready_handler(GmpvModel *model, gpointer data);
-static void metadata_update_handler(GmpvModel *model, gint64 pos, gpointer data);
 static void window_resize_handler(	GmpvModel *model,
 					gint64 width,
 					gint64 height,
@@ -107,6 +117,9 @@ static void shutdown_handler(GmpvMpv *mpv, gpointer data);
 static void fullscreen_handler(		GObject *object,
 					GParamSpec *pspec,
 					gpointer data );
+static void window_visible_handler(	GObject *object,
+					GParamSpec *pspec,
+					gpointer data );
 static void play_button_handler(GtkButton *button, gpointer data);
 static void stop_button_handler(GtkButton *button, gpointer data);
 static void forward_button_handler(GtkButton *button, gpointer data);
@@ -128,18 +141,35 @@ static void constructed(GObject *object)
 	gint64 wid;
 
 	controller = GMPV_CONTROLLER(object);
-	always_floating =	g_settings_get_boolean
-				(	controller->settings,
-					"always-use-floating-controls" );
 
-	controller->view = gmpv_view_new(controller->app, always_floating);
-	window = gmpv_view_get_main_window(controller->view);
-	wid = gmpv_video_area_get_xid(gmpv_main_window_get_video_area(window));
-	controller->model = gmpv_model_new(wid);
+	if(controller->headless)
+	{
+		/* Without a window, there is nothing to embed the video in.
+		 * A wid of 0 makes mpv use the null video output.
+		 */
+		controller->model = gmpv_model_new(0);
 
-	connect_signals(controller);
-	gmpv_controller_action_register_actions(controller);
-	gmpv_controller_input_connect_signals(controller);
+		connect_signals(controller);
+		gmpv_model_initialize(controller->model);
+	}
+	else
+	{
+		always_floating =	g_settings_get_boolean
+					(	controller->settings,
+						"always-use-floating-controls" );
+
+		controller->view =	gmpv_view_new
+					(controller->app, always_floating);
+		window = gmpv_view_get_main_window(controller->view);
+		wid =	gmpv_video_area_get_xid
+			(gmpv_main_window_get_video_area(window));
+		controller->model = gmpv_model_new(wid);
+
+		connect_signals(controller);
+		connect_view_signals(controller);
+		gmpv_controller_action_register_actions(controller);
+		gmpv_controller_input_connect_signals(controller);
+	}
 
 	g_signal_connect(	controller->settings,
 				"changed::mpris-enable",
@@ -155,7 +185,9 @@ static void constructed(GObject *object)
 		controller->mpris = gmpv_mpris_new(controller);
 	}
 
-	if(g_settings_get_boolean(controller->settings, "media-keys-enable"))
+	/* Media keys are only grabbed while the window is focused */
+	if(	controller->view &&
+		g_settings_get_boolean(controller->settings, "media-keys-enable") )
 	{
 		controller->media_keys = gmpv_media_keys_new(controller);
 	}
@@ -176,6 +208,10 @@ static void set_property(	GObject *object,
 		self->app = g_value_get_pointer(value);
 		break;
 
+		case PROP_HEADLESS:
+		self->headless = g_value_get_boolean(value);
+		break;
+
 		case PROP_READY:
 		self->ready = g_value_get_boolean(value);
 		break;
@@ -203,6 +239,10 @@ static void get_property(	GObject *object,
 		g_value_set_pointer(value, self->app);
 		break;
 
+		case PROP_HEADLESS:
+		g_value_set_boolean(value, self->headless);
+		break;
+
 		case PROP_READY:
 		g_value_set_boolean(value, self->ready);
 		break;
@@ -225,6 +265,13 @@ static void dispose(GObject *object)
 	g_clear_object(&controller->mpris);
 	g_clear_object(&controller->media_keys);
 
+	if(controller->waveform_service)
+	{
+		g_signal_handlers_disconnect_by_data
+			(controller->waveform_service, controller);
+		g_clear_object(&controller->waveform_service);
+	}
+
 	if(controller->update_seekbar_id != 0)
 	{
 		g_source_remove(controller->update_seekbar_id);
@@ -237,6 +284,10 @@ static void dispose(GObject *object)
 		g_clear_object(&controller->model);
 		g_clear_object(&controller->view);
 	}
+	else
+	{
+		g_clear_object(&controller->model);
+	}
 
 	G_OBJECT_CLASS(gmpv_controller_parent_class)->dispose(object);
 }
@@ -263,6 +314,11 @@ static void media_keys_enable_handler(	GSettings *settings,
 {
 	GmpvController *controller = data;
 
+	if(!controller->view)
+	{
+		return;
+	}
+
 	if(!controller->media_keys && g_settings_get_boolean(settings, key))
 	{
 		controller->media_keys = gmpv_media_keys_new(controller);
@@ -292,7 +348,7 @@ static void render_handler(GmpvView *view, gpointer data)
 
 static void preferences_updated_handler(GmpvView *view, gpointer data)
 {
-	gmpv_model_reset(GMPV_CONTROLLER(data)->model);
+	gmpv_model_apply_settings(GMPV_CONTROLLER(data)->model);
 }
 
 static void audio_track_load_handler(	GmpvView *view,
@@ -314,11 +370,9 @@ static void file_open_handler(	GmpvView *view,
 				gboolean append,
 				gpointer data )
 {
-	for(const gchar **iter = uri_list; iter && *iter; iter++)
+	if(uri_list)
 	{
-		gmpv_model_load_file(	GMPV_CONTROLLER(data)->model,
-					*iter,
-					append || iter != uri_list );
+		gmpv_controller_open_files(data, uri_list, append);
 	}
 }
 
@@ -362,12 +416,20 @@ static void playlist_item_deleted_handler(	GmpvView *view,
 	gmpv_model_remove_playlist_entry(GMPV_CONTROLLER(data)->model, pos);
 }
 
-static void playlist_reordered_handler(	GmpvView *view,
-					gint src,
-					gint dst,
-					gpointer data )
+static void playlist_items_deleted_handler(	GmpvView *view,
+						GArray *indices,
+						gpointer data )
+{
+	gmpv_model_remove_playlist_entries(GMPV_CONTROLLER(data)->model, indices);
+}
+
+static void playlist_items_moved_handler(	GmpvView *view,
+						GArray *indices,
+						gint dest,
+						gpointer data )
 {
-	gmpv_model_move_playlist_entry(GMPV_CONTROLLER(data)->model, src, dst);
+	gmpv_model_move_playlist_entries
+		(GMPV_CONTROLLER(data)->model, indices, (guint)dest);
 }
 
 static void connect_signals(GmpvController *controller)
@@ -375,6 +437,31 @@ static void connect_signals(GmpvController *controller)
 	g_object_bind_property(	controller->model, "core-idle",
 				controller, "idle",
 				G_BINDING_DEFAULT );
+
+	g_signal_connect(	controller->model,
+				"notify::ready",
+				G_CALLBACK(model_ready_handler),
+				controller );
+	g_signal_connect(	controller->model,
+				"notify::idle-active",
+				G_CALLBACK(idle_active_handler),
+				controller );
+	g_signal_connect(	controller->model,
+				"message",
+				G_CALLBACK(message_handler),
+				controller );
+	g_signal_connect(	controller->model,
+				"error",
+				G_CALLBACK(error_handler),
+				controller );
+	g_signal_connect(	controller->model,
+				"shutdown",
+				G_CALLBACK(shutdown_handler),
+				controller );
+}
+
+static void connect_view_signals(GmpvController *controller)
+{
 	g_object_bind_property(	controller->model, "pause",
 				controller->view, "pause",
 				G_BINDING_DEFAULT );
@@ -401,14 +488,6 @@ static void connect_signals(GmpvController *controller)
 					NULL,
 					NULL );
 
-	g_signal_connect(	controller->model,
-				"notify::ready",
-				G_CALLBACK(model_ready_handler),
-				controller );
-	g_signal_connect(	controller->model,
-				"notify::idle-active",
-				G_CALLBACK(idle_active_handler),
-				controller );
 	g_signal_connect(	controller->model,
 				"notify::playlist",
 				G_CALLBACK(playlist_handler),
@@ -418,12 +497,12 @@ static void connect_signals(GmpvController *controller)
 				G_CALLBACK(vid_handler),
 				controller );
 	g_signal_connect(	controller->model,
-				"frame-ready",
-				G_CALLBACK(frame_ready_handler),
+				"notify::path",
+				G_CALLBACK(path_handler),
 				controller );
 	g_signal_connect(	controller->model,
-				"metadata-update",
-				G_CALLBACK(metadata_update_handler),
+				"frame-ready",
+				G_CALLBACK(frame_ready_handler),
 				controller );
 	g_signal_connect(	controller->model,
 				"window-resize",
@@ -433,23 +512,15 @@ static void connect_signals(GmpvController *controller)
 				"window-move",
 				G_CALLBACK(window_move_handler),
 				controller );
-	g_signal_connect(	controller->model,
-				"message",
-				G_CALLBACK(message_handler),
-				controller );
-	g_signal_connect(	controller->model,
-				"error",
-				G_CALLBACK(error_handler),
-				controller );
-	g_signal_connect(	controller->model,
-				"shutdown",
-				G_CALLBACK(shutdown_handler),
-				controller );
 
 	g_signal_connect(	controller->view,
 				"notify::fullscreen",
 				G_CALLBACK(fullscreen_handler),
 				controller );
+	g_signal_connect(	controller->view,
+				"notify::window-visible",
+				G_CALLBACK(window_visible_handler),
+				controller );
 	g_signal_connect(	controller->view,
 				"button-clicked::play",
 				G_CALLBACK(play_button_handler),
@@ -524,8 +595,12 @@ static void connect_signals(GmpvController *controller)
 				G_CALLBACK(playlist_item_deleted_handler),
 				controller );
 	g_signal_connect(	controller->view,
-				"playlist-reordered",
-				G_CALLBACK(playlist_reordered_handler),
+				"playlist-items-deleted",
+				G_CALLBACK(playlist_items_deleted_handler),
+				controller );
+	g_signal_connect(	controller->view,
+				"playlist-items-moved",
+				G_CALLBACK(playlist_items_moved_handler),
 				controller );
 
 	controller->update_seekbar_id
@@ -540,10 +615,25 @@ gboolean update_seek_bar(gpointer data)
 	gdouble time_pos = gmpv_model_get_time_position(controller->model);
 
 	gmpv_view_set_time_position(controller->view, time_pos);
+	update_playlist_duration(controller);
 
 	return TRUE;
 }
 
+static void update_playlist_duration(GmpvController *controller)
+{
+	gboolean complete = FALSE;
+	gdouble duration = 0;
+	gdouble position = 0;
+
+	duration =	gmpv_model_get_playlist_duration
+			(controller->model, &complete);
+	position = gmpv_model_get_playlist_time_position(controller->model);
+
+	gmpv_view_set_playlist_duration
+		(controller->view, duration, position, complete);
+}
+
 static gboolean is_more_than_one(	GBinding *binding,
 					const GValue *from_value,
 					GValue *to_value,
@@ -565,11 +655,11 @@ static void idle_active_handler(	GObject *object,
 
 	g_object_get(object, "idle-active", &idle_active, NULL);
 
-	if(idle_active)
+	if(idle_active && controller->view)
 	{
-		gmpv_view_reset(GMPV_CONTROLLER(data)->view);
+		gmpv_view_reset(controller->view);
 	}
-	else if(controller->target_playlist_pos >= 0)
+	else if(!idle_active && controller->target_playlist_pos >= 0)
 	{
 		gmpv_model_set_playlist_position
 			(controller->model, controller->target_playlist_pos);
@@ -580,7 +670,8 @@ static void playlist_handler(	GObject *object,
 				GParamSpec *pspec,
 				gpointer data )
 {
-	GmpvView *view = GMPV_CONTROLLER(data)->view;
+	GmpvController *controller = data;
+	GmpvView *view = controller->view;
 	GPtrArray *playlist = NULL;
 	gint64 pos = 0;
 
@@ -591,6 +682,7 @@ static void playlist_handler(	GObject *object,
 
 	gmpv_view_update_playlist(view, playlist);
 	gmpv_view_set_playlist_pos(view, pos);
+	update_playlist_duration(controller);
 }
 
 static void vid_handler(	GObject *object,
@@ -611,6 +703,72 @@ static void vid_handler(	GObject *object,
 	g_free(vid_str);
 }
 
+/* Waveforms take a full decode of the audio to build, so they are only
+ * requested for the file that is playing.
+ */
+static void path_handler(	GObject *object,
+				GParamSpec *pspec,
+				gpointer data )
+{
+	GmpvController *controller = data;
+	GBytes *waveform = NULL;
+	gchar *path = NULL;
+
+	g_object_get(object, "path", &path, NULL);
+
+	if(	path &&
+		g_settings_get_boolean(controller->settings, "seek-bar-waveform") )
+	{
+		if(!controller->waveform_service)
+		{
+			controller->waveform_service =	gmpv_waveform_service_get_default();
+
+			g_signal_connect(	controller->waveform_service,
+						"ready",
+						G_CALLBACK(waveform_ready_handler),
+						controller );
+		}
+
+		gmpv_waveform_service_request
+			(controller->waveform_service, path);
+		waveform =	gmpv_waveform_service_lookup
+				(controller->waveform_service, path);
+	}
+
+	gmpv_view_set_waveform(controller->view, waveform);
+
+	if(waveform)
+	{
+		g_bytes_unref(waveform);
+	}
+
+	g_free(path);
+}
+
+static void waveform_ready_handler(	GmpvWaveformService *service,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvController *controller = data;
+	gchar *path = NULL;
+
+	g_object_get(controller->model, "path", &path, NULL);
+
+	if(g_strcmp0(uri, path) == 0)
+	{
+		GBytes *waveform = gmpv_waveform_service_lookup(service, uri);
+
+		gmpv_view_set_waveform(controller->view, waveform);
+
+		if(waveform)
+		{
+			g_bytes_unref(waveform);
+		}
+	}
+
+	g_free(path);
+}
+
 static void model_ready_handler(	GObject *object,
 					GParamSpec *pspec,
 					gpointer data )
@@ -620,7 +778,7 @@ static void model_ready_handler(	GObject *object,
 
 	g_object_get(object, "ready", &ready, NULL);
 
-	if(ready)
+	if(ready && controller->view)
 	{
 		gboolean use_opengl_cb;
 
@@ -644,15 +802,6 @@ static void frame_ready_handler(GmpvModel *model, gpointer data)
 	gmpv_view_queue_render(GMPV_CONTROLLER(data)->view);
 }
 
-static void metadata_update_handler(GmpvModel *model, gint64 pos, gpointer data)
-{
-	GmpvView *view = GMPV_CONTROLLER(data)->view;
-	GPtrArray *playlist = NULL;
-
-	g_object_get(G_OBJECT(model), "playlist", &playlist, NULL);
-	gmpv_view_update_playlist(view, playlist);
-}
-
 static void window_resize_handler(	GmpvModel *model,
 					gint64 width,
 					gint64 height,
@@ -685,7 +834,7 @@ static void message_handler(GmpvMpv *mpv, const gchar *message, gpointer data)
 		GmpvView *view = controller->view;
 		GActionMap *map = NULL;
 
-		if(g_str_has_prefix(action, "win."))
+		if(g_str_has_prefix(action, "win.") && view)
 		{
 			map = G_ACTION_MAP(gmpv_view_get_main_window(view));
 		}
@@ -710,11 +859,20 @@ static void message_handler(GmpvMpv *mpv, const gchar *message, gpointer data)
 
 static void error_handler(GmpvMpv *mpv, const gchar *message, gpointer data)
 {
-	gmpv_view_show_message_dialog(	GMPV_CONTROLLER(data)->view,
-					GTK_MESSAGE_ERROR,
-					_("Error"),
-					NULL,
-					message );
+	GmpvView *view = GMPV_CONTROLLER(data)->view;
+
+	if(view)
+	{
+		gmpv_view_show_message_dialog(	view,
+						GTK_MESSAGE_ERROR,
+						_("Error"),
+						NULL,
+						message );
+	}
+	else
+	{
+		g_warning("%s", message);
+	}
 }
 
 static void shutdown_handler(GmpvMpv *mpv, gpointer data)
@@ -744,6 +902,28 @@ static void fullscreen_handler(		GObject *object,
 		(G_SIMPLE_ACTION(toggle_controls), !fullscreen);
 }
 
+static void window_visible_handler(	GObject *object,
+					GParamSpec *pspec,
+					gpointer data )
+{
+	GmpvController *controller = data;
+	gboolean visible = TRUE;
+
+	g_object_get(object, "window-visible", &visible, NULL);
+
+	/* Always allow resuming so that toggling the setting off while the
+	 * window is hidden doesn't leave video disabled.
+	 */
+	if(	!visible &&
+		!g_settings_get_boolean
+		(controller->settings, "suspend-video-when-hidden") )
+	{
+		return;
+	}
+
+	gmpv_model_set_video_suspended(controller->model, !visible);
+}
+
 static void play_button_handler(GtkButton *button, gpointer data)
 {
 	GmpvModel *model = GMPV_CONTROLLER(data)->model;
@@ -817,6 +997,14 @@ static void gmpv_controller_class_init(GmpvControllerClass *klass)
 			G_PARAM_CONSTRUCT_ONLY|G_PARAM_READWRITE );
 	g_object_class_install_property(obj_class, PROP_APP, pspec);
 
+	pspec = g_param_spec_boolean
+		(	"headless",
+			"Headless",
+			"Whether or not to run without a window",
+			FALSE,
+			G_PARAM_CONSTRUCT_ONLY|G_PARAM_READWRITE );
+	g_object_class_install_property(obj_class, PROP_HEADLESS, pspec);
+
 	pspec = g_param_spec_boolean
 		(	"ready",
 			"Ready",
@@ -847,27 +1035,42 @@ static void gmpv_controller_class_init(GmpvControllerClass *klass)
 static void gmpv_controller_init(GmpvController *controller)
 {
 	controller->app = NULL;
+	controller->headless = FALSE;
 	controller->model = NULL;
 	controller->view = NULL;
 	controller->ready = FALSE;
 	controller->idle = TRUE;
 	controller->target_playlist_pos = -1;
 	controller->update_seekbar_id = 0;
+	controller->mouse_tick_id = 0;
+	controller->mouse_motion_pending = FALSE;
+	controller->mouse_x = 0;
+	controller->mouse_y = 0;
 	controller->settings = g_settings_new(CONFIG_ROOT);
 	controller->media_keys = NULL;
 	controller->mpris = NULL;
+	controller->waveform_service = NULL;
 }
 
 GmpvController *gmpv_controller_new(GmpvApplication *app)
 {
 	return GMPV_CONTROLLER(g_object_new(	gmpv_controller_get_type(),
 						"app", app,
+						"headless",
+						gmpv_application_get_headless(app),
 						NULL ));
 }
 
 void gmpv_controller_quit(GmpvController *controller)
 {
-	gmpv_view_quit(controller->view);
+	if(controller->view)
+	{
+		gmpv_view_quit(controller->view);
+	}
+	else
+	{
+		g_signal_emit_by_name(controller, "shutdown");
+	}
 }
 
 void gmpv_controller_autofit(GmpvController *controller, gdouble multiplier)
@@ -876,6 +1079,11 @@ void gmpv_controller_autofit(GmpvController *controller, gdouble multiplier)
 	gint64 width = -1;
 	gint64 height = -1;
 
+	if(!controller->view)
+	{
+		return;
+	}
+
 	g_object_get(G_OBJECT(controller->model), "vid", &vid, NULL);
 	gmpv_model_get_video_geometry(controller->model, &width, &height);
 
@@ -895,7 +1103,10 @@ void gmpv_controller_autofit(GmpvController *controller, gdouble multiplier)
 
 void gmpv_controller_present(GmpvController *controller)
 {
-	gmpv_view_present(controller->view);
+	if(controller->view)
+	{
+		gmpv_view_present(controller->view);
+	}
 }
 
 void gmpv_controller_open(	GmpvController *controller,
@@ -905,6 +1116,13 @@ void gmpv_controller_open(	GmpvController *controller,
 	gmpv_model_load_file(controller->model, uri, append);
 }
 
+void gmpv_controller_open_files(	GmpvController *controller,
+					const gchar **uris,
+					gboolean append )
+{
+	gmpv_model_load_files(controller->model, uris, append);
+}
+
 GmpvView *gmpv_controller_get_view(GmpvController *controller)
 {
 	return controller->view;
@@ -38,6 +38,9 @@ void gmpv_controller_present(GmpvController *controller);
 void gmpv_controller_open(	GmpvController *controller,
 				const gchar *urii,
 				gboolean append );
+void gmpv_controller_open_files(	GmpvController *controller,
+					const gchar **uris,
+					gboolean append );
 GmpvView *gmpv_controller_get_view(GmpvController *controller);
 GmpvModel *gmpv_controller_get_model(GmpvController *controller);
 
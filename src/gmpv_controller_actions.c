@@ -44,6 +44,9 @@ static void bind_properties(GmpvController *controller);
 static void open_handler(	GSimpleAction *action,
 				GVariant *param,
 				gpointer data );
+static void open_list_handler(	GSimpleAction *action,
+				GVariant *param,
+				gpointer data );
 static void show_open_dialog_handler(	GSimpleAction *action,
 					GVariant *param,
 					gpointer data );
@@ -68,6 +71,9 @@ static void save_playlist_handler(	GSimpleAction *action,
 static void shuffle_playlist_handler(	GSimpleAction *action,
 					GVariant *param,
 					gpointer data );
+static void sort_playlist_handler(	GSimpleAction *action,
+					GVariant *param,
+					gpointer data );
 static void remove_selected_playlist_item_handler(	GSimpleAction *action,
 							GVariant *param,
 							gpointer data );
@@ -220,6 +226,19 @@ static void open_handler(	GSimpleAction *action,
 	g_free(uri);
 }
 
+static void open_list_handler(	GSimpleAction *action,
+				GVariant *param,
+				gpointer data )
+{
+	const gchar **uris = NULL;
+	gboolean append = FALSE;
+
+	g_variant_get(param, "(^a&sb)", &uris, &append);
+	gmpv_controller_open_files(data, uris, append);
+
+	g_free(uris);
+}
+
 static void show_open_dialog_handler(	GSimpleAction *action,
 					GVariant *param,
 					gpointer data )
@@ -288,6 +307,23 @@ static void shuffle_playlist_handler(	GSimpleAction *action,
 	gmpv_model_shuffle_playlist(gmpv_controller_get_model(data));
 }
 
+static void sort_playlist_handler(	GSimpleAction *action,
+					GVariant *param,
+					gpointer data )
+{
+	const gchar *name = g_variant_get_string(param, NULL);
+	PlaylistSortField field;
+
+	if(gmpv_playlist_sort_field_from_string(name, &field))
+	{
+		gmpv_model_sort_playlist(gmpv_controller_get_model(data), field);
+	}
+	else
+	{
+		g_warning("Invalid playlist sort field: %s", name);
+	}
+}
+
 static void remove_selected_playlist_item_handler(	GSimpleAction *action,
 							GVariant *param,
 							gpointer data )
@@ -412,6 +448,9 @@ void gmpv_controller_action_register_actions(GmpvController *controller)
 		= {	{.name = "open",
 			.activate = open_handler,
 			.parameter_type = "(sb)"},
+			{.name = "open-list",
+			.activate = open_list_handler,
+			.parameter_type = "(asb)"},
 			{.name = "show-open-dialog",
 			.activate = show_open_dialog_handler,
 			.parameter_type = "b"},
@@ -437,6 +476,9 @@ void gmpv_controller_action_register_actions(GmpvController *controller)
 			.activate = save_playlist_handler},
 			{.name = "shuffle-playlist",
 			.activate = shuffle_playlist_handler},
+			{.name = "sort-playlist",
+			.activate = sort_playlist_handler,
+			.parameter_type = "s"},
 			{.name = "remove-selected-playlist-item",
 			.activate = remove_selected_playlist_item_handler},
 			{.name = "set-audio-track",
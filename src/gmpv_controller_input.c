@@ -32,7 +32,12 @@
 #include "gmpv_video_area.h"
 #include "gmpv_def.h"
 
-static gchar *get_full_keystr(guint keyval, guint state);
+static GtkWidget *get_video_area(GmpvController *controller);
+static GHashTable *get_keyval_map(void);
+static gboolean get_full_keystr(	guint keyval,
+					guint state,
+					gchar *buf,
+					gsize size );
 static gboolean key_press_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data );
@@ -42,6 +47,10 @@ static gboolean key_release_handler(	GtkWidget *widget,
 static gboolean mouse_button_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data );
+static void flush_mouse_motion(GmpvController *controller);
+static gboolean mouse_tick_handler(	GtkWidget *widget,
+					GdkFrameClock *frame_clock,
+					gpointer data );
 static gboolean mouse_move_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data );
@@ -49,52 +58,89 @@ static gboolean scroll_handler(	GtkWidget *widget,
 				GdkEvent *event,
 				gpointer data );
 
-static gchar *get_full_keystr(guint keyval, guint state)
+static GtkWidget *get_video_area(GmpvController *controller)
 {
-	/* strlen("Ctrl+Alt+Shift+Meta+")+1 == 21 */
-	const gsize max_modstr_len = 21;
-	gchar modstr[max_modstr_len];
-	gboolean found = FALSE;
-	const gchar *keystr = gdk_keyval_name(keyval);
-	const gchar *keystrmap[] = KEYSTRING_MAP;
-	modstr[0] = '\0';
+	GmpvMainWindow *wnd = gmpv_view_get_main_window(controller->view);
+
+	return GTK_WIDGET(gmpv_main_window_get_video_area(wnd));
+}
+
+/* Maps GDK keyvals to the names used by mpv. Built once from KEYSTRING_MAP
+ * so that key events only need a hash lookup.
+ */
+static GHashTable *get_keyval_map(void)
+{
+	static gsize initialized = 0;
+	static GHashTable *map = NULL;
+
+	if(g_once_init_enter(&initialized))
+	{
+		const gchar *keystrmap[] = KEYSTRING_MAP;
+
+		map = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+		for(gint i = 0; keystrmap[i]; i += 2)
+		{
+			guint keyval = gdk_keyval_from_name(keystrmap[i+1]);
+			gpointer key = GUINT_TO_POINTER(keyval);
+
+			if(	keyval != GDK_KEY_VoidSymbol &&
+				!g_hash_table_contains(map, key) )
+			{
+				g_hash_table_insert
+					(map, key, (gpointer)keystrmap[i]);
+			}
+		}
+
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return map;
+}
+
+/* Writes the mpv name of the key, with its modifiers, to buf. Returns FALSE
+ * if the key has no name or if the name does not fit in buf.
+ */
+static gboolean get_full_keystr(	guint keyval,
+					guint state,
+					gchar *buf,
+					gsize size )
+{
+	const gchar *keystr =	g_hash_table_lookup
+				(get_keyval_map(), GUINT_TO_POINTER(keyval));
+
+	/* Translate GDK key name to mpv key name */
+	if(!keystr)
+	{
+		keystr = gdk_keyval_name(keyval);
+	}
+
+	buf[0] = '\0';
 
 	if((state&GDK_SHIFT_MASK) != 0)
 	{
-		g_strlcat(modstr, "Shift+", max_modstr_len);
+		g_strlcat(buf, "Shift+", size);
 	}
 
 	if((state&GDK_CONTROL_MASK) != 0)
 	{
-		g_strlcat(modstr, "Ctrl+", max_modstr_len);
+		g_strlcat(buf, "Ctrl+", size);
 	}
 
 	if((state&GDK_MOD1_MASK) != 0)
 	{
-		g_strlcat(modstr, "Alt+", max_modstr_len);
+		g_strlcat(buf, "Alt+", size);
 	}
 
 	/* Super is Meta in mpv */
 	if((state&GDK_SUPER_MASK) != 0)
 	{
-		g_strlcat(modstr, "Meta+", max_modstr_len);
-	}
-
-	/* Translate GDK key name to mpv key name */
-	for(gint i = 0; !found && keystrmap[i]; i += 2)
-	{
-		gint rc = g_ascii_strncasecmp(	keystr,
-						keystrmap[i+1],
-						KEYSTRING_MAX_LEN );
-
-		if(rc == 0)
-		{
-			keystr = keystrmap[i];
-			found = TRUE;
-		}
+		g_strlcat(buf, "Meta+", size);
 	}
 
-	return (strlen(keystr) > 0)?g_strconcat(modstr, keystr, NULL):NULL;
+	return	keystr &&
+		keystr[0] != '\0' &&
+		g_strlcat(buf, keystr, size) < size;
 }
 
 static gboolean key_press_handler(	GtkWidget *widget,
@@ -104,12 +150,11 @@ static gboolean key_press_handler(	GtkWidget *widget,
 	GmpvController *controller = data;
 	guint keyval = ((GdkEventKey*)event)->keyval;
 	guint state = ((GdkEventKey*)event)->state;
-	gchar *keystr = get_full_keystr(keyval, state);
+	gchar keystr[KEYSTRING_BUFFER_SIZE];
 
-	if(keystr)
+	if(get_full_keystr(keyval, state, keystr, sizeof(keystr)))
 	{
 		gmpv_model_key_down(controller->model, keystr);
-		g_free(keystr);
 	}
 
 	return FALSE;
@@ -122,12 +167,11 @@ static gboolean key_release_handler(	GtkWidget *widget,
 	GmpvController *controller = data;
 	guint keyval = ((GdkEventKey*)event)->keyval;
 	guint state = ((GdkEventKey*)event)->state;
-	gchar *keystr = get_full_keystr(keyval, state);
+	gchar keystr[KEYSTRING_BUFFER_SIZE];
 
-	if(keystr)
+	if(get_full_keystr(keyval, state, keystr, sizeof(keystr)))
 	{
 		gmpv_model_key_up(controller->model, keystr);
-		g_free(keystr);
 	}
 
 	return FALSE;
@@ -144,22 +188,61 @@ static gboolean mouse_button_handler(	GtkWidget *widget,
 	|| btn_event->type == GDK_SCROLL)
 	{
 		GmpvController *controller = data;
-		gchar *btn_str =	g_strdup_printf
-					("MOUSE_BTN%u", btn_event->button-1);
+		gchar btn_str[KEYSTRING_BUFFER_SIZE];
 		void (*func)(GmpvModel *, const gchar *)
 			=	(btn_event->type == GDK_SCROLL)?
 				gmpv_model_key_press:
 				(btn_event->type == GDK_BUTTON_PRESS)?
 				gmpv_model_key_down:gmpv_model_key_up;
 
-		func(controller->model, btn_str);
+		g_snprintf(	btn_str,
+				sizeof(btn_str),
+				"MOUSE_BTN%u",
+				btn_event->button-1 );
 
-		g_free(btn_str);
+		/* Make sure that mpv knows where the button was pressed */
+		flush_mouse_motion(controller);
+		func(controller->model, btn_str);
 	}
 
 	return TRUE;
 }
 
+static void flush_mouse_motion(GmpvController *controller)
+{
+	if(controller->mouse_motion_pending && controller->model)
+	{
+		gmpv_model_mouse(	controller->model,
+					controller->mouse_x,
+					controller->mouse_y );
+	}
+
+	controller->mouse_motion_pending = FALSE;
+}
+
+static gboolean mouse_tick_handler(	GtkWidget *widget,
+					GdkFrameClock *frame_clock,
+					gpointer data )
+{
+	GmpvController *controller = data;
+	gboolean pending = controller->mouse_motion_pending;
+
+	flush_mouse_motion(controller);
+
+	/* Keep the callback while the pointer is moving, so that it is not
+	 * added and removed again on every frame.
+	 */
+	if(!pending)
+	{
+		controller->mouse_tick_id = 0;
+	}
+
+	return pending?G_SOURCE_CONTINUE:G_SOURCE_REMOVE;
+}
+
+/* Motion events can arrive much faster than the screen is refreshed, so
+ * only the last position is sent to mpv on each tick of the frame clock.
+ */
 static gboolean mouse_move_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data )
@@ -167,11 +250,20 @@ static gboolean mouse_move_handler(	GtkWidget *widget,
 	GmpvController *controller = data;
 	GdkEventMotion *motion_event = (GdkEventMotion *)event;
 
-	if(controller->model)
+	controller->mouse_x = (gint)motion_event->x;
+	controller->mouse_y = (gint)motion_event->y;
+	controller->mouse_motion_pending = TRUE;
+
+	if(controller->mouse_tick_id == 0)
 	{
-		gmpv_model_mouse(	controller->model,
-					(gint)motion_event->x,
-					(gint)motion_event->y );
+		/* Hold a reference until the callback is removed, which
+		 * happens at the latest when the widget is destroyed.
+		 */
+		controller->mouse_tick_id =	gtk_widget_add_tick_callback
+						(	get_video_area(controller),
+							mouse_tick_handler,
+							g_object_ref(controller),
+							g_object_unref );
 	}
 
 	return FALSE;
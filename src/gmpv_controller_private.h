@@ -22,6 +22,7 @@
 
 #include "gmpv_model.h"
 #include "gmpv_view.h"
+#include "gmpv_waveform_service.h"
 #include "mpris/gmpv_mpris.h"
 #include "media_keys/gmpv_media_keys.h"
 
@@ -31,6 +32,7 @@ enum
 {
 	PROP_0,
 	PROP_APP,
+	PROP_HEADLESS,
 	PROP_READY,
 	PROP_IDLE,
 	N_PROPERTIES
@@ -40,15 +42,21 @@ struct _GmpvController
 {
 	GObject parent;
 	GmpvApplication *app;
+	gboolean headless;
 	GmpvModel *model;
 	GmpvView *view;
 	gboolean ready;
 	gboolean idle;
 	gint64 target_playlist_pos;
 	guint update_seekbar_id;
+	guint mouse_tick_id;
+	gboolean mouse_motion_pending;
+	gint mouse_x;
+	gint mouse_y;
 	GSettings *settings;
 	GmpvMediaKeys *media_keys;
 	GmpvMpris *mpris;
+	GmpvWaveformService *waveform_service;
 };
 
 struct _GmpvControllerClass
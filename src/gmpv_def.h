@@ -35,14 +35,56 @@
 #define MPRIS_OBJ_ROOT_PATH "/org/mpris/MediaPlayer2"
 #define PLAYLIST_DEFAULT_WIDTH 200
 #define PLAYLIST_MIN_WIDTH 20
+#define PLAYLIST_SORT_MOVE_BUDGET (1 << 24)
+#define PLAYLIST_EXPORT_BUFFER_SIZE 65536
+#define PLAYLIST_EXPORT_DIALOG_DELAY 500
+#define FOLDER_IMPORT_MAX_SCANS 4
+#define FOLDER_IMPORT_BATCH_SIZE 128
+#define FOLDER_IMPORT_CHUNK_SIZE 256
+#define RESUME_DB_FILENAME "resume.db"
+#define RESUME_DB_POLL_INTERVAL 1
+#define RESUME_DB_SAVE_INTERVAL 10
+#define RESUME_DB_MIN_POSITION 10
+#define RESUME_DB_END_MARGIN 10
+#define RESUME_DB_COMPACT_MIN_RECORDS 1024
+#define RESUME_DB_COMPACT_RETRY_DELAY 60
+#define SESSION_FILENAME "session"
+#define SESSION_POSITION_FILENAME "session-position"
+#define SESSION_SAVE_INTERVAL 30
+#define PLAYLIST_FEED_CHUNK_SIZE 512
+#define FINGERPRINT_FILENAME "fingerprints"
+#define FINGERPRINT_BLOCK_SIZE 65536
+#define FINGERPRINT_MAX_THREADS 4
+#define FINGERPRINT_SAVE_DELAY 5
+#define LIBRARY_CATALOG_FILENAME "library"
+#define LIBRARY_CATALOG_SAVE_DELAY 10
+#define LIBRARY_CATALOG_RESCAN_DELAY 2
+#define LIBRARY_CATALOG_MAX_MONITORS 4096
+#define LOUDNESS_FILENAME "loudness"
+#define LOUDNESS_FILTER_LABEL "gmpvloudness"
+#define LOUDNESS_ANALYSIS_DELAY 3
+#define LOUDNESS_LOOKAHEAD 3
+#define LOUDNESS_SAVE_DELAY 5
+#define LOUDNESS_TARGET (-18.0)
+#define LOUDNESS_PEAK_LIMIT (-1.0)
+#define LOUDNESS_MAX_GAIN 12.0
+#define WAVEFORM_DIRNAME "waveforms"
+#define WAVEFORM_SAMPLE_RATE 8000
+#define WAVEFORM_BLOCK_SIZE 80
+#define WAVEFORM_BUCKET_COUNT 1024
+#define WAVEFORM_READ_SIZE 65536
+#define WAVEFORM_ALPHA 0.3
 #define CSD_WIDTH_OFFSET 52
 #define CSD_HEIGHT_OFFSET 99
 #define WAYLAND_NOCSD_HEIGHT_OFFSET 60
 #define MAIN_WINDOW_DEFAULT_WIDTH 625
 #define MAIN_WINDOW_DEFAULT_HEIGHT 400
 #define SEEK_BAR_UPDATE_INTERVAL 250
+#define RENDER_STALL_TIMEOUT 1000
+#define MPV_TERMINATE_TIMEOUT 3000
+#define MPV_DETACH_TIMEOUT 1000
 #define FS_CONTROL_HIDE_DELAY 1
-#define KEYSTRING_MAX_LEN 16
+#define KEYSTRING_BUFFER_SIZE 64
 
 #define SUBTITLE_EXTS	{	"utf",\
 				"utf8",\
@@ -63,11 +105,20 @@
 				"sup",\
 				NULL }
 
+#define AUDIO_TRACK_EXTS	{	"mka",\
+					"ac3",\
+					"eac3",\
+					"dts",\
+					"dtshd",\
+					NULL }
+
 #define PLAYLIST_EXTS	{	"m3u",\
 				"m3u8",\
 				"ini",\
 				"pls",\
 				"txt",\
+				"xspf",\
+				"cue",\
 				NULL }
 
 #define DND_TARGETS	{	{.target = "PLAYLIST_PATH",\
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gmpv_duration_index.h"
+#include "gmpv_common.h"
+
+struct _GmpvDurationIndex
+{
+	GArray *durations;
+	GArray *tree;
+	guint unknown_count;
+};
+
+static gdouble get_known_duration(gdouble duration);
+
+static gdouble get_known_duration(gdouble duration)
+{
+	return duration > 0?duration:0;
+}
+
+GmpvDurationIndex *gmpv_duration_index_new(void)
+{
+	GmpvDurationIndex *index = g_new(GmpvDurationIndex, 1);
+
+	index->durations = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	index->tree = g_array_new(FALSE, TRUE, sizeof(gdouble));
+	index->unknown_count = 0;
+
+	return index;
+}
+
+void gmpv_duration_index_free(GmpvDurationIndex *index)
+{
+	if(index)
+	{
+		g_array_free(index->durations, TRUE);
+		g_array_free(index->tree, TRUE);
+		g_free(index);
+	}
+}
+
+void gmpv_duration_index_load(GmpvDurationIndex *index, GPtrArray *playlist)
+{
+	guint length = playlist?playlist->len:0;
+	gdouble *tree = NULL;
+
+	g_array_set_size(index->durations, length);
+	g_array_set_size(index->tree, length+1);
+	index->unknown_count = 0;
+
+	tree = (gdouble *)index->tree->data;
+	tree[0] = 0;
+
+	for(guint i = 0; i < length; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		gdouble duration = entry->duration;
+
+		g_array_index(index->durations, gdouble, i) = duration;
+		tree[i+1] = get_known_duration(duration);
+		index->unknown_count += duration > 0?0:1;
+	}
+
+	/* Build the tree in place by pushing each node into its parent */
+	for(guint i = 1; i <= length; i++)
+	{
+		guint parent = i+(i&-i);
+
+		if(parent <= length)
+		{
+			tree[parent] += tree[i];
+		}
+	}
+}
+
+void gmpv_duration_index_set(	GmpvDurationIndex *index,
+				guint position,
+				gdouble duration )
+{
+	guint length = index->durations->len;
+	gdouble *old_duration = NULL;
+	gdouble delta = 0;
+
+	g_return_if_fail(position < length);
+
+	old_duration = &g_array_index(index->durations, gdouble, position);
+	delta =	get_known_duration(duration)-
+		get_known_duration(*old_duration);
+	index->unknown_count -= *old_duration > 0?0:1;
+	index->unknown_count += duration > 0?0:1;
+	*old_duration = duration;
+
+	for(guint i = position+1; delta != 0 && i <= length; i += i&-i)
+	{
+		g_array_index(index->tree, gdouble, i) += delta;
+	}
+}
+
+guint gmpv_duration_index_get_length(GmpvDurationIndex *index)
+{
+	return index->durations->len;
+}
+
+guint gmpv_duration_index_get_unknown_count(GmpvDurationIndex *index)
+{
+	return index->unknown_count;
+}
+
+gdouble gmpv_duration_index_get_sum(GmpvDurationIndex *index, guint count)
+{
+	gdouble sum = 0;
+
+	for(guint i = MIN(count, index->durations->len); i > 0; i -= i&-i)
+	{
+		sum += g_array_index(index->tree, gdouble, i);
+	}
+
+	return sum;
+}
+
+gdouble gmpv_duration_index_get_total(GmpvDurationIndex *index)
+{
+	return gmpv_duration_index_get_sum(index, index->durations->len);
+}
+
+gint gmpv_duration_index_find(	GmpvDurationIndex *index,
+				gdouble time,
+				gdouble *offset )
+{
+	guint length = index->durations->len;
+	guint position = 0;
+	guint step = 1;
+	gdouble remaining = MAX(0, time);
+
+	while(step <= length/2)
+	{
+		step <<= 1;
+	}
+
+	/* Descend the tree to find the number of entries that end at or
+	 * before the given time. The entry after them is the one containing
+	 * it.
+	 */
+	for(; length > 0 && step > 0; step >>= 1)
+	{
+		guint next = position+step;
+
+		if(	next <= length &&
+			g_array_index(index->tree, gdouble, next) <= remaining )
+		{
+			position = next;
+			remaining -= g_array_index(index->tree, gdouble, next);
+		}
+	}
+
+	if(offset)
+	{
+		*offset = remaining;
+	}
+
+	return position < length?(gint)position:-1;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DURATION_INDEX_H
+#define DURATION_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GmpvDurationIndex GmpvDurationIndex;
+
+/* Prefix sums over the durations of playlist entries, kept in a Fenwick
+ * tree. Loading a playlist takes linear time, after which the duration of
+ * any entry can be changed and the time before any entry can be queried in
+ * logarithmic time. Entries of unknown duration count as zero, and the
+ * number of such entries is tracked so that totals can be reported as
+ * incomplete.
+ */
+GmpvDurationIndex *gmpv_duration_index_new(void);
+void gmpv_duration_index_free(GmpvDurationIndex *index);
+void gmpv_duration_index_load(GmpvDurationIndex *index, GPtrArray *playlist);
+void gmpv_duration_index_set(	GmpvDurationIndex *index,
+				guint position,
+				gdouble duration );
+guint gmpv_duration_index_get_length(GmpvDurationIndex *index);
+guint gmpv_duration_index_get_unknown_count(GmpvDurationIndex *index);
+gdouble gmpv_duration_index_get_sum(GmpvDurationIndex *index, guint count);
+gdouble gmpv_duration_index_get_total(GmpvDurationIndex *index);
+gint gmpv_duration_index_find(	GmpvDurationIndex *index,
+				gdouble time,
+				gdouble *offset );
+
+G_END_DECLS
+
+#endif
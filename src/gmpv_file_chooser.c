@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "gmpv_file_chooser.h"
+#include "gmpv_settings_cache.h"
 #include "gmpv_def.h"
 
 static void load_last_folder(GtkFileChooser *chooser);
@@ -54,21 +55,10 @@ static void save_last_folder(GtkFileChooser *chooser)
 
 static void response_handler(GtkDialog *dialog, gint response_id, gpointer data)
 {
-	if(response_id == GTK_RESPONSE_ACCEPT)
+	if(	response_id == GTK_RESPONSE_ACCEPT &&
+		gmpv_settings_cache_get()->last_folder_enable )
 	{
-		GSettings *main_config;
-		gboolean last_folder_enable;
-
-		main_config = g_settings_new(CONFIG_ROOT);
-		last_folder_enable =	g_settings_get_boolean
-					(main_config, "last-folder-enable");
-
-		if(last_folder_enable)
-		{
-			save_last_folder(GTK_FILE_CHOOSER(dialog));
-		}
-
-		g_object_unref(main_config);
+		save_last_folder(GTK_FILE_CHOOSER(dialog));
 	}
 }
 
@@ -78,8 +68,7 @@ GmpvFileChooser *gmpv_file_chooser_new(	const gchar *title,
 {
 	GmpvFileChooser *chooser;
 	GtkFileChooser *gtk_chooser;
-	GSettings *main_config;
-	gboolean last_folder_enable;
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
 
 #if GTK_CHECK_VERSION(3, 19, 7)
 	chooser = gtk_file_chooser_native_new(title, parent, action, NULL, NULL);
@@ -95,11 +84,8 @@ GmpvFileChooser *gmpv_file_chooser_new(	const gchar *title,
 #endif
 
 	gtk_chooser = GTK_FILE_CHOOSER(chooser);
-	main_config = g_settings_new(CONFIG_ROOT);
-	last_folder_enable =	g_settings_get_boolean
-				(main_config, "last-folder-enable");
 
-	if(last_folder_enable)
+	if(settings->last_folder_enable)
 	{
 		load_last_folder(GTK_FILE_CHOOSER(chooser));
 	}
@@ -110,8 +96,6 @@ GmpvFileChooser *gmpv_file_chooser_new(	const gchar *title,
 
 	g_signal_connect(chooser, "response", G_CALLBACK(response_handler), NULL);
 
-	g_object_unref(main_config);
-
 	return chooser;
 }
 
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "gmpv_fingerprint_service.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+/* The index starts with FINGERPRINT_INDEX_MAGIC, followed by a GVariant of
+ * type FINGERPRINT_INDEX_FORMAT holding the URI, size, modification time
+ * and fingerprint of every known file.
+ */
+#define FINGERPRINT_INDEX_MAGIC "GMPVFPI1"
+#define FINGERPRINT_INDEX_MAGIC_SIZE (sizeof(FINGERPRINT_INDEX_MAGIC) - 1)
+#define FINGERPRINT_INDEX_FORMAT "a(sxxs)"
+
+typedef struct FingerprintRecord FingerprintRecord;
+typedef struct FingerprintJob FingerprintJob;
+
+struct FingerprintRecord
+{
+	gint64 size;
+	gint64 mtime;
+	gchar *fingerprint;
+	gboolean checked;
+};
+
+/* Jobs are owned by the worker thread until they are handed back to the
+ * main context by job_done().
+ */
+struct FingerprintJob
+{
+	GmpvFingerprintService *service;
+	gchar *uri;
+	gint64 size;
+	gint64 mtime;
+	gchar *fingerprint;
+};
+
+struct _GmpvFingerprintService
+{
+	GObject parent;
+	gchar *path;
+	GHashTable *index;
+	GHashTable *pending;
+	GThreadPool *pool;
+	GMainContext *context;
+	guint save_source_id;
+};
+
+struct _GmpvFingerprintServiceClass
+{
+	GObjectClass parent_class;
+};
+
+static GmpvFingerprintService *default_service = NULL;
+
+static void dispose(GObject *object);
+static void finalize(GObject *object);
+static void fingerprint_record_free(FingerprintRecord *record);
+static void fingerprint_job_free(FingerprintJob *job);
+static guint64 sum_words(const guchar *data, gsize size);
+static gchar *compute_fingerprint(GFile *file, guint64 size);
+static void fingerprint_thread(gpointer data, gpointer user_data);
+static gboolean job_done(gpointer data);
+static void load_index(GmpvFingerprintService *service);
+static void save_index(GmpvFingerprintService *service);
+static gboolean save_index_handler(gpointer data);
+static void queue_save(GmpvFingerprintService *service);
+
+G_DEFINE_TYPE(GmpvFingerprintService, gmpv_fingerprint_service, G_TYPE_OBJECT)
+
+static void dispose(GObject *object)
+{
+	GmpvFingerprintService *service = GMPV_FINGERPRINT_SERVICE(object);
+
+	if(service->save_source_id > 0)
+	{
+		g_source_remove(service->save_source_id);
+		service->save_source_id = 0;
+
+		save_index(service);
+	}
+
+	G_OBJECT_CLASS(gmpv_fingerprint_service_parent_class)->dispose(object);
+}
+
+static void finalize(GObject *object)
+{
+	GmpvFingerprintService *service = GMPV_FINGERPRINT_SERVICE(object);
+
+	/* Every job holds a reference, so the pool is idle by now */
+	g_thread_pool_free(service->pool, TRUE, FALSE);
+	g_main_context_unref(service->context);
+	g_hash_table_unref(service->pending);
+	g_hash_table_unref(service->index);
+	g_free(service->path);
+
+	G_OBJECT_CLASS(gmpv_fingerprint_service_parent_class)->finalize(object);
+}
+
+static void fingerprint_record_free(FingerprintRecord *record)
+{
+	g_free(record->fingerprint);
+	g_free(record);
+}
+
+static void fingerprint_job_free(FingerprintJob *job)
+{
+	g_object_unref(job->service);
+	g_free(job->uri);
+	g_free(job->fingerprint);
+	g_free(job);
+}
+
+static guint64 sum_words(const guchar *data, gsize size)
+{
+	guint64 sum = 0;
+
+	for(gsize i = 0; i + sizeof(guint64) <= size; i += sizeof(guint64))
+	{
+		guint64 word = 0;
+
+		memcpy(&word, data + i, sizeof(word));
+
+		sum += GUINT64_FROM_LE(word);
+	}
+
+	return sum;
+}
+
+/* Runs in a worker thread. Returns NULL if the file could not be read. */
+static gchar *compute_fingerprint(GFile *file, guint64 size)
+{
+	GFileInputStream *stream = g_file_read(file, NULL, NULL);
+	gsize block_size = (gsize)MIN(size, FINGERPRINT_BLOCK_SIZE);
+	guchar *buf = g_malloc(MAX(block_size, 1));
+	guint64 hash = size;
+	gboolean ok = !!stream;
+
+	for(gint i = 0; ok && i < 2; i++)
+	{
+		goffset offset = (i == 0)?0:(goffset)(size - block_size);
+		gsize bytes_read = 0;
+
+		ok =	g_seekable_seek(	G_SEEKABLE(stream),
+						offset,
+						G_SEEK_SET,
+						NULL,
+						NULL ) &&
+			g_input_stream_read_all(	G_INPUT_STREAM(stream),
+							buf,
+							block_size,
+							&bytes_read,
+							NULL,
+							NULL ) &&
+			bytes_read == block_size;
+
+		hash += sum_words(buf, block_size);
+	}
+
+	if(stream)
+	{
+		g_object_unref(stream);
+	}
+
+	g_free(buf);
+
+	return	ok?
+		g_strdup_printf(	"%016" G_GINT64_MODIFIER "x"
+					"%012" G_GINT64_MODIFIER "x",
+					hash,
+					size ):
+		NULL;
+}
+
+static void fingerprint_thread(gpointer data, gpointer user_data)
+{
+	FingerprintJob *job = data;
+	GFile *file = g_file_new_for_commandline_arg(job->uri);
+	GFileInfo *info = NULL;
+
+	/* Remote files are left alone, since reading them may block for a
+	 * long time and their identity is already given by their URI.
+	 */
+	if(g_file_is_native(file))
+	{
+		info = g_file_query_info(	file,
+						G_FILE_ATTRIBUTE_STANDARD_TYPE","
+						G_FILE_ATTRIBUTE_STANDARD_SIZE","
+						G_FILE_ATTRIBUTE_TIME_MODIFIED,
+						G_FILE_QUERY_INFO_NONE,
+						NULL,
+						NULL );
+	}
+
+	if(info && g_file_info_get_file_type(info) == G_FILE_TYPE_REGULAR)
+	{
+		gint64 size = (gint64)g_file_info_get_size(info);
+		gint64 mtime =	(gint64)
+				g_file_info_get_attribute_uint64
+				(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+		if(!job->fingerprint || job->size != size || job->mtime != mtime)
+		{
+			g_free(job->fingerprint);
+
+			job->fingerprint = compute_fingerprint(file, (guint64)size);
+			job->size = size;
+			job->mtime = mtime;
+		}
+	}
+	else
+	{
+		g_clear_pointer(&job->fingerprint, g_free);
+	}
+
+	g_main_context_invoke_full(	job->service->context,
+					G_PRIORITY_DEFAULT_IDLE,
+					job_done,
+					job,
+					NULL );
+
+	g_clear_object(&info);
+	g_object_unref(file);
+}
+
+static gboolean job_done(gpointer data)
+{
+	FingerprintJob *job = data;
+	GmpvFingerprintService *service = job->service;
+	FingerprintRecord *record = NULL;
+	gboolean changed = FALSE;
+
+	record = g_hash_table_lookup(service->index, job->uri);
+	g_hash_table_remove(service->pending, job->uri);
+
+	if(!job->fingerprint && record)
+	{
+		g_hash_table_remove(service->index, job->uri);
+
+		changed = TRUE;
+		queue_save(service);
+	}
+	else if(job->fingerprint)
+	{
+		if(!record)
+		{
+			record = g_new0(FingerprintRecord, 1);
+
+			g_hash_table_insert
+				(service->index, g_strdup(job->uri), record);
+		}
+
+		changed = (g_strcmp0(record->fingerprint, job->fingerprint) != 0);
+
+		if(	changed ||
+			record->size != job->size ||
+			record->mtime != job->mtime )
+		{
+			g_free(record->fingerprint);
+
+			record->size = job->size;
+			record->mtime = job->mtime;
+			record->fingerprint = job->fingerprint;
+			job->fingerprint = NULL;
+
+			queue_save(service);
+		}
+
+		record->checked = TRUE;
+	}
+
+	/* Files without a fingerprint are announced too, so that whoever is
+	 * waiting for it does not wait forever.
+	 */
+	if(changed || !job->fingerprint)
+	{
+		g_signal_emit_by_name(service, "ready", job->uri);
+	}
+
+	fingerprint_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void load_index(GmpvFingerprintService *service)
+{
+	GMappedFile *file = g_mapped_file_new(service->path, FALSE, NULL);
+	GBytes *bytes = file?g_mapped_file_get_bytes(file):NULL;
+	gsize size = bytes?g_bytes_get_size(bytes):0;
+	const gchar *data = bytes?g_bytes_get_data(bytes, NULL):NULL;
+
+	if(	size >= FINGERPRINT_INDEX_MAGIC_SIZE &&
+		memcmp(	data,
+			FINGERPRINT_INDEX_MAGIC,
+			FINGERPRINT_INDEX_MAGIC_SIZE ) == 0 )
+	{
+		GBytes *body = NULL;
+		GVariant *value = NULL;
+		GVariantIter iter;
+		const gchar *uri = NULL;
+		const gchar *fingerprint = NULL;
+		gint64 file_size = 0;
+		gint64 mtime = 0;
+
+		body =	g_bytes_new_from_bytes
+			(	bytes,
+				FINGERPRINT_INDEX_MAGIC_SIZE,
+				size - FINGERPRINT_INDEX_MAGIC_SIZE );
+		value =	g_variant_new_from_bytes
+			(	G_VARIANT_TYPE(FINGERPRINT_INDEX_FORMAT),
+				body,
+				FALSE );
+
+		g_variant_ref_sink(value);
+		g_variant_iter_init(&iter, value);
+
+		while(g_variant_iter_next(	&iter,
+						"(&sxx&s)",
+						&uri,
+						&file_size,
+						&mtime,
+						&fingerprint ))
+		{
+			FingerprintRecord *record = g_new0(FingerprintRecord, 1);
+
+			record->size = file_size;
+			record->mtime = mtime;
+			record->fingerprint = g_strdup(fingerprint);
+			record->checked = FALSE;
+
+			g_hash_table_replace
+				(service->index, g_strdup(uri), record);
+		}
+
+		g_variant_unref(value);
+		g_bytes_unref(body);
+	}
+
+	if(bytes)
+	{
+		g_bytes_unref(bytes);
+	}
+
+	if(file)
+	{
+		g_mapped_file_unref(file);
+	}
+}
+
+static void save_index(GmpvFingerprintService *service)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+	GVariant *index = NULL;
+	GString *buf = g_string_new(FINGERPRINT_INDEX_MAGIC);
+	gchar *dir = g_path_get_dirname(service->path);
+	GError *error = NULL;
+
+	g_variant_builder_init
+		(&builder, G_VARIANT_TYPE(FINGERPRINT_INDEX_FORMAT));
+	g_hash_table_iter_init(&iter, service->index);
+
+	while(g_hash_table_iter_next(&iter, &key, &value))
+	{
+		FingerprintRecord *record = value;
+
+		g_variant_builder_add(	&builder,
+					"(sxxs)",
+					key,
+					record->size,
+					record->mtime,
+					record->fingerprint );
+	}
+
+	index = g_variant_ref_sink(g_variant_builder_end(&builder));
+
+	g_string_append_len(	buf,
+				g_variant_get_data(index),
+				(gssize)g_variant_get_size(index) );
+	g_mkdir_with_parents(dir, 0755);
+
+	if(!g_file_set_contents(	service->path,
+					buf->str,
+					(gssize)buf->len,
+					&error ))
+	{
+		g_warning(	"Failed to save fingerprint index %s: %s",
+				service->path,
+				error->message );
+
+		g_error_free(error);
+	}
+
+	g_variant_unref(index);
+	g_string_free(buf, TRUE);
+	g_free(dir);
+}
+
+static gboolean save_index_handler(gpointer data)
+{
+	GmpvFingerprintService *service = data;
+
+	service->save_source_id = 0;
+	save_index(service);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Results tend to arrive in bursts, so they are saved together */
+static void queue_save(GmpvFingerprintService *service)
+{
+	if(service->save_source_id == 0)
+	{
+		service->save_source_id =	g_timeout_add_seconds
+						(	FINGERPRINT_SAVE_DELAY,
+							save_index_handler,
+							service );
+	}
+}
+
+static void gmpv_fingerprint_service_class_init
+	(GmpvFingerprintServiceClass *klass)
+{
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->dispose = dispose;
+	obj_class->finalize = finalize;
+
+	g_signal_new(	"ready",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__STRING,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_STRING );
+}
+
+static void gmpv_fingerprint_service_init(GmpvFingerprintService *service)
+{
+	gchar *config_dir = get_config_dir_path();
+
+	service->path = g_build_filename(config_dir, FINGERPRINT_FILENAME, NULL);
+	service->index =	g_hash_table_new_full
+				(	g_str_hash,
+					g_str_equal,
+					g_free,
+					(GDestroyNotify)
+					fingerprint_record_free );
+	service->pending =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	service->pool =	g_thread_pool_new(	fingerprint_thread,
+						NULL,
+						FINGERPRINT_MAX_THREADS,
+						FALSE,
+						NULL );
+	service->context = g_main_context_ref_thread_default();
+	service->save_source_id = 0;
+
+	load_index(service);
+
+	g_free(config_dir);
+}
+
+GmpvFingerprintService *gmpv_fingerprint_service_get_default(void)
+{
+	if(default_service)
+	{
+		g_object_ref(default_service);
+	}
+	else
+	{
+		default_service =	g_object_new
+					(gmpv_fingerprint_service_get_type(), NULL);
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_service), (gpointer *)&default_service);
+	}
+
+	return default_service;
+}
+
+void gmpv_fingerprint_service_request(	GmpvFingerprintService *service,
+					const gchar *uri )
+{
+	FingerprintRecord *record = g_hash_table_lookup(service->index, uri);
+
+	/* Files are only checked once per run */
+	if(	uri &&
+		!(record && record->checked) &&
+		!g_hash_table_contains(service->pending, uri) )
+	{
+		FingerprintJob *job = g_new0(FingerprintJob, 1);
+
+		job->service = g_object_ref(service);
+		job->uri = g_strdup(uri);
+		job->size = record?record->size:0;
+		job->mtime = record?record->mtime:0;
+		job->fingerprint = record?g_strdup(record->fingerprint):NULL;
+
+		g_hash_table_add(service->pending, g_strdup(uri));
+		g_thread_pool_push(service->pool, job, NULL);
+	}
+}
+
+const gchar *gmpv_fingerprint_service_lookup(	GmpvFingerprintService *service,
+						const gchar *uri )
+{
+	FingerprintRecord *record =	uri?
+					g_hash_table_lookup(service->index, uri):
+					NULL;
+
+	return record?record->fingerprint:NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FINGERPRINT_SERVICE_H
+#define FINGERPRINT_SERVICE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GMPV_TYPE_FINGERPRINT_SERVICE (gmpv_fingerprint_service_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvFingerprintService, gmpv_fingerprint_service, GMPV, FINGERPRINT_SERVICE, GObject)
+
+/* Identifies local files by their content rather than by their location.
+ * A fingerprint is made of the size of the file and a hash of its first
+ * and last blocks, like the hash used by OpenSubtitles, so it only takes
+ * two small reads regardless of the size of the file.
+ *
+ * Fingerprints are computed by a pool of worker threads and remembered in
+ * an index in the config directory, along with the size and modification
+ * time they were computed for. Requesting a fingerprint that is already
+ * known only checks that these are still the same.
+ *
+ * Lookups never touch the filesystem and return the last known fingerprint,
+ * or NULL if there is none, such as for remote files. The ready signal is
+ * emitted with the URI whenever its fingerprint becomes known or changes,
+ * and whenever a requested file turns out not to have one.
+ */
+GmpvFingerprintService *gmpv_fingerprint_service_get_default(void);
+void gmpv_fingerprint_service_request(	GmpvFingerprintService *service,
+					const gchar *uri );
+const gchar *gmpv_fingerprint_service_lookup(	GmpvFingerprintService *service,
+						const gchar *uri );
+
+G_END_DECLS
+
+#endif
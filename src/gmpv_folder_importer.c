@@ -0,0 +1,798 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gmpv_folder_importer.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+#include "gmpv_library_catalog.h"
+#include "gmpv_uri_classifier.h"
+
+#define FOLDER_IMPORTER_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_ID_FILE
+
+typedef enum ExtensionType ExtensionType;
+typedef struct FolderNode FolderNode;
+typedef struct FileItem FileItem;
+
+enum ExtensionType
+{
+	EXTENSION_TYPE_UNKNOWN,
+	EXTENSION_TYPE_MEDIA,
+	EXTENSION_TYPE_OTHER
+};
+
+/* Folders form a tree that is scanned in any order but emitted depth-first.
+ * A folder is freed as soon as it and all of its subfolders have been
+ * emitted, so only the folders that are still pending are kept in memory.
+ *
+ * Local folders are looked up in the library catalog first. The
+ * modification time of a folder is checked against the catalog, which
+ * only takes a stat, and the folder is only read if it has changed.
+ */
+struct FolderNode
+{
+	GmpvFolderImporter *importer;
+	FolderNode *parent;
+	GFile *folder;
+	gchar *path;
+	gchar *name;
+	gchar *id;
+	gchar *key;
+	gint64 mtime;
+	GArray *files;
+	GPtrArray *subfolders;
+	guint next_subfolder;
+	gboolean scanned;
+	gboolean enumerated;
+};
+
+struct FileItem
+{
+	gchar *key;
+	gchar *filename;
+	gint64 size;
+	gint64 mtime;
+};
+
+struct _GmpvFolderImporter
+{
+	GObject parent;
+	GCancellable *cancellable;
+	FolderNode *root;
+	GPtrArray *stack;
+	GQueue *scan_queue;
+	guint active_scans;
+	GHashTable *extensions;
+	GHashTable *visited;
+	GPtrArray *chunk;
+	GmpvLibraryCatalog *catalog;
+};
+
+struct _GmpvFolderImporterClass
+{
+	GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE(GmpvFolderImporter, gmpv_folder_importer, G_TYPE_OBJECT)
+
+static void dispose(GObject *object);
+static void finalize(GObject *object);
+static FolderNode *folder_node_new(	GmpvFolderImporter *importer,
+					FolderNode *parent,
+					GFile *folder,
+					const gchar *name );
+static void folder_node_free(FolderNode *node);
+static void file_item_clear(gpointer data);
+static gint compare_file_items(gconstpointer a, gconstpointer b);
+static gint compare_folder_nodes(gconstpointer a, gconstpointer b);
+static gboolean is_supported_mime_type(const gchar *mime_type);
+static gboolean is_media_file(GmpvFolderImporter *importer, const gchar *name);
+static void add_child(	FolderNode *node,
+			GFileEnumerator *enumerator,
+			GFileInfo *info );
+static gboolean visit_folder(	GmpvFolderImporter *importer,
+				const gchar *id );
+static void restore_folder(FolderNode *node, const GmpvLibraryFolder *folder);
+static void catalog_folder(FolderNode *node);
+static void start_scans(GmpvFolderImporter *importer);
+static void enumerate_folder(FolderNode *node);
+static void finish_scan(FolderNode *node);
+static void query_info_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data );
+static void enumerate_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data );
+static void next_files_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data );
+static void flush_chunk(GmpvFolderImporter *importer);
+static void emit_files(GmpvFolderImporter *importer);
+
+static void dispose(GObject *object)
+{
+	GmpvFolderImporter *importer = GMPV_FOLDER_IMPORTER(object);
+
+	g_cancellable_cancel(importer->cancellable);
+
+	G_OBJECT_CLASS(gmpv_folder_importer_parent_class)->dispose(object);
+}
+
+static void finalize(GObject *object)
+{
+	GmpvFolderImporter *importer = GMPV_FOLDER_IMPORTER(object);
+
+	folder_node_free(importer->root);
+	g_object_unref(importer->cancellable);
+	g_ptr_array_free(importer->stack, TRUE);
+	g_queue_free(importer->scan_queue);
+	g_hash_table_unref(importer->extensions);
+	g_hash_table_unref(importer->visited);
+	g_ptr_array_unref(importer->chunk);
+	g_object_unref(importer->catalog);
+
+	G_OBJECT_CLASS(gmpv_folder_importer_parent_class)->finalize(object);
+}
+
+static FolderNode *folder_node_new(	GmpvFolderImporter *importer,
+					FolderNode *parent,
+					GFile *folder,
+					const gchar *name )
+{
+	FolderNode *node = g_new0(FolderNode, 1);
+
+	node->importer = importer;
+	node->parent = parent;
+	node->folder = folder?g_object_ref(folder):NULL;
+	node->path = folder?g_file_get_path(folder):NULL;
+	node->name = g_strdup(name);
+	node->id = NULL;
+	node->key = name?g_utf8_collate_key_for_filename(name, -1):NULL;
+	node->mtime = -1;
+	node->files = g_array_new(FALSE, FALSE, sizeof(FileItem));
+	node->subfolders = g_ptr_array_new();
+	node->next_subfolder = 0;
+	node->scanned = FALSE;
+	node->enumerated = FALSE;
+
+	g_array_set_clear_func(node->files, file_item_clear);
+
+	return node;
+}
+
+static void folder_node_free(FolderNode *node)
+{
+	/* Subfolders that have already been emitted are freed separately, and
+	 * their slots are cleared.
+	 */
+	for(guint i = 0; i < node->subfolders->len; i++)
+	{
+		FolderNode *subfolder = g_ptr_array_index(node->subfolders, i);
+
+		if(subfolder)
+		{
+			folder_node_free(subfolder);
+		}
+	}
+
+	if(node->folder)
+	{
+		g_object_unref(node->folder);
+	}
+
+	g_free(node->path);
+	g_free(node->name);
+	g_free(node->id);
+	g_free(node->key);
+	g_array_free(node->files, TRUE);
+	g_ptr_array_free(node->subfolders, TRUE);
+	g_free(node);
+}
+
+static void file_item_clear(gpointer data)
+{
+	FileItem *item = data;
+
+	g_free(item->key);
+	g_free(item->filename);
+}
+
+static gint compare_file_items(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const FileItem *)a)->key, ((const FileItem *)b)->key);
+}
+
+static gint compare_folder_nodes(gconstpointer a, gconstpointer b)
+{
+	const FolderNode *node_a = *((FolderNode * const *)a);
+	const FolderNode *node_b = *((FolderNode * const *)b);
+
+	return strcmp(node_a->key, node_b->key);
+}
+
+static gboolean is_supported_mime_type(const gchar *mime_type)
+{
+	gboolean result =	g_str_has_prefix(mime_type, "audio/") ||
+				g_str_has_prefix(mime_type, "video/") ||
+				gmpv_uri_is_supported_mime_type(mime_type);
+
+	if(!result)
+	{
+		const gchar *mime_types[] = SUPPORTED_MIME_TYPES;
+
+		/* Also accept subclasses of the types listed in
+		 * SUPPORTED_MIME_TYPES.
+		 */
+		for(const gchar **iter = mime_types; !result && *iter; iter++)
+		{
+			result = g_content_type_is_a(mime_type, *iter);
+		}
+	}
+
+	return result;
+}
+
+static gboolean is_media_file(GmpvFolderImporter *importer, const gchar *name)
+{
+	const gchar *ext = strrchr(name, '.');
+	gchar *key = NULL;
+	ExtensionType type = EXTENSION_TYPE_UNKNOWN;
+	UriClass uri_class = gmpv_uri_classify(name);
+
+	/* Playlists found in folders usually list the same files again, and
+	 * subtitles are not played on their own.
+	 */
+	if(uri_class == URI_CLASS_SUBTITLE || uri_class == URI_CLASS_PLAYLIST)
+	{
+		type = EXTENSION_TYPE_OTHER;
+	}
+	else if(ext && ext != name)
+	{
+		key = g_ascii_strdown(ext + 1, -1);
+		type =	GPOINTER_TO_INT
+			(g_hash_table_lookup(importer->extensions, key));
+	}
+
+	/* Guessing the content type is much slower than a hash lookup, so it
+	 * is only done once for each extension.
+	 */
+	if(key && type == EXTENSION_TYPE_UNKNOWN)
+	{
+		gchar *content_type = g_content_type_guess(name, NULL, 0, NULL);
+		gchar *mime_type = g_content_type_get_mime_type(content_type);
+
+		type =	(mime_type && is_supported_mime_type(mime_type))?
+			EXTENSION_TYPE_MEDIA:
+			EXTENSION_TYPE_OTHER;
+
+		g_hash_table_insert
+			(importer->extensions, key, GINT_TO_POINTER(type));
+
+		g_free(content_type);
+		g_free(mime_type);
+	}
+	else
+	{
+		g_free(key);
+	}
+
+	return type == EXTENSION_TYPE_MEDIA;
+}
+
+static void add_child(	FolderNode *node,
+			GFileEnumerator *enumerator,
+			GFileInfo *info )
+{
+	GmpvFolderImporter *importer = node->importer;
+	const gchar *name = g_file_info_get_name(info);
+	GFileType type = g_file_info_get_file_type(info);
+
+	if(g_file_info_get_is_hidden(info))
+	{
+		/* Skip hidden files and folders */
+	}
+	else if(type == G_FILE_TYPE_DIRECTORY)
+	{
+		const gchar *id =	g_file_info_get_attribute_string
+					(info, G_FILE_ATTRIBUTE_ID_FILE);
+
+		if(visit_folder(importer, id))
+		{
+			GFile *folder = g_file_enumerator_get_child(enumerator, info);
+			FolderNode *subfolder =	folder_node_new
+						(importer, node, folder, name);
+
+			subfolder->id = g_strdup(id);
+			subfolder->mtime =	(gint64)
+						g_file_info_get_attribute_uint64
+						(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+			g_ptr_array_add(node->subfolders, subfolder);
+			g_object_unref(folder);
+		}
+	}
+	else if(type == G_FILE_TYPE_REGULAR && is_media_file(importer, name))
+	{
+		GFile *file = g_file_enumerator_get_child(enumerator, info);
+		FileItem item = {NULL, NULL, 0, 0};
+
+		item.key = g_utf8_collate_key_for_filename(name, -1);
+		item.filename = g_file_get_path(file)?:g_file_get_uri(file);
+		item.size = (gint64)g_file_info_get_size(info);
+		item.mtime =	(gint64)
+				g_file_info_get_attribute_uint64
+				(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+		g_array_append_val(node->files, item);
+		g_object_unref(file);
+	}
+}
+
+/* Symbolic links are followed, so make sure that each folder is only
+ * visited once to avoid loops.
+ */
+static gboolean visit_folder(	GmpvFolderImporter *importer,
+				const gchar *id )
+{
+	gboolean result = !id || !g_hash_table_contains(importer->visited, id);
+
+	if(id && result)
+	{
+		g_hash_table_add(importer->visited, g_strdup(id));
+	}
+
+	return result;
+}
+
+static void restore_folder(FolderNode *node, const GmpvLibraryFolder *folder)
+{
+	GmpvFolderImporter *importer = node->importer;
+
+	for(guint i = 0; i < folder->files->len; i++)
+	{
+		const gchar *filename = g_ptr_array_index(folder->files, i);
+		gchar *name = g_path_get_basename(filename);
+		FileItem item = {NULL, NULL, 0, 0};
+
+		item.key = g_utf8_collate_key_for_filename(name, -1);
+		item.filename = g_strdup(filename);
+
+		g_array_append_val(node->files, item);
+		g_free(name);
+	}
+
+	for(guint i = 0; i < folder->subfolders->len; i++)
+	{
+		const gchar *name = g_ptr_array_index(folder->subfolders, i);
+		const gchar *id = g_ptr_array_index(folder->subfolder_ids, i);
+
+		if(visit_folder(importer, *id?id:NULL))
+		{
+			GFile *child = g_file_get_child(node->folder, name);
+			FolderNode *subfolder =	folder_node_new
+						(importer, node, child, name);
+
+			subfolder->id = *id?g_strdup(id):NULL;
+
+			g_ptr_array_add(node->subfolders, subfolder);
+			g_object_unref(child);
+		}
+	}
+}
+
+/* Must be called after the files and subfolders have been sorted, so that
+ * the catalog lists them in the order they are imported in.
+ */
+static void catalog_folder(FolderNode *node)
+{
+	GmpvLibraryCatalog *catalog = node->importer->catalog;
+	GmpvLibraryFolder *folder = gmpv_library_folder_new(node->mtime);
+
+	for(guint i = 0; i < node->files->len; i++)
+	{
+		FileItem *item = &g_array_index(node->files, FileItem, i);
+
+		gmpv_library_catalog_add_file
+			(catalog, item->filename, item->size, item->mtime);
+		g_ptr_array_add(folder->files, g_strdup(item->filename));
+	}
+
+	for(guint i = 0; i < node->subfolders->len; i++)
+	{
+		FolderNode *subfolder = g_ptr_array_index(node->subfolders, i);
+
+		g_ptr_array_add(folder->subfolders, g_strdup(subfolder->name));
+		g_ptr_array_add(	folder->subfolder_ids,
+					g_strdup(subfolder->id?:"") );
+	}
+
+	gmpv_library_catalog_add_folder(catalog, node->path, folder);
+}
+
+static void start_scans(GmpvFolderImporter *importer)
+{
+	while(	importer->active_scans < FOLDER_IMPORT_MAX_SCANS &&
+		!g_queue_is_empty(importer->scan_queue) )
+	{
+		FolderNode *node = g_queue_pop_head(importer->scan_queue);
+
+		/* Keep the importer alive until the callback is invoked, even
+		 * if it is cancelled.
+		 */
+		g_object_ref(importer);
+		importer->active_scans++;
+
+		if(	node->path &&
+			(	node->mtime < 0 ||
+				gmpv_library_catalog_contains
+				(importer->catalog, node->path) ) )
+		{
+			g_file_query_info_async
+				(	node->folder,
+					G_FILE_ATTRIBUTE_TIME_MODIFIED,
+					G_FILE_QUERY_INFO_NONE,
+					G_PRIORITY_LOW,
+					importer->cancellable,
+					query_info_ready_handler,
+					node );
+		}
+		else
+		{
+			enumerate_folder(node);
+		}
+	}
+}
+
+static void enumerate_folder(FolderNode *node)
+{
+	g_file_enumerate_children_async(	node->folder,
+						FOLDER_IMPORTER_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NONE,
+						G_PRIORITY_LOW,
+						node->importer->cancellable,
+						enumerate_ready_handler,
+						node );
+}
+
+static void finish_scan(FolderNode *node)
+{
+	GmpvFolderImporter *importer = node->importer;
+
+	g_array_sort(node->files, compare_file_items);
+	g_ptr_array_sort(node->subfolders, compare_folder_nodes);
+
+	if(node->enumerated && node->path && node->mtime >= 0)
+	{
+		catalog_folder(node);
+	}
+
+	/* Scan subfolders before the folders that were queued earlier, since
+	 * they are the next ones to be emitted.
+	 */
+	for(guint i = node->subfolders->len; i > 0; i--)
+	{
+		FolderNode *subfolder = g_ptr_array_index(node->subfolders, i - 1);
+
+		g_queue_push_head(importer->scan_queue, subfolder);
+	}
+
+	node->scanned = TRUE;
+	importer->active_scans--;
+
+	start_scans(importer);
+	emit_files(importer);
+	g_object_unref(importer);
+}
+
+static void query_info_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data )
+{
+	FolderNode *node = data;
+	GmpvFolderImporter *importer = node->importer;
+	GFileInfo *info = NULL;
+	GmpvLibraryFolder *folder = NULL;
+	GError *error = NULL;
+
+	info = g_file_query_info_finish(G_FILE(source_object), res, &error);
+
+	if(info)
+	{
+		node->mtime =	(gint64)
+				g_file_info_get_attribute_uint64
+				(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+		folder =	gmpv_library_catalog_lookup
+				(importer->catalog, node->path, node->mtime);
+	}
+
+	if(g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	{
+		g_object_unref(importer);
+	}
+	else if(folder)
+	{
+		restore_folder(node, folder);
+		finish_scan(node);
+	}
+	else
+	{
+		/* Errors are reported when enumerating the folder */
+		enumerate_folder(node);
+	}
+
+	gmpv_library_folder_free(folder);
+	g_clear_object(&info);
+	g_clear_error(&error);
+}
+
+static void enumerate_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data )
+{
+	FolderNode *node = data;
+	GmpvFolderImporter *importer = node->importer;
+	GFileEnumerator *enumerator = NULL;
+	GError *error = NULL;
+
+	enumerator =	g_file_enumerate_children_finish
+			(G_FILE(source_object), res, &error);
+
+	if(enumerator)
+	{
+		g_file_enumerator_next_files_async(	enumerator,
+							FOLDER_IMPORT_BATCH_SIZE,
+							G_PRIORITY_LOW,
+							importer->cancellable,
+							next_files_ready_handler,
+							node );
+	}
+	else if(g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	{
+		g_object_unref(importer);
+	}
+	else
+	{
+		gchar *uri = g_file_get_uri(node->folder);
+
+		g_warning(	"Failed to read folder %s: %s",
+				uri,
+				error->message );
+
+		finish_scan(node);
+		g_free(uri);
+	}
+
+	g_clear_error(&error);
+}
+
+static void next_files_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data )
+{
+	GFileEnumerator *enumerator = G_FILE_ENUMERATOR(source_object);
+	FolderNode *node = data;
+	GmpvFolderImporter *importer = node->importer;
+	GList *infos = NULL;
+	GError *error = NULL;
+
+	infos = g_file_enumerator_next_files_finish(enumerator, res, &error);
+
+	if(g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	{
+		g_object_unref(enumerator);
+		g_object_unref(importer);
+	}
+	else if(infos)
+	{
+		for(GList *iter = infos; iter; iter = g_list_next(iter))
+		{
+			add_child(node, enumerator, iter->data);
+		}
+
+		g_file_enumerator_next_files_async(	enumerator,
+							FOLDER_IMPORT_BATCH_SIZE,
+							G_PRIORITY_LOW,
+							importer->cancellable,
+							next_files_ready_handler,
+							node );
+	}
+	else
+	{
+		if(error)
+		{
+			g_warning("Failed to read folder: %s", error->message);
+		}
+
+		node->enumerated = !error;
+
+		g_object_unref(enumerator);
+		finish_scan(node);
+	}
+
+	g_list_free_full(infos, g_object_unref);
+	g_clear_error(&error);
+}
+
+static void flush_chunk(GmpvFolderImporter *importer)
+{
+	if(	importer->chunk->len > 0 &&
+		!g_cancellable_is_cancelled(importer->cancellable) )
+	{
+		GPtrArray *chunk = importer->chunk;
+
+		importer->chunk = gmpv_playlist_new(FOLDER_IMPORT_CHUNK_SIZE);
+
+		g_signal_emit_by_name(importer, "files-found", chunk);
+		g_ptr_array_unref(chunk);
+	}
+}
+
+static void emit_files(GmpvFolderImporter *importer)
+{
+	gboolean blocked = FALSE;
+
+	/* Signal handlers may drop the last reference to the importer */
+	g_object_ref(importer);
+
+	while(!blocked && !g_cancellable_is_cancelled(importer->cancellable))
+	{
+		FolderNode *node =	g_ptr_array_index
+					(importer->stack, importer->stack->len - 1);
+
+		if(!node->scanned)
+		{
+			blocked = TRUE;
+		}
+		else if(node->files->len > 0)
+		{
+			for(guint i = 0; i < node->files->len; i++)
+			{
+				FileItem *item =	&g_array_index
+							(node->files, FileItem, i);
+
+				g_ptr_array_add
+					(	importer->chunk,
+						gmpv_library_catalog_get_entry
+						(	importer->catalog,
+							item->filename ) );
+
+				if(importer->chunk->len >= FOLDER_IMPORT_CHUNK_SIZE)
+				{
+					flush_chunk(importer);
+				}
+			}
+
+			g_array_set_size(node->files, 0);
+		}
+		else if(node->next_subfolder < node->subfolders->len)
+		{
+			FolderNode *subfolder =	g_ptr_array_index
+						(	node->subfolders,
+							node->next_subfolder++ );
+
+			g_ptr_array_add(importer->stack, subfolder);
+		}
+		else if(node == importer->root)
+		{
+			blocked = TRUE;
+		}
+		else
+		{
+			g_ptr_array_index
+				(node->parent->subfolders,
+				node->parent->next_subfolder - 1) = NULL;
+			g_ptr_array_set_size
+				(importer->stack, importer->stack->len - 1);
+
+			folder_node_free(node);
+		}
+	}
+
+	if(!g_cancellable_is_cancelled(importer->cancellable))
+	{
+		FolderNode *root = importer->root;
+
+		flush_chunk(importer);
+
+		if(	importer->stack->len == 1 &&
+			root->next_subfolder == root->subfolders->len &&
+			importer->active_scans == 0 )
+		{
+			g_ptr_array_set_size(root->subfolders, 0);
+			root->next_subfolder = 0;
+
+			g_signal_emit_by_name(importer, "finished");
+		}
+	}
+
+	g_object_unref(importer);
+}
+
+static void gmpv_folder_importer_class_init(GmpvFolderImporterClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	object_class->dispose = dispose;
+	object_class->finalize = finalize;
+
+	g_signal_new(	"files-found",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__BOXED,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_PTR_ARRAY );
+	g_signal_new(	"finished",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__VOID,
+			G_TYPE_NONE,
+			0 );
+}
+
+static void gmpv_folder_importer_init(GmpvFolderImporter *importer)
+{
+	importer->cancellable = g_cancellable_new();
+	importer->root = folder_node_new(importer, NULL, NULL, NULL);
+	importer->stack = g_ptr_array_new();
+	importer->scan_queue = g_queue_new();
+	importer->active_scans = 0;
+	importer->extensions =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	importer->visited =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	importer->chunk = gmpv_playlist_new(FOLDER_IMPORT_CHUNK_SIZE);
+	importer->catalog = gmpv_library_catalog_get_default();
+
+	importer->root->scanned = TRUE;
+	g_ptr_array_add(importer->stack, importer->root);
+}
+
+GmpvFolderImporter *gmpv_folder_importer_new(void)
+{
+	return g_object_new(gmpv_folder_importer_get_type(), NULL);
+}
+
+void gmpv_folder_importer_add(GmpvFolderImporter *importer, GFile *folder)
+{
+	FolderNode *node = folder_node_new(importer, importer->root, folder, "");
+
+	g_ptr_array_add(importer->root->subfolders, node);
+	g_queue_push_tail(importer->scan_queue, node);
+
+	start_scans(importer);
+}
+
+void gmpv_folder_importer_cancel(GmpvFolderImporter *importer)
+{
+	g_cancellable_cancel(importer->cancellable);
+}
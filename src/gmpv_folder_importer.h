@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FOLDER_IMPORTER_H
+#define FOLDER_IMPORTER_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GMPV_TYPE_FOLDER_IMPORTER (gmpv_folder_importer_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvFolderImporter, gmpv_folder_importer, GMPV, FOLDER_IMPORTER, GObject)
+
+/* Recursively collects the media files in folders in the background. The
+ * files are reported through the files-found signal as playlists created
+ * by gmpv_playlist_new(), in natural order with the files of each folder
+ * before those of its subfolders. Results are emitted as soon as they are
+ * known to be in the right place, so the first ones arrive long before the
+ * whole tree has been scanned. The finished signal is emitted once every
+ * added folder has been imported.
+ */
+GmpvFolderImporter *gmpv_folder_importer_new(void);
+void gmpv_folder_importer_add(GmpvFolderImporter *importer, GFile *folder);
+void gmpv_folder_importer_cancel(GmpvFolderImporter *importer);
+
+G_END_DECLS
+
+#endif
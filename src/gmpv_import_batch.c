@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gmpv_import_batch.h"
+#include "gmpv_common.h"
+#include "gmpv_folder_importer.h"
+#include "gmpv_playlist_parser.h"
+#include "gmpv_uri_classifier.h"
+
+static void append_entries(GmpvImportBatch *batch, GPtrArray *entries);
+static void files_found_handler(	GmpvFolderImporter *importer,
+					GPtrArray *entries,
+					gpointer data );
+static void finished_handler(GmpvFolderImporter *importer, gpointer data);
+static void cancelled_handler(GCancellable *cancellable, gpointer data);
+static void import_folders(	GmpvImportBatch *batch,
+				GPtrArray *folders,
+				GCancellable *cancellable );
+static void import_uri(	GmpvImportBatch *batch,
+			const gchar *uri,
+			UriClass uri_class );
+static void import_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable );
+
+static void append_entries(GmpvImportBatch *batch, GPtrArray *entries)
+{
+	for(guint i = 0; i < entries->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(entries, i);
+
+		g_ptr_array_add(batch->entries, gmpv_playlist_entry_ref(entry));
+	}
+}
+
+static void files_found_handler(	GmpvFolderImporter *importer,
+					GPtrArray *entries,
+					gpointer data )
+{
+	append_entries(data, entries);
+}
+
+static void finished_handler(GmpvFolderImporter *importer, gpointer data)
+{
+	*((gboolean *)data) = TRUE;
+}
+
+static void cancelled_handler(GCancellable *cancellable, gpointer data)
+{
+	/* May be invoked from any thread. This only cancels the importer's
+	 * own cancellable, which is thread-safe.
+	 */
+	gmpv_folder_importer_cancel(data);
+}
+
+/* Runs a folder importer to completion on a main context private to the
+ * worker thread, so that its callbacks are dispatched here instead of in
+ * the main thread.
+ */
+static void import_folders(	GmpvImportBatch *batch,
+				GPtrArray *folders,
+				GCancellable *cancellable )
+{
+	GMainContext *context = g_main_context_new();
+	GmpvFolderImporter *importer = NULL;
+	gboolean finished = FALSE;
+	gulong cancelled_id = 0;
+
+	g_main_context_push_thread_default(context);
+
+	importer = gmpv_folder_importer_new();
+
+	g_signal_connect(	importer,
+				"files-found",
+				G_CALLBACK(files_found_handler),
+				batch );
+	g_signal_connect(	importer,
+				"finished",
+				G_CALLBACK(finished_handler),
+				&finished );
+
+	for(guint i = 0; i < folders->len; i++)
+	{
+		gmpv_folder_importer_add(importer, g_ptr_array_index(folders, i));
+	}
+
+	if(cancellable)
+	{
+		cancelled_id =	g_cancellable_connect
+				(	cancellable,
+					G_CALLBACK(cancelled_handler),
+					importer,
+					NULL );
+	}
+
+	while(!finished && !g_cancellable_is_cancelled(cancellable))
+	{
+		g_main_context_iteration(context, TRUE);
+	}
+
+	if(cancellable)
+	{
+		g_cancellable_disconnect(cancellable, cancelled_id);
+	}
+	g_signal_handlers_disconnect_by_data(importer, batch);
+	g_signal_handlers_disconnect_by_data(importer, &finished);
+
+	/* Pending operations hold references to the importer and complete
+	 * with G_IO_ERROR_CANCELLED once it is cancelled. Wait for them so
+	 * that none of them is left on the context when it is freed.
+	 */
+	gmpv_folder_importer_cancel(importer);
+	g_object_add_weak_pointer(G_OBJECT(importer), (gpointer *)&importer);
+	g_object_unref(importer);
+
+	while(importer)
+	{
+		g_main_context_iteration(context, TRUE);
+	}
+
+	g_main_context_pop_thread_default(context);
+	g_main_context_unref(context);
+}
+
+static void import_uri(	GmpvImportBatch *batch,
+			const gchar *uri,
+			UriClass uri_class )
+{
+	GPtrArray *entries = NULL;
+	GError *error = NULL;
+
+	if(uri_class == URI_CLASS_PLAYLIST)
+	{
+		entries = gmpv_playlist_parser_parse(uri, &error);
+	}
+
+	/* Playlists that could not be read are left to mpv, so that errors
+	 * are reported the same way as for any other file.
+	 */
+	if(error)
+	{
+		g_warning("Failed to read playlist %s: %s", uri, error->message);
+		g_error_free(error);
+	}
+
+	if(uri_class == URI_CLASS_SUBTITLE)
+	{
+		g_ptr_array_add(batch->subtitles, g_strdup(uri));
+	}
+	else if(entries && entries->len > 0)
+	{
+		append_entries(batch, entries);
+	}
+	else
+	{
+		GmpvPlaylistEntry *entry = gmpv_playlist_entry_new(uri, NULL);
+
+		g_ptr_array_add(batch->entries, entry);
+	}
+
+	if(entries)
+	{
+		g_ptr_array_unref(entries);
+	}
+}
+
+static void import_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable )
+{
+	const gchar **uris = task_data;
+	GmpvImportBatch *batch = g_new0(GmpvImportBatch, 1);
+	GPtrArray *folders = g_ptr_array_new_with_free_func(g_object_unref);
+
+	batch->entries = gmpv_playlist_new(0);
+	batch->subtitles = g_ptr_array_new_with_free_func(g_free);
+
+	for(	const gchar **iter = uris;
+		*iter && !g_cancellable_is_cancelled(cancellable);
+		iter++ )
+	{
+		UriClass uri_class = gmpv_uri_classify(*iter);
+		GFile *folder =	(uri_class == URI_CLASS_SUBTITLE)?
+				NULL:
+				get_local_folder(*iter);
+
+		/* Consecutive folders are imported together so that they can
+		 * be scanned concurrently.
+		 */
+		if(folder)
+		{
+			g_ptr_array_add(folders, folder);
+		}
+		else
+		{
+			if(folders->len > 0)
+			{
+				import_folders(batch, folders, cancellable);
+				g_ptr_array_set_size(folders, 0);
+			}
+
+			import_uri(batch, *iter, uri_class);
+		}
+	}
+
+	if(folders->len > 0 && !g_cancellable_is_cancelled(cancellable))
+	{
+		import_folders(batch, folders, cancellable);
+	}
+
+	g_ptr_array_free(folders, TRUE);
+
+	if(g_cancellable_is_cancelled(cancellable))
+	{
+		gmpv_import_batch_free(batch);
+		g_task_return_new_error(	task,
+						G_IO_ERROR,
+						G_IO_ERROR_CANCELLED,
+						"Import cancelled" );
+	}
+	else
+	{
+		g_task_return_pointer
+			(task, batch, (GDestroyNotify)gmpv_import_batch_free);
+	}
+}
+
+void gmpv_import_batch_async(	const gchar **uris,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer data )
+{
+	GTask *task = g_task_new(NULL, cancellable, callback, data);
+
+	g_task_set_source_tag(task, gmpv_import_batch_async);
+	g_task_set_task_data(	task,
+				g_strdupv((gchar **)uris),
+				(GDestroyNotify)g_strfreev );
+	g_task_run_in_thread(task, import_thread);
+
+	g_object_unref(task);
+}
+
+GmpvImportBatch *gmpv_import_batch_finish(	GAsyncResult *result,
+						GError **error )
+{
+	g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+void gmpv_import_batch_free(GmpvImportBatch *batch)
+{
+	if(batch)
+	{
+		g_ptr_array_unref(batch->entries);
+		g_ptr_array_free(batch->subtitles, TRUE);
+		g_free(batch);
+	}
+}
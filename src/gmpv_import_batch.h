@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMPORT_BATCH_H
+#define IMPORT_BATCH_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct GmpvImportBatch GmpvImportBatch;
+
+/* The files to add to the playlist, as created by gmpv_playlist_new(), and
+ * the URIs of the subtitles to load for them.
+ */
+struct GmpvImportBatch
+{
+	GPtrArray *entries;
+	GPtrArray *subtitles;
+};
+
+/* Resolves a list of URIs, as dropped on the window or given on the
+ * command line, in a worker thread. Subtitles are set apart, playlists are
+ * read with gmpv_playlist_parser and local folders are expanded
+ * recursively with GmpvFolderImporter. The resulting entries keep the
+ * order of uris, so that the whole list can be added to the playlist at
+ * once.
+ */
+void gmpv_import_batch_async(	const gchar **uris,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer data );
+GmpvImportBatch *gmpv_import_batch_finish(	GAsyncResult *result,
+						GError **error );
+void gmpv_import_batch_free(GmpvImportBatch *batch);
+
+G_END_DECLS
+
+#endif
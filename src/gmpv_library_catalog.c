@@ -0,0 +1,1153 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "gmpv_library_catalog.h"
+#include "gmpv_fingerprint_service.h"
+#include "gmpv_folder_importer.h"
+#include "gmpv_metadata_cache.h"
+#include "gmpv_def.h"
+
+/* The catalog starts with LIBRARY_CATALOG_MAGIC, followed by a GVariant of
+ * type LIBRARY_CATALOG_FORMAT holding the folders, as path, modification
+ * time, files, subfolders and subfolder IDs, then the files, as filename,
+ * size, modification time, time of addition, title, duration and tags.
+ */
+#define LIBRARY_CATALOG_MAGIC "GMPVLIB1"
+#define LIBRARY_CATALOG_MAGIC_SIZE (sizeof(LIBRARY_CATALOG_MAGIC) - 1)
+#define LIBRARY_CATALOG_FORMAT "(a(sxasasas)a(sxxxmsda(ss)))"
+
+typedef struct LibraryFile LibraryFile;
+
+struct LibraryFile
+{
+	gint64 size;
+	gint64 mtime;
+	gint64 added;
+	gchar *title;
+	gdouble duration;
+	GPtrArray *tags;
+};
+
+struct _GmpvLibraryCatalog
+{
+	GObject parent;
+	gchar *path;
+
+	/* Guarded by lock, since imports may run in other threads */
+	GMutex lock;
+	GHashTable *folders;
+	GHashTable *files;
+	GHashTable *stale;
+	GPtrArray *unwatched;
+	GPtrArray *unfingerprinted;
+	gboolean dirty;
+	guint pending_source_id;
+
+	/* Only used in the default main context */
+	GHashTable *monitors;
+	GHashTable *rescan_paths;
+	GmpvFolderImporter *rescanner;
+	GmpvMetadataCache *cache;
+	GmpvFingerprintService *fingerprint_service;
+	guint save_source_id;
+	guint rescan_source_id;
+	gboolean saving;
+	gboolean save_again;
+};
+
+struct _GmpvLibraryCatalogClass
+{
+	GObjectClass parent_class;
+};
+
+G_LOCK_DEFINE_STATIC(default_catalog);
+static GmpvLibraryCatalog *default_catalog = NULL;
+
+static void dispose(GObject *object);
+static void finalize(GObject *object);
+static LibraryFile *library_file_new(void);
+static void library_file_free(LibraryFile *file);
+static GmpvLibraryFolder *library_folder_copy(const GmpvLibraryFolder *folder);
+static void monitor_free(GFileMonitor *monitor);
+static void queue_pending(GmpvLibraryCatalog *catalog);
+static gboolean process_pending_handler(gpointer data);
+static void remove_folder(GmpvLibraryCatalog *catalog, const gchar *path);
+static void remove_missing(	GmpvLibraryCatalog *catalog,
+				const gchar *path,
+				const GmpvLibraryFolder *old_folder,
+				const GmpvLibraryFolder *new_folder );
+static GmpvPlaylistEntry *file_to_entry(	const gchar *filename,
+						const LibraryFile *file );
+static void cache_update_handler(	GmpvMetadataCache *cache,
+					const gchar *uri,
+					gpointer data );
+static void watch_folder(GmpvLibraryCatalog *catalog, const gchar *path);
+static void folder_changed_handler(	GFileMonitor *monitor,
+					GFile *file,
+					GFile *other_file,
+					GFileMonitorEvent event,
+					gpointer data );
+static void queue_rescan(GmpvLibraryCatalog *catalog);
+static gboolean rescan_handler(gpointer data);
+static void rescan_finished_handler(	GmpvFolderImporter *importer,
+					gpointer data );
+static void load(GmpvLibraryCatalog *catalog);
+static GVariant *take_snapshot(GmpvLibraryCatalog *catalog);
+static gboolean write_snapshot(	const gchar *path,
+				GVariant *snapshot,
+				GError **error );
+static void save_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable );
+static void save_ready_handler(	GObject *source_object,
+				GAsyncResult *res,
+				gpointer data );
+static void save_async(GmpvLibraryCatalog *catalog);
+static gboolean save_handler(gpointer data);
+
+G_DEFINE_TYPE(GmpvLibraryCatalog, gmpv_library_catalog, G_TYPE_OBJECT)
+
+static void dispose(GObject *object)
+{
+	GmpvLibraryCatalog *catalog = GMPV_LIBRARY_CATALOG(object);
+	GVariant *snapshot = NULL;
+	guint pending_source_id = 0;
+
+	if(catalog->rescanner)
+	{
+		g_signal_handlers_disconnect_by_data(catalog->rescanner, catalog);
+		gmpv_folder_importer_cancel(catalog->rescanner);
+		g_clear_object(&catalog->rescanner);
+	}
+
+	if(catalog->rescan_source_id > 0)
+	{
+		g_source_remove(catalog->rescan_source_id);
+		catalog->rescan_source_id = 0;
+	}
+
+	g_mutex_lock(&catalog->lock);
+	pending_source_id = catalog->pending_source_id;
+	catalog->pending_source_id = 0;
+	g_mutex_unlock(&catalog->lock);
+
+	if(pending_source_id > 0)
+	{
+		g_source_remove(pending_source_id);
+	}
+
+	if(catalog->save_source_id > 0)
+	{
+		g_source_remove(catalog->save_source_id);
+		catalog->save_source_id = 0;
+	}
+
+	/* Saves in progress hold a reference, so none is running by now. The
+	 * last changes are written right away, as nothing would be left to
+	 * finish a background save.
+	 */
+	snapshot = take_snapshot(catalog);
+
+	if(snapshot)
+	{
+		GError *error = NULL;
+
+		if(!write_snapshot(catalog->path, snapshot, &error))
+		{
+			g_warning(	"Failed to save library catalog %s: %s",
+					catalog->path,
+					error->message );
+
+			g_error_free(error);
+		}
+
+		g_variant_unref(snapshot);
+	}
+
+	if(catalog->cache)
+	{
+		g_signal_handlers_disconnect_by_data(catalog->cache, catalog);
+		g_clear_object(&catalog->cache);
+	}
+
+	g_clear_object(&catalog->fingerprint_service);
+	g_hash_table_remove_all(catalog->monitors);
+
+	G_OBJECT_CLASS(gmpv_library_catalog_parent_class)->dispose(object);
+}
+
+static void finalize(GObject *object)
+{
+	GmpvLibraryCatalog *catalog = GMPV_LIBRARY_CATALOG(object);
+
+	g_free(catalog->path);
+	g_mutex_clear(&catalog->lock);
+	g_hash_table_unref(catalog->folders);
+	g_hash_table_unref(catalog->files);
+	g_hash_table_unref(catalog->stale);
+	g_ptr_array_free(catalog->unwatched, TRUE);
+	g_ptr_array_free(catalog->unfingerprinted, TRUE);
+	g_hash_table_unref(catalog->monitors);
+	g_hash_table_unref(catalog->rescan_paths);
+
+	G_OBJECT_CLASS(gmpv_library_catalog_parent_class)->finalize(object);
+}
+
+static LibraryFile *library_file_new(void)
+{
+	LibraryFile *file = g_new0(LibraryFile, 1);
+
+	file->tags =	g_ptr_array_new_with_free_func
+			((GDestroyNotify)gmpv_metadata_entry_free);
+
+	return file;
+}
+
+static void library_file_free(LibraryFile *file)
+{
+	g_free(file->title);
+	g_ptr_array_free(file->tags, TRUE);
+	g_free(file);
+}
+
+static GmpvLibraryFolder *library_folder_copy(const GmpvLibraryFolder *folder)
+{
+	GmpvLibraryFolder *copy = gmpv_library_folder_new(folder->mtime);
+
+	for(guint i = 0; i < folder->files->len; i++)
+	{
+		g_ptr_array_add(	copy->files,
+					g_strdup(g_ptr_array_index(folder->files, i)) );
+	}
+
+	for(guint i = 0; i < folder->subfolders->len; i++)
+	{
+		const gchar *name = g_ptr_array_index(folder->subfolders, i);
+		const gchar *id = g_ptr_array_index(folder->subfolder_ids, i);
+
+		g_ptr_array_add(copy->subfolders, g_strdup(name));
+		g_ptr_array_add(copy->subfolder_ids, g_strdup(id));
+	}
+
+	return copy;
+}
+
+static void monitor_free(GFileMonitor *monitor)
+{
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
+}
+
+/* Must be called with the lock held */
+static void queue_pending(GmpvLibraryCatalog *catalog)
+{
+	if(catalog->pending_source_id == 0)
+	{
+		catalog->pending_source_id =	g_idle_add
+						(process_pending_handler, catalog);
+	}
+}
+
+/* Does the work that has to happen in the default main context on behalf
+ * of the threads that changed the catalog.
+ */
+static gboolean process_pending_handler(gpointer data)
+{
+	GmpvLibraryCatalog *catalog = data;
+	GPtrArray *unwatched = NULL;
+	GPtrArray *unfingerprinted = NULL;
+	gboolean dirty = FALSE;
+
+	g_mutex_lock(&catalog->lock);
+
+	unwatched = catalog->unwatched;
+	unfingerprinted = catalog->unfingerprinted;
+	dirty = catalog->dirty;
+
+	catalog->unwatched = g_ptr_array_new_with_free_func(g_free);
+	catalog->unfingerprinted = g_ptr_array_new_with_free_func(g_free);
+	catalog->pending_source_id = 0;
+
+	g_mutex_unlock(&catalog->lock);
+
+	if(!catalog->cache)
+	{
+		catalog->cache = gmpv_metadata_cache_get_default();
+
+		g_signal_connect(	catalog->cache,
+					"update",
+					G_CALLBACK(cache_update_handler),
+					catalog );
+	}
+
+	if(!catalog->fingerprint_service)
+	{
+		catalog->fingerprint_service
+			= gmpv_fingerprint_service_get_default();
+	}
+
+	for(guint i = 0; i < unwatched->len; i++)
+	{
+		watch_folder(catalog, g_ptr_array_index(unwatched, i));
+	}
+
+	for(guint i = 0; i < unfingerprinted->len; i++)
+	{
+		gmpv_fingerprint_service_request
+			(	catalog->fingerprint_service,
+				g_ptr_array_index(unfingerprinted, i) );
+	}
+
+	if(dirty && catalog->save_source_id == 0)
+	{
+		catalog->save_source_id =	g_timeout_add_seconds
+						(	LIBRARY_CATALOG_SAVE_DELAY,
+							save_handler,
+							catalog );
+	}
+
+	g_ptr_array_free(unwatched, TRUE);
+	g_ptr_array_free(unfingerprinted, TRUE);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Must be called with the lock held */
+static void remove_folder(GmpvLibraryCatalog *catalog, const gchar *path)
+{
+	GmpvLibraryFolder *folder = g_hash_table_lookup(catalog->folders, path);
+
+	if(folder)
+	{
+		for(guint i = 0; i < folder->files->len; i++)
+		{
+			g_hash_table_remove(	catalog->files,
+						g_ptr_array_index(folder->files, i) );
+		}
+
+		for(guint i = 0; i < folder->subfolders->len; i++)
+		{
+			gchar *subfolder_path =	g_build_filename
+						(	path,
+							g_ptr_array_index
+							(folder->subfolders, i),
+							NULL );
+
+			remove_folder(catalog, subfolder_path);
+			g_free(subfolder_path);
+		}
+
+		g_hash_table_remove(catalog->stale, path);
+		g_hash_table_remove(catalog->folders, path);
+	}
+}
+
+/* Drops the files and subfolders of old_folder that are no longer in
+ * new_folder. Must be called with the lock held.
+ */
+static void remove_missing(	GmpvLibraryCatalog *catalog,
+				const gchar *path,
+				const GmpvLibraryFolder *old_folder,
+				const GmpvLibraryFolder *new_folder )
+{
+	GHashTable *names = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for(guint i = 0; i < new_folder->files->len; i++)
+	{
+		g_hash_table_add(names, g_ptr_array_index(new_folder->files, i));
+	}
+
+	for(guint i = 0; i < old_folder->files->len; i++)
+	{
+		const gchar *filename = g_ptr_array_index(old_folder->files, i);
+
+		if(!g_hash_table_contains(names, filename))
+		{
+			g_hash_table_remove(catalog->files, filename);
+		}
+	}
+
+	g_hash_table_remove_all(names);
+
+	for(guint i = 0; i < new_folder->subfolders->len; i++)
+	{
+		g_hash_table_add
+			(names, g_ptr_array_index(new_folder->subfolders, i));
+	}
+
+	for(guint i = 0; i < old_folder->subfolders->len; i++)
+	{
+		const gchar *name = g_ptr_array_index(old_folder->subfolders, i);
+
+		if(!g_hash_table_contains(names, name))
+		{
+			gchar *subfolder_path = g_build_filename(path, name, NULL);
+
+			remove_folder(catalog, subfolder_path);
+			g_free(subfolder_path);
+		}
+	}
+
+	g_hash_table_unref(names);
+}
+
+static GmpvPlaylistEntry *file_to_entry(	const gchar *filename,
+						const LibraryFile *file )
+{
+	GmpvPlaylistEntry *entry =	gmpv_playlist_entry_new
+					(filename, file?file->title:NULL);
+
+	entry->duration = file?file->duration:0;
+
+	return entry;
+}
+
+static void cache_update_handler(	GmpvMetadataCache *cache,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvLibraryCatalog *catalog = data;
+	GmpvMetadataCacheEntry *entry = gmpv_metadata_cache_peek(cache, uri);
+	LibraryFile *file = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	file = entry?g_hash_table_lookup(catalog->files, uri):NULL;
+
+	if(file)
+	{
+		g_free(file->title);
+		g_ptr_array_set_size(file->tags, 0);
+
+		file->title = g_strdup(entry->title);
+		file->duration = entry->duration;
+
+		for(guint i = 0; i < entry->tags->len; i++)
+		{
+			GmpvMetadataEntry *tag = g_ptr_array_index(entry->tags, i);
+
+			g_ptr_array_add(	file->tags,
+						gmpv_metadata_entry_new
+						(tag->key, tag->value) );
+		}
+
+		catalog->dirty = TRUE;
+		queue_pending(catalog);
+	}
+
+	g_mutex_unlock(&catalog->lock);
+}
+
+static void watch_folder(GmpvLibraryCatalog *catalog, const gchar *path)
+{
+	/* Each monitor uses up an inotify watch, which are limited */
+	if(	!g_hash_table_contains(catalog->monitors, path) &&
+		g_hash_table_size(catalog->monitors)
+		< LIBRARY_CATALOG_MAX_MONITORS )
+	{
+		GFile *folder = g_file_new_for_path(path);
+		GFileMonitor *monitor =	g_file_monitor_directory
+					(folder, G_FILE_MONITOR_NONE, NULL, NULL);
+
+		if(monitor)
+		{
+			g_object_set_data_full(	G_OBJECT(monitor),
+						"path",
+						g_strdup(path),
+						g_free );
+			g_signal_connect(	monitor,
+						"changed",
+						G_CALLBACK(folder_changed_handler),
+						catalog );
+			g_hash_table_insert
+				(catalog->monitors, g_strdup(path), monitor);
+		}
+
+		g_object_unref(folder);
+	}
+}
+
+static void folder_changed_handler(	GFileMonitor *monitor,
+					GFile *file,
+					GFile *other_file,
+					GFileMonitorEvent event,
+					gpointer data )
+{
+	GmpvLibraryCatalog *catalog = data;
+	const gchar *path = g_object_get_data(G_OBJECT(monitor), "path");
+
+	if(	event == G_FILE_MONITOR_EVENT_CREATED ||
+		event == G_FILE_MONITOR_EVENT_DELETED ||
+		event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT )
+	{
+		gboolean known = FALSE;
+
+		g_mutex_lock(&catalog->lock);
+
+		known = g_hash_table_contains(catalog->folders, path);
+
+		if(known)
+		{
+			g_hash_table_add(catalog->stale, g_strdup(path));
+		}
+
+		g_mutex_unlock(&catalog->lock);
+
+		if(known)
+		{
+			g_hash_table_add(catalog->rescan_paths, g_strdup(path));
+			queue_rescan(catalog);
+		}
+		else
+		{
+			/* The folder has been dropped from the catalog */
+			g_hash_table_remove(catalog->monitors, path);
+		}
+	}
+}
+
+/* Changes tend to come in bursts, such as when files are being copied, so
+ * rescans are delayed until things settle down.
+ */
+static void queue_rescan(GmpvLibraryCatalog *catalog)
+{
+	if(!catalog->rescanner)
+	{
+		if(catalog->rescan_source_id > 0)
+		{
+			g_source_remove(catalog->rescan_source_id);
+		}
+
+		catalog->rescan_source_id =	g_timeout_add_seconds
+						(	LIBRARY_CATALOG_RESCAN_DELAY,
+							rescan_handler,
+							catalog );
+	}
+}
+
+/* Only the stale folders are read again. Their subfolders are looked up in
+ * the catalog like any other import, so unchanged ones are just stat'ed.
+ */
+static gboolean rescan_handler(gpointer data)
+{
+	GmpvLibraryCatalog *catalog = data;
+	GHashTableIter iter;
+	gpointer path = NULL;
+
+	catalog->rescan_source_id = 0;
+	catalog->rescanner = gmpv_folder_importer_new();
+
+	g_signal_connect(	catalog->rescanner,
+				"finished",
+				G_CALLBACK(rescan_finished_handler),
+				catalog );
+
+	g_hash_table_iter_init(&iter, catalog->rescan_paths);
+
+	while(g_hash_table_iter_next(&iter, &path, NULL))
+	{
+		GFile *folder = g_file_new_for_path(path);
+
+		g_debug("Rescanning %s", (const gchar *)path);
+		gmpv_folder_importer_add(catalog->rescanner, folder);
+
+		g_object_unref(folder);
+	}
+
+	g_hash_table_remove_all(catalog->rescan_paths);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void rescan_finished_handler(	GmpvFolderImporter *importer,
+					gpointer data )
+{
+	GmpvLibraryCatalog *catalog = data;
+
+	g_signal_handlers_disconnect_by_data(importer, catalog);
+	g_clear_object(&catalog->rescanner);
+
+	if(g_hash_table_size(catalog->rescan_paths) > 0)
+	{
+		queue_rescan(catalog);
+	}
+}
+
+static void load(GmpvLibraryCatalog *catalog)
+{
+	GMappedFile *file = g_mapped_file_new(catalog->path, FALSE, NULL);
+	GBytes *bytes = file?g_mapped_file_get_bytes(file):NULL;
+	gsize size = bytes?g_bytes_get_size(bytes):0;
+	const gchar *data = bytes?g_bytes_get_data(bytes, NULL):NULL;
+
+	if(	size >= LIBRARY_CATALOG_MAGIC_SIZE &&
+		memcmp(	data,
+			LIBRARY_CATALOG_MAGIC,
+			LIBRARY_CATALOG_MAGIC_SIZE ) == 0 )
+	{
+		GBytes *body = NULL;
+		GVariant *value = NULL;
+		GVariant *folders = NULL;
+		GVariant *files = NULL;
+		GVariant *tags = NULL;
+		GVariantIter iter;
+		const gchar *path = NULL;
+		const gchar *title = NULL;
+		const gchar **filenames = NULL;
+		const gchar **subfolders = NULL;
+		const gchar **subfolder_ids = NULL;
+		gint64 file_size = 0;
+		gint64 mtime = 0;
+		gint64 added = 0;
+		gdouble duration = 0;
+
+		body =	g_bytes_new_from_bytes
+			(	bytes,
+				LIBRARY_CATALOG_MAGIC_SIZE,
+				size - LIBRARY_CATALOG_MAGIC_SIZE );
+		value =	g_variant_new_from_bytes
+			(	G_VARIANT_TYPE(LIBRARY_CATALOG_FORMAT),
+				body,
+				FALSE );
+
+		g_variant_ref_sink(value);
+		g_variant_get(	value,
+				"(@a(sxasasas)@a(sxxxmsda(ss)))",
+				&folders,
+				&files );
+		g_variant_iter_init(&iter, folders);
+
+		while(g_variant_iter_next(	&iter,
+						"(&sx^a&s^a&s^a&s)",
+						&path,
+						&mtime,
+						&filenames,
+						&subfolders,
+						&subfolder_ids ))
+		{
+			GmpvLibraryFolder *folder = gmpv_library_folder_new(mtime);
+
+			for(guint i = 0; filenames[i]; i++)
+			{
+				g_ptr_array_add
+					(folder->files, g_strdup(filenames[i]));
+			}
+
+			for(guint i = 0; subfolders[i] && subfolder_ids[i]; i++)
+			{
+				g_ptr_array_add
+					(folder->subfolders, g_strdup(subfolders[i]));
+				g_ptr_array_add
+					(	folder->subfolder_ids,
+						g_strdup(subfolder_ids[i]) );
+			}
+
+			g_hash_table_replace
+				(catalog->folders, g_strdup(path), folder);
+
+			g_free(filenames);
+			g_free(subfolders);
+			g_free(subfolder_ids);
+		}
+
+		g_variant_iter_init(&iter, files);
+
+		while(g_variant_iter_next(	&iter,
+						"(&sxxxm&sd@a(ss))",
+						&path,
+						&file_size,
+						&mtime,
+						&added,
+						&title,
+						&duration,
+						&tags ))
+		{
+			LibraryFile *library_file = library_file_new();
+			GVariantIter tags_iter;
+			const gchar *key = NULL;
+			const gchar *tag_value = NULL;
+
+			library_file->size = file_size;
+			library_file->mtime = mtime;
+			library_file->added = added;
+			library_file->title = g_strdup(title);
+			library_file->duration = duration;
+
+			g_variant_iter_init(&tags_iter, tags);
+
+			while(g_variant_iter_next(	&tags_iter,
+							"(&s&s)",
+							&key,
+							&tag_value ))
+			{
+				g_ptr_array_add(	library_file->tags,
+							gmpv_metadata_entry_new
+							(key, tag_value) );
+			}
+
+			g_hash_table_replace
+				(catalog->files, g_strdup(path), library_file);
+
+			g_variant_unref(tags);
+		}
+
+		g_variant_unref(files);
+		g_variant_unref(folders);
+		g_variant_unref(value);
+		g_bytes_unref(body);
+	}
+
+	if(bytes)
+	{
+		g_bytes_unref(bytes);
+	}
+
+	if(file)
+	{
+		g_mapped_file_unref(file);
+	}
+}
+
+/* Copies the catalog while holding the lock, so that imports are not held
+ * up by the disk. Returns NULL if there is nothing new to save.
+ */
+static GVariant *take_snapshot(GmpvLibraryCatalog *catalog)
+{
+	GVariantBuilder folders;
+	GVariantBuilder files;
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+	GVariant *snapshot = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	if(catalog->dirty)
+	{
+		g_variant_builder_init(&folders, G_VARIANT_TYPE("a(sxasasas)"));
+		g_variant_builder_init
+			(&files, G_VARIANT_TYPE("a(sxxxmsda(ss))"));
+		g_hash_table_iter_init(&iter, catalog->folders);
+
+		while(g_hash_table_iter_next(&iter, &key, &value))
+		{
+			GmpvLibraryFolder *folder = value;
+
+			g_variant_builder_add
+				(	&folders,
+					"(sx@as@as@as)",
+					key,
+					folder->mtime,
+					g_variant_new_strv
+					(	(const gchar * const *)
+						folder->files->pdata,
+						(gssize)folder->files->len ),
+					g_variant_new_strv
+					(	(const gchar * const *)
+						folder->subfolders->pdata,
+						(gssize)folder->subfolders->len ),
+					g_variant_new_strv
+					(	(const gchar * const *)
+						folder->subfolder_ids->pdata,
+						(gssize)
+						folder->subfolder_ids->len ) );
+		}
+
+		g_hash_table_iter_init(&iter, catalog->files);
+
+		while(g_hash_table_iter_next(&iter, &key, &value))
+		{
+			LibraryFile *file = value;
+			GVariantBuilder tags;
+
+			g_variant_builder_init(&tags, G_VARIANT_TYPE("a(ss)"));
+
+			for(guint i = 0; i < file->tags->len; i++)
+			{
+				GmpvMetadataEntry *tag =	g_ptr_array_index
+								(file->tags, i);
+
+				g_variant_builder_add
+					(&tags, "(ss)", tag->key, tag->value);
+			}
+
+			g_variant_builder_add(	&files,
+						"(sxxxmsda(ss))",
+						key,
+						file->size,
+						file->mtime,
+						file->added,
+						file->title,
+						file->duration,
+						&tags );
+		}
+
+		snapshot =	g_variant_ref_sink
+				(	g_variant_new
+					(LIBRARY_CATALOG_FORMAT, &folders, &files) );
+
+		catalog->dirty = FALSE;
+	}
+
+	g_mutex_unlock(&catalog->lock);
+
+	return snapshot;
+}
+
+static gboolean write_snapshot(	const gchar *path,
+				GVariant *snapshot,
+				GError **error )
+{
+	GString *buf = g_string_new(LIBRARY_CATALOG_MAGIC);
+	gchar *dir = g_path_get_dirname(path);
+	gboolean rc = FALSE;
+
+	g_string_append_len(	buf,
+				g_variant_get_data(snapshot),
+				(gssize)g_variant_get_size(snapshot) );
+	g_mkdir_with_parents(dir, 0755);
+
+	rc = g_file_set_contents(path, buf->str, (gssize)buf->len, error);
+
+	g_string_free(buf, TRUE);
+	g_free(dir);
+
+	return rc;
+}
+
+static void save_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable )
+{
+	GmpvLibraryCatalog *catalog = source_object;
+	GError *error = NULL;
+
+	if(write_snapshot(catalog->path, task_data, &error))
+	{
+		g_task_return_boolean(task, TRUE);
+	}
+	else
+	{
+		g_task_return_error(task, error);
+	}
+}
+
+static void save_ready_handler(	GObject *source_object,
+				GAsyncResult *res,
+				gpointer data )
+{
+	GmpvLibraryCatalog *catalog = GMPV_LIBRARY_CATALOG(source_object);
+	GError *error = NULL;
+
+	if(!g_task_propagate_boolean(G_TASK(res), &error))
+	{
+		g_warning(	"Failed to save library catalog %s: %s",
+				catalog->path,
+				error->message );
+
+		/* Try again with the next save */
+		g_mutex_lock(&catalog->lock);
+		catalog->dirty = TRUE;
+		g_mutex_unlock(&catalog->lock);
+
+		g_error_free(error);
+	}
+
+	catalog->saving = FALSE;
+
+	if(catalog->save_again)
+	{
+		catalog->save_again = FALSE;
+		save_async(catalog);
+	}
+}
+
+/* The snapshot is written in a worker thread. Only one save runs at a time,
+ * so that an older snapshot never replaces a newer one.
+ */
+static void save_async(GmpvLibraryCatalog *catalog)
+{
+	GVariant *snapshot = NULL;
+
+	if(catalog->saving)
+	{
+		catalog->save_again = TRUE;
+	}
+	else
+	{
+		snapshot = take_snapshot(catalog);
+	}
+
+	if(snapshot)
+	{
+		GTask *task = g_task_new(catalog, NULL, save_ready_handler, NULL);
+
+		catalog->saving = TRUE;
+
+		g_task_set_source_tag(task, save_async);
+		g_task_set_task_data
+			(task, snapshot, (GDestroyNotify)g_variant_unref);
+		g_task_run_in_thread(task, save_thread);
+
+		g_object_unref(task);
+	}
+}
+
+static gboolean save_handler(gpointer data)
+{
+	GmpvLibraryCatalog *catalog = data;
+
+	catalog->save_source_id = 0;
+	save_async(catalog);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void gmpv_library_catalog_class_init(GmpvLibraryCatalogClass *klass)
+{
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->dispose = dispose;
+	obj_class->finalize = finalize;
+}
+
+static void gmpv_library_catalog_init(GmpvLibraryCatalog *catalog)
+{
+	gchar *config_dir = get_config_dir_path();
+
+	catalog->path =	g_build_filename
+			(config_dir, LIBRARY_CATALOG_FILENAME, NULL);
+
+	g_mutex_init(&catalog->lock);
+
+	catalog->folders =	g_hash_table_new_full
+				(	g_str_hash,
+					g_str_equal,
+					g_free,
+					(GDestroyNotify)
+					gmpv_library_folder_free );
+	catalog->files =	g_hash_table_new_full
+				(	g_str_hash,
+					g_str_equal,
+					g_free,
+					(GDestroyNotify)library_file_free );
+	catalog->stale =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	catalog->unwatched = g_ptr_array_new_with_free_func(g_free);
+	catalog->unfingerprinted = g_ptr_array_new_with_free_func(g_free);
+	catalog->dirty = FALSE;
+	catalog->pending_source_id = 0;
+	catalog->monitors =	g_hash_table_new_full
+				(	g_str_hash,
+					g_str_equal,
+					g_free,
+					(GDestroyNotify)monitor_free );
+	catalog->rescan_paths =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	catalog->rescanner = NULL;
+	catalog->cache = NULL;
+	catalog->fingerprint_service = NULL;
+	catalog->save_source_id = 0;
+	catalog->rescan_source_id = 0;
+	catalog->saving = FALSE;
+	catalog->save_again = FALSE;
+
+	load(catalog);
+
+	g_free(config_dir);
+}
+
+GmpvLibraryFolder *gmpv_library_folder_new(gint64 mtime)
+{
+	GmpvLibraryFolder *folder = g_new0(GmpvLibraryFolder, 1);
+
+	folder->mtime = mtime;
+	folder->files = g_ptr_array_new_with_free_func(g_free);
+	folder->subfolders = g_ptr_array_new_with_free_func(g_free);
+	folder->subfolder_ids = g_ptr_array_new_with_free_func(g_free);
+
+	return folder;
+}
+
+void gmpv_library_folder_free(GmpvLibraryFolder *folder)
+{
+	if(folder)
+	{
+		g_ptr_array_free(folder->files, TRUE);
+		g_ptr_array_free(folder->subfolders, TRUE);
+		g_ptr_array_free(folder->subfolder_ids, TRUE);
+		g_free(folder);
+	}
+}
+
+GmpvLibraryCatalog *gmpv_library_catalog_get_default(void)
+{
+	GmpvLibraryCatalog *catalog = NULL;
+
+	G_LOCK(default_catalog);
+
+	if(default_catalog)
+	{
+		catalog = g_object_ref(default_catalog);
+	}
+	else
+	{
+		default_catalog =	g_object_new
+					(gmpv_library_catalog_get_type(), NULL);
+		catalog = default_catalog;
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_catalog), (gpointer *)&default_catalog);
+	}
+
+	G_UNLOCK(default_catalog);
+
+	return catalog;
+}
+
+gboolean gmpv_library_catalog_contains(	GmpvLibraryCatalog *catalog,
+					const gchar *path )
+{
+	gboolean result = FALSE;
+
+	g_mutex_lock(&catalog->lock);
+	result = g_hash_table_contains(catalog->folders, path);
+	g_mutex_unlock(&catalog->lock);
+
+	return result;
+}
+
+GmpvLibraryFolder *gmpv_library_catalog_lookup(	GmpvLibraryCatalog *catalog,
+						const gchar *path,
+						gint64 mtime )
+{
+	GmpvLibraryFolder *folder = NULL;
+	GmpvLibraryFolder *result = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	folder = g_hash_table_lookup(catalog->folders, path);
+
+	/* Adding or removing files changes the modification time of the
+	 * folder, while changes that leave it alone are caught by monitors.
+	 */
+	if(	folder &&
+		folder->mtime == mtime &&
+		!g_hash_table_contains(catalog->stale, path) )
+	{
+		result = library_folder_copy(folder);
+
+		g_ptr_array_add(catalog->unwatched, g_strdup(path));
+		queue_pending(catalog);
+	}
+
+	g_mutex_unlock(&catalog->lock);
+
+	return result;
+}
+
+void gmpv_library_catalog_add_folder(	GmpvLibraryCatalog *catalog,
+					const gchar *path,
+					GmpvLibraryFolder *folder )
+{
+	GmpvLibraryFolder *old_folder = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	old_folder = g_hash_table_lookup(catalog->folders, path);
+
+	if(old_folder)
+	{
+		remove_missing(catalog, path, old_folder, folder);
+	}
+
+	g_hash_table_replace(catalog->folders, g_strdup(path), folder);
+	g_hash_table_remove(catalog->stale, path);
+	g_ptr_array_add(catalog->unwatched, g_strdup(path));
+
+	catalog->dirty = TRUE;
+	queue_pending(catalog);
+
+	g_mutex_unlock(&catalog->lock);
+}
+
+void gmpv_library_catalog_add_file(	GmpvLibraryCatalog *catalog,
+					const gchar *filename,
+					gint64 size,
+					gint64 mtime )
+{
+	LibraryFile *file = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	file = g_hash_table_lookup(catalog->files, filename);
+
+	if(!file || file->size != size || file->mtime != mtime)
+	{
+		if(!file)
+		{
+			file = library_file_new();
+			file->added = g_get_real_time()/G_USEC_PER_SEC;
+
+			g_hash_table_insert
+				(catalog->files, g_strdup(filename), file);
+		}
+		else
+		{
+			/* The file has been replaced, so what was probed from
+			 * the old one no longer applies.
+			 */
+			g_clear_pointer(&file->title, g_free);
+			g_ptr_array_set_size(file->tags, 0);
+
+			file->duration = 0;
+		}
+
+		file->size = size;
+		file->mtime = mtime;
+
+		g_ptr_array_add(catalog->unfingerprinted, g_strdup(filename));
+
+		catalog->dirty = TRUE;
+		queue_pending(catalog);
+	}
+
+	g_mutex_unlock(&catalog->lock);
+}
+
+GmpvPlaylistEntry *gmpv_library_catalog_get_entry(	GmpvLibraryCatalog *catalog,
+							const gchar *filename )
+{
+	GmpvPlaylistEntry *entry = NULL;
+
+	g_mutex_lock(&catalog->lock);
+
+	entry =	file_to_entry
+		(filename, g_hash_table_lookup(catalog->files, filename));
+
+	g_mutex_unlock(&catalog->lock);
+
+	return entry;
+}
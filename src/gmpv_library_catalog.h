@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBRARY_CATALOG_H
+#define LIBRARY_CATALOG_H
+
+#include <glib-object.h>
+
+#include "gmpv_common.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GmpvLibraryFolder GmpvLibraryFolder;
+
+/* The listing of a folder as seen by the folder importer. Files are full
+ * filenames of the media files in the folder, and subfolders are names,
+ * along with the G_FILE_ATTRIBUTE_ID_FILE of each of them, or an empty
+ * string if unknown. Both are in the order they are imported in.
+ */
+struct _GmpvLibraryFolder
+{
+	gint64 mtime;
+	GPtrArray *files;
+	GPtrArray *subfolders;
+	GPtrArray *subfolder_ids;
+};
+
+#define GMPV_TYPE_LIBRARY_CATALOG (gmpv_library_catalog_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvLibraryCatalog, gmpv_library_catalog, GMPV, LIBRARY_CATALOG, GObject)
+
+GmpvLibraryFolder *gmpv_library_folder_new(gint64 mtime);
+void gmpv_library_folder_free(GmpvLibraryFolder *folder);
+
+/* Remembers the folders scanned by the folder importer, so that unchanged
+ * folders only need to be stat'ed instead of read again. The catalog also
+ * keeps the size, modification time, time of addition and the probed
+ * title, duration and tags of every file, and is saved to the config
+ * directory shortly after it changes, so an interrupted scan picks up
+ * where it left off.
+ *
+ * Folders are watched while the program runs. A folder that changes is
+ * imported again on its own.
+ *
+ * The catalog may be used from the threads running folder imports. The
+ * monitors and timers always run in the default main context.
+ */
+GmpvLibraryCatalog *gmpv_library_catalog_get_default(void);
+gboolean gmpv_library_catalog_contains(	GmpvLibraryCatalog *catalog,
+					const gchar *path );
+GmpvLibraryFolder *gmpv_library_catalog_lookup(	GmpvLibraryCatalog *catalog,
+						const gchar *path,
+						gint64 mtime );
+void gmpv_library_catalog_add_folder(	GmpvLibraryCatalog *catalog,
+					const gchar *path,
+					GmpvLibraryFolder *folder );
+void gmpv_library_catalog_add_file(	GmpvLibraryCatalog *catalog,
+					const gchar *filename,
+					gint64 size,
+					gint64 mtime );
+GmpvPlaylistEntry *gmpv_library_catalog_get_entry(	GmpvLibraryCatalog *catalog,
+							const gchar *filename );
+
+G_END_DECLS
+
+#endif
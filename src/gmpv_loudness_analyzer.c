@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gmpv_loudness_analyzer.h"
+#include "gmpv_fingerprint_service.h"
+#include "gmpv_mpv.h"
+#include "gmpv_mpv_wrapper.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+/* The index starts with LOUDNESS_INDEX_MAGIC, followed by a GVariant of type
+ * LOUDNESS_INDEX_FORMAT holding the fingerprint, integrated loudness in LUFS
+ * and true peak in dBTP of every analyzed file.
+ */
+#define LOUDNESS_INDEX_MAGIC "GMPVLDN1"
+#define LOUDNESS_INDEX_MAGIC_SIZE (sizeof(LOUDNESS_INDEX_MAGIC) - 1)
+#define LOUDNESS_INDEX_FORMAT "a(sdd)"
+
+/* Frame metadata set by the ebur128 filter of FFmpeg. Both values cover
+ * everything that has been decoded so far, so the last ones reported before
+ * the end of the file apply to the whole file. Peaks are linear.
+ */
+#define LOUDNESS_ANALYSIS_LABEL "loudness"
+#define LOUDNESS_ANALYSIS_FILTER	"@" LOUDNESS_ANALYSIS_LABEL ":lavfi=" \
+					"[ebur128=peak=true:metadata=1]"
+#define LOUDNESS_INTEGRATED_KEY "lavfi.r128.I"
+#define LOUDNESS_TRUE_PEAK_PREFIX "lavfi.r128.true_peaks_ch"
+
+/* Anything quieter is below the absolute gate of EBU R128, which is what
+ * the filter reports for silence.
+ */
+#define LOUDNESS_MIN_LEVEL (-70.0)
+
+typedef struct LoudnessRecord LoudnessRecord;
+
+struct LoudnessRecord
+{
+	gdouble loudness;
+	gdouble peak;
+};
+
+struct _GmpvLoudnessAnalyzer
+{
+	GObject parent;
+	gchar *path;
+	GHashTable *records;
+	GHashTable *requested;
+	GHashTable *waiting;
+	GQueue *queue;
+	GmpvFingerprintService *fingerprint_service;
+	GmpvMpv *decoder;
+	GPtrArray *batch;
+	gint64 current;
+	gdouble loudness;
+	gdouble peak;
+	gboolean measured;
+	guint analyze_source_id;
+	guint save_source_id;
+};
+
+struct _GmpvLoudnessAnalyzerClass
+{
+	GObjectClass parent_class;
+};
+
+static GmpvLoudnessAnalyzer *default_analyzer = NULL;
+
+static void dispose(GObject *object);
+static void finalize(GObject *object);
+static void stop_decoder(GmpvLoudnessAnalyzer *analyzer);
+static void mpv_event_notify(	GmpvMpv *mpv,
+				gint event_id,
+				gpointer event_data,
+				gpointer data );
+static void mpv_property_changed(	GmpvMpv *mpv,
+					const gchar *name,
+					gpointer value,
+					gpointer data );
+static void shutdown_handler(GmpvMpv *mpv, gpointer data);
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data );
+static void store_result(GmpvLoudnessAnalyzer *analyzer, const gchar *uri);
+static gboolean analyze_handler(gpointer data);
+static void queue_analysis(GmpvLoudnessAnalyzer *analyzer);
+static void load_index(GmpvLoudnessAnalyzer *analyzer);
+static void save_index(GmpvLoudnessAnalyzer *analyzer);
+static gboolean save_index_handler(gpointer data);
+static void queue_save(GmpvLoudnessAnalyzer *analyzer);
+
+G_DEFINE_TYPE(GmpvLoudnessAnalyzer, gmpv_loudness_analyzer, G_TYPE_OBJECT)
+
+static void dispose(GObject *object)
+{
+	GmpvLoudnessAnalyzer *analyzer = GMPV_LOUDNESS_ANALYZER(object);
+
+	if(analyzer->analyze_source_id > 0)
+	{
+		g_source_remove(analyzer->analyze_source_id);
+		analyzer->analyze_source_id = 0;
+	}
+
+	if(analyzer->save_source_id > 0)
+	{
+		g_source_remove(analyzer->save_source_id);
+		analyzer->save_source_id = 0;
+
+		save_index(analyzer);
+	}
+
+	stop_decoder(analyzer);
+
+	if(analyzer->fingerprint_service)
+	{
+		g_signal_handlers_disconnect_by_data
+			(analyzer->fingerprint_service, analyzer);
+		g_clear_object(&analyzer->fingerprint_service);
+	}
+
+	G_OBJECT_CLASS(gmpv_loudness_analyzer_parent_class)->dispose(object);
+}
+
+static void finalize(GObject *object)
+{
+	GmpvLoudnessAnalyzer *analyzer = GMPV_LOUDNESS_ANALYZER(object);
+
+	g_ptr_array_unref(analyzer->batch);
+	g_queue_free_full(analyzer->queue, g_free);
+	g_hash_table_unref(analyzer->waiting);
+	g_hash_table_unref(analyzer->requested);
+	g_hash_table_unref(analyzer->records);
+	g_free(analyzer->path);
+
+	G_OBJECT_CLASS(gmpv_loudness_analyzer_parent_class)->finalize(object);
+}
+
+static void stop_decoder(GmpvLoudnessAnalyzer *analyzer)
+{
+	if(analyzer->decoder)
+	{
+		g_signal_handlers_disconnect_by_data(analyzer->decoder, analyzer);
+		g_clear_object(&analyzer->decoder);
+	}
+
+	g_ptr_array_set_size(analyzer->batch, 0);
+
+	analyzer->current = -1;
+	analyzer->measured = FALSE;
+}
+
+static void mpv_event_notify(	GmpvMpv *mpv,
+				gint event_id,
+				gpointer event_data,
+				gpointer data )
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+
+	if(event_id == MPV_EVENT_FILE_LOADED)
+	{
+		gint64 playlist_pos = -1;
+
+		/* Files are loaded in the order of the batch, so the position
+		 * identifies the URI even if mpv reports a different path.
+		 */
+		gmpv_mpv_get_property(	mpv,
+					"playlist-pos",
+					MPV_FORMAT_INT64,
+					&playlist_pos );
+
+		analyzer->current = playlist_pos;
+		analyzer->loudness = LOUDNESS_MIN_LEVEL;
+		analyzer->peak = 0;
+		analyzer->measured = FALSE;
+	}
+	else if(event_id == MPV_EVENT_END_FILE)
+	{
+		mpv_event_end_file *event = event_data;
+		gint64 current = analyzer->current;
+
+		if(	event->reason == MPV_END_FILE_REASON_EOF &&
+			analyzer->measured &&
+			current >= 0 &&
+			(guint64)current < analyzer->batch->len )
+		{
+			store_result(	analyzer,
+					g_ptr_array_index
+					(analyzer->batch, (guint)current) );
+		}
+		else if(event->reason == MPV_END_FILE_REASON_ERROR)
+		{
+			g_debug("Failed to analyze loudness");
+		}
+
+		analyzer->current = -1;
+		analyzer->measured = FALSE;
+	}
+}
+
+static void mpv_property_changed(	GmpvMpv *mpv,
+					const gchar *name,
+					gpointer value,
+					gpointer data )
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+	mpv_node *metadata = value;
+
+	if(	analyzer->current >= 0 &&
+		metadata &&
+		metadata->format == MPV_FORMAT_NODE_MAP &&
+		g_strcmp0(name, "af-metadata/" LOUDNESS_ANALYSIS_LABEL) == 0 )
+	{
+		mpv_node_list *list = metadata->u.list;
+
+		for(gint i = 0; i < list->num; i++)
+		{
+			const gchar *key = list->keys[i];
+			mpv_node node = list->values[i];
+
+			if(node.format != MPV_FORMAT_STRING)
+			{
+				continue;
+			}
+
+			if(g_strcmp0(key, LOUDNESS_INTEGRATED_KEY) == 0)
+			{
+				analyzer->loudness =	g_ascii_strtod
+							(node.u.string, NULL);
+				analyzer->measured = TRUE;
+			}
+			else if(g_str_has_prefix(key, LOUDNESS_TRUE_PEAK_PREFIX))
+			{
+				gdouble peak = g_ascii_strtod(node.u.string, NULL);
+
+				analyzer->peak = MAX(analyzer->peak, peak);
+			}
+		}
+	}
+}
+
+static void shutdown_handler(GmpvMpv *mpv, gpointer data)
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+
+	stop_decoder(analyzer);
+
+	if(!g_queue_is_empty(analyzer->queue))
+	{
+		queue_analysis(analyzer);
+	}
+}
+
+/* Files that were set aside because their fingerprint was not known yet
+ * are requested again as soon as it is.
+ */
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+
+	if(	g_hash_table_remove(analyzer->waiting, uri) &&
+		gmpv_fingerprint_service_lookup(service, uri) )
+	{
+		gmpv_loudness_analyzer_request(analyzer, uri);
+	}
+}
+
+static void store_result(GmpvLoudnessAnalyzer *analyzer, const gchar *uri)
+{
+	const gchar *fingerprint = NULL;
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(analyzer->fingerprint_service, uri);
+
+	if(fingerprint && analyzer->loudness > LOUDNESS_MIN_LEVEL)
+	{
+		LoudnessRecord *record = g_new0(LoudnessRecord, 1);
+
+		record->loudness = analyzer->loudness;
+		record->peak =	analyzer->peak > 0?
+				20*log10(analyzer->peak):
+				LOUDNESS_MIN_LEVEL;
+
+		g_debug(	"Measured loudness of %s: %.1f LUFS, "
+				"true peak %.1f dBTP",
+				uri,
+				record->loudness,
+				record->peak );
+
+		g_hash_table_replace(	analyzer->records,
+					g_strdup(fingerprint),
+					record );
+		queue_save(analyzer);
+	}
+}
+
+static gboolean analyze_handler(gpointer data)
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+
+	analyzer->analyze_source_id = 0;
+
+	if(analyzer->decoder)
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Files whose fingerprint is not known yet are set aside until it is,
+	 * since results are stored by fingerprint.
+	 */
+	for(	gchar *uri = g_queue_pop_tail(analyzer->queue);
+		uri;
+		uri = g_queue_pop_tail(analyzer->queue) )
+	{
+		const gchar *fingerprint = NULL;
+
+		fingerprint =	gmpv_fingerprint_service_lookup
+				(analyzer->fingerprint_service, uri);
+
+		if(	fingerprint &&
+			!g_hash_table_contains(analyzer->records, fingerprint) )
+		{
+			g_ptr_array_add(analyzer->batch, uri);
+		}
+		else
+		{
+			if(!fingerprint)
+			{
+				g_hash_table_add(analyzer->waiting, g_strdup(uri));
+			}
+
+			g_hash_table_remove(analyzer->requested, uri);
+			g_free(uri);
+		}
+	}
+
+	if(analyzer->batch->len == 0)
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	analyzer->decoder = gmpv_mpv_new(0);
+
+	g_signal_connect(	analyzer->decoder,
+				"mpv-event-notify",
+				G_CALLBACK(mpv_event_notify),
+				analyzer );
+	g_signal_connect(	analyzer->decoder,
+				"mpv-property-changed",
+				G_CALLBACK(mpv_property_changed),
+				analyzer );
+	g_signal_connect(	analyzer->decoder,
+				"shutdown",
+				G_CALLBACK(shutdown_handler),
+				analyzer );
+
+	/* Only the audio is decoded, and ao-null-untimed lets it run as fast
+	 * as it can be decoded instead of in real time.
+	 */
+	gmpv_mpv_set_option_string(analyzer->decoder, "ao", "null");
+	gmpv_mpv_set_option_string(analyzer->decoder, "ao-null-untimed", "yes");
+	gmpv_mpv_set_option_string(analyzer->decoder, "vo", "null");
+	gmpv_mpv_set_option_string(analyzer->decoder, "vid", "no");
+	gmpv_mpv_set_option_string(analyzer->decoder, "sid", "no");
+	gmpv_mpv_set_option_string(analyzer->decoder, "audio-display", "no");
+	gmpv_mpv_set_option_string(analyzer->decoder, "idle", "once");
+	gmpv_mpv_set_option_string(analyzer->decoder, "ytdl", "no");
+	gmpv_mpv_set_option_string
+		(analyzer->decoder, "af", LOUDNESS_ANALYSIS_FILTER);
+	gmpv_mpv_initialize(analyzer->decoder);
+	gmpv_mpv_observe_property(	analyzer->decoder,
+					0,
+					"af-metadata/" LOUDNESS_ANALYSIS_LABEL,
+					MPV_FORMAT_NODE );
+
+	for(guint i = 0; i < analyzer->batch->len; i++)
+	{
+		const gchar *uri = g_ptr_array_index(analyzer->batch, i);
+
+		g_debug("Queuing %s for loudness analysis", uri);
+		gmpv_mpv_load_file(analyzer->decoder, uri, TRUE);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* The analysis decodes whole files, so it waits for the player to settle
+ * down and only runs when nothing more important is pending.
+ */
+static void queue_analysis(GmpvLoudnessAnalyzer *analyzer)
+{
+	if(analyzer->analyze_source_id == 0)
+	{
+		analyzer->analyze_source_id =	g_timeout_add_seconds_full
+						(	G_PRIORITY_LOW,
+							LOUDNESS_ANALYSIS_DELAY,
+							analyze_handler,
+							analyzer,
+							NULL );
+	}
+}
+
+static void load_index(GmpvLoudnessAnalyzer *analyzer)
+{
+	GMappedFile *file = g_mapped_file_new(analyzer->path, FALSE, NULL);
+	GBytes *bytes = file?g_mapped_file_get_bytes(file):NULL;
+	gsize size = bytes?g_bytes_get_size(bytes):0;
+	const gchar *data = bytes?g_bytes_get_data(bytes, NULL):NULL;
+
+	if(	size >= LOUDNESS_INDEX_MAGIC_SIZE &&
+		memcmp(	data,
+			LOUDNESS_INDEX_MAGIC,
+			LOUDNESS_INDEX_MAGIC_SIZE ) == 0 )
+	{
+		GBytes *body = NULL;
+		GVariant *value = NULL;
+		GVariantIter iter;
+		const gchar *fingerprint = NULL;
+		gdouble loudness = 0;
+		gdouble peak = 0;
+
+		body =	g_bytes_new_from_bytes
+			(	bytes,
+				LOUDNESS_INDEX_MAGIC_SIZE,
+				size - LOUDNESS_INDEX_MAGIC_SIZE );
+		value =	g_variant_new_from_bytes
+			(	G_VARIANT_TYPE(LOUDNESS_INDEX_FORMAT),
+				body,
+				FALSE );
+
+		g_variant_ref_sink(value);
+		g_variant_iter_init(&iter, value);
+
+		while(g_variant_iter_next(	&iter,
+						"(&sdd)",
+						&fingerprint,
+						&loudness,
+						&peak ))
+		{
+			LoudnessRecord *record = g_new0(LoudnessRecord, 1);
+
+			record->loudness = loudness;
+			record->peak = peak;
+
+			g_hash_table_replace
+				(analyzer->records, g_strdup(fingerprint), record);
+		}
+
+		g_variant_unref(value);
+		g_bytes_unref(body);
+	}
+
+	if(bytes)
+	{
+		g_bytes_unref(bytes);
+	}
+
+	if(file)
+	{
+		g_mapped_file_unref(file);
+	}
+}
+
+static void save_index(GmpvLoudnessAnalyzer *analyzer)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+	GVariant *index = NULL;
+	GString *buf = g_string_new(LOUDNESS_INDEX_MAGIC);
+	gchar *dir = g_path_get_dirname(analyzer->path);
+	GError *error = NULL;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE(LOUDNESS_INDEX_FORMAT));
+	g_hash_table_iter_init(&iter, analyzer->records);
+
+	while(g_hash_table_iter_next(&iter, &key, &value))
+	{
+		LoudnessRecord *record = value;
+
+		g_variant_builder_add(	&builder,
+					"(sdd)",
+					key,
+					record->loudness,
+					record->peak );
+	}
+
+	index = g_variant_ref_sink(g_variant_builder_end(&builder));
+
+	g_string_append_len(	buf,
+				g_variant_get_data(index),
+				(gssize)g_variant_get_size(index) );
+	g_mkdir_with_parents(dir, 0755);
+
+	if(!g_file_set_contents(	analyzer->path,
+					buf->str,
+					(gssize)buf->len,
+					&error ))
+	{
+		g_warning(	"Failed to save loudness index %s: %s",
+				analyzer->path,
+				error->message );
+
+		g_error_free(error);
+	}
+
+	g_variant_unref(index);
+	g_string_free(buf, TRUE);
+	g_free(dir);
+}
+
+static gboolean save_index_handler(gpointer data)
+{
+	GmpvLoudnessAnalyzer *analyzer = data;
+
+	analyzer->save_source_id = 0;
+	save_index(analyzer);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void queue_save(GmpvLoudnessAnalyzer *analyzer)
+{
+	if(analyzer->save_source_id == 0)
+	{
+		analyzer->save_source_id =	g_timeout_add_seconds
+						(	LOUDNESS_SAVE_DELAY,
+							save_index_handler,
+							analyzer );
+	}
+}
+
+static void gmpv_loudness_analyzer_class_init(GmpvLoudnessAnalyzerClass *klass)
+{
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->dispose = dispose;
+	obj_class->finalize = finalize;
+}
+
+static void gmpv_loudness_analyzer_init(GmpvLoudnessAnalyzer *analyzer)
+{
+	gchar *config_dir = get_config_dir_path();
+
+	analyzer->path = g_build_filename(config_dir, LOUDNESS_FILENAME, NULL);
+	analyzer->records =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, g_free);
+	analyzer->requested =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	analyzer->waiting =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	analyzer->queue = g_queue_new();
+	analyzer->fingerprint_service = gmpv_fingerprint_service_get_default();
+	analyzer->decoder = NULL;
+	analyzer->batch = g_ptr_array_new_with_free_func(g_free);
+	analyzer->current = -1;
+	analyzer->loudness = LOUDNESS_MIN_LEVEL;
+	analyzer->peak = 0;
+	analyzer->measured = FALSE;
+	analyzer->analyze_source_id = 0;
+	analyzer->save_source_id = 0;
+
+	g_signal_connect(	analyzer->fingerprint_service,
+				"ready",
+				G_CALLBACK(fingerprint_ready_handler),
+				analyzer );
+
+	load_index(analyzer);
+
+	g_free(config_dir);
+}
+
+GmpvLoudnessAnalyzer *gmpv_loudness_analyzer_get_default(void)
+{
+	if(default_analyzer)
+	{
+		g_object_ref(default_analyzer);
+	}
+	else
+	{
+		default_analyzer =	g_object_new
+					(gmpv_loudness_analyzer_get_type(), NULL);
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_analyzer), (gpointer *)&default_analyzer);
+	}
+
+	return default_analyzer;
+}
+
+void gmpv_loudness_analyzer_request(	GmpvLoudnessAnalyzer *analyzer,
+					const gchar *uri )
+{
+	const gchar *fingerprint = NULL;
+
+	if(!uri || g_hash_table_contains(analyzer->requested, uri))
+	{
+		return;
+	}
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(analyzer->fingerprint_service, uri);
+
+	if(!fingerprint || !g_hash_table_contains(analyzer->records, fingerprint))
+	{
+		g_hash_table_add(analyzer->requested, g_strdup(uri));
+		g_queue_push_head(analyzer->queue, g_strdup(uri));
+		gmpv_fingerprint_service_request
+			(analyzer->fingerprint_service, uri);
+
+		if(!analyzer->decoder)
+		{
+			queue_analysis(analyzer);
+		}
+	}
+}
+
+gboolean gmpv_loudness_analyzer_get_gain(	GmpvLoudnessAnalyzer *analyzer,
+						const gchar *uri,
+						gdouble *gain )
+{
+	const gchar *fingerprint = NULL;
+	LoudnessRecord *record = NULL;
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(analyzer->fingerprint_service, uri);
+
+	if(fingerprint)
+	{
+		record = g_hash_table_lookup(analyzer->records, fingerprint);
+	}
+
+	if(record && gain)
+	{
+		gdouble value = LOUDNESS_TARGET-record->loudness;
+
+		value = MIN(value, LOUDNESS_PEAK_LIMIT-record->peak);
+		*gain = CLAMP(value, -LOUDNESS_MAX_GAIN, LOUDNESS_MAX_GAIN);
+	}
+
+	return record != NULL;
+}
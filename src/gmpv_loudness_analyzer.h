@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOUDNESS_ANALYZER_H
+#define LOUDNESS_ANALYZER_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GMPV_TYPE_LOUDNESS_ANALYZER (gmpv_loudness_analyzer_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvLoudnessAnalyzer, gmpv_loudness_analyzer, GMPV, LOUDNESS_ANALYZER, GObject)
+
+/* Measures the integrated loudness and true peak of local files following
+ * EBU R128. Requested files are decoded in the background by a headless mpv
+ * instance running the ebur128 filter, without any audio output, so they
+ * are analyzed as fast as they can be decoded. The analysis only starts
+ * after a short delay and at low priority, so that it does not compete with
+ * playback starting.
+ *
+ * Results are keyed by the fingerprint of the file, so they are shared by
+ * copies of the same file, and remembered in the config directory. Files
+ * without a fingerprint, such as remote ones, are never analyzed.
+ *
+ * gmpv_loudness_analyzer_get_gain() returns the gain in dB that brings a
+ * file to LOUDNESS_TARGET without pushing its true peak above
+ * LOUDNESS_PEAK_LIMIT.
+ */
+GmpvLoudnessAnalyzer *gmpv_loudness_analyzer_get_default(void);
+void gmpv_loudness_analyzer_request(	GmpvLoudnessAnalyzer *analyzer,
+					const gchar *uri );
+gboolean gmpv_loudness_analyzer_get_gain(	GmpvLoudnessAnalyzer *analyzer,
+						const gchar *uri,
+						gdouble *gain );
+
+G_END_DECLS
+
+#endif
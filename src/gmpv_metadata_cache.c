@@ -18,6 +18,7 @@
  */
 
 #include "gmpv_metadata_cache.h"
+#include "gmpv_fingerprint_service.h"
 #include "gmpv_mpv.h"
 #include "gmpv_mpv_wrapper.h"
 
@@ -25,8 +26,14 @@ struct _GmpvMetadataCache
 {
 	GObject parent;
 	GHashTable *table;
+	GHashTable *owners;
 	GmpvMpv *fetcher;
 	GQueue *fetch_queue;
+	guint fetch_source_id;
+	GmpvFingerprintService *fingerprint_service;
+	GHashTable *fingerprints;
+	GHashTable *waiting;
+	GHashTable *fingerprinting;
 };
 
 struct _GmpvMetadataCacheClass
@@ -34,17 +41,49 @@ struct _GmpvMetadataCacheClass
 	GObjectClass parent_class;
 };
 
+/* The cache is shared by every player in the process so that each URI is
+ * only fetched once regardless of how many windows have it queued.
+ */
+static GmpvMetadataCache *default_cache = NULL;
+
 static void dispose(GObject *object)
 {
-	g_clear_object(&GMPV_METADATA_CACHE(object)->fetcher);
+	GmpvMetadataCache *cache = GMPV_METADATA_CACHE(object);
+
+	if(cache->fetch_source_id > 0)
+	{
+		g_source_remove(cache->fetch_source_id);
+		cache->fetch_source_id = 0;
+	}
+
+	if(cache->fetcher)
+	{
+		g_signal_handlers_disconnect_by_data(cache->fetcher, cache);
+		g_clear_object(&cache->fetcher);
+	}
+
+	if(cache->fingerprint_service)
+	{
+		g_signal_handlers_disconnect_by_data
+			(cache->fingerprint_service, cache);
+		g_clear_object(&cache->fingerprint_service);
+	}
+
+	G_OBJECT_CLASS(gmpv_metadata_cache_parent_class)->dispose(object);
 }
 
 static void finalize(GObject *object)
 {
 	GmpvMetadataCache *cache = GMPV_METADATA_CACHE(object);
 
+	g_hash_table_unref(cache->fingerprinting);
+	g_hash_table_unref(cache->waiting);
+	g_hash_table_unref(cache->fingerprints);
+	g_hash_table_unref(cache->owners);
 	g_hash_table_unref(cache->table);
 	g_queue_free_full(cache->fetch_queue, g_free);
+
+	G_OBJECT_CLASS(gmpv_metadata_cache_parent_class)->finalize(object);
 }
 
 static void metadata_to_ptr_array(mpv_node metadata, GPtrArray *array);
@@ -52,7 +91,16 @@ static void mpv_event_notify(	GmpvMpv *mpv,
 				gint event_id,
 				gpointer event_data,
 				gpointer data );
+static void copy_entry(	GmpvMetadataCache *cache,
+			const gchar *uri,
+			const gchar *src_uri );
+static void fingerprint_loaded(GmpvMetadataCache *cache, const gchar *uri);
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data );
 static gboolean fetch_metadata(GmpvMetadataCache *cache);
+static void queue_fetch(GmpvMetadataCache *cache);
+static void unref_counts(GmpvMetadataCache *cache, GHashTable *counts);
 static GmpvMetadataCacheEntry *gmpv_metadata_cache_entry_new(void);
 static void gmpv_metadata_cache_entry_free(GmpvMetadataCacheEntry *entry);
 
@@ -163,6 +211,8 @@ static void mpv_event_notify(	GmpvMpv *mpv,
 
 			g_signal_emit_by_name(cache, "update", path);
 
+			fingerprint_loaded(cache, path);
+
 			mpv_free(media_title);
 			mpv_free_node_contents(&metadata);
 		}
@@ -180,21 +230,231 @@ static void mpv_event_notify(	GmpvMpv *mpv,
 	}
 }
 
+static void copy_entry(	GmpvMetadataCache *cache,
+			const gchar *uri,
+			const gchar *src_uri )
+{
+	GmpvMetadataCacheEntry *src = g_hash_table_lookup(cache->table, src_uri);
+	GmpvMetadataCacheEntry *dst = g_hash_table_lookup(cache->table, uri);
+
+	if(src && dst)
+	{
+		g_ptr_array_set_size(dst->tags, 0);
+
+		/* The media title of the source falls back to its own file
+		 * name, so only a title from the tags is worth copying.
+		 */
+		for(guint i = 0; i < src->tags->len; i++)
+		{
+			GmpvMetadataEntry *tag = g_ptr_array_index(src->tags, i);
+
+			if(	!dst->title &&
+				g_ascii_strcasecmp(tag->key, "title") == 0 )
+			{
+				dst->title = g_strdup(tag->value);
+			}
+
+			g_ptr_array_add(	dst->tags,
+						gmpv_metadata_entry_new
+						(tag->key, tag->value) );
+		}
+
+		dst->duration = src->duration;
+
+		g_signal_emit_by_name(cache, "update", uri);
+	}
+}
+
+/* Hands the metadata of a file that has just been fetched to the files with
+ * the same content that were waiting for it.
+ */
+static void fingerprint_loaded(GmpvMetadataCache *cache, const gchar *uri)
+{
+	const gchar *fingerprint = NULL;
+	GPtrArray *waiting = NULL;
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(cache->fingerprint_service, uri);
+
+	if(fingerprint)
+	{
+		g_hash_table_replace(	cache->fingerprints,
+					g_strdup(fingerprint),
+					g_strdup(uri) );
+
+		waiting = g_hash_table_lookup(cache->waiting, fingerprint);
+	}
+
+	if(waiting)
+	{
+		g_ptr_array_ref(waiting);
+		g_hash_table_remove(cache->waiting, fingerprint);
+
+		for(guint i = 0; i < waiting->len; i++)
+		{
+			copy_entry(cache, g_ptr_array_index(waiting, i), uri);
+		}
+
+		g_ptr_array_unref(waiting);
+	}
+}
+
+/* Files looked up before their fingerprint was known are only queued for
+ * fetching once it is, so that duplicates can be spotted before they are
+ * loaded.
+ */
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvMetadataCache *cache = data;
+
+	if(g_hash_table_remove(cache->fingerprinting, uri))
+	{
+		if(!cache->fetcher)
+		{
+			queue_fetch(cache);
+		}
+
+		g_queue_push_head(cache->fetch_queue, g_strdup(uri));
+	}
+}
+
 static void shutdown_handler(GmpvMpv *mpv, gpointer data)
 {
 	GmpvMetadataCache *cache = data;
+	GHashTableIter iter;
+	gpointer waiting = NULL;
 
+	g_signal_handlers_disconnect_by_data(mpv, cache);
 	g_clear_object(&cache->fetcher);
 
+	/* Files whose duplicate failed to load are fetched on their own */
+	g_hash_table_iter_init(&iter, cache->waiting);
+
+	while(g_hash_table_iter_next(&iter, NULL, &waiting))
+	{
+		for(guint i = 0; i < ((GPtrArray *)waiting)->len; i++)
+		{
+			const gchar *uri = g_ptr_array_index(waiting, i);
+
+			g_queue_push_head(cache->fetch_queue, g_strdup(uri));
+		}
+	}
+
+	g_hash_table_remove_all(cache->waiting);
+
 	if(!g_queue_is_empty(cache->fetch_queue))
 	{
-		g_idle_add((GSourceFunc)fetch_metadata, cache);
+		queue_fetch(cache);
+	}
+}
+
+static void queue_fetch(GmpvMetadataCache *cache)
+{
+	if(cache->fetch_source_id == 0)
+	{
+		cache->fetch_source_id =	g_idle_add
+						((GSourceFunc)fetch_metadata, cache);
+	}
+}
+
+static void unref_counts(GmpvMetadataCache *cache, GHashTable *counts)
+{
+	GHashTableIter iter;
+	gpointer uri = NULL;
+	gpointer count = NULL;
+
+	g_hash_table_iter_init(&iter, counts);
+
+	while(g_hash_table_iter_next(&iter, &uri, &count))
+	{
+		GmpvMetadataCacheEntry *entry;
+
+		entry = g_hash_table_lookup(cache->table, uri);
+
+		if(entry)
+		{
+			entry->references -= GPOINTER_TO_INT(count);
+
+			if(entry->references <= 0)
+			{
+				g_hash_table_remove(cache->table, uri);
+			}
+		}
 	}
 }
 
 static gboolean fetch_metadata(GmpvMetadataCache *cache)
 {
-	g_assert(!cache->fetcher);
+	GPtrArray *uris = NULL;
+
+	cache->fetch_source_id = 0;
+
+	/* Lookups made by update handlers while duplicates are being resolved
+	 * below may have queued another fetch. The fetcher picks up whatever
+	 * is left in the queue once it shuts down.
+	 */
+	if(cache->fetcher)
+	{
+		return G_SOURCE_REMOVE;
+	}
+
+	uris = g_ptr_array_new_with_free_func(g_free);
+
+	/* Files with the same content as one that has already been fetched,
+	 * or is about to be, reuse its metadata instead of being loaded again.
+	 */
+	for(	gchar *uri = g_queue_pop_tail(cache->fetch_queue);
+		uri;
+		uri = g_queue_pop_tail(cache->fetch_queue) )
+	{
+		const gchar *fingerprint = NULL;
+		const gchar *source = NULL;
+		GPtrArray *waiting = NULL;
+
+		fingerprint =	gmpv_fingerprint_service_lookup
+				(cache->fingerprint_service, uri);
+
+		if(fingerprint)
+		{
+			source =	g_hash_table_lookup
+					(cache->fingerprints, fingerprint);
+			waiting =	g_hash_table_lookup
+					(cache->waiting, fingerprint);
+		}
+
+		if(source && g_hash_table_contains(cache->table, source))
+		{
+			g_debug("Reusing metadata of %s for %s", source, uri);
+			copy_entry(cache, uri, source);
+			g_free(uri);
+		}
+		else if(waiting)
+		{
+			g_ptr_array_add(waiting, uri);
+		}
+		else
+		{
+			if(fingerprint)
+			{
+				g_hash_table_insert(	cache->waiting,
+							g_strdup(fingerprint),
+							g_ptr_array_new_with_free_func
+							(g_free) );
+			}
+
+			g_ptr_array_add(uris, uri);
+		}
+	}
+
+	if(uris->len == 0)
+	{
+		g_ptr_array_free(uris, TRUE);
+
+		return G_SOURCE_REMOVE;
+	}
+
 	cache->fetcher = gmpv_mpv_new(0);
 
 	g_signal_connect(	cache->fetcher,
@@ -212,15 +472,16 @@ static gboolean fetch_metadata(GmpvMetadataCache *cache)
 	gmpv_mpv_set_option_string(cache->fetcher, "ytdl", "yes");
 	gmpv_mpv_initialize(cache->fetcher);
 
-	for(	gchar *uri = g_queue_pop_tail(cache->fetch_queue);
-		uri;
-		uri = g_queue_pop_tail(cache->fetch_queue) )
+	for(guint i = 0; i < uris->len; i++)
 	{
+		const gchar *uri = g_ptr_array_index(uris, i);
+
 		g_debug("Queuing %s for metadata fetch", uri);
 		gmpv_mpv_load_file(cache->fetcher, uri, TRUE);
-		g_free(uri);
 	}
 
+	g_ptr_array_free(uris, TRUE);
+
 	return G_SOURCE_REMOVE;
 }
 
@@ -250,8 +511,33 @@ static void gmpv_metadata_cache_init(GmpvMetadataCache *cache)
 						g_free,
 						(GDestroyNotify)
 						gmpv_metadata_cache_entry_free );
+	cache->owners = g_hash_table_new_full(	g_direct_hash,
+						g_direct_equal,
+						NULL,
+						(GDestroyNotify)
+						g_hash_table_unref );
 	cache->fetcher = NULL;
 	cache->fetch_queue = g_queue_new();
+	cache->fetch_source_id = 0;
+	cache->fingerprint_service = gmpv_fingerprint_service_get_default();
+	cache->fingerprints = g_hash_table_new_full(	g_str_hash,
+							g_str_equal,
+							g_free,
+							g_free );
+	cache->waiting = g_hash_table_new_full(	g_str_hash,
+						g_str_equal,
+						g_free,
+						(GDestroyNotify)
+						g_ptr_array_unref );
+	cache->fingerprinting = g_hash_table_new_full(	g_str_hash,
+							g_str_equal,
+							g_free,
+							NULL );
+
+	g_signal_connect(	cache->fingerprint_service,
+				"ready",
+				G_CALLBACK(fingerprint_ready_handler),
+				cache );
 }
 
 GmpvMetadataCache *gmpv_metadata_cache_new(void)
@@ -259,6 +545,23 @@ GmpvMetadataCache *gmpv_metadata_cache_new(void)
 	return g_object_new(gmpv_metadata_cache_get_type(), NULL);
 }
 
+GmpvMetadataCache *gmpv_metadata_cache_get_default(void)
+{
+	if(default_cache)
+	{
+		g_object_ref(default_cache);
+	}
+	else
+	{
+		default_cache = gmpv_metadata_cache_new();
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_cache), (gpointer *)&default_cache);
+	}
+
+	return default_cache;
+}
+
 void gmpv_metadata_cache_ref_entry(GmpvMetadataCache *cache, const gchar *uri)
 {
 	gmpv_metadata_cache_lookup(cache, uri)->references++;
@@ -275,42 +578,51 @@ void gmpv_metadata_cache_unref_entry(GmpvMetadataCache *cache, const gchar *uri)
 }
 
 void gmpv_metadata_cache_load_playlist(	GmpvMetadataCache *cache,
+					gconstpointer owner,
 					const GPtrArray *playlist )
 {
-	GmpvMetadataCacheEntry *entry = NULL;
-	GHashTableIter iter;
+	GHashTable *counts = NULL;
+	GHashTable *old_counts = NULL;
 
-	g_hash_table_iter_init(&iter, cache->table);
+	counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
-	/* First, set the refrence count for all entries to zero */
-	while(g_hash_table_iter_next(&iter, NULL, (gpointer)&entry))
-	{
-		g_assert(entry);
-		entry->references = 0;
-	}
-
-	/* Then ref all entries in the playlist. This sets the reference count
-	 * to the number of times the entry appears in the playlist.
+	/* Count how many times each URI appears in the new playlist, then ref
+	 * the entries before dropping the references held for the previous
+	 * playlist of the same owner. Doing it in this order keeps entries
+	 * that are in both playlists alive, so they are not fetched again.
 	 */
 	for(guint i = 0; i < playlist->len; i++)
 	{
 		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		gpointer count = NULL;
+
+		count = g_hash_table_lookup(counts, entry->filename);
+
+		g_hash_table_replace(	counts,
+					g_strdup(entry->filename),
+					GINT_TO_POINTER(GPOINTER_TO_INT(count)+1) );
 		gmpv_metadata_cache_ref_entry(cache, entry->filename);
 	}
 
-	g_hash_table_iter_init(&iter, cache->table);
+	old_counts = g_hash_table_lookup(cache->owners, owner);
 
-	/* Remove all entries that with refrence count of zero, which means that
-	 * the entry no longer exists in the playlist.
-	 */
-	while(g_hash_table_iter_next(&iter, NULL, (gpointer)&entry))
+	if(old_counts)
 	{
-		g_assert(entry);
+		unref_counts(cache, old_counts);
+	}
 
-		if(entry->references == 0)
-		{
-			g_hash_table_iter_remove(&iter);
-		}
+	g_hash_table_replace(cache->owners, (gpointer)owner, counts);
+}
+
+void gmpv_metadata_cache_release(	GmpvMetadataCache *cache,
+					gconstpointer owner )
+{
+	GHashTable *counts = g_hash_table_lookup(cache->owners, owner);
+
+	if(counts)
+	{
+		unref_counts(cache, counts);
+		g_hash_table_remove(cache->owners, owner);
 	}
 }
 
@@ -324,14 +636,31 @@ GmpvMetadataCacheEntry *gmpv_metadata_cache_lookup(	GmpvMetadataCache *cache,
 		entry = gmpv_metadata_cache_entry_new();
 
 		g_hash_table_insert(cache->table, g_strdup(uri), entry);
+		gmpv_fingerprint_service_request
+			(cache->fingerprint_service, uri);
 
-		if(!cache->fetcher && g_queue_is_empty(cache->fetch_queue))
+		if(gmpv_fingerprint_service_lookup
+			(cache->fingerprint_service, uri))
 		{
-			g_idle_add((GSourceFunc)fetch_metadata, cache);
-		}
+			if(!cache->fetcher)
+			{
+				queue_fetch(cache);
+			}
 
-		g_queue_push_head(cache->fetch_queue, g_strdup(uri));
+			g_queue_push_head(cache->fetch_queue, g_strdup(uri));
+		}
+		else
+		{
+			g_hash_table_add(cache->fingerprinting, g_strdup(uri));
+		}
 	}
 
 	return entry;
 }
+
+GmpvMetadataCacheEntry *gmpv_metadata_cache_peek(	GmpvMetadataCache *cache,
+							const gchar *uri )
+{
+	/* Unlike gmpv_metadata_cache_lookup(), this does not queue a fetch */
+	return g_hash_table_lookup(cache->table, uri);
+}
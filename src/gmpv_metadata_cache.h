@@ -39,12 +39,18 @@ struct _GmpvMetadataCacheEntry
 G_DECLARE_FINAL_TYPE(GmpvMetadataCache, gmpv_metadata_cache, GMPV, METADATA_CACHE, GObject)
 
 GmpvMetadataCache *gmpv_metadata_cache_new(void);
+GmpvMetadataCache *gmpv_metadata_cache_get_default(void);
 void gmpv_metadata_cache_ref_entry(GmpvMetadataCache *cache, const gchar *uri);
 void gmpv_metadata_cache_unref_entry(GmpvMetadataCache *cache, const gchar *uri);
 void gmpv_metadata_cache_load_playlist(	GmpvMetadataCache *cache,
+					gconstpointer owner,
 					const GPtrArray *playlist );
+void gmpv_metadata_cache_release(	GmpvMetadataCache *cache,
+					gconstpointer owner );
 GmpvMetadataCacheEntry *gmpv_metadata_cache_lookup(	GmpvMetadataCache *cache,
 							const gchar *uri );
+GmpvMetadataCacheEntry *gmpv_metadata_cache_peek(	GmpvMetadataCache *cache,
+							const gchar *uri );
 
 G_END_DECLS
 
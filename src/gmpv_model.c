@@ -44,6 +44,7 @@ enum
 	PROP_LOOP_PLAYLIST,
 	PROP_DURATION,
 	PROP_MEDIA_TITLE,
+	PROP_PATH,
 	PROP_PLAYLIST_COUNT,
 	PROP_PLAYLIST_POS,
 	PROP_SPEED,
@@ -72,10 +73,13 @@ struct _GmpvModel
 	gchar *loop_playlist;
 	gdouble duration;
 	gchar *media_title;
+	gchar *path;
 	gint64 playlist_count;
 	gint64 playlist_pos;
 	gdouble speed;
 	gdouble volume;
+	gchar *suspended_vid;
+	gchar *suspended_path;
 };
 
 struct _GmpvModelClass
@@ -206,7 +210,20 @@ static void set_property(	GObject *object,
 		break;
 
 		case PROP_PLAYLIST:
+		/* Playlists are immutable snapshots, so keeping a reference
+		 * is enough to keep this version around.
+		 */
+		if(self->playlist)
+		{
+			g_ptr_array_unref(self->playlist);
+		}
+
 		self->playlist = g_value_get_pointer(value);
+
+		if(self->playlist)
+		{
+			g_ptr_array_ref(self->playlist);
+		}
 		break;
 
 		case PROP_METADATA:
@@ -265,6 +282,11 @@ static void set_property(	GObject *object,
 		self->media_title = g_value_dup_string(value);
 		break;
 
+		case PROP_PATH:
+		g_free(self->path);
+		self->path = g_value_dup_string(value);
+		break;
+
 		case PROP_PLAYLIST_COUNT:
 		self->playlist_count = g_value_get_int64(value);
 		break;
@@ -366,6 +388,10 @@ static void get_property(	GObject *object,
 		g_value_set_string(value, self->media_title);
 		break;
 
+		case PROP_PATH:
+		g_value_set_string(value, self->path);
+		break;
+
 		case PROP_PLAYLIST_COUNT:
 		g_value_set_int64(value, self->playlist_count);
 		break;
@@ -412,6 +438,14 @@ static void finalize(GObject *object)
 	g_free(model->sid);
 	g_free(model->loop_playlist);
 	g_free(model->media_title);
+	g_free(model->path);
+	g_free(model->suspended_vid);
+	g_free(model->suspended_path);
+
+	if(model->playlist)
+	{
+		g_ptr_array_unref(model->playlist);
+	}
 
 	G_OBJECT_CLASS(gmpv_model_parent_class)->finalize(object);
 }
@@ -688,6 +722,7 @@ static void gmpv_model_class_init(GmpvModelClass *klass)
 			{"loop-playlist", PROP_LOOP_PLAYLIST, G_TYPE_STRING},
 			{"duration", PROP_DURATION, G_TYPE_DOUBLE},
 			{"media-title", PROP_MEDIA_TITLE, G_TYPE_STRING},
+			{"path", PROP_PATH, G_TYPE_STRING},
 			{"playlist-count", PROP_PLAYLIST_COUNT, G_TYPE_INT64},
 			{"playlist-pos", PROP_PLAYLIST_POS, G_TYPE_INT64},
 			{"speed", PROP_SPEED, G_TYPE_DOUBLE},
@@ -853,10 +888,13 @@ static void gmpv_model_init(GmpvModel *model)
 	model->loop_playlist = NULL;
 	model->duration = 0.0;
 	model->media_title = NULL;
+	model->path = NULL;
 	model->playlist_count = 0;
 	model->playlist_pos = 0;
 	model->speed = 1.0;
 	model->volume = 1.0;
+	model->suspended_vid = NULL;
+	model->suspended_path = NULL;
 }
 
 GmpvModel *gmpv_model_new(gint64 wid)
@@ -882,6 +920,14 @@ void gmpv_model_reset(GmpvModel *model)
 	gmpv_mpv_reset(GMPV_MPV(model->player));
 }
 
+void gmpv_model_apply_settings(GmpvModel *model)
+{
+	if(!gmpv_player_apply_settings(model->player))
+	{
+		gmpv_model_reset(model);
+	}
+}
+
 void gmpv_model_quit(GmpvModel *model)
 {
 	if(model->ready)
@@ -895,15 +941,15 @@ void gmpv_model_quit(GmpvModel *model)
 
 void gmpv_model_mouse(GmpvModel *model, gint x, gint y)
 {
-	gchar *x_str = g_strdup_printf("%d", x);
-	gchar *y_str = g_strdup_printf("%d", y);
+	gchar x_str[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar y_str[G_ASCII_DTOSTR_BUF_SIZE];
 	const gchar *cmd[] = {"mouse", x_str, y_str, NULL};
 
+	g_snprintf(x_str, sizeof(x_str), "%d", x);
+	g_snprintf(y_str, sizeof(y_str), "%d", y);
+
 	g_debug("Set mouse location to (%s, %s)", x_str, y_str);
 	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
-
-	g_free(x_str);
-	g_free(y_str);
 }
 
 void gmpv_model_key_down(GmpvModel *model, const gchar* keystr)
@@ -985,6 +1031,7 @@ void gmpv_model_next_playlist_entry(GmpvModel *model)
 {
 	const gchar *cmd[] = {"osd-msg", "playlist-next", "weak", NULL};
 
+	gmpv_player_sync_playlist(model->player);
 	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
 }
 
@@ -992,6 +1039,7 @@ void gmpv_model_previous_playlist_entry(GmpvModel *model)
 {
 	const gchar *cmd[] = {"osd-msg", "playlist-prev", "weak", NULL};
 
+	gmpv_player_sync_playlist(model->player);
 	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
 }
 
@@ -999,9 +1047,15 @@ void gmpv_model_shuffle_playlist(GmpvModel *model)
 {
 	const gchar *cmd[] = {"osd-msg", "playlist-shuffle", NULL};
 
+	gmpv_player_sync_playlist(model->player);
 	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
 }
 
+void gmpv_model_sort_playlist(GmpvModel *model, PlaylistSortField field)
+{
+	gmpv_player_sort_playlist(model->player, field);
+}
+
 void gmpv_model_seek(GmpvModel *model, gdouble value)
 {
 	gmpv_mpv_set_property(GMPV_MPV(model->player), "time-pos", MPV_FORMAT_DOUBLE, &value);
@@ -1046,8 +1100,26 @@ gdouble gmpv_model_get_time_position(GmpvModel *model)
 	return MAX(0, time_pos);
 }
 
+gdouble gmpv_model_get_playlist_duration(	GmpvModel *model,
+						gboolean *complete )
+{
+	return gmpv_player_get_playlist_duration(model->player, complete);
+}
+
+gdouble gmpv_model_get_playlist_time_position(GmpvModel *model)
+{
+	return gmpv_player_get_playlist_time_position(model->player);
+}
+
+gboolean gmpv_model_seek_playlist(GmpvModel *model, gdouble time)
+{
+	return gmpv_player_seek_playlist(model->player, time);
+}
+
 void gmpv_model_set_playlist_position(GmpvModel *model, gint64 position)
 {
+	gmpv_player_sync_playlist(model->player);
+
 	if(position != model->playlist_pos)
 	{
 		gmpv_mpv_set_property(	GMPV_MPV(model->player),
@@ -1064,26 +1136,23 @@ void gmpv_model_remove_playlist_entry(GmpvModel *model, gint64 position)
 
 	cmd[1] = index_str;
 
+	gmpv_player_sync_playlist(model->player);
 	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
 
 	g_free(index_str);
 }
 
-void gmpv_model_move_playlist_entry(GmpvModel *model, gint64 src, gint64 dst)
+void gmpv_model_remove_playlist_entries(	GmpvModel *model,
+						const GArray *indices )
 {
-	const gchar *cmd[] =	{"playlist_move", NULL, NULL, NULL};
-	gchar *src_str =	g_strdup_printf
-				("%" G_GINT64_FORMAT, (src > dst)?--src:src);
-	gchar *dst_str =	g_strdup_printf
-				("%" G_GINT64_FORMAT, dst);
-
-	cmd[1] = src_str;
-	cmd[2] = dst_str;
-
-	gmpv_mpv_command(GMPV_MPV(model->player), cmd);
+	gmpv_player_remove_playlist_entries(model->player, indices);
+}
 
-	g_free(src_str);
-	g_free(dst_str);
+void gmpv_model_move_playlist_entries(	GmpvModel *model,
+					const GArray *indices,
+					guint dest )
+{
+	gmpv_player_move_playlist_entries(model->player, indices, dest);
 }
 
 void gmpv_model_load_file(GmpvModel *model, const gchar *uri, gboolean append)
@@ -1099,6 +1168,81 @@ void gmpv_model_load_file(GmpvModel *model, const gchar *uri, gboolean append)
 	}
 }
 
+void gmpv_model_load_files(	GmpvModel *model,
+				const gchar **uris,
+				gboolean append )
+{
+	gboolean empty = model->playlist->len == 0;
+
+	gmpv_player_load_files(model->player, uris, append);
+
+	if(!append || empty)
+	{
+		gmpv_model_play(model);
+	}
+}
+
+void gmpv_model_set_video_suspended(GmpvModel *model, gboolean suspended)
+{
+	GmpvMpv *mpv = GMPV_MPV(model->player);
+
+	if(suspended && !model->suspended_vid)
+	{
+		if(	!model->ready ||
+			model->idle_active ||
+			!model->vid ||
+			g_strcmp0(model->vid, "no") == 0 )
+		{
+			return;
+		}
+
+		g_debug("Suspending video decoding (vid=%s)", model->vid);
+
+		model->suspended_vid = g_strdup(model->vid);
+		model->suspended_path = gmpv_model_get_current_path(model);
+
+		gmpv_mpv_set_property_string(mpv, "vid", "no");
+	}
+	else if(!suspended && model->suspended_vid)
+	{
+		gchar *path = gmpv_model_get_current_path(model);
+		const gchar *vid = model->suspended_vid;
+
+		/* Track IDs are only meaningful for the file they were taken
+		 * from, so fall back to automatic selection if the file has
+		 * changed in the meantime.
+		 */
+		if(g_strcmp0(path, model->suspended_path) != 0)
+		{
+			vid = "auto";
+		}
+
+		g_debug("Resuming video decoding (vid=%s)", vid);
+		gmpv_mpv_set_property_string(mpv, "vid", vid);
+
+		/* Video frames are only decoded from the next keyframe
+		 * onward, so do a precise seek to the current position to
+		 * get a frame to show immediately.
+		 */
+		if(model->ready && !model->idle_active)
+		{
+			const gchar *cmd[] = {"seek", NULL, "absolute+exact", NULL};
+			gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+			g_ascii_dtostr(	buf,
+					G_ASCII_DTOSTR_BUF_SIZE,
+					gmpv_model_get_time_position(model) );
+			cmd[1] = buf;
+
+			gmpv_mpv_command(mpv, cmd);
+		}
+
+		g_clear_pointer(&model->suspended_vid, g_free);
+		g_clear_pointer(&model->suspended_path, g_free);
+		g_free(path);
+	}
+}
+
 gboolean gmpv_model_get_use_opengl_cb(GmpvModel *model)
 {
 	return gmpv_mpv_get_use_opengl_cb(GMPV_MPV(model->player));
@@ -1134,6 +1278,22 @@ void gmpv_model_get_video_geometry(	GmpvModel *model,
 	gmpv_mpv_get_property(mpv, "dheight", MPV_FORMAT_INT64, height);
 }
 
+guint64 gmpv_model_get_playlist_version(GmpvModel *model)
+{
+	return gmpv_player_get_playlist_version(model->player);
+}
+
+GmpvSession *gmpv_model_get_session(	GmpvModel *model,
+					gboolean include_playlist )
+{
+	return gmpv_player_get_session(model->player, include_playlist);
+}
+
+void gmpv_model_restore_session(GmpvModel *model, const GmpvSession *session)
+{
+	gmpv_player_restore_session(model->player, session);
+}
+
 gchar *gmpv_model_get_current_path(GmpvModel *model)
 {
 	GmpvMpv *mpv = GMPV_MPV(model->player);
@@ -23,6 +23,8 @@
 #include <glib.h>
 
 #include "gmpv_mpv.h"
+#include "gmpv_playlist_sort.h"
+#include "gmpv_session.h"
 
 G_BEGIN_DECLS
 
@@ -33,6 +35,7 @@ G_DECLARE_FINAL_TYPE(GmpvModel, gmpv_model, GMPV, MODEL, GObject)
 GmpvModel *gmpv_model_new(gint64 wid);
 void gmpv_model_initialize(GmpvModel *model);
 void gmpv_model_reset(GmpvModel *model);
+void gmpv_model_apply_settings(GmpvModel *model);
 void gmpv_model_quit(GmpvModel *model);
 void gmpv_model_mouse(GmpvModel *model, gint x, gint y);
 void gmpv_model_key_down(GmpvModel *model, const gchar* keystr);
@@ -49,21 +52,38 @@ void gmpv_model_previous_chapter(GmpvModel *model);
 void gmpv_model_next_playlist_entry(GmpvModel *model);
 void gmpv_model_previous_playlist_entry(GmpvModel *model);
 void gmpv_model_shuffle_playlist(GmpvModel *model);
+void gmpv_model_sort_playlist(GmpvModel *model, PlaylistSortField field);
 void gmpv_model_seek(GmpvModel *model, gdouble value);
 void gmpv_model_seek_offset(GmpvModel *model, gdouble offset);
 void gmpv_model_load_audio_track(GmpvModel *model, const gchar *filename);
 void gmpv_model_load_subtitle_track(GmpvModel *model, const gchar *filename);
 gdouble gmpv_model_get_time_position(GmpvModel *model);
+gdouble gmpv_model_get_playlist_duration(	GmpvModel *model,
+						gboolean *complete );
+gdouble gmpv_model_get_playlist_time_position(GmpvModel *model);
+gboolean gmpv_model_seek_playlist(GmpvModel *model, gdouble time);
 void gmpv_model_set_playlist_position(GmpvModel *model, gint64 position);
 void gmpv_model_remove_playlist_entry(GmpvModel *model, gint64 position);
-void gmpv_model_move_playlist_entry(GmpvModel *model, gint64 src, gint64 dst);
+void gmpv_model_remove_playlist_entries(	GmpvModel *model,
+						const GArray *indices );
+void gmpv_model_move_playlist_entries(	GmpvModel *model,
+					const GArray *indices,
+					guint dest );
 void gmpv_model_load_file(GmpvModel *model, const gchar *uri, gboolean append);
+void gmpv_model_load_files(	GmpvModel *model,
+				const gchar **uris,
+				gboolean append );
+void gmpv_model_set_video_suspended(GmpvModel *model, gboolean suspended);
 gboolean gmpv_model_get_use_opengl_cb(GmpvModel *model);
 void gmpv_model_initialize_gl(GmpvModel *model);
 void gmpv_model_render_frame(GmpvModel *model, gint width, gint height);
 void gmpv_model_get_video_geometry(	GmpvModel *model,
 					gint64 *width,
 					gint64 *height );
+guint64 gmpv_model_get_playlist_version(GmpvModel *model);
+GmpvSession *gmpv_model_get_session(	GmpvModel *model,
+					gboolean include_playlist );
+void gmpv_model_restore_session(GmpvModel *model, const GmpvSession *session);
 gchar *gmpv_model_get_current_path(GmpvModel *model);
 
 G_END_DECLS
@@ -47,6 +47,7 @@
 #include "gmpv_common.h"
 #include "gmpv_def.h"
 #include "gmpv_marshal.h"
+#include "gmpv_uri_classifier.h"
 
 static void *GLAPIENTRY glMPGetNativeDisplay(const gchar *name);
 static void *get_proc_address(void *fn_ctx, const gchar *name);
@@ -73,9 +74,16 @@ static gboolean process_mpv_events(gpointer data);
 static void initialize(GmpvMpv *mpv);
 static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append);
 static void reset(GmpvMpv *mpv);
+static void detach_window(GmpvMpv *mpv);
+static gpointer terminate_thread(gpointer data);
 
 G_DEFINE_TYPE_WITH_PRIVATE(GmpvMpv, gmpv_mpv, G_TYPE_OBJECT)
 
+/* Handles that are being destroyed in the background */
+static GMutex terminate_mutex;
+static GCond terminate_cond;
+static guint terminate_pending = 0;
+
 static void *GLAPIENTRY glMPGetNativeDisplay(const gchar *name)
 {
        GdkDisplay *display = gdk_display_get_default();
@@ -363,7 +371,7 @@ static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append)
 static void reset(GmpvMpv *mpv)
 {
 	GmpvMpvPrivate *priv = get_private(mpv);
-	const gchar *quit_cmd[] = {"quit_watch_later", NULL};
+	const gchar *write_cmd[] = {"write_watch_later_config", NULL};
 	gchar *loop_str;
 	gboolean loop;
 	gboolean pause;
@@ -377,7 +385,21 @@ static void reset(GmpvMpv *mpv)
 	priv->ready = FALSE;
 	g_object_notify(G_OBJECT(mpv), "ready");
 
-	gmpv_mpv_command(mpv, quit_cmd);
+	/* The new instance needs the watch later config written by the old one
+	 * to resume playback. Commands are synchronous, so the config is on
+	 * disk once this returns and there is no need to wait for the old
+	 * instance to terminate.
+	 */
+	gmpv_mpv_command(mpv, write_cmd);
+
+	/* The new instance is attached to the same window, so the old one has
+	 * to let go of it before it is destroyed in the background.
+	 */
+	if(priv->wid > 0)
+	{
+		detach_window(mpv);
+	}
+
 	gmpv_mpv_quit(mpv);
 
 	priv->mpv_ctx = mpv_create();
@@ -399,6 +421,61 @@ static void mpv_log_message(	GmpvMpv *mpv,
 {
 }
 
+/* Stops playback and waits for at most MPV_DETACH_TIMEOUT milliseconds
+ * for mpv to become idle. Without force-window, mpv destroys its video
+ * window before it does so. An idle instance only shows a blank window, so
+ * it is not waited for.
+ */
+static void detach_window(GmpvMpv *mpv)
+{
+	GmpvMpvPrivate *priv = get_private(mpv);
+	const gchar *stop_cmd[] = {"stop", NULL};
+	gint64 end_time =	g_get_monotonic_time()+
+				MPV_DETACH_TIMEOUT*G_TIME_SPAN_MILLISECOND;
+	int idle_active = 0;
+	gboolean done = FALSE;
+
+	mpv_get_property(	priv->mpv_ctx,
+				"idle-active",
+				MPV_FORMAT_FLAG,
+				&idle_active );
+	mpv_set_property_string(priv->mpv_ctx, "force-window", "no");
+	mpv_command(priv->mpv_ctx, stop_cmd);
+
+	done = idle_active;
+
+	while(!done)
+	{
+		gint64 remaining = end_time-g_get_monotonic_time();
+		mpv_event *event = NULL;
+
+		if(remaining > 0)
+		{
+			event =	mpv_wait_event
+				(	priv->mpv_ctx,
+					(gdouble)remaining/G_TIME_SPAN_SECOND );
+		}
+
+		done =	!event ||
+			event->event_id == MPV_EVENT_IDLE ||
+			event->event_id == MPV_EVENT_SHUTDOWN;
+	}
+}
+
+static gpointer terminate_thread(gpointer data)
+{
+	mpv_terminate_destroy(data);
+
+	g_mutex_lock(&terminate_mutex);
+	terminate_pending--;
+	g_cond_broadcast(&terminate_cond);
+	g_mutex_unlock(&terminate_mutex);
+
+	g_debug("Terminated mpv handle %p", data);
+
+	return NULL;
+}
+
 static void gmpv_mpv_class_init(GmpvMpvClass* klass)
 {
 	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
@@ -594,11 +671,44 @@ void gmpv_mpv_quit(GmpvMpv *mpv)
 	}
 
 	g_assert(priv->mpv_ctx);
-	mpv_terminate_destroy(priv->mpv_ctx);
+
+	/* mpv_terminate_destroy() blocks until the core has shut down, which
+	 * can take arbitrarily long if it is stuck on a broken stream, so do
+	 * it in a separate thread. The wakeup callback is removed first so
+	 * that the core never refers back to this object.
+	 */
+	mpv_set_wakeup_callback(priv->mpv_ctx, NULL, NULL);
+
+	g_mutex_lock(&terminate_mutex);
+	terminate_pending++;
+	g_mutex_unlock(&terminate_mutex);
+
+	g_thread_unref(g_thread_new(	"mpv-terminate",
+					terminate_thread,
+					priv->mpv_ctx ));
 
 	priv->mpv_ctx = NULL;
 }
 
+gboolean gmpv_mpv_wait_for_termination(gint64 timeout)
+{
+	gint64 end_time = g_get_monotonic_time()+timeout*G_TIME_SPAN_MILLISECOND;
+	gboolean done = TRUE;
+
+	g_mutex_lock(&terminate_mutex);
+
+	while(terminate_pending > 0 && done)
+	{
+		done = g_cond_wait_until(&terminate_cond, &terminate_mutex, end_time);
+	}
+
+	done = (terminate_pending == 0);
+
+	g_mutex_unlock(&terminate_mutex);
+
+	return done;
+}
+
 void gmpv_mpv_load_track(GmpvMpv *mpv, const gchar *uri, TrackType type)
 {
 	const gchar *cmd[3] = {NULL};
@@ -632,9 +742,7 @@ void gmpv_mpv_load_file(GmpvMpv *mpv, const gchar *uri, gboolean append)
 
 void gmpv_mpv_load(GmpvMpv *mpv, const gchar *uri, gboolean append)
 {
-	const gchar *subtitle_exts[] = SUBTITLE_EXTS;
-
-	if(extension_matches(uri, subtitle_exts))
+	if(gmpv_uri_classify(uri) == URI_CLASS_SUBTITLE)
 	{
 		gmpv_mpv_load_track(mpv, uri, TRACK_TYPE_SUBTITLE);
 	}
@@ -57,7 +57,15 @@ gboolean gmpv_mpv_get_use_opengl_cb(GmpvMpv *mpv);
 void gmpv_mpv_initialize(GmpvMpv *mpv);
 void gmpv_mpv_init_gl(GmpvMpv *mpv);
 void gmpv_mpv_reset(GmpvMpv *mpv);
+
+/* gmpv_mpv_quit() hands the handle to a background thread that destroys
+ * it, so a core that is stuck on a broken stream does not freeze the UI when
+ * a window is closed or the player is reset. gmpv_mpv_wait_for_termination()
+ * waits up to timeout milliseconds for those threads, and returns FALSE if
+ * some are still running.
+ */
 void gmpv_mpv_quit(GmpvMpv *mpv);
+gboolean gmpv_mpv_wait_for_termination(gint64 timeout);
 void gmpv_mpv_load_track(GmpvMpv *mpv, const gchar *uri, TrackType type);
 void gmpv_mpv_load_file(GmpvMpv *mpv, const gchar *uri, gboolean append);
 void gmpv_mpv_load(GmpvMpv *mpv, const gchar *uri, gboolean append);
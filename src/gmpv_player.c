@@ -24,11 +24,21 @@
 #include "gmpv_player.h"
 #include "gmpv_player_options.h"
 #include "gmpv_marshal.h"
+#include "gmpv_duration_index.h"
+#include "gmpv_folder_importer.h"
+#include "gmpv_import_batch.h"
+#include "gmpv_library_catalog.h"
+#include "gmpv_loudness_analyzer.h"
 #include "gmpv_metadata_cache.h"
+#include "gmpv_playlist_parser.h"
+#include "gmpv_resume_db.h"
+#include "gmpv_session.h"
+#include "gmpv_settings_cache.h"
 #include "gmpv_mpv_wrapper.h"
 #include "gmpv_def.h"
 
 typedef struct _GmpvLogLevel GmpvLogLevel;
+typedef struct PendingImport PendingImport;
 
 enum
 {
@@ -49,7 +59,34 @@ struct _GmpvPlayer
 {
 	GmpvMpv parent;
 	GmpvMetadataCache *cache;
+	GHashTable *cache_updates;
+	guint cache_update_source_id;
 	GPtrArray *playlist;
+	gboolean playlist_published;
+	guint64 playlist_version;
+	GmpvDurationIndex *durations;
+	gboolean durations_synced;
+	GmpvFolderImporter *importer;
+	gboolean import_replace;
+	GQueue *pending_imports;
+	GmpvLibraryCatalog *catalog;
+	GmpvLoudnessAnalyzer *loudness_analyzer;
+	gboolean loudness_filter;
+	GmpvResumeDb *resume_db;
+	gchar *resume_path;
+	gdouble resume_position;
+	gdouble resume_duration;
+	gdouble resume_saved_position;
+	guint resume_source_id;
+	gint64 playlist_pos;
+	gint64 restore_pos;
+	gdouble restore_time_pos;
+	gboolean restore_paused;
+	GPtrArray *feed_playlist;
+	guint feed_current;
+	guint feed_before;
+	guint feed_after;
+	guint feed_source_id;
 	GPtrArray *metadata;
 	GPtrArray *track_list;
 	GHashTable *log_levels;
@@ -57,6 +94,12 @@ struct _GmpvPlayer
 	gboolean new_file;
 	gboolean init_vo_config;
 	gchar *tmp_input_config;
+	gchar *applied_mpv_options;
+	gchar *applied_config_file;
+	gchar *applied_config_checksum;
+	gchar *applied_input_config;
+	gchar *applied_input_config_checksum;
+	GHashTable *loaded_scripts;
 };
 
 struct _GmpvPlayerClass
@@ -64,6 +107,23 @@ struct _GmpvPlayerClass
 	GmpvMpvClass parent_class;
 };
 
+/* Batches are resolved concurrently but committed in the order in which
+ * they were requested.
+ */
+struct PendingImport
+{
+	GmpvPlayer *player;
+	GCancellable *cancellable;
+	GmpvImportBatch *batch;
+	gboolean append;
+	gboolean done;
+};
+
+/* Playlist versions are shared by all players, so that the playlists of two
+ * players never have the same version.
+ */
+static guint64 last_playlist_version = 0;
+
 static void set_property(	GObject *object,
 				guint property_id,
 				const GValue *value,
@@ -72,6 +132,7 @@ static void get_property(	GObject *object,
 				guint property_id,
 				GValue *value,
 				GParamSpec *pspec );
+static void dispose(GObject *object);
 static void finalize(GObject *object);
 static void mpv_event_notify(GmpvMpv *mpv, gint event_id, gpointer event_data);
 static void mpv_log_message(	GmpvMpv *mpv,
@@ -85,23 +146,73 @@ static void observe_properties(GmpvMpv *mpv);
 static void apply_default_options(GmpvMpv *mpv);
 static void initialize(GmpvMpv *mpv);
 static gint apply_options_array_string(GmpvMpv *mpv, gchar *args);
+static GHashTable *parse_options_string(const gchar *args);
 static void apply_extra_options(GmpvMpv *mpv);
 static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append);
+static void load_single_file(	GmpvPlayer *player,
+				const gchar *uri,
+				gboolean append );
+static void import_folder(GmpvPlayer *player, GFile *folder, gboolean append);
+static void cancel_import(GmpvPlayer *player);
+static void import_files_found_handler(	GmpvFolderImporter *importer,
+					GPtrArray *entries,
+					gpointer data );
+static void import_finished_handler(	GmpvFolderImporter *importer,
+					gpointer data );
+static void pending_import_free(PendingImport *pending);
+static void cancel_pending_imports(GmpvPlayer *player);
+static void import_batch_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data );
+static void commit_pending_imports(GmpvPlayer *player);
+static void apply_loudness_gain(GmpvPlayer *player);
+static void request_loudness_analysis(GmpvPlayer *player);
+static void start_resume_tracking(GmpvPlayer *player);
+static void stop_resume_tracking(GmpvPlayer *player, gboolean finished);
+static void poll_resume_position(GmpvPlayer *player);
+static void save_resume_position(GmpvPlayer *player);
+static gboolean resume_poll_handler(gpointer data);
 static void reset(GmpvMpv *mpv);
 static void load_input_conf(GmpvPlayer *player, const gchar *input_conf);
 static void load_config_file(GmpvMpv *mpv);
 static void load_input_config_file(GmpvPlayer *player);
 static void load_scripts(GmpvPlayer *player);
+static GPtrArray *get_scripts(void);
+static gchar *get_file_setting(gboolean enable, const gchar *filename);
+static gchar *get_file_checksum(const gchar *filename);
+static gboolean apply_option_changes(	GmpvPlayer *player,
+					const gchar *mpv_options );
+static gboolean apply_input_config_changes(	GmpvPlayer *player,
+						const gchar *input_config );
+static gboolean apply_script_changes(GmpvPlayer *player);
 static GmpvTrack *parse_track_entry(mpv_node_list *node);
 static void add_file_to_playlist(GmpvPlayer *player, const gchar *uri);
+static void load_playlist_entries(	GmpvPlayer *player,
+					GPtrArray *entries,
+					gboolean append );
+static void seed_metadata_cache(GmpvPlayer *player, GPtrArray *entries);
 static void load_from_playlist(GmpvPlayer *player);
-static GmpvPlaylistEntry *parse_playlist_entry(mpv_node_list *node);
+static gboolean feed_playlist(GmpvPlayer *player, guint count);
+static gboolean feed_playlist_handler(gpointer data);
+static void stop_playlist_feed(GmpvPlayer *player);
+static gint64 get_playlist_position(GmpvPlayer *player);
+static void parse_playlist_entry(	mpv_node_list *node,
+					const gchar **filename,
+					const gchar **title );
+static GPtrArray *get_writable_playlist(GmpvPlayer *player);
+static void publish_playlist(GmpvPlayer *player);
+static void load_durations(GmpvPlayer *player);
+static gboolean playlist_equal(GPtrArray *a, GPtrArray *b);
+static void apply_playlist_moves(GmpvPlayer *player, GArray *moves);
+static void reload_playlist(GmpvPlayer *player, GArray *order);
+static void apply_playlist_order(GmpvPlayer *player, GArray *order);
 static void update_playlist(GmpvPlayer *player);
 static void update_metadata(GmpvPlayer *player);
 static void update_track_list(GmpvPlayer *player);
 static void cache_update_handler(	GmpvMetadataCache *cache,
 					const gchar *uri,
 					gpointer data );
+static gboolean apply_cache_updates(gpointer data);
 
 G_DEFINE_TYPE(GmpvPlayer, gmpv_player, GMPV_TYPE_MPV)
 
@@ -134,6 +245,8 @@ static void get_property(	GObject *object,
 	switch(property_id)
 	{
 		case PROP_PLAYLIST:
+		/* Once handed out, the array may be referenced elsewhere */
+		self->playlist_published = TRUE;
 		g_value_set_pointer(value, self->playlist);
 		break;
 
@@ -151,6 +264,39 @@ static void get_property(	GObject *object,
 	}
 }
 
+static void dispose(GObject *object)
+{
+	GmpvPlayer *player = GMPV_PLAYER(object);
+
+	cancel_import(player);
+	cancel_pending_imports(player);
+	stop_playlist_feed(player);
+	g_clear_object(&player->catalog);
+	g_clear_object(&player->loudness_analyzer);
+
+	if(player->resume_db)
+	{
+		poll_resume_position(player);
+		stop_resume_tracking(player, FALSE);
+		g_clear_object(&player->resume_db);
+	}
+
+	if(player->cache)
+	{
+		g_signal_handlers_disconnect_by_data(player->cache, player);
+		gmpv_metadata_cache_release(player->cache, player);
+		g_clear_object(&player->cache);
+	}
+
+	if(player->cache_update_source_id > 0)
+	{
+		g_source_remove(player->cache_update_source_id);
+		player->cache_update_source_id = 0;
+	}
+
+	G_OBJECT_CLASS(gmpv_player_parent_class)->dispose(object);
+}
+
 static void finalize(GObject *object)
 {
 	GmpvPlayer *player = GMPV_PLAYER(object);
@@ -161,7 +307,16 @@ static void finalize(GObject *object)
 	}
 
 	g_free(player->tmp_input_config);
-	g_ptr_array_free(player->playlist, TRUE);
+	g_free(player->applied_mpv_options);
+	g_free(player->applied_config_file);
+	g_free(player->applied_config_checksum);
+	g_free(player->applied_input_config);
+	g_free(player->applied_input_config_checksum);
+	g_hash_table_unref(player->loaded_scripts);
+	g_hash_table_unref(player->cache_updates);
+	g_ptr_array_unref(player->playlist);
+	gmpv_duration_index_free(player->durations);
+	g_queue_free(player->pending_imports);
 	g_ptr_array_free(player->metadata, TRUE);
 	g_ptr_array_free(player->track_list, TRUE);
 
@@ -176,6 +331,7 @@ static void mpv_event_notify(GmpvMpv *mpv, gint event_id, gpointer event_data)
 	{
 		gboolean vo_configured = FALSE;
 
+		apply_loudness_gain(player);
 		gmpv_mpv_get_property(	mpv,
 					"vo-configured",
 					MPV_FORMAT_FLAG,
@@ -192,10 +348,15 @@ static void mpv_event_notify(GmpvMpv *mpv, gint event_id, gpointer event_data)
 	}
 	else if(event_id == MPV_EVENT_END_FILE)
 	{
+		mpv_event_end_file *ef_event = event_data;
+
 		if(player->loaded)
 		{
 			player->new_file = FALSE;
 		}
+
+		stop_resume_tracking
+			(player, ef_event->reason == MPV_END_FILE_REASON_EOF);
 	}
 	else if(event_id == MPV_EVENT_IDLE)
 	{
@@ -204,6 +365,23 @@ static void mpv_event_notify(GmpvMpv *mpv, gint event_id, gpointer event_data)
 	else if(event_id == MPV_EVENT_FILE_LOADED)
 	{
 		player->loaded = TRUE;
+
+		start_resume_tracking(player);
+
+		if(player->restore_time_pos > 0)
+		{
+			const gchar *cmd[] = {"seek", NULL, "absolute", NULL};
+			gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+			g_ascii_dtostr(	buf,
+					G_ASCII_DTOSTR_BUF_SIZE,
+					player->restore_time_pos );
+			cmd[1] = buf;
+
+			gmpv_mpv_command(mpv, cmd);
+
+			player->restore_time_pos = 0;
+		}
 	}
 	else if(event_id == MPV_EVENT_VIDEO_RECONFIG)
 	{
@@ -300,6 +478,13 @@ static void mpv_property_changed(	GmpvMpv *mpv,
 		{
 			load_from_playlist(player);
 		}
+
+		/* Pausing is often the last thing done before leaving */
+		if(pause && player->resume_path)
+		{
+			poll_resume_position(player);
+			save_resume_position(player);
+		}
 	}
 	else if(g_strcmp0(name, "playlist") == 0)
 	{
@@ -331,6 +516,12 @@ static void mpv_property_changed(	GmpvMpv *mpv,
 			gmpv_mpv_set_property_flag(mpv, "pause", FALSE);
 		}
 	}
+	else if(g_strcmp0(name, "playlist-pos") == 0)
+	{
+		player->playlist_pos = value?*((gint64 *)value):-1;
+
+		request_loudness_analysis(player);
+	}
 	else if(g_strcmp0(name, "metadata") == 0)
 	{
 		update_metadata(player);
@@ -366,6 +557,7 @@ static void observe_properties(GmpvMpv *mpv)
 	gmpv_mpv_observe_property(mpv, 0, "loop", MPV_FORMAT_STRING);
 	gmpv_mpv_observe_property(mpv, 0, "duration", MPV_FORMAT_DOUBLE);
 	gmpv_mpv_observe_property(mpv, 0, "media-title", MPV_FORMAT_STRING);
+	gmpv_mpv_observe_property(mpv, 0, "path", MPV_FORMAT_STRING);
 	gmpv_mpv_observe_property(mpv, 0, "metadata", MPV_FORMAT_NODE);
 	gmpv_mpv_observe_property(mpv, 0, "playlist", MPV_FORMAT_NODE);
 	gmpv_mpv_observe_property(mpv, 0, "playlist-count", MPV_FORMAT_INT64);
@@ -482,8 +674,8 @@ static gint apply_options_array_string(GmpvMpv *mpv, gchar *args)
 
 static void apply_extra_options(GmpvMpv *mpv)
 {
-	GSettings *settings = g_settings_new(CONFIG_ROOT);
-	gchar *extra_options = g_settings_get_string(settings, "mpv-options");
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	gchar *extra_options = g_strdup(settings->mpv_options);
 
 	g_debug("Applying extra mpv options: %s", extra_options);
 
@@ -494,16 +686,114 @@ static void apply_extra_options(GmpvMpv *mpv)
 		g_signal_emit_by_name(mpv, "error", msg);
 	}
 
-	g_free(extra_options);
-	g_object_unref(settings);
+	g_free(GMPV_PLAYER(mpv)->applied_mpv_options);
+	GMPV_PLAYER(mpv)->applied_mpv_options = extra_options;
+}
+
+static GHashTable *parse_options_string(const gchar *args)
+{
+	GHashTable *options = g_hash_table_new_full(	g_str_hash,
+							g_str_equal,
+							g_free,
+							g_free );
+	gchar **tokens = g_regex_split_simple(	"(^|\\s+)--",
+						args?:"",
+						G_REGEX_NO_AUTO_CAPTURE,
+						0 );
+
+	/* Tokens are split the same way as in apply_options_array_string().
+	 * Later occurrences of an option override earlier ones, just like
+	 * they do when the options are applied in order.
+	 */
+	for(gint i = tokens[0]?1:0; tokens[i]; i++)
+	{
+		gchar **parts = g_strsplit(g_strchomp(tokens[i]), "=", 2);
+
+		if(parts[0])
+		{
+			g_hash_table_replace(	options,
+						g_strdup(parts[0]),
+						g_strdup(parts[1]?:"") );
+		}
+
+		g_strfreev(parts);
+	}
+
+	g_strfreev(tokens);
+
+	return options;
 }
 
 static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append)
 {
 	GmpvPlayer *player = GMPV_PLAYER(mpv);
+	GFile *folder = get_local_folder(uri);
+	GPtrArray *entries = NULL;
+	GError *error = NULL;
+
+	/* Files from an ongoing import would otherwise be added after the
+	 * ones that replaced them.
+	 */
+	if(!append)
+	{
+		cancel_import(player);
+		cancel_pending_imports(player);
+	}
+
+	if(!folder)
+	{
+		entries = gmpv_playlist_parser_parse(uri, &error);
+	}
+
+	/* Let mpv try to load the playlist if it could not be read here, so
+	 * that errors are reported the same way as for any other file.
+	 */
+	if(error)
+	{
+		g_warning(	"Failed to read playlist %s: %s",
+				uri,
+				error->message );
+
+		g_error_free(error);
+	}
+
+	if(folder)
+	{
+		import_folder(player, folder, append);
+		g_object_unref(folder);
+	}
+	else if(entries && entries->len > 0)
+	{
+		load_playlist_entries(player, entries, append);
+	}
+	else
+	{
+		load_single_file(player, uri, append);
+	}
+
+	if(entries)
+	{
+		g_ptr_array_unref(entries);
+	}
+}
+
+static void load_single_file(	GmpvPlayer *player,
+				const gchar *uri,
+				gboolean append )
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
 	gboolean ready = FALSE;
 	gboolean idle_active = FALSE;
 
+	if(append)
+	{
+		gmpv_player_sync_playlist(player);
+	}
+	else
+	{
+		stop_playlist_feed(player);
+	}
+
 	g_object_get(mpv, "ready", &ready, NULL);
 	gmpv_mpv_get_property(	mpv,
 				"idle-active",
@@ -514,7 +804,10 @@ static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append)
 	{
 		if(!append)
 		{
-			g_ptr_array_set_size(player->playlist, 0);
+			g_ptr_array_unref(player->playlist);
+
+			player->playlist = gmpv_playlist_new(0);
+			player->playlist_published = FALSE;
 		}
 
 		add_file_to_playlist(player, uri);
@@ -538,196 +831,758 @@ static void load_file(GmpvMpv *mpv, const gchar *uri, gboolean append)
 	 */
 	if(idle_active)
 	{
-		g_object_notify(G_OBJECT(player), "playlist");
+		publish_playlist(player);
 	}
 }
 
-static void reset(GmpvMpv *mpv)
+static void import_folder(GmpvPlayer *player, GFile *folder, gboolean append)
 {
-	gboolean idle_active = FALSE;
-	gint64 playlist_pos = 0;
-
-	gmpv_mpv_get_property(	mpv,
-				"idle-active",
-				MPV_FORMAT_FLAG,
-				&idle_active );
-	gmpv_mpv_get_property(	mpv,
-				"playlist-pos",
-				MPV_FORMAT_INT64,
-				&playlist_pos );
+	gchar *uri = g_file_get_uri(folder);
 
-	GMPV_MPV_CLASS(gmpv_player_parent_class)->reset(mpv);
+	g_info("Importing folder (append=%s): %s", append?"TRUE":"FALSE", uri);
 
-	if(!idle_active)
+	/* Folders appended while another import is in progress are imported
+	 * by the same importer so that their files stay in order.
+	 */
+	if(!player->importer)
 	{
-		load_from_playlist(GMPV_PLAYER(mpv));
+		player->importer = gmpv_folder_importer_new();
+		player->import_replace = !append;
+
+		g_signal_connect(	player->importer,
+					"files-found",
+					G_CALLBACK(import_files_found_handler),
+					player );
+		g_signal_connect(	player->importer,
+					"finished",
+					G_CALLBACK(import_finished_handler),
+					player );
 	}
 
-	if(playlist_pos > 0)
+	gmpv_folder_importer_add(player->importer, folder);
+
+	g_free(uri);
+}
+
+static void cancel_import(GmpvPlayer *player)
+{
+	if(player->importer)
 	{
-		gmpv_mpv_set_property(	mpv,
-					"playlist-pos",
-					MPV_FORMAT_INT64,
-					&playlist_pos );
+		g_signal_handlers_disconnect_by_data(player->importer, player);
+		gmpv_folder_importer_cancel(player->importer);
+		g_clear_object(&player->importer);
 	}
 }
 
-static void load_input_conf(GmpvPlayer *player, const gchar *input_conf)
+static void import_files_found_handler(	GmpvFolderImporter *importer,
+					GPtrArray *entries,
+					gpointer data )
 {
-	const gchar *default_keybinds[] = DEFAULT_KEYBINDS;
-	gchar *tmp_path;
-	FILE *tmp_file;
-	gint tmp_fd;
+	GmpvPlayer *player = data;
 
-	if(player->tmp_input_config)
+	/* Only the first chunk replaces the playlist */
+	load_playlist_entries(player, entries, !player->import_replace);
+	player->import_replace = FALSE;
+}
+
+static void import_finished_handler(	GmpvFolderImporter *importer,
+					gpointer data )
+{
+	GmpvPlayer *player = data;
+
+	g_debug("Folder import finished");
+
+	g_signal_handlers_disconnect_by_data(importer, player);
+	g_clear_object(&player->importer);
+}
+
+static void pending_import_free(PendingImport *pending)
+{
+	g_object_unref(pending->cancellable);
+	gmpv_import_batch_free(pending->batch);
+	g_free(pending);
+}
+
+static void cancel_pending_imports(GmpvPlayer *player)
+{
+	PendingImport *pending = NULL;
+
+	/* Imports that are done were only waiting for the ones before them,
+	 * so they can be freed right away. The others are freed by
+	 * import_batch_ready_handler() once they are cancelled.
+	 */
+	while((pending = g_queue_pop_head(player->pending_imports)))
 	{
-		g_unlink(player->tmp_input_config);
-		g_free(player->tmp_input_config);
+		if(pending->done)
+		{
+			pending_import_free(pending);
+		}
+		else
+		{
+			pending->player = NULL;
+			g_cancellable_cancel(pending->cancellable);
+		}
 	}
+}
 
-	tmp_fd = g_file_open_tmp(NULL, &tmp_path, NULL);
-	tmp_file = fdopen(tmp_fd, "w");
-	player->tmp_input_config = tmp_path;
+static void import_batch_ready_handler(	GObject *source_object,
+					GAsyncResult *res,
+					gpointer data )
+{
+	PendingImport *pending = data;
+	GError *error = NULL;
 
-	if(!tmp_file)
+	pending->batch = gmpv_import_batch_finish(res, &error);
+	pending->done = TRUE;
+
+	if(error && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 	{
-		g_error("Failed to open temporary input config file");
+		g_warning("Failed to import files: %s", error->message);
 	}
 
-	for(gint i = 0; default_keybinds[i]; i++)
+	if(pending->player)
 	{
-		const gsize len = strlen(default_keybinds[i]);
-		gsize write_size = fwrite(default_keybinds[i], len, 1, tmp_file);
-		gint rc = fputc('\n', tmp_file);
-
-		if(write_size != 1 || rc != '\n')
-		{
-			g_error(	"Error writing default keybindings to "
-					"temporary input config file" );
-		}
+		commit_pending_imports(pending->player);
+	}
+	else
+	{
+		pending_import_free(pending);
 	}
 
-	g_debug("Using temporary input config file: %s", tmp_path);
-	gmpv_mpv_set_option_string(GMPV_MPV(player), "input-conf", tmp_path);
+	g_clear_error(&error);
+}
 
-	if(input_conf && strlen(input_conf) > 0)
+static void commit_pending_imports(GmpvPlayer *player)
+{
+	PendingImport *pending = g_queue_peek_head(player->pending_imports);
+
+	while(pending && pending->done)
 	{
-		const gsize buf_size = 65536;
-		void *buf = g_malloc(buf_size);
-		FILE *src_file = g_fopen(input_conf, "r");
-		gsize read_size = buf_size;
+		GmpvImportBatch *batch = pending->batch;
 
-		if(!src_file)
+		g_queue_pop_head(player->pending_imports);
+
+		/* The whole batch is added to the playlist at once */
+		if(batch && batch->entries->len > 0)
 		{
-			g_warning(	"Cannot open input config file: %s",
-					input_conf );
+			load_playlist_entries
+				(player, batch->entries, pending->append);
 		}
 
-		while(src_file && read_size == buf_size)
+		for(guint i = 0; batch && i < batch->subtitles->len; i++)
 		{
-			read_size = fread(buf, 1, buf_size, src_file);
+			const gchar *uri = g_ptr_array_index(batch->subtitles, i);
 
-			if(read_size != fwrite(buf, 1, read_size, tmp_file))
-			{
-				g_error(	"Error writing requested input "
-						"config file to temporary "
-						"input config file" );
-			}
+			gmpv_mpv_load_track
+				(GMPV_MPV(player), uri, TRACK_TYPE_SUBTITLE);
 		}
 
-		g_info("Loaded input config file: %s", input_conf);
-
-		g_free(buf);
+		pending_import_free(pending);
+		pending = g_queue_peek_head(player->pending_imports);
 	}
-
-	fclose(tmp_file);
 }
 
-static void load_config_file(GmpvMpv *mpv)
+/* Replaces the gain applied to the previous file by the one of the file
+ * that is starting, if its loudness has been measured. A static volume
+ * filter costs next to nothing, unlike normalizing in real time.
+ */
+static void apply_loudness_gain(GmpvPlayer *player)
 {
-	GSettings *settings = g_settings_new(CONFIG_ROOT);
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	GmpvMpv *mpv = GMPV_MPV(player);
+	gchar *path = NULL;
+	gdouble gain = 0;
 
-	if(g_settings_get_boolean(settings, "mpv-config-enable"))
+	if(player->loudness_filter)
 	{
-		gchar *mpv_conf =	g_settings_get_string
-					(settings, "mpv-config-file");
+		const gchar *cmd[] =	{	"af",
+						"remove",
+						"@" LOUDNESS_FILTER_LABEL,
+						NULL };
 
-		g_info("Loading config file: %s", mpv_conf);
-		gmpv_mpv_load_config_file(mpv, mpv_conf);
+		gmpv_mpv_command(mpv, cmd);
 
-		g_free(mpv_conf);
+		player->loudness_filter = FALSE;
 	}
 
-	g_object_unref(settings);
-}
-
-static void load_input_config_file(GmpvPlayer *player)
-{
-	GSettings *settings = g_settings_new(CONFIG_ROOT);
-	gchar *input_conf = NULL;
+	if(settings->loudness_normalization)
+	{
+		path = gmpv_mpv_get_property_string(mpv, "path");
+	}
 
-	if(g_settings_get_boolean(settings, "mpv-input-config-enable"))
+	if(	path &&
+		gmpv_loudness_analyzer_get_gain
+		(player->loudness_analyzer, path, &gain) )
 	{
-		input_conf =	g_settings_get_string
-				(settings, "mpv-input-config-file");
+		const gchar *cmd[] = {"af", "add", NULL, NULL};
+		gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+		gchar *filter = NULL;
 
-		g_info("Loading input config file: %s", input_conf);
-	}
+		g_ascii_formatd(buf, G_ASCII_DTOSTR_BUF_SIZE, "%.2f", gain);
 
-	load_input_conf(player, input_conf);
+		filter =	g_strdup_printf
+				(	"@" LOUDNESS_FILTER_LABEL
+					":lavfi=[volume=%sdB]",
+					buf );
+		cmd[2] = filter;
+
+		g_debug("Applying loudness gain of %s dB to %s", buf, path);
+		gmpv_mpv_command(mpv, cmd);
+
+		player->loudness_filter = TRUE;
 
-	g_free(input_conf);
-	g_object_unref(settings);
+		g_free(filter);
+	}
+
+	mpv_free(path);
 }
 
-static void load_scripts(GmpvPlayer *player)
+/* Entries are analyzed ahead of time so that their gain is known by the
+ * time they start. The current entry is included so that the first file
+ * played gets measured too, and has a gain the next time it is played.
+ */
+static void request_loudness_analysis(GmpvPlayer *player)
 {
-	gchar *path = get_scripts_dir_path();
-	GDir *dir = g_dir_open(path, 0, NULL);
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	GPtrArray *playlist = player->playlist;
+	gint64 position = get_playlist_position(player);
+	guint end = 0;
 
-	if(dir)
+	if(!settings->loudness_normalization || position < 0)
 	{
-		const gchar *name;
+		return;
+	}
 
-		do
-		{
-			gchar *full_path;
+	end = (guint)MIN(playlist->len, position+1+LOUDNESS_LOOKAHEAD);
 
-			name = g_dir_read_name(dir);
-			full_path = g_build_filename(path, name, NULL);
+	for(guint i = (guint)position; i < end; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
 
-			if(g_file_test(full_path, G_FILE_TEST_IS_REGULAR))
-			{
-				const gchar *cmd[]
-					= {"load-script", full_path, NULL};
+		gmpv_loudness_analyzer_request
+			(player->loudness_analyzer, entry->filename);
+	}
+}
 
-				g_info("Loading script: %s", full_path);
-				gmpv_mpv_command(GMPV_MPV(player), cmd);
-			}
+static void start_resume_tracking(GmpvPlayer *player)
+{
+	gchar *path = gmpv_mpv_get_property_string(GMPV_MPV(player), "path");
 
-			g_free(full_path);
-		}
-		while(name);
+	/* END_FILE is not reported when a file is replaced by loading another
+	 * one, so the previous file may still be tracked.
+	 */
+	save_resume_position(player);
+	g_free(player->resume_path);
 
-		g_dir_close(dir);
-	}
-	else
+	player->resume_path = g_strdup(path);
+	player->resume_position = 0;
+	player->resume_duration = 0;
+	player->resume_saved_position = 0;
+
+	if(player->resume_source_id == 0)
 	{
-		g_warning("Failed to open scripts directory: %s", path);
+		player->resume_source_id =	g_timeout_add_seconds
+						(	RESUME_DB_POLL_INTERVAL,
+							resume_poll_handler,
+							player );
 	}
 
-	g_free(path);
+	mpv_free(path);
 }
 
-static GmpvTrack *parse_track_entry(mpv_node_list *node)
+/* The position can no longer be queried once the file has ended, so the
+ * last polled position is saved instead.
+ */
+static void stop_resume_tracking(GmpvPlayer *player, gboolean finished)
 {
-	GmpvTrack *entry = gmpv_track_new();
+	if(player->resume_path && finished)
+	{
+		gmpv_resume_db_remove(player->resume_db, player->resume_path);
+	}
+	else if(player->resume_path)
+	{
+		save_resume_position(player);
+	}
 
-	for(gint i = 0; i < node->num; i++)
+	if(player->resume_source_id > 0)
 	{
-		if(g_strcmp0(node->keys[i], "type") == 0)
-		{
-			const gchar *type = node->values[i].u.string;
+		g_source_remove(player->resume_source_id);
+		player->resume_source_id = 0;
+	}
+
+	g_clear_pointer(&player->resume_path, g_free);
+}
+
+static void poll_resume_position(GmpvPlayer *player)
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
+	gdouble time_pos = 0;
+	gdouble duration = 0;
+
+	if(	player->resume_path &&
+		gmpv_mpv_get_property
+		(mpv, "time-pos", MPV_FORMAT_DOUBLE, &time_pos) >= 0 )
+	{
+		player->resume_position = time_pos;
+
+		if(gmpv_mpv_get_property
+			(mpv, "duration", MPV_FORMAT_DOUBLE, &duration) >= 0)
+		{
+			player->resume_duration = duration;
+		}
+	}
+}
+
+static void save_resume_position(GmpvPlayer *player)
+{
+	if(player->resume_path && player->resume_position > 0)
+	{
+		gmpv_resume_db_update(	player->resume_db,
+					player->resume_path,
+					player->resume_position,
+					player->resume_duration );
+
+		player->resume_saved_position = player->resume_position;
+	}
+}
+
+/* Positions are polled often so that they are accurate when the file ends,
+ * but are only written once playback has moved far enough.
+ */
+static gboolean resume_poll_handler(gpointer data)
+{
+	GmpvPlayer *player = data;
+	gdouble distance = 0;
+
+	poll_resume_position(player);
+
+	distance = ABS(player->resume_position - player->resume_saved_position);
+
+	if(distance >= RESUME_DB_SAVE_INTERVAL)
+	{
+		save_resume_position(player);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void reset(GmpvMpv *mpv)
+{
+	gboolean idle_active = FALSE;
+	gint64 playlist_pos = 0;
+
+	/* The file will be loaded again by the new instance */
+	poll_resume_position(GMPV_PLAYER(mpv));
+	stop_resume_tracking(GMPV_PLAYER(mpv), FALSE);
+
+	gmpv_mpv_get_property(	mpv,
+				"idle-active",
+				MPV_FORMAT_FLAG,
+				&idle_active );
+	gmpv_mpv_get_property(	mpv,
+				"playlist-pos",
+				MPV_FORMAT_INT64,
+				&playlist_pos );
+
+	GMPV_MPV_CLASS(gmpv_player_parent_class)->reset(mpv);
+
+	/* Scripts loaded by the old instance are gone. If the video output was
+	 * already configured, they will not be loaded by the vo-configured
+	 * handler, so load them now.
+	 */
+	g_hash_table_remove_all(GMPV_PLAYER(mpv)->loaded_scripts);
+
+	if(!GMPV_PLAYER(mpv)->init_vo_config)
+	{
+		load_scripts(GMPV_PLAYER(mpv));
+	}
+
+	if(!idle_active)
+	{
+		GMPV_PLAYER(mpv)->restore_pos = playlist_pos;
+
+		load_from_playlist(GMPV_PLAYER(mpv));
+	}
+}
+
+static void load_input_conf(GmpvPlayer *player, const gchar *input_conf)
+{
+	const gchar *default_keybinds[] = DEFAULT_KEYBINDS;
+	gchar *tmp_path;
+	FILE *tmp_file;
+	gint tmp_fd;
+
+	if(player->tmp_input_config)
+	{
+		g_unlink(player->tmp_input_config);
+		g_free(player->tmp_input_config);
+	}
+
+	tmp_fd = g_file_open_tmp(NULL, &tmp_path, NULL);
+	tmp_file = fdopen(tmp_fd, "w");
+	player->tmp_input_config = tmp_path;
+
+	if(!tmp_file)
+	{
+		g_error("Failed to open temporary input config file");
+	}
+
+	for(gint i = 0; default_keybinds[i]; i++)
+	{
+		const gsize len = strlen(default_keybinds[i]);
+		gsize write_size = fwrite(default_keybinds[i], len, 1, tmp_file);
+		gint rc = fputc('\n', tmp_file);
+
+		if(write_size != 1 || rc != '\n')
+		{
+			g_error(	"Error writing default keybindings to "
+					"temporary input config file" );
+		}
+	}
+
+	g_debug("Using temporary input config file: %s", tmp_path);
+	gmpv_mpv_set_option_string(GMPV_MPV(player), "input-conf", tmp_path);
+
+	if(input_conf && strlen(input_conf) > 0)
+	{
+		const gsize buf_size = 65536;
+		void *buf = g_malloc(buf_size);
+		FILE *src_file = g_fopen(input_conf, "r");
+		gsize read_size = buf_size;
+
+		if(!src_file)
+		{
+			g_warning(	"Cannot open input config file: %s",
+					input_conf );
+		}
+
+		while(src_file && read_size == buf_size)
+		{
+			read_size = fread(buf, 1, buf_size, src_file);
+
+			if(read_size != fwrite(buf, 1, read_size, tmp_file))
+			{
+				g_error(	"Error writing requested input "
+						"config file to temporary "
+						"input config file" );
+			}
+		}
+
+		g_info("Loaded input config file: %s", input_conf);
+
+		g_free(buf);
+	}
+
+	fclose(tmp_file);
+}
+
+static void load_config_file(GmpvMpv *mpv)
+{
+	GmpvPlayer *player = GMPV_PLAYER(mpv);
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	gchar *mpv_conf =	get_file_setting
+				(	settings->mpv_config_enable,
+					settings->mpv_config_file );
+
+	if(mpv_conf)
+	{
+		g_info("Loading config file: %s", mpv_conf);
+		gmpv_mpv_load_config_file(mpv, mpv_conf);
+	}
+
+	g_free(player->applied_config_file);
+	g_free(player->applied_config_checksum);
+	player->applied_config_file = mpv_conf;
+	player->applied_config_checksum = get_file_checksum(mpv_conf);
+}
+
+static void load_input_config_file(GmpvPlayer *player)
+{
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	gchar *input_conf =	get_file_setting
+				(	settings->mpv_input_config_enable,
+					settings->mpv_input_config_file );
+
+	if(input_conf)
+	{
+		g_info("Loading input config file: %s", input_conf);
+	}
+
+	load_input_conf(player, input_conf);
+
+	g_free(player->applied_input_config);
+	g_free(player->applied_input_config_checksum);
+	player->applied_input_config = input_conf;
+	player->applied_input_config_checksum = get_file_checksum(input_conf);
+}
+
+static void load_scripts(GmpvPlayer *player)
+{
+	GPtrArray *scripts = get_scripts();
+
+	for(guint i = 0; i < scripts->len; i++)
+	{
+		const gchar *full_path = g_ptr_array_index(scripts, i);
+
+		if(!g_hash_table_contains(player->loaded_scripts, full_path))
+		{
+			const gchar *cmd[] = {"load-script", full_path, NULL};
+
+			g_info("Loading script: %s", full_path);
+			gmpv_mpv_command(GMPV_MPV(player), cmd);
+
+			g_hash_table_add(	player->loaded_scripts,
+						g_strdup(full_path) );
+		}
+	}
+
+	g_ptr_array_free(scripts, TRUE);
+}
+
+static GPtrArray *get_scripts(void)
+{
+	GPtrArray *scripts = g_ptr_array_new_with_free_func(g_free);
+	gchar *path = get_scripts_dir_path();
+	GDir *dir = g_dir_open(path, 0, NULL);
+
+	if(dir)
+	{
+		const gchar *name;
+
+		do
+		{
+			gchar *full_path;
+
+			name = g_dir_read_name(dir);
+			full_path = g_build_filename(path, name, NULL);
+
+			if(g_file_test(full_path, G_FILE_TEST_IS_REGULAR))
+			{
+				g_ptr_array_add(scripts, full_path);
+			}
+			else
+			{
+				g_free(full_path);
+			}
+		}
+		while(name);
+
+		g_dir_close(dir);
+	}
+	else
+	{
+		g_warning("Failed to open scripts directory: %s", path);
+	}
+
+	g_free(path);
+
+	return scripts;
+}
+
+static gchar *get_file_setting(gboolean enable, const gchar *filename)
+{
+	return (enable && filename && *filename)?g_strdup(filename):NULL;
+}
+
+/* Config files are small, so hashing their contents is cheap, and unlike
+ * modification times, it does not miss edits made within the same second.
+ */
+static gchar *get_file_checksum(const gchar *filename)
+{
+	gchar *contents = NULL;
+	gsize size = 0;
+	gchar *checksum = NULL;
+
+	if(filename && g_file_get_contents(filename, &contents, &size, NULL))
+	{
+		checksum =	g_compute_checksum_for_data
+				(G_CHECKSUM_SHA1, (const guchar *)contents, size);
+	}
+
+	g_free(contents);
+
+	return checksum;
+}
+
+static gboolean apply_option_changes(	GmpvPlayer *player,
+					const gchar *mpv_options )
+{
+	GHashTable *old_options = NULL;
+	GHashTable *new_options = NULL;
+	GHashTableIter iter;
+	gpointer name = NULL;
+	gpointer value = NULL;
+	gboolean live = TRUE;
+
+	if(g_strcmp0(player->applied_mpv_options, mpv_options) == 0)
+	{
+		return TRUE;
+	}
+
+	old_options = parse_options_string(player->applied_mpv_options);
+	new_options = parse_options_string(mpv_options);
+
+	g_hash_table_iter_init(&iter, old_options);
+
+	/* There is no way to tell which value an option had before it was
+	 * overridden, so removing an option requires starting over.
+	 */
+	while(live && g_hash_table_iter_next(&iter, &name, NULL))
+	{
+		if(!g_hash_table_contains(new_options, name))
+		{
+			g_info(	"Option --%s was removed; mpv needs to be reset",
+				(gchar *)name );
+
+			live = FALSE;
+		}
+	}
+
+	g_hash_table_iter_init(&iter, new_options);
+
+	while(live && g_hash_table_iter_next(&iter, &name, &value))
+	{
+		const gchar *old_value = g_hash_table_lookup(old_options, name);
+
+		if(	g_hash_table_contains(old_options, name) &&
+			g_strcmp0(old_value, value) == 0 )
+		{
+			continue;
+		}
+
+		if(gmpv_mpv_set_option_string(GMPV_MPV(player), name, value) < 0)
+		{
+			g_info(	"Option --%s=%s cannot be changed at runtime; "
+				"mpv needs to be reset",
+				(gchar *)name,
+				(gchar *)value );
+
+			live = FALSE;
+		}
+		else
+		{
+			g_info(	"Applied option --%s=%s at runtime",
+				(gchar *)name,
+				(gchar *)value );
+		}
+	}
+
+	if(live)
+	{
+		g_free(player->applied_mpv_options);
+		player->applied_mpv_options = g_strdup(mpv_options);
+	}
+
+	g_hash_table_unref(old_options);
+	g_hash_table_unref(new_options);
+
+	return live;
+}
+
+static gboolean apply_input_config_changes(	GmpvPlayer *player,
+						const gchar *input_config )
+{
+	const gchar *cmd[] = {"load-input-conf", input_config, NULL};
+	gchar *checksum = get_file_checksum(input_config);
+	gboolean live = TRUE;
+
+	if(	g_strcmp0(player->applied_input_config, input_config) == 0 &&
+		g_strcmp0(player->applied_input_config_checksum, checksum) == 0 )
+	{
+		g_free(checksum);
+
+		return TRUE;
+	}
+
+	/* Bindings can be added at runtime, but not removed */
+	if(player->applied_input_config)
+	{
+		g_info(	"Input config file %s was edited, replaced or "
+			"disabled; mpv needs to be reset",
+			player->applied_input_config );
+
+		live = FALSE;
+	}
+	else if(gmpv_mpv_command(GMPV_MPV(player), cmd) < 0)
+	{
+		g_info(	"Failed to load input config file %s at runtime; "
+			"mpv needs to be reset",
+			input_config );
+
+		live = FALSE;
+	}
+	else
+	{
+		g_info("Loaded input config file %s at runtime", input_config);
+
+		player->applied_input_config = g_strdup(input_config);
+		player->applied_input_config_checksum = checksum;
+		checksum = NULL;
+	}
+
+	g_free(checksum);
+
+	return live;
+}
+
+static gboolean apply_script_changes(GmpvPlayer *player)
+{
+	GPtrArray *scripts = NULL;
+	GHashTable *available = NULL;
+	GHashTableIter iter;
+	gpointer script = NULL;
+	gboolean live = TRUE;
+
+	/* Scripts are loaded once the video output is configured. If that
+	 * has not happened yet, the current set of scripts will be loaded
+	 * then.
+	 */
+	if(player->init_vo_config)
+	{
+		return TRUE;
+	}
+
+	scripts = get_scripts();
+	available = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for(guint i = 0; i < scripts->len; i++)
+	{
+		g_hash_table_add(available, g_ptr_array_index(scripts, i));
+	}
+
+	g_hash_table_iter_init(&iter, player->loaded_scripts);
+
+	while(live && g_hash_table_iter_next(&iter, &script, NULL))
+	{
+		if(!g_hash_table_contains(available, script))
+		{
+			g_info(	"Script %s was removed; mpv needs to be reset",
+				(gchar *)script );
+
+			live = FALSE;
+		}
+	}
+
+	if(live)
+	{
+		load_scripts(player);
+	}
+
+	g_hash_table_unref(available);
+	g_ptr_array_free(scripts, TRUE);
+
+	return live;
+}
+
+static GmpvTrack *parse_track_entry(mpv_node_list *node)
+{
+	GmpvTrack *entry = gmpv_track_new();
+
+	for(gint i = 0; i < node->num; i++)
+	{
+		if(g_strcmp0(node->keys[i], "type") == 0)
+		{
+			const gchar *type = node->values[i].u.string;
 
 			if(g_strcmp0(type, "audio") == 0)
 			{
@@ -763,93 +1618,617 @@ static void add_file_to_playlist(GmpvPlayer *player, const gchar *uri)
 {
 	GmpvPlaylistEntry *entry = gmpv_playlist_entry_new(uri, NULL);
 
-	g_ptr_array_add(player->playlist, entry);
+	g_ptr_array_add(get_writable_playlist(player), entry);
+}
+
+/* Loads entries read by gmpv_playlist_parser, GmpvFolderImporter or
+ * gmpv_import_batch. Unlike letting mpv expand playlists, the titles and
+ * durations are known from the start, and the whole list is published once.
+ * Only the first entry is handed to mpv right away. The others are fed to
+ * it in the background, like when loading from the playlist.
+ */
+static void load_playlist_entries(	GmpvPlayer *player,
+					GPtrArray *entries,
+					gboolean append )
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
+	GPtrArray *playlist = NULL;
+	gboolean ready = FALSE;
+	gboolean idle_active = FALSE;
+	guint start = player->playlist->len;
+
+	if(!append)
+	{
+		stop_playlist_feed(player);
+	}
+
+	g_object_get(mpv, "ready", &ready, NULL);
+	gmpv_mpv_get_property(	mpv,
+				"idle-active",
+				MPV_FORMAT_FLAG,
+				&idle_active );
+
+	g_info(	"Loading %u playlist entries (append=%s)",
+		entries->len,
+		append?"TRUE":"FALSE" );
+
+	if(!append)
+	{
+		g_ptr_array_unref(player->playlist);
+
+		player->playlist = gmpv_playlist_new(entries->len);
+		player->playlist_published = FALSE;
+		start = 0;
+	}
+
+	playlist = get_writable_playlist(player);
+
+	for(guint i = 0; i < entries->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(entries, i);
+
+		g_ptr_array_add(playlist, gmpv_playlist_entry_ref(entry));
+	}
+
+	/* Files added while mpv is idle are only in our own playlist */
+	if(ready && !idle_active && !append)
+	{
+		player->new_file = TRUE;
+		player->loaded = FALSE;
+		player->restore_pos = 0;
+		player->restore_paused = FALSE;
+
+		load_from_playlist(player);
+	}
+	else if(ready && !idle_active && player->feed_playlist)
+	{
+		/* The feed reaches the new entries once it is done with the
+		 * others. The fed playlist is never modified, and the new one
+		 * starts with the same entries.
+		 */
+		g_ptr_array_unref(player->feed_playlist);
+
+		player->feed_playlist = g_ptr_array_ref(playlist);
+	}
+	else if(ready && !idle_active && start < playlist->len)
+	{
+		player->feed_playlist = g_ptr_array_ref(playlist);
+		player->feed_current = 0;
+		player->feed_before = 0;
+		player->feed_after = start;
+		player->feed_source_id =	g_idle_add
+						(feed_playlist_handler, player);
+	}
+
+	publish_playlist(player);
+	seed_metadata_cache(player, entries);
+}
+
+/* Seeds the cache with what is already known, so that titles that mpv does
+ * not know about are kept when the metadata is fetched.
+ */
+static void seed_metadata_cache(GmpvPlayer *player, GPtrArray *entries)
+{
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+
+	if(player->cache && settings->prefetch_metadata)
+	{
+		for(guint i = 0; i < entries->len; i++)
+		{
+			GmpvPlaylistEntry *entry = g_ptr_array_index(entries, i);
+			GmpvMetadataCacheEntry *cache_entry = NULL;
+
+			cache_entry =	gmpv_metadata_cache_lookup
+					(player->cache, entry->filename);
+
+			if(!cache_entry->title && entry->title)
+			{
+				cache_entry->title = g_strdup(entry->title);
+			}
+
+			if(cache_entry->duration <= 0)
+			{
+				cache_entry->duration = entry->duration;
+			}
+		}
+
+		gmpv_metadata_cache_load_playlist
+			(player->cache, player, player->playlist);
+	}
 }
 
+/* Only the entry at restore_pos is loaded right away. The others are fed to
+ * mpv in the background, so that long playlists do not block the main loop.
+ * Until that is done, mpv's playlist is incomplete, so it is not published.
+ */
 static void load_from_playlist(GmpvPlayer *player)
 {
 	GmpvMpv *mpv = GMPV_MPV(player);
 	GPtrArray *playlist = player->playlist;
 
-	for(guint i = 0; playlist && i < playlist->len; i++)
+	stop_playlist_feed(player);
+
+	if(playlist && playlist->len > 0)
 	{
-		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		GmpvPlaylistEntry *entry = NULL;
+		guint current = 0;
+
+		if(player->restore_pos > 0 && player->restore_pos < playlist->len)
+		{
+			current = (guint)player->restore_pos;
+		}
+
+		entry = g_ptr_array_index(playlist, current);
 
-		/* Do not append on first iteration */
 		GMPV_MPV_CLASS(gmpv_player_parent_class)
-			->load_file(mpv, entry->filename, i != 0);
+			->load_file(mpv, entry->filename, FALSE);
+
+		if(player->restore_paused)
+		{
+			gmpv_mpv_set_property_flag(mpv, "pause", TRUE);
+		}
+
+		/* The fed playlist must not change under the feeder, so make
+		 * sure that it is copied before being modified.
+		 */
+		player->playlist_published = TRUE;
+		player->feed_playlist = g_ptr_array_ref(playlist);
+		player->feed_current = current;
+		player->feed_before = 0;
+		player->feed_after = current + 1;
+
+		if(current > 0 || current + 1 < playlist->len)
+		{
+			player->feed_source_id =	g_idle_add
+							(	feed_playlist_handler,
+								player );
+		}
+		else
+		{
+			stop_playlist_feed(player);
+		}
+	}
+
+	player->restore_pos = 0;
+	player->restore_paused = FALSE;
+}
+
+/* Appends up to count entries to mpv's playlist. The entries before the
+ * current one come first, so that the playlist position is right as soon
+ * as possible. They are appended after the current entry, which is then
+ * moved behind them. Returns TRUE if there are entries left.
+ */
+static gboolean feed_playlist(GmpvPlayer *player, guint count)
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
+	GPtrArray *playlist = player->feed_playlist;
+	gboolean before = (player->feed_before < player->feed_current);
+	guint start = 0;
+	guint end = 0;
+
+	if(before)
+	{
+		start = player->feed_before;
+		end = start + MIN(count, player->feed_current - start);
+	}
+	else
+	{
+		start = player->feed_after;
+		end = start + MIN(count, playlist->len - start);
+	}
+
+	for(guint i = start; i < end; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		const gchar *cmd[] = {"loadfile", entry->filename, "append", NULL};
+
+		gmpv_mpv_command(mpv, cmd);
 	}
+
+	if(before)
+	{
+		const gchar *cmd[] = {"playlist-move", NULL, NULL, NULL};
+		gchar *src_str = g_strdup_printf("%u", start);
+		gchar *dest_str = g_strdup_printf("%u", end + 1);
+
+		cmd[1] = src_str;
+		cmd[2] = dest_str;
+
+		gmpv_mpv_command(mpv, cmd);
+
+		player->feed_before = end;
+
+		g_free(src_str);
+		g_free(dest_str);
+	}
+	else
+	{
+		player->feed_after = end;
+	}
+
+	return	player->feed_before < player->feed_current ||
+		player->feed_after < playlist->len;
+}
+
+static gboolean feed_playlist_handler(gpointer data)
+{
+	GmpvPlayer *player = data;
+	gboolean more = feed_playlist(player, PLAYLIST_FEED_CHUNK_SIZE);
+
+	if(!more)
+	{
+		g_debug("Finished loading playlist into mpv");
+
+		player->feed_source_id = 0;
+		g_clear_pointer(&player->feed_playlist, g_ptr_array_unref);
+	}
+
+	return more;
+}
+
+static void stop_playlist_feed(GmpvPlayer *player)
+{
+	if(player->feed_source_id > 0)
+	{
+		g_source_remove(player->feed_source_id);
+		player->feed_source_id = 0;
+	}
+
+	g_clear_pointer(&player->feed_playlist, g_ptr_array_unref);
+}
+
+/* mpv's position is meaningless until the entries before the current one
+ * have been fed. After that, mpv's playlist starts like ours, even if the
+ * entries after it are still being fed.
+ */
+static gint64 get_playlist_position(GmpvPlayer *player)
+{
+	gboolean feeding_before =	player->feed_playlist &&
+					player->feed_before < player->feed_current;
+
+	return feeding_before?player->feed_current:player->playlist_pos;
 }
 
-static GmpvPlaylistEntry *parse_playlist_entry(mpv_node_list *node)
+static void parse_playlist_entry(	mpv_node_list *node,
+					const gchar **filename,
+					const gchar **title )
 {
-	const gchar *filename = NULL;
-	const gchar *title = NULL;
+	*filename = NULL;
+	*title = NULL;
 
 	for(gint i = 0; i < node->num; i++)
 	{
 		if(g_strcmp0(node->keys[i], "filename") == 0)
 		{
-			filename = node->values[i].u.string;
+			*filename = node->values[i].u.string;
 		}
 		else if(g_strcmp0(node->keys[i], "title") == 0)
 		{
-			title = node->values[i].u.string;
+			*title = node->values[i].u.string;
+		}
+	}
+}
+
+static GPtrArray *get_writable_playlist(GmpvPlayer *player)
+{
+	/* Published playlists may be referenced by anyone, so they must never
+	 * be modified. Copy the array first. The entries themselves are
+	 * immutable, so they are shared.
+	 */
+	if(player->playlist_published)
+	{
+		GPtrArray *playlist = player->playlist;
+		GPtrArray *copy = gmpv_playlist_new(playlist->len);
+
+		for(guint i = 0; i < playlist->len; i++)
+		{
+			GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+
+			g_ptr_array_add(copy, gmpv_playlist_entry_ref(entry));
+		}
+
+		g_ptr_array_unref(player->playlist);
+
+		player->playlist = copy;
+		player->playlist_published = FALSE;
+	}
+
+	return player->playlist;
+}
+
+static void publish_playlist(GmpvPlayer *player)
+{
+	/* Updates that only change durations keep the index in sync
+	 * themselves. Anything else may have moved entries around.
+	 */
+	if(!player->durations_synced)
+	{
+		load_durations(player);
+	}
+
+	player->durations_synced = FALSE;
+	player->playlist_published = TRUE;
+	player->playlist_version = ++last_playlist_version;
+	g_object_notify(G_OBJECT(player), "playlist");
+}
+
+static void load_durations(GmpvPlayer *player)
+{
+	GPtrArray *playlist = player->playlist;
+
+	gmpv_duration_index_load(player->durations, playlist);
+
+	/* Entries added by mpv do not carry durations, but the metadata cache
+	 * may already know them.
+	 */
+	for(guint i = 0; player->cache && i < playlist->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		GmpvMetadataCacheEntry *cache_entry = NULL;
+
+		if(entry->duration <= 0)
+		{
+			cache_entry =	gmpv_metadata_cache_peek
+					(player->cache, entry->filename);
 		}
+
+		if(cache_entry && cache_entry->duration > 0)
+		{
+			gmpv_duration_index_set
+				(player->durations, i, cache_entry->duration);
+		}
+	}
+}
+
+static gboolean playlist_equal(GPtrArray *a, GPtrArray *b)
+{
+	gboolean equal = (a->len == b->len);
+
+	for(guint i = 0; equal && i < a->len; i++)
+	{
+		GmpvPlaylistEntry *x = g_ptr_array_index(a, i);
+		GmpvPlaylistEntry *y = g_ptr_array_index(b, i);
+
+		equal =	x == y ||
+			(	g_strcmp0(x->filename, y->filename) == 0 &&
+				g_strcmp0(x->title, y->title) == 0 );
+	}
+
+	return equal;
+}
+
+static void apply_playlist_moves(GmpvPlayer *player, GArray *moves)
+{
+	const gchar *cmd[] = {"playlist-move", NULL, NULL, NULL};
+
+	for(guint i = 0; i < moves->len; i++)
+	{
+		PlaylistMove *move = &g_array_index(moves, PlaylistMove, i);
+		gchar *src_str = g_strdup_printf("%" G_GINT64_FORMAT, move->src);
+		gchar *dest_str = g_strdup_printf("%" G_GINT64_FORMAT, move->dest);
+
+		cmd[1] = src_str;
+		cmd[2] = dest_str;
+
+		gmpv_mpv_command(GMPV_MPV(player), cmd);
+
+		g_free(src_str);
+		g_free(dest_str);
+	}
+}
+
+static void reload_playlist(GmpvPlayer *player, GArray *order)
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
+	const gchar *clear_cmd[] = {"playlist-clear", NULL};
+	gint64 pos = -1;
+	gint64 new_pos = -1;
+
+	gmpv_mpv_get_property(mpv, "playlist-pos", MPV_FORMAT_INT64, &pos);
+
+	/* playlist-clear keeps the current entry, so playback is not
+	 * interrupted. Append everything else around it in the new order.
+	 */
+	gmpv_mpv_command(mpv, clear_cmd);
+
+	for(guint i = 0; i < order->len; i++)
+	{
+		guint index = g_array_index(order, guint, i);
+
+		if(index == pos)
+		{
+			new_pos = i;
+		}
+		else
+		{
+			GmpvPlaylistEntry *entry =	g_ptr_array_index
+							(player->playlist, index);
+			const gchar *cmd[] =	{	"loadfile",
+							entry->filename,
+							"append",
+							NULL };
+
+			gmpv_mpv_command(mpv, cmd);
+		}
+	}
+
+	if(new_pos > 0)
+	{
+		GArray *moves = g_array_new(FALSE, FALSE, sizeof(PlaylistMove));
+		PlaylistMove move = {0, new_pos+1};
+
+		g_array_append_val(moves, move);
+		apply_playlist_moves(player, moves);
+		g_array_free(moves, TRUE);
+	}
+}
+
+/* Puts the entries of the playlist in the given order in as few commands as
+ * possible, then publishes the result as a single new version.
+ */
+static void apply_playlist_order(GmpvPlayer *player, GArray *order)
+{
+	GPtrArray *playlist = player->playlist;
+	GPtrArray *reordered = gmpv_playlist_new(order->len);
+	gboolean idle_active = FALSE;
+
+	gmpv_mpv_get_property(	GMPV_MPV(player),
+				"idle-active",
+				MPV_FORMAT_FLAG,
+				&idle_active );
+
+	/* Files added while mpv is idle are only in our own playlist */
+	if(!idle_active)
+	{
+		GArray *moves = gmpv_playlist_sort_get_moves(order);
+
+		if(moves)
+		{
+			g_debug("Reordering playlist using %u moves", moves->len);
+			apply_playlist_moves(player, moves);
+			g_array_free(moves, TRUE);
+		}
+		else
+		{
+			g_debug("Reordering playlist by reloading it");
+			reload_playlist(player, order);
+		}
+	}
+
+	for(guint i = 0; i < order->len; i++)
+	{
+		guint index = g_array_index(order, guint, i);
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, index);
+
+		g_ptr_array_add(reordered, gmpv_playlist_entry_ref(entry));
 	}
 
-	return gmpv_playlist_entry_new(filename, title);
+	g_ptr_array_unref(player->playlist);
+
+	player->playlist = reordered;
+	publish_playlist(player);
 }
 
 static void update_playlist(GmpvPlayer *player)
 {
-	GSettings *settings;
+	const GmpvSettingsCache *settings = gmpv_settings_cache_get();
+	GHashTable *old_entries = NULL;
+	GPtrArray *new_playlist = NULL;
+	guint reused = 0;
 	gboolean prefetch_metadata;
 	const mpv_node_list *org_list;
 	mpv_node playlist;
 
-	settings = g_settings_new(CONFIG_ROOT);
-	prefetch_metadata = g_settings_get_boolean(settings, "prefetch-metadata");
+	/* mpv only has part of the playlist while it is being fed */
+	if(player->feed_playlist)
+	{
+		return;
+	}
 
-	g_ptr_array_set_size(player->playlist, 0);
+	prefetch_metadata = player->cache && settings->prefetch_metadata;
 
 	gmpv_mpv_get_property
 		(GMPV_MPV(player), "playlist", MPV_FORMAT_NODE, &playlist);
 
 	org_list = playlist.u.list;
+	old_entries = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for(guint i = 0; i < player->playlist->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(player->playlist, i);
+
+		g_hash_table_insert
+			(old_entries, (gpointer)entry->filename, entry);
+	}
 
 	if(playlist.format == MPV_FORMAT_NODE_ARRAY)
 	{
+		new_playlist = gmpv_playlist_new((guint)org_list->num);
+
 		for(gint i = 0; i < org_list->num; i++)
 		{
-			GmpvPlaylistEntry *entry;
+			GmpvPlaylistEntry *entry = NULL;
+			const gchar *filename = NULL;
+			const gchar *title = NULL;
+
+			parse_playlist_entry
+				(org_list->values[i].u.list, &filename, &title);
 
-			entry = parse_playlist_entry(org_list->values[i].u.list);
+			entry = g_hash_table_lookup(old_entries, filename);
+
+			/* mpv does not know the titles read from playlist files
+			 * by gmpv_playlist_parser, so keep them.
+			 */
+			if(!title && entry)
+			{
+				title = entry->title;
+			}
 
-			if(!entry->title && prefetch_metadata)
+			if(!title && prefetch_metadata)
 			{
 				GmpvMetadataCacheEntry *cache_entry;
 
 				cache_entry =	gmpv_metadata_cache_lookup
-						(player->cache, entry->filename);
-				entry->title =	g_strdup(cache_entry->title);
+						(player->cache, filename);
+				title =	cache_entry->title;
+			}
+
+			/* Reuse the entry from the previous version of the
+			 * playlist if it did not change, so that unchanged
+			 * entries are only stored once.
+			 */
+			if(entry && g_strcmp0(entry->title, title) == 0)
+			{
+				entry = gmpv_playlist_entry_ref(entry);
+				reused++;
+			}
+			else
+			{
+				entry = gmpv_playlist_entry_new(filename, title);
 			}
 
-			g_ptr_array_add(player->playlist, entry);
+			g_ptr_array_add(new_playlist, entry);
 		}
 
 		mpv_free_node_contents(&playlist);
-		g_object_notify(G_OBJECT(player), "playlist");
+
+		g_debug(	"Playlist updated: %u entries, %u reused",
+				new_playlist->len,
+				reused );
+	}
+
+	g_hash_table_unref(old_entries);
+
+	/* Batched changes such as sorting publish the result themselves, so
+	 * the property change that follows does not need to be published
+	 * again.
+	 */
+	if(	new_playlist &&
+		player->playlist_published &&
+		playlist_equal(new_playlist, player->playlist) )
+	{
+		g_ptr_array_unref(new_playlist);
+	}
+	else if(new_playlist)
+	{
+		g_ptr_array_unref(player->playlist);
+
+		player->playlist = new_playlist;
+		publish_playlist(player);
 	}
+	else
+	{
+		g_ptr_array_unref(player->playlist);
 
+		player->playlist = gmpv_playlist_new(0);
+		player->playlist_published = FALSE;
+	}
 
 	if(prefetch_metadata)
 	{
 		gmpv_metadata_cache_load_playlist
-			(player->cache, player->playlist);
+			(player->cache, player, player->playlist);
 	}
-
-	g_object_unref(settings);
 }
 
 static void update_metadata(GmpvPlayer *player)
@@ -930,21 +2309,87 @@ static void cache_update_handler(	GmpvMetadataCache *cache,
 {
 	GmpvPlayer *player = data;
 
+	/* Every update publishes a new version of the playlist, so batch the
+	 * updates that arrive in quick succession.
+	 */
+	g_hash_table_add(player->cache_updates, g_strdup(uri));
+
+	if(player->cache_update_source_id == 0)
+	{
+		player->cache_update_source_id =	g_idle_add
+							(apply_cache_updates, player);
+	}
+}
+
+static gboolean apply_cache_updates(gpointer data)
+{
+	GmpvPlayer *player = data;
+	GArray *updated = g_array_new(FALSE, FALSE, sizeof(gint64));
+	gboolean synced =	gmpv_duration_index_get_length(player->durations)
+				== player->playlist->len;
+
+	player->cache_update_source_id = 0;
+
 	for(guint i = 0; i < player->playlist->len; i++)
 	{
 		GmpvPlaylistEntry *entry = g_ptr_array_index(player->playlist, i);
+		GmpvMetadataCacheEntry *cache_entry = NULL;
 
-		if(g_strcmp0(entry->filename, uri) == 0)
+		if(g_hash_table_contains(player->cache_updates, entry->filename))
 		{
-			GmpvMetadataCacheEntry *cache_entry;
+			cache_entry =	gmpv_metadata_cache_lookup
+					(player->cache, entry->filename);
+		}
 
-			cache_entry = gmpv_metadata_cache_lookup(cache, uri);
-			g_free(entry->title);
-			entry->title = g_strdup(cache_entry->title);
+		if(	cache_entry &&
+			(g_strcmp0(cache_entry->title, entry->title) != 0 ||
+			(cache_entry->duration > 0 &&
+			cache_entry->duration != entry->duration)) )
+		{
+			GPtrArray *playlist = get_writable_playlist(player);
+			GmpvPlaylistEntry *new_entry = NULL;
+			gint64 index = i;
+
+			new_entry =	gmpv_playlist_entry_new
+					(entry->filename, cache_entry->title);
+			new_entry->duration =	cache_entry->duration > 0?
+						cache_entry->duration:
+						entry->duration;
+			playlist->pdata[i] = new_entry;
+			gmpv_playlist_entry_unref(entry);
+
+			if(synced)
+			{
+				gmpv_duration_index_set
+					(player->durations, i, new_entry->duration);
+			}
 
-			g_signal_emit_by_name(data, "metadata-update", i);
+			g_array_append_val(updated, index);
 		}
 	}
+
+	g_hash_table_remove_all(player->cache_updates);
+
+	if(updated->len > 0)
+	{
+		/* Only durations changed, so there is no need to rebuild the
+		 * whole index.
+		 */
+		player->durations_synced = synced;
+
+		publish_playlist(player);
+	}
+
+	for(guint i = 0; i < updated->len; i++)
+	{
+		gint64 index = g_array_index(updated, gint64, i);
+
+		g_signal_emit_by_name(player, "metadata-update", index);
+	}
+
+	g_array_free(updated, TRUE);
+
+	return G_SOURCE_REMOVE;
 }
 
 static void gmpv_player_class_init(GmpvPlayerClass *klass)
@@ -961,6 +2406,7 @@ static void gmpv_player_class_init(GmpvPlayerClass *klass)
 	mpv_class->reset = reset;
 	obj_class->set_property = set_property;
 	obj_class->get_property = get_property;
+	obj_class->dispose = dispose;
 	obj_class->finalize = finalize;
 
 	pspec = g_param_spec_pointer
@@ -1007,9 +2453,36 @@ static void gmpv_player_class_init(GmpvPlayerClass *klass)
 
 static void gmpv_player_init(GmpvPlayer *player)
 {
-	player->cache =		gmpv_metadata_cache_new();
-	player->playlist =	g_ptr_array_new_with_free_func
-				((GDestroyNotify)gmpv_playlist_entry_free);
+	player->cache =		gmpv_metadata_cache_get_default();
+	player->cache_updates =	g_hash_table_new_full
+				(g_str_hash, g_str_equal, g_free, NULL);
+	player->cache_update_source_id = 0;
+	player->playlist =	gmpv_playlist_new(0);
+	player->playlist_published = TRUE;
+	player->playlist_version = ++last_playlist_version;
+	player->durations = gmpv_duration_index_new();
+	player->durations_synced = FALSE;
+	player->importer =	NULL;
+	player->import_replace = FALSE;
+	player->pending_imports = g_queue_new();
+	player->catalog = gmpv_library_catalog_get_default();
+	player->loudness_analyzer = gmpv_loudness_analyzer_get_default();
+	player->loudness_filter = FALSE;
+	player->resume_db = gmpv_resume_db_get_default();
+	player->resume_path = NULL;
+	player->resume_position = 0;
+	player->resume_duration = 0;
+	player->resume_saved_position = 0;
+	player->resume_source_id = 0;
+	player->playlist_pos = -1;
+	player->restore_pos = 0;
+	player->restore_time_pos = 0;
+	player->restore_paused = FALSE;
+	player->feed_playlist = NULL;
+	player->feed_current = 0;
+	player->feed_before = 0;
+	player->feed_after = 0;
+	player->feed_source_id = 0;
 	player->metadata =	g_ptr_array_new_with_free_func
 				((GDestroyNotify)gmpv_metadata_entry_free);
 	player->track_list =	g_ptr_array_new_with_free_func
@@ -1022,6 +2495,13 @@ static void gmpv_player_init(GmpvPlayer *player)
 	player->new_file = TRUE;
 	player->init_vo_config = TRUE;
 	player->tmp_input_config = NULL;
+	player->applied_mpv_options = NULL;
+	player->applied_config_file = NULL;
+	player->applied_config_checksum = NULL;
+	player->applied_input_config = NULL;
+	player->applied_input_config_checksum = NULL;
+	player->loaded_scripts =	g_hash_table_new_full
+					(g_str_hash, g_str_equal, g_free, NULL);
 
 	g_signal_connect(	player->cache,
 				"update",
@@ -1036,6 +2516,437 @@ GmpvPlayer *gmpv_player_new(gint64 wid)
 						NULL ));
 }
 
+gboolean gmpv_player_apply_settings(GmpvPlayer *player)
+{
+	const GmpvSettingsCache *settings = NULL;
+	gchar *config_file = NULL;
+	gchar *config_checksum = NULL;
+	gchar *input_config = NULL;
+	gboolean live = TRUE;
+
+	/* The preferences dialog applies its changes right before this is
+	 * called, so don't rely on the change notifications having arrived.
+	 */
+	gmpv_settings_cache_refresh();
+
+	settings = gmpv_settings_cache_get();
+	config_file =	get_file_setting
+			(settings->mpv_config_enable, settings->mpv_config_file);
+	config_checksum = get_file_checksum(config_file);
+	input_config =	get_file_setting
+			(	settings->mpv_input_config_enable,
+				settings->mpv_input_config_file );
+
+	/* Options set by a config file cannot be told apart from the ones
+	 * set elsewhere, so they can only be undone by starting over.
+	 */
+	if(g_strcmp0(player->applied_config_file, config_file) != 0)
+	{
+		g_info(	"Config file changed from %s to %s; "
+			"mpv needs to be reset",
+			player->applied_config_file?:"none",
+			config_file?:"none" );
+
+		live = FALSE;
+	}
+	else if(g_strcmp0(player->applied_config_checksum, config_checksum) != 0)
+	{
+		g_info(	"Config file %s was edited; mpv needs to be reset",
+			config_file );
+
+		live = FALSE;
+	}
+
+	live = live && apply_input_config_changes(player, input_config);
+	live = live && apply_option_changes(player, settings->mpv_options);
+	live = live && apply_script_changes(player);
+
+	if(live)
+	{
+		g_info("Applied settings without resetting mpv");
+	}
+
+	g_free(config_file);
+	g_free(config_checksum);
+	g_free(input_config);
+
+	return live;
+}
+
+void gmpv_player_load_files(	GmpvPlayer *player,
+				const gchar **uris,
+				gboolean append )
+{
+	if(!append)
+	{
+		cancel_import(player);
+		cancel_pending_imports(player);
+	}
+
+	/* A single file is loaded right away, unless batches requested
+	 * earlier are still pending, since it has to come after them.
+	 */
+	if(uris[0] && !uris[1] && g_queue_is_empty(player->pending_imports))
+	{
+		gmpv_mpv_load(GMPV_MPV(player), uris[0], append);
+	}
+	else if(uris[0])
+	{
+		PendingImport *pending = g_new0(PendingImport, 1);
+
+		g_info(	"Importing %u files (append=%s)",
+			g_strv_length((gchar **)uris),
+			append?"TRUE":"FALSE" );
+
+		pending->player = player;
+		pending->cancellable = g_cancellable_new();
+		pending->batch = NULL;
+		pending->append = append;
+		pending->done = FALSE;
+
+		g_queue_push_tail(player->pending_imports, pending);
+		gmpv_import_batch_async(	uris,
+						pending->cancellable,
+						import_batch_ready_handler,
+						pending );
+	}
+}
+
+void gmpv_player_sort_playlist(GmpvPlayer *player, PlaylistSortField field)
+{
+	GArray *order = NULL;
+
+	gmpv_player_sync_playlist(player);
+
+	order =	gmpv_playlist_sort_get_order
+		(player->playlist, player->cache, field);
+
+	apply_playlist_order(player, order);
+	g_array_free(order, TRUE);
+}
+
+void gmpv_player_remove_playlist_entries(	GmpvPlayer *player,
+						const GArray *indices )
+{
+	GPtrArray *playlist = NULL;
+	GPtrArray *remaining = NULL;
+	gboolean *removed = NULL;
+	gboolean idle_active = FALSE;
+
+	gmpv_player_sync_playlist(player);
+
+	playlist = player->playlist;
+	removed = g_new0(gboolean, playlist->len+1);
+
+	for(guint i = 0; i < indices->len; i++)
+	{
+		guint index = g_array_index(indices, guint, i);
+
+		if(index < playlist->len)
+		{
+			removed[index] = TRUE;
+		}
+	}
+
+	gmpv_mpv_get_property(	GMPV_MPV(player),
+				"idle-active",
+				MPV_FORMAT_FLAG,
+				&idle_active );
+
+	/* Remove from the back so that the remaining indices stay valid */
+	for(guint i = playlist->len; !idle_active && i > 0; i--)
+	{
+		if(removed[i-1])
+		{
+			const gchar *cmd[] = {"playlist-remove", NULL, NULL};
+			gchar *index_str = g_strdup_printf("%u", i-1);
+
+			cmd[1] = index_str;
+
+			gmpv_mpv_command(GMPV_MPV(player), cmd);
+
+			g_free(index_str);
+		}
+	}
+
+	remaining = gmpv_playlist_new(playlist->len);
+
+	for(guint i = 0; i < playlist->len; i++)
+	{
+		if(!removed[i])
+		{
+			GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+
+			g_ptr_array_add(remaining, gmpv_playlist_entry_ref(entry));
+		}
+	}
+
+	g_free(removed);
+	g_ptr_array_unref(player->playlist);
+
+	player->playlist = remaining;
+	publish_playlist(player);
+}
+
+void gmpv_player_move_playlist_entries(	GmpvPlayer *player,
+					const GArray *indices,
+					guint dest )
+{
+	guint length = 0;
+	gboolean *selected = NULL;
+	GArray *order = NULL;
+
+	gmpv_player_sync_playlist(player);
+
+	length = player->playlist->len;
+	selected = g_new0(gboolean, length+1);
+	order = g_array_sized_new(FALSE, FALSE, sizeof(guint), length);
+
+	for(guint i = 0; i < indices->len; i++)
+	{
+		guint index = g_array_index(indices, guint, i);
+
+		if(index < length)
+		{
+			selected[index] = TRUE;
+		}
+	}
+
+	/* The selected entries are put in front of the entry at dest, keeping
+	 * their relative order.
+	 */
+	for(guint i = 0; i < MIN(dest, length); i++)
+	{
+		if(!selected[i])
+		{
+			g_array_append_val(order, i);
+		}
+	}
+
+	for(guint i = 0; i < length; i++)
+	{
+		if(selected[i])
+		{
+			g_array_append_val(order, i);
+		}
+	}
+
+	for(guint i = MIN(dest, length); i < length; i++)
+	{
+		if(!selected[i])
+		{
+			g_array_append_val(order, i);
+		}
+	}
+
+	apply_playlist_order(player, order);
+
+	g_array_free(order, TRUE);
+	g_free(selected);
+}
+
+void gmpv_player_sync_playlist(GmpvPlayer *player)
+{
+	if(player->feed_playlist)
+	{
+		while(feed_playlist(player, G_MAXUINT));
+
+		stop_playlist_feed(player);
+	}
+}
+
+gdouble gmpv_player_get_playlist_duration(	GmpvPlayer *player,
+						gboolean *complete )
+{
+	if(complete)
+	{
+		*complete =	gmpv_duration_index_get_unknown_count
+				(player->durations) == 0;
+	}
+
+	return gmpv_duration_index_get_total(player->durations);
+}
+
+gdouble gmpv_player_get_playlist_time_position(GmpvPlayer *player)
+{
+	gint64 position = get_playlist_position(player);
+	gdouble time_pos = 0;
+
+	if(position < 0)
+	{
+		return 0;
+	}
+
+	if(player->loaded)
+	{
+		gmpv_mpv_get_property(	GMPV_MPV(player),
+					"time-pos",
+					MPV_FORMAT_DOUBLE,
+					&time_pos );
+	}
+
+	return	gmpv_duration_index_get_sum(player->durations, (guint)position)+
+		MAX(0, time_pos);
+}
+
+gboolean gmpv_player_seek_playlist(GmpvPlayer *player, gdouble time)
+{
+	GmpvMpv *mpv = GMPV_MPV(player);
+	gdouble offset = 0;
+	gint64 position = -1;
+
+	gmpv_player_sync_playlist(player);
+
+	position = gmpv_duration_index_find(player->durations, time, &offset);
+
+	if(position < 0)
+	{
+		return FALSE;
+	}
+
+	if(position == player->playlist_pos && player->loaded)
+	{
+		const gchar *cmd[] = {"seek", NULL, "absolute", NULL};
+		gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+		cmd[1] = g_ascii_dtostr(buf, G_ASCII_DTOSTR_BUF_SIZE, offset);
+
+		gmpv_mpv_command(mpv, cmd);
+	}
+	else
+	{
+		/* The seek is done once the file is loaded */
+		player->restore_time_pos = offset;
+
+		gmpv_mpv_set_property(	mpv,
+					"playlist-pos",
+					MPV_FORMAT_INT64,
+					&position );
+	}
+
+	return TRUE;
+}
+
+guint64 gmpv_player_get_playlist_version(GmpvPlayer *player)
+{
+	return player->playlist_version;
+}
+
+/* The playlist is only copied if include_playlist is TRUE, since that costs
+ * as much as the playlist is long.
+ */
+GmpvSession *gmpv_player_get_session(	GmpvPlayer *player,
+					gboolean include_playlist )
+{
+	GPtrArray *playlist = player->playlist;
+	GPtrArray *entries = NULL;
+	GmpvSession *session = NULL;
+	gint64 position = get_playlist_position(player);
+	gdouble time_pos = 0;
+
+	if(include_playlist)
+	{
+		entries = gmpv_playlist_new(playlist->len);
+	}
+
+	/* Entries that already carry everything are shared with the snapshot.
+	 * The others are completed with what the metadata cache knows.
+	 */
+	for(guint i = 0; entries && i < playlist->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		GmpvMetadataCacheEntry *cache_entry = NULL;
+
+		if(player->cache && (!entry->title || entry->duration <= 0))
+		{
+			cache_entry =	gmpv_metadata_cache_peek
+					(player->cache, entry->filename);
+		}
+
+		if(	cache_entry &&
+			((!entry->title && cache_entry->title) ||
+			(entry->duration <= 0 && cache_entry->duration > 0)) )
+		{
+			const gchar *title =	entry->title?
+						entry->title:
+						cache_entry->title;
+			GmpvPlaylistEntry *copy =	gmpv_playlist_entry_new
+							(entry->filename, title);
+
+			copy->duration =	entry->duration > 0?
+						entry->duration:
+						cache_entry->duration;
+
+			g_ptr_array_add(entries, copy);
+		}
+		else
+		{
+			g_ptr_array_add(entries, gmpv_playlist_entry_ref(entry));
+		}
+	}
+
+	/* mpv's position is meaningless before a restored session was
+	 * loaded.
+	 */
+	if(player->restore_pos > 0)
+	{
+		position = player->restore_pos;
+	}
+
+	if(player->restore_time_pos > 0)
+	{
+		time_pos = player->restore_time_pos;
+	}
+	else if(player->loaded)
+	{
+		poll_resume_position(player);
+
+		time_pos = player->resume_position;
+	}
+
+	session = gmpv_session_new(entries, MAX(0, position), time_pos);
+
+	if(entries)
+	{
+		g_ptr_array_unref(entries);
+	}
+
+	return session;
+}
+
+void gmpv_player_restore_session(	GmpvPlayer *player,
+					const GmpvSession *session )
+{
+	gboolean ready = FALSE;
+
+	g_info(	"Restoring session with %u playlist entries",
+		session->playlist->len );
+
+	cancel_import(player);
+	cancel_pending_imports(player);
+	stop_playlist_feed(player);
+
+	g_ptr_array_unref(player->playlist);
+
+	player->playlist = g_ptr_array_ref(session->playlist);
+	player->restore_pos = session->position;
+	player->restore_time_pos = session->time_pos;
+	player->restore_paused = TRUE;
+
+	publish_playlist(player);
+	seed_metadata_cache(player, player->playlist);
+
+	/* Otherwise, the playlist is loaded once the video output is
+	 * configured.
+	 */
+	g_object_get(player, "ready", &ready, NULL);
+
+	if(ready && !player->init_vo_config && player->playlist->len > 0)
+	{
+		load_from_playlist(player);
+	}
+}
+
 void gmpv_player_set_log_level(	GmpvPlayer *player,
 				const gchar *prefix,
 				const gchar *level )
@@ -23,6 +23,8 @@
 #include <glib-object.h>
 
 #include "gmpv_mpv.h"
+#include "gmpv_playlist_sort.h"
+#include "gmpv_session.h"
 
 G_BEGIN_DECLS
 
@@ -31,6 +33,26 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE(GmpvPlayer, gmpv_player, GMPV, PLAYER, GmpvMpv)
 
 GmpvPlayer *gmpv_player_new(gint64 wid);
+gboolean gmpv_player_apply_settings(GmpvPlayer *player);
+void gmpv_player_load_files(	GmpvPlayer *player,
+				const gchar **uris,
+				gboolean append );
+void gmpv_player_sort_playlist(GmpvPlayer *player, PlaylistSortField field);
+void gmpv_player_remove_playlist_entries(	GmpvPlayer *player,
+						const GArray *indices );
+void gmpv_player_move_playlist_entries(	GmpvPlayer *player,
+					const GArray *indices,
+					guint dest );
+void gmpv_player_sync_playlist(GmpvPlayer *player);
+gdouble gmpv_player_get_playlist_duration(	GmpvPlayer *player,
+						gboolean *complete );
+gdouble gmpv_player_get_playlist_time_position(GmpvPlayer *player);
+gboolean gmpv_player_seek_playlist(GmpvPlayer *player, gdouble time);
+guint64 gmpv_player_get_playlist_version(GmpvPlayer *player);
+GmpvSession *gmpv_player_get_session(	GmpvPlayer *player,
+					gboolean include_playlist );
+void gmpv_player_restore_session(	GmpvPlayer *player,
+					const GmpvSession *session );
 void gmpv_player_set_log_level(	GmpvPlayer *player,
 				const gchar *prefix,
 				const gchar *level );
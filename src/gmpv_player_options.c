@@ -90,8 +90,13 @@ static gboolean parse_dim_string(const gchar *geom_str, gint64 dim[2])
 
 	dim[0] = -1;
 	dim[1] = -1;
-	screen_dim[0] = gdk_screen_get_width(screen);
-	screen_dim[1] = gdk_screen_get_height(screen);
+
+	/* There is no screen when running headless */
+	if(screen)
+	{
+		screen_dim[0] = gdk_screen_get_width(screen);
+		screen_dim[1] = gdk_screen_get_height(screen);
+	}
 
 	while(tokens && tokens[++i] && i < 3)
 	{
@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gmpv_playlist_export.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+typedef struct ExportItem ExportItem;
+typedef struct ExportData ExportData;
+typedef struct ProgressReport ProgressReport;
+
+struct ExportItem
+{
+	GmpvPlaylistEntry *entry;
+	gchar *title;
+	gdouble duration;
+};
+
+struct ExportData
+{
+	GFile *file;
+	PlaylistFormat format;
+	ExportItem *items;
+	guint n_items;
+	GmpvPlaylistExportProgressFunc progress_func;
+	gpointer progress_data;
+};
+
+struct ProgressReport
+{
+	GTask *task;
+	guint written;
+	guint total;
+};
+
+static void export_data_free(gpointer data);
+static gchar *get_location_uri(const gchar *filename);
+static void append_header(GString *buf, PlaylistFormat format);
+static void append_footer(GString *buf, PlaylistFormat format);
+static void append_item(GString *buf, PlaylistFormat format, ExportItem *item);
+static gboolean progress_report_handler(gpointer data);
+static void progress_report_free(gpointer data);
+static void report_progress(GTask *task, guint written, guint total);
+static gboolean write_buffer(	GOutputStream *stream,
+				GString *buf,
+				GCancellable *cancellable,
+				GError **error );
+static void export_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable );
+
+static void export_data_free(gpointer data)
+{
+	ExportData *export_data = data;
+
+	for(guint i = 0; i < export_data->n_items; i++)
+	{
+		gmpv_playlist_entry_unref(export_data->items[i].entry);
+		g_free(export_data->items[i].title);
+	}
+
+	g_object_unref(export_data->file);
+	g_free(export_data->items);
+	g_free(export_data);
+}
+
+static gchar *get_location_uri(const gchar *filename)
+{
+	gchar *scheme = NULL;
+	gchar *result = NULL;
+
+	/* Check for absolute paths first since Windows drive letters would
+	 * otherwise be mistaken for URI schemes.
+	 */
+	if(g_path_is_absolute(filename))
+	{
+		result = g_filename_to_uri(filename, NULL, NULL);
+	}
+	else if((scheme = g_uri_parse_scheme(filename)))
+	{
+		result = g_strdup(filename);
+	}
+
+	if(!result)
+	{
+		result =	g_uri_escape_string
+				(	filename,
+					G_URI_RESERVED_CHARS_ALLOWED_IN_PATH,
+					TRUE );
+	}
+
+	g_free(scheme);
+
+	return result;
+}
+
+static void append_header(GString *buf, PlaylistFormat format)
+{
+	switch(format)
+	{
+		case PLAYLIST_FORMAT_M3U:
+		g_string_append(buf, "#EXTM3U\n");
+		break;
+
+		case PLAYLIST_FORMAT_XSPF:
+		g_string_append(	buf,
+					"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<playlist version=\"1\" "
+					"xmlns=\"http://xspf.org/ns/0/\">\n"
+					"\t<trackList>\n" );
+		break;
+
+		default:
+		g_assert_not_reached();
+		break;
+	}
+}
+
+static void append_footer(GString *buf, PlaylistFormat format)
+{
+	if(format == PLAYLIST_FORMAT_XSPF)
+	{
+		g_string_append(buf, "\t</trackList>\n</playlist>\n");
+	}
+}
+
+static void append_item(GString *buf, PlaylistFormat format, ExportItem *item)
+{
+	const gchar *filename = item->entry->filename;
+
+	if(format == PLAYLIST_FORMAT_M3U)
+	{
+		if(item->title || item->duration > 0)
+		{
+			gint64 duration =	(item->duration > 0)?
+						(gint64)(item->duration + 0.5):
+						-1;
+
+			/* Titles must not span multiple lines */
+			if(item->title)
+			{
+				g_strdelimit(item->title, "\r\n", ' ');
+			}
+
+			g_string_append_printf(	buf,
+						"#EXTINF:%" G_GINT64_FORMAT ",%s\n",
+						duration,
+						item->title?:"" );
+		}
+
+		g_string_append(buf, filename);
+		g_string_append_c(buf, '\n');
+	}
+	else if(format == PLAYLIST_FORMAT_XSPF)
+	{
+		gchar *uri = get_location_uri(filename);
+		gchar *escaped = g_markup_escape_text(uri, -1);
+
+		g_string_append(buf, "\t\t<track>\n");
+		g_string_append_printf(	buf,
+					"\t\t\t<location>%s</location>\n",
+					escaped );
+
+		if(item->title)
+		{
+			g_free(escaped);
+			escaped = g_markup_escape_text(item->title, -1);
+
+			g_string_append_printf(	buf,
+						"\t\t\t<title>%s</title>\n",
+						escaped );
+		}
+
+		if(item->duration > 0)
+		{
+			/* XSPF durations are in milliseconds */
+			g_string_append_printf
+				(	buf,
+					"\t\t\t<duration>%" G_GINT64_FORMAT
+					"</duration>\n",
+					(gint64)(item->duration*1000 + 0.5) );
+		}
+
+		g_string_append(buf, "\t\t</track>\n");
+
+		g_free(escaped);
+		g_free(uri);
+	}
+	else
+	{
+		g_assert_not_reached();
+	}
+}
+
+static gboolean progress_report_handler(gpointer data)
+{
+	ProgressReport *report = data;
+	ExportData *export_data = g_task_get_task_data(report->task);
+
+	/* The report may be dispatched after the task has already returned */
+	if(!g_task_get_completed(report->task))
+	{
+		export_data->progress_func(	report->written,
+						report->total,
+						export_data->progress_data );
+	}
+
+	return FALSE;
+}
+
+static void progress_report_free(gpointer data)
+{
+	ProgressReport *report = data;
+
+	g_object_unref(report->task);
+	g_free(report);
+}
+
+static void report_progress(GTask *task, guint written, guint total)
+{
+	ProgressReport *report = g_new(ProgressReport, 1);
+
+	report->task = g_object_ref(task);
+	report->written = written;
+	report->total = total;
+
+	g_main_context_invoke_full(	g_task_get_context(task),
+					G_PRIORITY_DEFAULT,
+					progress_report_handler,
+					report,
+					progress_report_free );
+}
+
+static gboolean write_buffer(	GOutputStream *stream,
+				GString *buf,
+				GCancellable *cancellable,
+				GError **error )
+{
+	gboolean rc =	g_output_stream_write_all
+			(stream, buf->str, buf->len, NULL, cancellable, error);
+
+	g_string_truncate(buf, 0);
+
+	return rc;
+}
+
+static void export_thread(	GTask *task,
+				gpointer source_object,
+				gpointer task_data,
+				GCancellable *cancellable )
+{
+	ExportData *export_data = task_data;
+	GFileOutputStream *file_stream = NULL;
+	GOutputStream *stream = NULL;
+	GString *buf = g_string_sized_new(PLAYLIST_EXPORT_BUFFER_SIZE*2);
+	GError *error = NULL;
+	guint last_percent = 0;
+	gboolean rc = FALSE;
+
+	file_stream = g_file_replace(	export_data->file,
+					NULL,
+					FALSE,
+					G_FILE_CREATE_NONE,
+					cancellable,
+					&error );
+
+	if(file_stream)
+	{
+		stream = G_OUTPUT_STREAM(file_stream);
+		rc = TRUE;
+
+		append_header(buf, export_data->format);
+	}
+
+	for(guint i = 0; rc && i < export_data->n_items; i++)
+	{
+		guint percent =	(guint)
+				((guint64)(i + 1)*100/export_data->n_items);
+
+		append_item(buf, export_data->format, &export_data->items[i]);
+
+		/* Items are accumulated in buf and written in large chunks,
+		 * since each write may be a round trip when saving to a remote
+		 * location.
+		 */
+		if(buf->len >= PLAYLIST_EXPORT_BUFFER_SIZE)
+		{
+			rc = write_buffer(stream, buf, cancellable, &error);
+		}
+
+		if(rc && export_data->progress_func && percent > last_percent)
+		{
+			report_progress(task, i + 1, export_data->n_items);
+			last_percent = percent;
+		}
+	}
+
+	if(rc)
+	{
+		append_footer(buf, export_data->format);
+
+		rc = write_buffer(stream, buf, cancellable, &error);
+	}
+
+	if(stream)
+	{
+		/* If the export failed, close the stream with a cancelled
+		 * cancellable so that the destination is not replaced with a
+		 * truncated playlist.
+		 */
+		GCancellable *abort_cancellable = NULL;
+
+		if(!rc)
+		{
+			abort_cancellable = g_cancellable_new();
+			g_cancellable_cancel(abort_cancellable);
+		}
+
+		if(!g_output_stream_close(	stream,
+						rc?cancellable:abort_cancellable,
+						rc?&error:NULL ))
+		{
+			rc = FALSE;
+		}
+
+		g_clear_object(&abort_cancellable);
+		g_object_unref(stream);
+	}
+
+	g_string_free(buf, TRUE);
+
+	if(rc)
+	{
+		g_task_return_boolean(task, TRUE);
+	}
+	else
+	{
+		g_task_return_error(task, error);
+	}
+}
+
+PlaylistFormat gmpv_playlist_export_format_from_file(GFile *file)
+{
+	gchar *basename = g_file_get_basename(file);
+	gsize length = basename?strlen(basename):0;
+	PlaylistFormat format = PLAYLIST_FORMAT_M3U;
+
+	if(	length >= 5 &&
+		g_ascii_strcasecmp(basename + length - 5, ".xspf") == 0 )
+	{
+		format = PLAYLIST_FORMAT_XSPF;
+	}
+
+	g_free(basename);
+
+	return format;
+}
+
+void gmpv_playlist_export_async(	GFile *file,
+					const GPtrArray *playlist,
+					GmpvMetadataCache *cache,
+					PlaylistFormat format,
+					GCancellable *cancellable,
+					GmpvPlaylistExportProgressFunc progress_func,
+					gpointer progress_data,
+					GAsyncReadyCallback callback,
+					gpointer data )
+{
+	ExportData *export_data = g_new0(ExportData, 1);
+	GTask *task = g_task_new(NULL, cancellable, callback, data);
+
+	export_data->file = g_object_ref(file);
+	export_data->format = format;
+	export_data->items = g_new(ExportItem, playlist->len);
+	export_data->n_items = playlist->len;
+	export_data->progress_func = progress_func;
+	export_data->progress_data = progress_data;
+
+	/* The cache may only be used from the main thread, so copy everything
+	 * the worker needs beforehand. The entries themselves are immutable
+	 * and can be shared.
+	 */
+	for(guint i = 0; i < playlist->len; i++)
+	{
+		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+		GmpvMetadataCacheEntry *cache_entry = NULL;
+		ExportItem *item = &export_data->items[i];
+		const gchar *title = entry->title;
+
+		if(cache)
+		{
+			cache_entry =	gmpv_metadata_cache_peek
+					(cache, entry->filename);
+		}
+
+		if(!title && cache_entry)
+		{
+			title = cache_entry->title;
+		}
+
+		item->entry = gmpv_playlist_entry_ref(entry);
+		item->title = g_strdup(title);
+		item->duration =	(cache_entry && cache_entry->duration > 0)?
+					cache_entry->duration:
+					entry->duration;
+	}
+
+	g_task_set_source_tag(task, gmpv_playlist_export_async);
+	g_task_set_task_data(task, export_data, export_data_free);
+	g_task_run_in_thread(task, export_thread);
+
+	g_object_unref(task);
+}
+
+gboolean gmpv_playlist_export_finish(GAsyncResult *result, GError **error)
+{
+	g_return_val_if_fail(g_task_is_valid(result, NULL), FALSE);
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLIST_EXPORT_H
+#define PLAYLIST_EXPORT_H
+
+#include <gio/gio.h>
+
+#include "gmpv_metadata_cache.h"
+
+G_BEGIN_DECLS
+
+typedef enum PlaylistFormat PlaylistFormat;
+
+typedef void (*GmpvPlaylistExportProgressFunc)(	guint written,
+						guint total,
+						gpointer data );
+
+enum PlaylistFormat
+{
+	PLAYLIST_FORMAT_M3U,
+	PLAYLIST_FORMAT_XSPF,
+	PLAYLIST_FORMAT_N
+};
+
+PlaylistFormat gmpv_playlist_export_format_from_file(GFile *file);
+
+/* Writes the playlist to file in a worker thread. The titles and durations
+ * are taken from the cache, which is only accessed before this function
+ * returns. progress_func is called in the thread-default main context of
+ * the caller, and is never called after callback.
+ */
+void gmpv_playlist_export_async(	GFile *file,
+					const GPtrArray *playlist,
+					GmpvMetadataCache *cache,
+					PlaylistFormat format,
+					GCancellable *cancellable,
+					GmpvPlaylistExportProgressFunc progress_func,
+					gpointer progress_data,
+					GAsyncReadyCallback callback,
+					gpointer data );
+gboolean gmpv_playlist_export_finish(GAsyncResult *result, GError **error);
+
+G_END_DECLS
+
+#endif
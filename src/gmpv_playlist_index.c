@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gmpv_playlist_index.h"
+
+/* Grams of up to PLAYLIST_INDEX_GRAM_SIZE bytes are indexed. The shorter
+ * ones are only used by queries shorter than that.
+ */
+#define PLAYLIST_INDEX_GRAM_SIZE 3
+
+typedef struct IndexItem IndexItem;
+
+struct _GmpvPlaylistIndex
+{
+	GHashTable *items;
+	GHashTable *postings;
+};
+
+struct IndexItem
+{
+	gchar *text;
+	guint references;
+};
+
+static gchar *normalize(const gchar *text);
+static gpointer get_gram(const gchar *str, gsize size);
+static void add_postings(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text );
+static void remove_postings(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text );
+static void index_item_free(IndexItem *item);
+
+static gchar *normalize(const gchar *text)
+{
+	gchar *normalized = g_utf8_normalize(text, -1, G_NORMALIZE_ALL);
+	gchar *result = NULL;
+
+	if(normalized)
+	{
+		result = g_utf8_casefold(normalized, -1);
+	}
+	else
+	{
+		/* Not valid UTF-8. Fall back to byte-wise case folding. */
+		result = g_ascii_strdown(text, -1);
+	}
+
+	g_free(normalized);
+
+	return result;
+}
+
+static gpointer get_gram(const gchar *str, gsize size)
+{
+	guint gram = 0;
+
+	/* None of the bytes can be zero, so grams of different sizes can
+	 * never be equal, and none of them is zero.
+	 */
+	for(gsize i = 0; i < size; i++)
+	{
+		gram = (gram << 8)|(guint)(guchar)str[i];
+	}
+
+	return GUINT_TO_POINTER(gram);
+}
+
+static void add_postings(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text )
+{
+	gsize len = strlen(text);
+
+	for(gsize size = 1; size <= PLAYLIST_INDEX_GRAM_SIZE; size++)
+	{
+		for(gsize i = 0; i+size <= len; i++)
+		{
+			gpointer gram = get_gram(text+i, size);
+			GHashTable *keys =	g_hash_table_lookup
+						(index->postings, gram);
+
+			if(!keys)
+			{
+				keys =	g_hash_table_new
+					(g_direct_hash, g_direct_equal);
+
+				g_hash_table_insert(index->postings, gram, keys);
+			}
+
+			g_hash_table_add(keys, (gpointer)key);
+		}
+	}
+}
+
+static void remove_postings(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text )
+{
+	gsize len = strlen(text);
+
+	for(gsize size = 1; size <= PLAYLIST_INDEX_GRAM_SIZE; size++)
+	{
+		for(gsize i = 0; i+size <= len; i++)
+		{
+			gpointer gram = get_gram(text+i, size);
+			GHashTable *keys =	g_hash_table_lookup
+						(index->postings, gram);
+
+			if(keys)
+			{
+				g_hash_table_remove(keys, key);
+
+				if(g_hash_table_size(keys) == 0)
+				{
+					g_hash_table_remove
+						(index->postings, gram);
+				}
+			}
+		}
+	}
+}
+
+static void index_item_free(IndexItem *item)
+{
+	g_free(item->text);
+	g_free(item);
+}
+
+GmpvPlaylistIndex *gmpv_playlist_index_new(void)
+{
+	GmpvPlaylistIndex *index = g_malloc(sizeof(GmpvPlaylistIndex));
+
+	index->items =	g_hash_table_new_full
+			(	g_direct_hash,
+				g_direct_equal,
+				NULL,
+				(GDestroyNotify)index_item_free );
+	index->postings =	g_hash_table_new_full
+				(	g_direct_hash,
+					g_direct_equal,
+					NULL,
+					(GDestroyNotify)g_hash_table_unref );
+
+	return index;
+}
+
+void gmpv_playlist_index_free(GmpvPlaylistIndex *index)
+{
+	if(index)
+	{
+		g_hash_table_unref(index->postings);
+		g_hash_table_unref(index->items);
+		g_free(index);
+	}
+}
+
+void gmpv_playlist_index_add(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text )
+{
+	IndexItem *item = g_hash_table_lookup(index->items, key);
+
+	if(item)
+	{
+		item->references++;
+	}
+	else
+	{
+		item = g_malloc(sizeof(IndexItem));
+		item->text = normalize(text?:"");
+		item->references = 1;
+
+		g_hash_table_insert(index->items, (gpointer)key, item);
+		add_postings(index, key, item->text);
+	}
+}
+
+void gmpv_playlist_index_remove(GmpvPlaylistIndex *index, gconstpointer key)
+{
+	IndexItem *item = g_hash_table_lookup(index->items, key);
+
+	if(item && --item->references == 0)
+	{
+		remove_postings(index, key, item->text);
+		g_hash_table_remove(index->items, key);
+	}
+}
+
+GHashTable *gmpv_playlist_index_query(	GmpvPlaylistIndex *index,
+					const gchar *query )
+{
+	GHashTable *result = g_hash_table_new(g_direct_hash, g_direct_equal);
+	GHashTable *candidates = index->items;
+	gchar *needle = normalize(query);
+	gsize len = strlen(needle);
+	gsize size = MIN(len, PLAYLIST_INDEX_GRAM_SIZE);
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	/* Only empty queries have to look at every item */
+	for(gsize i = 0; candidates && size > 0 && i+size <= len; i++)
+	{
+		GHashTable *keys =	g_hash_table_lookup
+					(index->postings, get_gram(needle+i, size));
+		gboolean shorter =	keys &&
+					g_hash_table_size(keys) <
+					g_hash_table_size(candidates);
+
+		/* A missing gram means that nothing can match */
+		if(!keys || i == 0 || shorter)
+		{
+			candidates = keys;
+		}
+	}
+
+	if(candidates)
+	{
+		/* Grams do not record their position, so candidates still need
+		 * to be checked, unless the query is a single gram.
+		 */
+		gboolean exact = (len <= PLAYLIST_INDEX_GRAM_SIZE);
+
+		g_hash_table_iter_init(&iter, candidates);
+
+		while(g_hash_table_iter_next(&iter, &key, &value))
+		{
+			IndexItem *item = NULL;
+
+			if(!exact)
+			{
+				item = g_hash_table_lookup(index->items, key);
+			}
+
+			if(exact || strstr(item->text, needle))
+			{
+				g_hash_table_add(result, key);
+			}
+		}
+	}
+
+	g_free(needle);
+
+	return result;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLIST_INDEX_H
+#define PLAYLIST_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GmpvPlaylistIndex GmpvPlaylistIndex;
+
+/* Substring search index over the text of playlist items. Each key is
+ * mapped to a text, which is split into byte unigrams, bigrams and
+ * trigrams of its normalized, case-folded form. Queries only look at the
+ * keys in the shortest posting list of the query's longest grams, so their
+ * cost depends on the number of candidates rather than on the number of
+ * items, even for queries of one or two bytes.
+ *
+ * Items are reference counted by key, so the same key may be added more
+ * than once as long as it is always added with the same text.
+ */
+GmpvPlaylistIndex *gmpv_playlist_index_new(void);
+void gmpv_playlist_index_free(GmpvPlaylistIndex *index);
+void gmpv_playlist_index_add(	GmpvPlaylistIndex *index,
+				gconstpointer key,
+				const gchar *text );
+void gmpv_playlist_index_remove(GmpvPlaylistIndex *index, gconstpointer key);
+GHashTable *gmpv_playlist_index_query(	GmpvPlaylistIndex *index,
+					const gchar *query );
+
+G_END_DECLS
+
+#endif
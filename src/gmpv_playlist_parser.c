@@ -0,0 +1,744 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gmpv_playlist_parser.h"
+#include "gmpv_common.h"
+
+typedef enum ParserFormat ParserFormat;
+typedef struct Parser Parser;
+typedef struct PlsItem PlsItem;
+typedef struct XspfState XspfState;
+
+enum ParserFormat
+{
+	PARSER_FORMAT_NONE,
+	PARSER_FORMAT_M3U,
+	PARSER_FORMAT_PLS,
+	PARSER_FORMAT_XSPF,
+	PARSER_FORMAT_CUE
+};
+
+struct Parser
+{
+	const gchar *path;
+	gchar *dir;
+	gboolean utf8;
+	GPtrArray *playlist;
+};
+
+struct PlsItem
+{
+	gchar *filename;
+	gchar *title;
+	gdouble duration;
+};
+
+struct XspfState
+{
+	Parser *parser;
+	gboolean in_track;
+	gchar *location;
+	gchar *title;
+	gdouble duration;
+	GString *text;
+};
+
+static gchar *get_local_path(const gchar *uri);
+static ParserFormat get_format(const gchar *path, gboolean *utf8);
+static gboolean next_line(	const gchar **pos,
+				const gchar *end,
+				const gchar **line,
+				gsize *length );
+static gboolean has_prefix(	const gchar *line,
+				gsize length,
+				const gchar *prefix );
+static gchar *dup_text(Parser *parser, const gchar *text, gsize length);
+static gchar *resolve_location(Parser *parser, const gchar *location);
+static void add_entry(	Parser *parser,
+			gchar *filename,
+			const gchar *title,
+			gdouble duration );
+static gchar *parse_extinf(	Parser *parser,
+				const gchar *text,
+				gsize length,
+				gdouble *duration );
+static void parse_m3u(Parser *parser, const gchar *contents, gsize length);
+static guint64 parse_pls_index(const gchar *text, gsize length);
+static void parse_pls(Parser *parser, const gchar *contents, gsize length);
+static const gchar *get_local_name(const gchar *element_name);
+static void xspf_start_element(	GMarkupParseContext *context,
+				const gchar *element_name,
+				const gchar **attribute_names,
+				const gchar **attribute_values,
+				gpointer data,
+				GError **error );
+static void xspf_end_element(	GMarkupParseContext *context,
+				const gchar *element_name,
+				gpointer data,
+				GError **error );
+static void xspf_text(	GMarkupParseContext *context,
+			const gchar *text,
+			gsize text_len,
+			gpointer data,
+			GError **error );
+static gboolean parse_xspf(	Parser *parser,
+				const gchar *contents,
+				gsize length,
+				GError **error );
+static gchar *parse_cue_string(	Parser *parser,
+				const gchar *text,
+				gsize length );
+static void parse_cue(Parser *parser, const gchar *contents, gsize length);
+
+static gchar *get_local_path(const gchar *uri)
+{
+	gchar *scheme = g_uri_parse_scheme(uri);
+	gchar *result = NULL;
+
+	if(g_path_is_absolute(uri))
+	{
+		result = g_strdup(uri);
+	}
+	else if(scheme && g_ascii_strcasecmp(scheme, "file") == 0)
+	{
+		result = g_filename_from_uri(uri, NULL, NULL);
+	}
+	else if(!scheme)
+	{
+		gchar *cwd = g_get_current_dir();
+
+		result = g_build_filename(cwd, uri, NULL);
+
+		g_free(cwd);
+	}
+
+	g_free(scheme);
+
+	return result;
+}
+
+static ParserFormat get_format(const gchar *path, gboolean *utf8)
+{
+	const gchar *ext = strrchr(path, '.');
+	ParserFormat format = PARSER_FORMAT_NONE;
+
+	*utf8 = FALSE;
+
+	if(!ext)
+	{
+		format = PARSER_FORMAT_NONE;
+	}
+	else if(g_ascii_strcasecmp(ext, ".m3u") == 0)
+	{
+		format = PARSER_FORMAT_M3U;
+	}
+	else if(g_ascii_strcasecmp(ext, ".m3u8") == 0)
+	{
+		format = PARSER_FORMAT_M3U;
+		*utf8 = TRUE;
+	}
+	else if(g_ascii_strcasecmp(ext, ".pls") == 0)
+	{
+		format = PARSER_FORMAT_PLS;
+	}
+	else if(g_ascii_strcasecmp(ext, ".xspf") == 0)
+	{
+		format = PARSER_FORMAT_XSPF;
+		*utf8 = TRUE;
+	}
+	else if(g_ascii_strcasecmp(ext, ".cue") == 0)
+	{
+		format = PARSER_FORMAT_CUE;
+	}
+
+	return format;
+}
+
+static gboolean next_line(	const gchar **pos,
+				const gchar *end,
+				const gchar **line,
+				gsize *length )
+{
+	const gchar *start = *pos;
+	const gchar *eol = NULL;
+	gboolean rc = start < end;
+
+	if(rc)
+	{
+		eol = memchr(start, '\n', (gsize)(end - start));
+		*pos = eol?eol + 1:end;
+		eol = eol?:end;
+
+		/* Also strips the carriage return of CRLF line endings */
+		while(start < eol && g_ascii_isspace(*start))
+		{
+			start++;
+		}
+
+		while(eol > start && g_ascii_isspace(*(eol - 1)))
+		{
+			eol--;
+		}
+
+		*line = start;
+		*length = (gsize)(eol - start);
+	}
+
+	return rc;
+}
+
+static gboolean has_prefix(	const gchar *line,
+				gsize length,
+				const gchar *prefix )
+{
+	gsize prefix_length = strlen(prefix);
+
+	return	length >= prefix_length &&
+		g_ascii_strncasecmp(line, prefix, prefix_length) == 0;
+}
+
+static gchar *dup_text(Parser *parser, const gchar *text, gsize length)
+{
+	gchar *result = NULL;
+
+	if(g_utf8_validate(text, (gssize)length, NULL))
+	{
+		result = g_strndup(text, length);
+	}
+	else if(!parser->utf8)
+	{
+		/* Files that are not explicitly UTF-8 are commonly written in
+		 * the legacy Windows encoding.
+		 */
+		result = g_convert(	text,
+					(gssize)length,
+					"UTF-8",
+					"WINDOWS-1252",
+					NULL,
+					NULL,
+					NULL );
+	}
+
+	return result;
+}
+
+static gchar *resolve_location(Parser *parser, const gchar *location)
+{
+	gchar *scheme = NULL;
+	gchar *result = NULL;
+
+	if(g_path_is_absolute(location))
+	{
+		result = g_strdup(location);
+	}
+	else if((scheme = g_uri_parse_scheme(location)))
+	{
+		/* Local files are passed to mpv as paths, so store them the
+		 * same way to match the entries of its playlist.
+		 */
+		if(g_ascii_strcasecmp(scheme, "file") == 0)
+		{
+			result = g_filename_from_uri(location, NULL, NULL);
+		}
+
+		result = result?:g_strdup(location);
+	}
+	else
+	{
+		result = g_build_filename(parser->dir, location, NULL);
+	}
+
+	g_free(scheme);
+
+	return result;
+}
+
+static void add_entry(	Parser *parser,
+			gchar *filename,
+			const gchar *title,
+			gdouble duration )
+{
+	GmpvPlaylistEntry *entry = gmpv_playlist_entry_new(filename, title);
+
+	entry->duration = duration > 0?duration:0;
+
+	g_ptr_array_add(parser->playlist, entry);
+	g_free(filename);
+}
+
+static gchar *parse_extinf(	Parser *parser,
+				const gchar *text,
+				gsize length,
+				gdouble *duration )
+{
+	gchar *info = g_strndup(text, length);
+	gchar *end = NULL;
+	gchar *title = NULL;
+	gboolean quoted = FALSE;
+
+	*duration = g_ascii_strtod(info, &end);
+
+	/* The title follows the first comma that is not part of the quoted
+	 * value of an attribute, as in #EXTINF:-1 tvg-name="a,b",Title.
+	 */
+	for(gchar *c = end; *c && !title; c++)
+	{
+		if(*c == '"')
+		{
+			quoted = !quoted;
+		}
+		else if(*c == ',' && !quoted)
+		{
+			title = g_strstrip(c + 1);
+		}
+	}
+
+	title = (title && *title)?dup_text(parser, title, strlen(title)):NULL;
+
+	g_free(info);
+
+	return title;
+}
+
+static void parse_m3u(Parser *parser, const gchar *contents, gsize length)
+{
+	const gchar *pos = contents;
+	const gchar *end = contents + length;
+	const gchar *line = NULL;
+	gsize line_length = 0;
+	gchar *title = NULL;
+	gdouble duration = 0;
+
+	while(next_line(&pos, end, &line, &line_length))
+	{
+		if(has_prefix(line, line_length, "#EXTINF:"))
+		{
+			g_free(title);
+
+			title =	parse_extinf
+				(	parser,
+					line + 8,
+					line_length - 8,
+					&duration );
+		}
+		else if(line_length > 0 && line[0] != '#')
+		{
+			gchar *location = g_strndup(line, line_length);
+
+			add_entry(	parser,
+					resolve_location(parser, location),
+					title,
+					duration );
+
+			g_free(location);
+			g_clear_pointer(&title, g_free);
+			duration = 0;
+		}
+	}
+
+	g_free(title);
+}
+
+static guint64 parse_pls_index(const gchar *text, gsize length)
+{
+	guint64 result = 0;
+
+	for(gsize i = 0; i < length && result < G_MAXUINT; i++)
+	{
+		result =	g_ascii_isdigit(text[i])?
+				result*10 + (guint64)g_ascii_digit_value(text[i]):
+				G_MAXUINT64;
+	}
+
+	return result;
+}
+
+static void parse_pls(Parser *parser, const gchar *contents, gsize length)
+{
+	const gchar *pos = contents;
+	const gchar *end = contents + length;
+	const gchar *line = NULL;
+	gsize line_length = 0;
+	GArray *items = g_array_new(FALSE, TRUE, sizeof(PlsItem));
+
+	while(next_line(&pos, end, &line, &line_length))
+	{
+		const gchar *sep = memchr(line, '=', line_length);
+		const gchar *value = sep?sep + 1:NULL;
+		gsize key_length = sep?(gsize)(sep - line):0;
+		gsize value_length = sep?line_length - key_length - 1:0;
+		gsize prefix_length = 0;
+		guint64 index = 0;
+		PlsItem *item = NULL;
+
+		while(key_length > 0 && g_ascii_isspace(line[key_length - 1]))
+		{
+			key_length--;
+		}
+
+		while(value_length > 0 && g_ascii_isspace(*value))
+		{
+			value++;
+			value_length--;
+		}
+
+		if(has_prefix(line, key_length, "File"))
+		{
+			prefix_length = 4;
+		}
+		else if(has_prefix(line, key_length, "Title"))
+		{
+			prefix_length = 5;
+		}
+		else if(has_prefix(line, key_length, "Length"))
+		{
+			prefix_length = 6;
+		}
+
+		if(prefix_length > 0)
+		{
+			index =	parse_pls_index
+				(	line + prefix_length,
+					key_length - prefix_length );
+		}
+
+		/* Every item takes up at least one byte of the file, which
+		 * bounds the size of the array for malformed indices.
+		 */
+		if(index > 0 && index <= length)
+		{
+			if(index > items->len)
+			{
+				g_array_set_size(items, (guint)index);
+			}
+
+			item = &g_array_index(items, PlsItem, index - 1);
+		}
+
+		if(item && prefix_length == 4)
+		{
+			gchar *location = g_strndup(value, value_length);
+
+			g_free(item->filename);
+			item->filename = resolve_location(parser, location);
+
+			g_free(location);
+		}
+		else if(item && prefix_length == 5)
+		{
+			g_free(item->title);
+			item->title = dup_text(parser, value, value_length);
+		}
+		else if(item && prefix_length == 6)
+		{
+			gchar *duration = g_strndup(value, value_length);
+
+			item->duration = g_ascii_strtod(duration, NULL);
+
+			g_free(duration);
+		}
+	}
+
+	for(guint i = 0; i < items->len; i++)
+	{
+		PlsItem *item = &g_array_index(items, PlsItem, i);
+
+		if(item->filename)
+		{
+			/* add_entry() takes ownership of the filename */
+			add_entry(	parser,
+					item->filename,
+					item->title,
+					item->duration );
+		}
+
+		g_free(item->title);
+	}
+
+	g_array_free(items, TRUE);
+}
+
+static const gchar *get_local_name(const gchar *element_name)
+{
+	const gchar *sep = strrchr(element_name, ':');
+
+	return sep?sep + 1:element_name;
+}
+
+static void xspf_start_element(	GMarkupParseContext *context,
+				const gchar *element_name,
+				const gchar **attribute_names,
+				const gchar **attribute_values,
+				gpointer data,
+				GError **error )
+{
+	XspfState *state = data;
+
+	if(g_strcmp0(get_local_name(element_name), "track") == 0)
+	{
+		g_clear_pointer(&state->location, g_free);
+		g_clear_pointer(&state->title, g_free);
+
+		state->in_track = TRUE;
+		state->duration = 0;
+	}
+
+	g_string_truncate(state->text, 0);
+}
+
+static void xspf_end_element(	GMarkupParseContext *context,
+				const gchar *element_name,
+				gpointer data,
+				GError **error )
+{
+	XspfState *state = data;
+	const gchar *name = get_local_name(element_name);
+	gchar *text = g_strstrip(state->text->str);
+
+	if(!state->in_track)
+	{
+		/* Ignore the elements describing the playlist itself */
+	}
+	else if(g_strcmp0(name, "location") == 0 && !state->location)
+	{
+		/* Locations are URIs, so relative ones are escaped */
+		gchar *scheme = g_uri_parse_scheme(text);
+
+		state->location =	scheme?
+					g_strdup(text):
+					g_uri_unescape_string(text, NULL);
+
+		g_free(scheme);
+	}
+	else if(g_strcmp0(name, "title") == 0 && *text)
+	{
+		g_free(state->title);
+		state->title = g_strdup(text);
+	}
+	else if(g_strcmp0(name, "duration") == 0)
+	{
+		/* XSPF durations are in milliseconds */
+		state->duration = g_ascii_strtod(text, NULL)/1000;
+	}
+	else if(g_strcmp0(name, "track") == 0)
+	{
+		if(state->location)
+		{
+			add_entry(	state->parser,
+					resolve_location
+					(state->parser, state->location),
+					state->title,
+					state->duration );
+		}
+
+		state->in_track = FALSE;
+	}
+
+	g_string_truncate(state->text, 0);
+}
+
+static void xspf_text(	GMarkupParseContext *context,
+			const gchar *text,
+			gsize text_len,
+			gpointer data,
+			GError **error )
+{
+	XspfState *state = data;
+
+	if(state->in_track)
+	{
+		g_string_append_len(state->text, text, (gssize)text_len);
+	}
+}
+
+static gboolean parse_xspf(	Parser *parser,
+				const gchar *contents,
+				gsize length,
+				GError **error )
+{
+	const GMarkupParser markup_parser =	{	xspf_start_element,
+							xspf_end_element,
+							xspf_text,
+							NULL,
+							NULL };
+	XspfState state = {parser, FALSE, NULL, NULL, 0, g_string_new(NULL)};
+	GMarkupParseContext *context = NULL;
+	gboolean rc = FALSE;
+
+	context =	g_markup_parse_context_new
+			(&markup_parser, 0, &state, NULL);
+	rc =	g_markup_parse_context_parse
+		(context, contents, (gssize)length, error) &&
+		g_markup_parse_context_end_parse(context, error);
+
+	g_markup_parse_context_free(context);
+	g_string_free(state.text, TRUE);
+	g_free(state.location);
+	g_free(state.title);
+
+	return rc;
+}
+
+static gchar *parse_cue_string(	Parser *parser,
+				const gchar *text,
+				gsize length )
+{
+	const gchar *end = text + length;
+
+	while(text < end && g_ascii_isspace(*text))
+	{
+		text++;
+	}
+
+	if(text < end && *text == '"')
+	{
+		const gchar *quote = memchr(text + 1, '"', (gsize)(end - text - 1));
+
+		end = quote?:end;
+		text++;
+	}
+
+	return (text < end)?dup_text(parser, text, (gsize)(end - text)):NULL;
+}
+
+static void parse_cue(Parser *parser, const gchar *contents, gsize length)
+{
+	const gchar *pos = contents;
+	const gchar *end = contents + length;
+	const gchar *line = NULL;
+	gsize line_length = 0;
+	gboolean done = FALSE;
+	gchar *title = NULL;
+	gchar *performer = NULL;
+	gchar *full_title = NULL;
+
+	/* mpv plays cue sheets as a single file with one chapter per track,
+	 * so the sheet itself is the only entry. Its title is taken from the
+	 * header, which ends at the first FILE or TRACK command.
+	 */
+	while(!done && next_line(&pos, end, &line, &line_length))
+	{
+		if(	has_prefix(line, line_length, "FILE ") ||
+			has_prefix(line, line_length, "TRACK ") )
+		{
+			done = TRUE;
+		}
+		else if(has_prefix(line, line_length, "TITLE ") && !title)
+		{
+			title = parse_cue_string(parser, line + 6, line_length - 6);
+		}
+		else if(has_prefix(line, line_length, "PERFORMER ") && !performer)
+		{
+			performer =	parse_cue_string
+					(parser, line + 10, line_length - 10);
+		}
+	}
+
+	if(title && performer)
+	{
+		full_title = g_strdup_printf("%s - %s", performer, title);
+	}
+
+	add_entry(	parser,
+			g_strdup(parser->path),
+			full_title?:title?:performer,
+			0 );
+
+	g_free(full_title);
+	g_free(performer);
+	g_free(title);
+}
+
+GPtrArray *gmpv_playlist_parser_parse(const gchar *uri, GError **error)
+{
+	gchar *path = get_local_path(uri);
+	gboolean utf8 = FALSE;
+	ParserFormat format = path?get_format(path, &utf8):PARSER_FORMAT_NONE;
+	GMappedFile *file = NULL;
+	GPtrArray *result = NULL;
+
+	if(format != PARSER_FORMAT_NONE)
+	{
+		file = g_mapped_file_new(path, FALSE, error);
+	}
+
+	if(file)
+	{
+		const gchar *contents = g_mapped_file_get_contents(file);
+		gsize length = g_mapped_file_get_length(file);
+		gboolean rc = TRUE;
+		Parser parser = {path, g_path_get_dirname(path), utf8, NULL};
+
+		/* Empty files are mapped to NULL */
+		contents = contents?:"";
+		parser.playlist = gmpv_playlist_new(0);
+
+		if(length >= 3 && memcmp(contents, "\xEF\xBB\xBF", 3) == 0)
+		{
+			contents += 3;
+			length -= 3;
+			parser.utf8 = TRUE;
+		}
+
+		switch(format)
+		{
+			case PARSER_FORMAT_M3U:
+			parse_m3u(&parser, contents, length);
+			break;
+
+			case PARSER_FORMAT_PLS:
+			parse_pls(&parser, contents, length);
+			break;
+
+			case PARSER_FORMAT_XSPF:
+			rc = parse_xspf(&parser, contents, length, error);
+			break;
+
+			case PARSER_FORMAT_CUE:
+			parse_cue(&parser, contents, length);
+			break;
+
+			default:
+			g_assert_not_reached();
+			break;
+		}
+
+		g_debug(	"Parsed %u entries from playlist %s",
+				parser.playlist->len,
+				path );
+
+		if(rc)
+		{
+			result = parser.playlist;
+		}
+		else
+		{
+			g_ptr_array_unref(parser.playlist);
+		}
+
+		g_free(parser.dir);
+		g_mapped_file_unref(file);
+	}
+
+	g_free(path);
+
+	return result;
+}
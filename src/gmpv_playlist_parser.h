@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLIST_PARSER_H
+#define PLAYLIST_PARSER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Reads local playlist files without going through mpv. The file is
+ * memory-mapped and scanned in a single pass, so only the resulting
+ * entries are allocated. Relative locations are resolved against the
+ * directory of the playlist.
+ *
+ * Returns NULL without setting error if uri is not a local file in one of
+ * the supported formats, in which case it should be handed to mpv as is.
+ * Otherwise, returns a playlist as created by gmpv_playlist_new(), with
+ * the titles and durations found in the file.
+ */
+GPtrArray *gmpv_playlist_parser_parse(const gchar *uri, GError **error);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gmpv_playlist_sort.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+typedef struct SortItem SortItem;
+
+struct SortItem
+{
+	guint index;
+	gchar *key;
+	gdouble value;
+};
+
+static const gchar *find_tag(	GmpvMetadataCacheEntry *cache_entry,
+				const gchar *name );
+static void init_sort_item(	SortItem *item,
+				guint index,
+				GmpvPlaylistEntry *entry,
+				GmpvMetadataCache *cache,
+				PlaylistSortField field );
+static gint compare_sort_items(	gconstpointer a,
+				gconstpointer b,
+				gpointer data );
+static void update_positions(	const guint *current,
+				guint *positions,
+				guint start,
+				guint end );
+
+static const gchar *find_tag(	GmpvMetadataCacheEntry *cache_entry,
+				const gchar *name )
+{
+	const gchar *result = NULL;
+
+	for(guint i = 0; cache_entry && !result && i < cache_entry->tags->len; i++)
+	{
+		GmpvMetadataEntry *tag = g_ptr_array_index(cache_entry->tags, i);
+
+		if(g_ascii_strcasecmp(tag->key, name) == 0)
+		{
+			result = tag->value;
+		}
+	}
+
+	return result;
+}
+
+static void init_sort_item(	SortItem *item,
+				guint index,
+				GmpvPlaylistEntry *entry,
+				GmpvMetadataCache *cache,
+				PlaylistSortField field )
+{
+	GmpvMetadataCacheEntry *cache_entry = NULL;
+
+	if(cache)
+	{
+		cache_entry = gmpv_metadata_cache_peek(cache, entry->filename);
+	}
+
+	item->index = index;
+	item->key = NULL;
+	item->value = -1;
+
+	switch(field)
+	{
+		case PLAYLIST_SORT_FIELD_TITLE:
+		if(entry->title || (cache_entry && cache_entry->title))
+		{
+			const gchar *title =	entry->title?:
+						cache_entry->title;
+
+			item->key = g_utf8_collate_key(title, -1);
+		}
+		else
+		{
+			gchar *name = get_name_from_path(entry->filename);
+
+			item->key = g_utf8_collate_key_for_filename(name, -1);
+
+			g_free(name);
+		}
+		break;
+
+		case PLAYLIST_SORT_FIELD_ARTIST:
+		case PLAYLIST_SORT_FIELD_ALBUM:
+		{
+			const gchar *name =	(field == PLAYLIST_SORT_FIELD_ARTIST)?
+						"artist":
+						"album";
+			const gchar *value = find_tag(cache_entry, name);
+
+			if(value)
+			{
+				item->key = g_utf8_collate_key(value, -1);
+			}
+		}
+		break;
+
+		case PLAYLIST_SORT_FIELD_DURATION:
+		if(cache_entry && cache_entry->duration > 0)
+		{
+			item->value = cache_entry->duration;
+		}
+		else if(entry->duration > 0)
+		{
+			item->value = entry->duration;
+		}
+		break;
+
+		case PLAYLIST_SORT_FIELD_PATH:
+		item->key =	g_utf8_collate_key_for_filename
+				(entry->filename, -1);
+		break;
+
+		default:
+		g_assert_not_reached();
+		break;
+	}
+}
+
+static gint compare_sort_items(	gconstpointer a,
+				gconstpointer b,
+				gpointer data )
+{
+	const SortItem *item_a = a;
+	const SortItem *item_b = b;
+	PlaylistSortField field = GPOINTER_TO_INT(data);
+	gint result = 0;
+
+	/* Entries without a value for the field go last */
+	if(field == PLAYLIST_SORT_FIELD_DURATION)
+	{
+		gboolean missing_a = item_a->value < 0;
+		gboolean missing_b = item_b->value < 0;
+
+		result =	(missing_a != missing_b)?
+				missing_a-missing_b:
+				(item_a->value > item_b->value)-
+				(item_a->value < item_b->value);
+	}
+	else
+	{
+		result =	(!item_a->key != !item_b->key)?
+				!item_a->key-!item_b->key:
+				g_strcmp0(item_a->key, item_b->key);
+	}
+
+	/* Keep the sort stable */
+	if(result == 0)
+	{
+		result =	(item_a->index > item_b->index)-
+				(item_a->index < item_b->index);
+	}
+
+	return result;
+}
+
+/* Records where the entries in current[start..end] now are */
+static void update_positions(	const guint *current,
+				guint *positions,
+				guint start,
+				guint end )
+{
+	for(guint i = start; i <= end; i++)
+	{
+		positions[current[i]] = i;
+	}
+}
+
+gboolean gmpv_playlist_sort_field_from_string(	const gchar *str,
+						PlaylistSortField *field )
+{
+	const gchar *names[] = {"title", "artist", "album", "duration", "path"};
+	gboolean found = FALSE;
+
+	G_STATIC_ASSERT(G_N_ELEMENTS(names) == PLAYLIST_SORT_FIELD_N);
+
+	for(gint i = 0; !found && i < PLAYLIST_SORT_FIELD_N; i++)
+	{
+		found = (g_strcmp0(str, names[i]) == 0);
+
+		if(found)
+		{
+			*field = i;
+		}
+	}
+
+	return found;
+}
+
+/* Returns the indices of the entries of the playlist in sorted order */
+GArray *gmpv_playlist_sort_get_order(	const GPtrArray *playlist,
+					GmpvMetadataCache *cache,
+					PlaylistSortField field )
+{
+	GArray *items = g_array_sized_new
+			(FALSE, FALSE, sizeof(SortItem), playlist->len);
+	GArray *order = g_array_sized_new
+			(FALSE, FALSE, sizeof(guint), playlist->len);
+
+	g_array_set_size(items, playlist->len);
+
+	for(guint i = 0; i < playlist->len; i++)
+	{
+		init_sort_item(	&g_array_index(items, SortItem, i),
+				i,
+				g_ptr_array_index(playlist, i),
+				cache,
+				field );
+	}
+
+	g_array_sort_with_data
+		(items, compare_sort_items, GINT_TO_POINTER(field));
+
+	for(guint i = 0; i < items->len; i++)
+	{
+		SortItem *item = &g_array_index(items, SortItem, i);
+
+		g_array_append_val(order, item->index);
+		g_free(item->key);
+	}
+
+	g_array_free(items, TRUE);
+
+	return order;
+}
+
+/* Returns the shortest sequence of playlist-move commands that puts the
+ * playlist in the given order, or NULL if applying it would be more
+ * expensive than reloading the playlist.
+ *
+ * Entries that are part of a longest increasing subsequence of the order
+ * are already sorted relative to each other, so only the other entries
+ * need to be moved. Each of them is moved right behind the entry that
+ * precedes it in the new order. The position of every entry is kept up to
+ * date as they are moved, so each move only costs the shifting of the
+ * entries between its source and its destination.
+ */
+GArray *gmpv_playlist_sort_get_moves(const GArray *order)
+{
+	const guint *target = (const guint *)order->data;
+	guint length = order->len;
+	guint *tails = g_new(guint, length+1);
+	gint *prev = g_new(gint, length+1);
+	gboolean *keep = g_new0(gboolean, length+1);
+	guint *current = NULL;
+	guint *positions = NULL;
+	GArray *moves = NULL;
+	guint lis_length = 0;
+
+	for(guint i = 0; i < length; i++)
+	{
+		guint low = 0;
+		guint high = lis_length;
+
+		while(low < high)
+		{
+			guint mid = low+(high-low)/2;
+
+			if(target[tails[mid]] < target[i])
+			{
+				low = mid+1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+
+		prev[i] = (low > 0)?(gint)tails[low-1]:-1;
+		tails[low] = i;
+		lis_length = MAX(lis_length, low+1);
+	}
+
+	for(	gint i = (lis_length > 0)?(gint)tails[lis_length-1]:-1;
+		i >= 0;
+		i = prev[i] )
+	{
+		keep[i] = TRUE;
+	}
+
+	if((guint64)(length-lis_length)*length <= PLAYLIST_SORT_MOVE_BUDGET)
+	{
+		current = g_new(guint, length+1);
+		positions = g_new(guint, length+1);
+		moves = g_array_new(FALSE, FALSE, sizeof(PlaylistMove));
+
+		for(guint i = 0; i < length; i++)
+		{
+			current[i] = i;
+			positions[i] = i;
+		}
+	}
+
+	for(guint i = 0; moves && i < length; i++)
+	{
+		guint src = 0;
+		guint dest = 0;
+
+		if(keep[i])
+		{
+			continue;
+		}
+
+		src = positions[target[i]];
+
+		if(i > 0)
+		{
+			guint prev_pos = positions[target[i-1]];
+
+			dest = (src < prev_pos)?prev_pos:prev_pos+1;
+		}
+
+		if(src < dest)
+		{
+			PlaylistMove move = {src, dest+1};
+
+			memmove(	current+src,
+					current+src+1,
+					(dest-src)*sizeof(guint) );
+			update_positions(current, positions, src, dest-1);
+			g_array_append_val(moves, move);
+		}
+		else if(src > dest)
+		{
+			PlaylistMove move = {src, dest};
+
+			memmove(	current+dest+1,
+					current+dest,
+					(src-dest)*sizeof(guint) );
+			update_positions(current, positions, dest+1, src);
+			g_array_append_val(moves, move);
+		}
+
+		current[dest] = target[i];
+		positions[target[i]] = dest;
+	}
+
+	g_free(tails);
+	g_free(prev);
+	g_free(keep);
+	g_free(positions);
+	g_free(current);
+
+	return moves;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLAYLIST_SORT_H
+#define PLAYLIST_SORT_H
+
+#include <glib.h>
+
+#include "gmpv_metadata_cache.h"
+
+G_BEGIN_DECLS
+
+typedef enum PlaylistSortField PlaylistSortField;
+typedef struct PlaylistMove PlaylistMove;
+
+enum PlaylistSortField
+{
+	PLAYLIST_SORT_FIELD_TITLE,
+	PLAYLIST_SORT_FIELD_ARTIST,
+	PLAYLIST_SORT_FIELD_ALBUM,
+	PLAYLIST_SORT_FIELD_DURATION,
+	PLAYLIST_SORT_FIELD_PATH,
+	PLAYLIST_SORT_FIELD_N
+};
+
+/* Arguments of a playlist-move command. dest refers to the entry that src
+ * is moved in front of, as expected by mpv.
+ */
+struct PlaylistMove
+{
+	gint64 src;
+	gint64 dest;
+};
+
+gboolean gmpv_playlist_sort_field_from_string(	const gchar *str,
+						PlaylistSortField *field );
+GArray *gmpv_playlist_sort_get_order(	const GPtrArray *playlist,
+					GmpvMetadataCache *cache,
+					PlaylistSortField field );
+GArray *gmpv_playlist_sort_get_moves(const GArray *order);
+
+G_END_DECLS
+
+#endif
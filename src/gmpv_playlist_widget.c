@@ -25,7 +25,10 @@
 #include <glib/gi18n.h>
 
 #include "gmpv_playlist_widget.h"
+#include "gmpv_playlist_index.h"
 #include "gmpv_metadata_cache.h"
+#include "gmpv_resume_db.h"
+#include "gmpv_fingerprint_service.h"
 #include "gmpv_marshal.h"
 #include "gmpv_common.h"
 #include "gmpv_def.h"
@@ -40,30 +43,45 @@ enum
 enum PlaylistColumn
 {
 	PLAYLIST_NAME_COLUMN,
-	PLAYLIST_URI_COLUMN,
 	PLAYLIST_WEIGHT_COLUMN,
+	PLAYLIST_ENTRY_COLUMN,
+	PLAYLIST_DUPLICATE_COLUMN,
 	PLAYLIST_N_COLUMNS
 };
 
 struct _GmpvPlaylistWidget
 {
-	GtkScrolledWindow parent_instance;
+	GtkBox parent_instance;
 	gint64 playlist_count;
 	GtkListStore *store;
+	GtkTreeModel *filter;
+	GmpvPlaylistIndex *index;
+	GHashTable *matches;
+	GmpvMetadataCache *cache;
+	GmpvResumeDb *resume_db;
+	GmpvFingerprintService *fingerprint_service;
+	guint duplicates_source_id;
+	GtkWidget *search_entry;
+	GtkWidget *scrolled_window;
 	GtkWidget *tree_view;
 	GtkTreeViewColumn *title_column;
 	GtkCellRenderer *title_renderer;
+	GtkCellRenderer *resume_renderer;
+	GtkCellRenderer *duplicate_renderer;
 	gint last_x;
 	gint last_y;
 	gboolean dnd_delete;
+	gboolean block_selection;
+	gboolean dragging;
 };
 
 struct _GmpvPlaylistWidgetClass
 {
-	GtkScrolledWindowClass parent_class;
+	GtkBoxClass parent_class;
 };
 
 static void constructed(GObject *object);
+static void finalize(GObject *object);
 static void set_property(	GObject *object,
 				guint property_id,
 				const GValue *value,
@@ -106,26 +124,88 @@ static void row_deleted_handler(	GtkTreeModel *tree_model,
 static gboolean mouse_press_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data );
+static gboolean mouse_release_handler(	GtkWidget *widget,
+					GdkEvent *event,
+					gpointer data );
+static gboolean select_func(	GtkTreeSelection *selection,
+				GtkTreeModel *model,
+				GtkTreePath *path,
+				gboolean path_currently_selected,
+				gpointer data );
+static void search_changed_handler(GtkSearchEntry *entry, gpointer data);
+static void stop_search_handler(GtkSearchEntry *entry, gpointer data);
+static gboolean filter_visible_func(	GtkTreeModel *model,
+					GtkTreeIter *iter,
+					gpointer data );
 static gchar *get_uri_selected(GmpvPlaylistWidget *wgt);
+static GtkTreePath *get_selected_path(GmpvPlaylistWidget *wgt);
+static GArray *get_selected_indices(GmpvPlaylistWidget *wgt);
+static GArray *parse_indices(const gchar *str);
+static gchar *get_index_text(	GmpvPlaylistWidget *wgt,
+				GmpvPlaylistEntry *entry,
+				const gchar *name );
+static void index_entry(	GmpvPlaylistWidget *wgt,
+				GmpvPlaylistEntry *entry,
+				const gchar *name );
+static void unindex_row(GmpvPlaylistWidget *wgt, GtkTreeIter *iter);
+static void update_matches(GmpvPlaylistWidget *wgt);
+static void resume_changed_handler(	GmpvResumeDb *db,
+					const gchar *filename,
+					gpointer data );
+static gchar *format_time(gdouble time);
+static void resume_data_func(	GtkTreeViewColumn *column,
+				GtkCellRenderer *renderer,
+				GtkTreeModel *model,
+				GtkTreeIter *iter,
+				gpointer data );
+static void update_duplicates(GmpvPlaylistWidget *wgt);
+static gboolean update_duplicates_handler(gpointer data);
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data );
 
-G_DEFINE_TYPE(GmpvPlaylistWidget, gmpv_playlist_widget, GTK_TYPE_SCROLLED_WINDOW)
+G_DEFINE_TYPE(GmpvPlaylistWidget, gmpv_playlist_widget, GTK_TYPE_BOX)
 
 static void constructed(GObject *object)
 {
 	GmpvPlaylistWidget *self = GMPV_PLAYLIST_WIDGET(object);
 	GtkTargetEntry targets[] = DND_TARGETS;
+	GtkTreeSelection *selection = NULL;
 
-	self->store = gtk_list_store_new(	3,
-						G_TYPE_STRING,
+	self->store = gtk_list_store_new(	PLAYLIST_N_COLUMNS,
 						G_TYPE_STRING,
-						G_TYPE_INT );
-	self->tree_view =	gtk_tree_view_new_with_model
-				(GTK_TREE_MODEL(self->store));
+						G_TYPE_INT,
+						GMPV_TYPE_PLAYLIST_ENTRY,
+						G_TYPE_BOOLEAN );
+	self->filter =	gtk_tree_model_filter_new
+			(GTK_TREE_MODEL(self->store), NULL);
+	self->tree_view = gtk_tree_view_new_with_model(self->filter);
+	self->search_entry = gtk_search_entry_new();
+	self->scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+
+	gtk_tree_model_filter_set_visible_func
+		(	GTK_TREE_MODEL_FILTER(self->filter),
+			filter_visible_func,
+			self,
+			NULL );
+
+	g_signal_connect(	self->search_entry,
+				"search-changed",
+				G_CALLBACK(search_changed_handler),
+				self );
+	g_signal_connect(	self->search_entry,
+				"stop-search",
+				G_CALLBACK(stop_search_handler),
+				self );
 
 	g_signal_connect(	self->tree_view,
 				"button-press-event",
 				G_CALLBACK(mouse_press_handler),
 				self );
+	g_signal_connect(	self->tree_view,
+				"button-release-event",
+				G_CALLBACK(mouse_release_handler),
+				self );
 	g_signal_connect_after(	self->tree_view,
 				"drag-begin",
 				G_CALLBACK(drag_begin_handler),
@@ -154,6 +234,14 @@ static void constructed(GObject *object)
 				"row-deleted",
 				G_CALLBACK(row_deleted_handler),
 				self );
+	g_signal_connect(	self->resume_db,
+				"changed",
+				G_CALLBACK(resume_changed_handler),
+				self );
+	g_signal_connect(	self->fingerprint_service,
+				"ready",
+				G_CALLBACK(fingerprint_ready_handler),
+				self );
 
 	gtk_tree_view_enable_model_drag_source(	GTK_TREE_VIEW(self->tree_view),
 						GDK_BUTTON1_MASK,
@@ -171,14 +259,66 @@ static void constructed(GObject *object)
 	gtk_widget_set_can_focus(self->tree_view, FALSE);
 	gtk_tree_view_set_reorderable(GTK_TREE_VIEW(self->tree_view), FALSE);
 
+	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(self->tree_view));
+	gtk_tree_selection_set_mode(selection, GTK_SELECTION_MULTIPLE);
+	gtk_tree_selection_set_select_function
+		(selection, select_func, self, NULL);
+
 	gtk_tree_view_append_column
 		(GTK_TREE_VIEW(self->tree_view), self->title_column);
 
-	gtk_container_add(GTK_CONTAINER(self), self->tree_view);
+	gtk_entry_set_placeholder_text
+		(GTK_ENTRY(self->search_entry), _("Search playlist"));
+	gtk_orientable_set_orientation
+		(GTK_ORIENTABLE(self), GTK_ORIENTATION_VERTICAL);
+
+	gtk_container_add
+		(GTK_CONTAINER(self->scrolled_window), self->tree_view);
+	gtk_box_pack_start
+		(GTK_BOX(self), self->search_entry, FALSE, FALSE, 0);
+	gtk_box_pack_start
+		(GTK_BOX(self), self->scrolled_window, TRUE, TRUE, 0);
 
 	G_OBJECT_CLASS(gmpv_playlist_widget_parent_class)->constructed(object);
 }
 
+static void finalize(GObject *object)
+{
+	GmpvPlaylistWidget *self = GMPV_PLAYLIST_WIDGET(object);
+
+	gmpv_playlist_index_free(self->index);
+
+	if(self->matches)
+	{
+		g_hash_table_unref(self->matches);
+	}
+
+	if(self->resume_db)
+	{
+		g_signal_handlers_disconnect_by_data(self->resume_db, self);
+		g_clear_object(&self->resume_db);
+	}
+
+	if(self->duplicates_source_id > 0)
+	{
+		g_source_remove(self->duplicates_source_id);
+		self->duplicates_source_id = 0;
+	}
+
+	if(self->fingerprint_service)
+	{
+		g_signal_handlers_disconnect_by_data
+			(self->fingerprint_service, self);
+		g_clear_object(&self->fingerprint_service);
+	}
+
+	g_clear_object(&self->cache);
+	g_clear_object(&self->filter);
+	g_clear_object(&self->store);
+
+	G_OBJECT_CLASS(gmpv_playlist_widget_parent_class)->finalize(object);
+}
+
 static void set_property(	GObject *object,
 				guint property_id,
 				const GValue *value,
@@ -223,6 +363,8 @@ static void drag_begin_handler(	GtkWidget *widget,
 	GtkTreeView *tree_view = GTK_TREE_VIEW(widget);
 	GtkStyleContext *style = gtk_widget_get_style_context(widget);
 	GtkTreeModel *model = gtk_tree_view_get_model(tree_view);
+	GtkTreeSelection *selection = gtk_tree_view_get_selection(tree_view);
+	gint selected_count = gtk_tree_selection_count_selected_rows(selection);
 	GtkTreePath *path = NULL;
 	GtkTreeIter iter;
 	GdkWindow *window = gtk_widget_get_window(widget);
@@ -243,9 +385,22 @@ static void drag_begin_handler(	GtkWidget *widget,
 					NULL,
 					&cell_x, &cell_y );
 
-	gtk_tree_view_get_cursor(tree_view, &path, NULL);
-	gtk_tree_model_get_iter(model, &iter, path);
-	gtk_tree_model_get(model, &iter, PLAYLIST_NAME_COLUMN, &name, -1);
+	wgt->dragging = TRUE;
+
+	if(selected_count > 1)
+	{
+		name = g_strdup_printf(	ngettext(	"%d item",
+							"%d items",
+							selected_count ),
+					selected_count );
+	}
+	else
+	{
+		gtk_tree_view_get_cursor(tree_view, &path, NULL);
+		gtk_tree_model_get_iter(model, &iter, path);
+		gtk_tree_model_get(model, &iter, PLAYLIST_NAME_COLUMN, &name, -1);
+	}
+
 	pango_layout_set_text(layout, name, (gint)strlen(name));
 	pango_layout_get_pixel_size(layout, &text_width, &text_height);
 
@@ -292,6 +447,8 @@ static void drag_begin_handler(	GtkWidget *widget,
 	gdk_rgba_free(border_color);
 	cairo_destroy(cr);
 	g_object_unref(layout);
+	gtk_tree_path_free(path);
+	g_free(name);
 }
 
 static void drag_data_get_handler(	GtkWidget *widget,
@@ -306,30 +463,61 @@ static void drag_data_get_handler(	GtkWidget *widget,
 
 	if(g_strcmp0(type, "PLAYLIST_PATH") == 0)
 	{
-		GmpvPlaylistWidget *wgt = data;
-		GtkTreePath *path = NULL;
-		gchar *path_str = NULL;
+		GArray *indices = get_selected_indices(data);
+		GString *indices_str = g_string_new(NULL);
 		GdkAtom atom = gdk_atom_intern_static_string("PLAYLIST_PATH");
 
-		gtk_tree_view_get_cursor
-			(GTK_TREE_VIEW(wgt->tree_view), &path, NULL);
-
-		path_str = gtk_tree_path_to_string(path);
+		/* Send the store indices of all selected rows */
+		for(guint i = 0; i < indices->len; i++)
+		{
+			g_string_append_printf(	indices_str,
+						i > 0?" %u":"%u",
+						g_array_index(indices, guint, i) );
+		}
 
 		gtk_selection_data_set(	sel_data,
 					atom,
 					8,
-					(const guchar *)path_str,
-					(gint)strlen(path_str) );
+					(const guchar *)indices_str->str,
+					(gint)indices_str->len );
 
-		g_free(path_str);
+		g_array_free(indices, TRUE);
+		g_string_free(indices_str, TRUE);
 	}
 	else if(g_strcmp0(type, "text/uri-list") == 0)
 	{
-		/* Only one URI can be selected at a time */
-		gchar *uris[] = {text, NULL};
+		GmpvPlaylistWidget *wgt = data;
+		GtkTreeModel *model = GTK_TREE_MODEL(wgt->store);
+		GArray *indices = get_selected_indices(wgt);
+		gchar **uris = g_new0(gchar *, indices->len+1);
+
+		for(guint i = 0; i < indices->len; i++)
+		{
+			guint index = g_array_index(indices, guint, i);
+			GmpvPlaylistEntry *entry = NULL;
+			GtkTreeIter iter;
+
+			if(gtk_tree_model_iter_nth_child
+				(model, &iter, NULL, (gint)index))
+			{
+				gtk_tree_model_get(	model,
+							&iter,
+							PLAYLIST_ENTRY_COLUMN, &entry,
+							-1 );
+			}
+
+			uris[i] = g_strdup(entry?entry->filename:"");
+
+			if(entry)
+			{
+				gmpv_playlist_entry_unref(entry);
+			}
+		}
 
 		gtk_selection_data_set_uris(sel_data, uris);
+
+		g_array_free(indices, TRUE);
+		g_strfreev(uris);
 	}
 	else
 	{
@@ -357,21 +545,20 @@ static void drag_data_received_handler(	GtkWidget *widget,
 
 	if(reorder)
 	{
-		GtkListStore *store;
-		const guchar *raw_data;
-		gint src_index, dest_index;
-		GtkTreeIter src_iter, dest_iter;
-		GtkTreePath *src_path, *dest_path;
+		GtkListStore *store = wgt->store;
+		GtkTreeModel *model = GTK_TREE_MODEL(store);
+		gint length = gtk_tree_model_iter_n_children(model, NULL);
+		const guchar *raw_data = gtk_selection_data_get_data(sel_data);
+		GArray *indices = parse_indices((const gchar *)raw_data);
+		gboolean *selected = g_new0(gboolean, (gsize)length+1);
+		gint *new_order = g_new(gint, (gsize)length+1);
+		gint dest_index = length;
+		gint pos = 0;
+		GtkTreePath *dest_path = NULL;
 		GtkTreeViewDropPosition before_mask;
 		GtkTreeViewDropPosition drop_pos;
-		gboolean insert_before;
 		gboolean dest_row_exist;
 
-		store = wgt->store;
-		raw_data = gtk_selection_data_get_data(sel_data);
-		src_path =	gtk_tree_path_new_from_string
-				((const gchar *)raw_data);
-		src_index = gtk_tree_path_get_indices(src_path)[0];
 		before_mask =	GTK_TREE_VIEW_DROP_BEFORE|
 				GTK_TREE_VIEW_DROP_INTO_OR_BEFORE;
 		dest_row_exist =	gtk_tree_view_get_dest_row_at_pos
@@ -383,63 +570,75 @@ static void drag_data_received_handler(	GtkWidget *widget,
 		wgt->dnd_delete = FALSE;
 
 		g_assert(g_strcmp0(type, "PLAYLIST_PATH") == 0);
-		g_assert(src_path);
-
-		gtk_tree_model_get_iter(	GTK_TREE_MODEL(store),
-						&src_iter,
-						src_path );
 
 		if(dest_row_exist)
 		{
-			g_assert(dest_path);
+			GtkTreeModelFilter *filter;
+			GtkTreePath *filter_path = dest_path;
+			gboolean insert_before;
 
-			dest_index = gtk_tree_path_get_indices(dest_path)[0];
+			g_assert(filter_path);
 
-			gtk_tree_model_get_iter(	GTK_TREE_MODEL(store),
-							&dest_iter,
-							dest_path );
-		}
-		else
-		{
-			/* Set dest_iter to the last child */
-			GtkTreeIter iter;
-			gboolean has_next;
+			/* The tree view shows the filtered model */
+			filter = GTK_TREE_MODEL_FILTER(wgt->filter);
+			dest_path =	gtk_tree_model_filter_convert_path_to_child_path
+					(filter, filter_path);
+			insert_before = (drop_pos&before_mask || drop_pos == 0);
 
-			drop_pos = GTK_TREE_VIEW_DROP_AFTER;
-			dest_index = -1;
+			if(dest_path)
+			{
+				dest_index =	gtk_tree_path_get_indices
+						(dest_path)[0]+!insert_before;
+			}
 
-			gtk_tree_model_get_iter_first
-				(GTK_TREE_MODEL(store), &iter);
+			gtk_tree_path_free(filter_path);
+		}
 
-			do
-			{
-				dest_iter = iter;
-				has_next =	gtk_tree_model_iter_next
-						(GTK_TREE_MODEL(store), &iter);
+		for(guint i = 0; i < indices->len; i++)
+		{
+			guint index = g_array_index(indices, guint, i);
 
-				dest_index++;
+			if(index < (guint)length)
+			{
+				selected[index] = TRUE;
 			}
-			while(has_next);
 		}
 
-		insert_before = (drop_pos&before_mask || drop_pos == 0);
+		/* Move the selected rows in front of the row at dest_index,
+		 * keeping their relative order. This must match the order
+		 * computed by gmpv_player_move_playlist_entries().
+		 */
+		for(gint i = 0; i < dest_index; i++)
+		{
+			if(!selected[i])
+			{
+				new_order[pos++] = i;
+			}
+		}
 
-		if(insert_before)
+		for(gint i = 0; i < length; i++)
 		{
-			gtk_list_store_move_before(store, &src_iter, &dest_iter);
+			if(selected[i])
+			{
+				new_order[pos++] = i;
+			}
 		}
-		else
+
+		for(gint i = dest_index; i < length; i++)
 		{
-			gtk_list_store_move_after(store, &src_iter, &dest_iter);
+			if(!selected[i])
+			{
+				new_order[pos++] = i;
+			}
 		}
 
-		g_signal_emit_by_name(	wgt,
-					"rows-reordered",
-					src_index+(src_index>dest_index),
-					dest_index+!insert_before );
+		gtk_list_store_reorder(store, new_order);
+		g_signal_emit_by_name(wgt, "rows-moved", indices, dest_index);
 
-		gtk_tree_path_free(src_path);
 		gtk_tree_path_free(dest_path);
+		g_array_free(indices, TRUE);
+		g_free(selected);
+		g_free(new_order);
 	}
 	else
 	{
@@ -477,10 +676,19 @@ static void row_activated_handler(	GtkTreeView *tree_view,
 					GtkTreeViewColumn *column,
 					gpointer data )
 {
-	gint *indices = gtk_tree_path_get_indices(path);
-	gint64 index = indices?indices[0]:-1;
+	GmpvPlaylistWidget *wgt = data;
+	GtkTreePath *child_path = NULL;
+	gint *indices = NULL;
+	gint64 index = -1;
+
+	child_path =	gtk_tree_model_filter_convert_path_to_child_path
+			(GTK_TREE_MODEL_FILTER(wgt->filter), path);
+	indices = child_path?gtk_tree_path_get_indices(child_path):NULL;
+	index = indices?indices[0]:-1;
 
 	g_signal_emit_by_name(data, "row-activated", index);
+
+	gtk_tree_path_free(child_path);
 }
 
 static void row_inserted_handler(	GtkTreeModel *tree_model,
@@ -516,10 +724,37 @@ static gboolean mouse_press_handler(	GtkWidget *widget,
 
 	wgt->last_x = (gint)btn_event->x;
 	wgt->last_y = (gint)btn_event->y;
+	wgt->dragging = FALSE;
 
 	handled = (	btn_event->type == GDK_BUTTON_PRESS &&
 			btn_event->button == 3 );
 
+	/* Keep the selection when pressing on a selected row so that all
+	 * selected rows can be dragged. The selection is changed on release
+	 * instead if no drag was started.
+	 */
+	if(	btn_event->type == GDK_BUTTON_PRESS &&
+		btn_event->button == 1 &&
+		!(btn_event->state&(GDK_SHIFT_MASK|GDK_CONTROL_MASK)) )
+	{
+		GtkTreeView *tree_view = GTK_TREE_VIEW(widget);
+		GtkTreeSelection *selection = gtk_tree_view_get_selection(tree_view);
+		GtkTreePath *path = NULL;
+
+		gtk_tree_view_get_path_at_pos(	tree_view,
+						wgt->last_x, wgt->last_y,
+						&path,
+						NULL,
+						NULL,
+						NULL );
+
+		wgt->block_selection =	path &&
+					gtk_tree_selection_path_is_selected
+					(selection, path);
+
+		gtk_tree_path_free(path);
+	}
+
 	if(handled)
 	{
 		GMenu *menu;
@@ -527,6 +762,7 @@ static gboolean mouse_press_handler(	GtkWidget *widget,
 		GMenuItem *add_loc_menu_item;
 		GMenuItem *shuffle_menu_item;
 		GMenuItem *loop_menu_item;
+		GMenu *sort_menu;
 		GtkWidget *ctx_menu;
 
 		menu = g_menu_new();
@@ -541,9 +777,22 @@ static gboolean mouse_press_handler(	GtkWidget *widget,
 		shuffle_menu_item = g_menu_item_new(_("_Shuffle"), "win.shuffle-playlist");
 		loop_menu_item = g_menu_item_new(_("L_oop"), "win.toggle-loop");
 
+		sort_menu = g_menu_new();
+		g_menu_append
+			(sort_menu, _("_Title"), "win.sort-playlist::title");
+		g_menu_append
+			(sort_menu, _("A_rtist"), "win.sort-playlist::artist");
+		g_menu_append
+			(sort_menu, _("A_lbum"), "win.sort-playlist::album");
+		g_menu_append
+			(sort_menu, _("_Duration"), "win.sort-playlist::duration");
+		g_menu_append
+			(sort_menu, _("_Path"), "win.sort-playlist::path");
+
 		g_menu_append_item(menu, add_menu_item);
 		g_menu_append_item(menu, add_loc_menu_item);
 		g_menu_append_item(menu, shuffle_menu_item);
+		g_menu_append_submenu(menu, _("Sort _By"), G_MENU_MODEL(sort_menu));
 		g_menu_append_item(menu, loop_menu_item);
 		g_menu_freeze(menu);
 
@@ -559,38 +808,432 @@ static gboolean mouse_press_handler(	GtkWidget *widget,
 	return handled;
 }
 
+static gboolean mouse_release_handler(	GtkWidget *widget,
+					GdkEvent *event,
+					gpointer data )
+{
+	GmpvPlaylistWidget *wgt = data;
+	GdkEventButton *btn_event = (GdkEventButton *)event;
+
+	if(wgt->block_selection)
+	{
+		GtkTreeView *tree_view = GTK_TREE_VIEW(widget);
+		GtkTreePath *path = NULL;
+
+		wgt->block_selection = FALSE;
+
+		gtk_tree_view_get_path_at_pos(	tree_view,
+						(gint)btn_event->x,
+						(gint)btn_event->y,
+						&path,
+						NULL,
+						NULL,
+						NULL );
+
+		if(path && !wgt->dragging)
+		{
+			gtk_tree_view_set_cursor(tree_view, path, NULL, FALSE);
+		}
+
+		gtk_tree_path_free(path);
+	}
+
+	return FALSE;
+}
+
+static gboolean select_func(	GtkTreeSelection *selection,
+				GtkTreeModel *model,
+				GtkTreePath *path,
+				gboolean path_currently_selected,
+				gpointer data )
+{
+	return !GMPV_PLAYLIST_WIDGET(data)->block_selection;
+}
+
 static gchar *get_uri_selected(GmpvPlaylistWidget *wgt)
 {
 	GtkTreeIter iter;
-	GtkTreePath *path = NULL;
+	GtkTreePath *path = get_selected_path(wgt);
 	gchar *result = NULL;
 	gboolean rc = FALSE;
 
-	gtk_tree_view_get_cursor(GTK_TREE_VIEW(wgt->tree_view), &path, NULL);
-
 	if(path)
 	{
 		rc =	gtk_tree_model_get_iter
 			(GTK_TREE_MODEL(wgt->store), &iter, path);
+
+		gtk_tree_path_free(path);
 	}
 
 	if(rc)
 	{
+		GmpvPlaylistEntry *entry = NULL;
+
 		gtk_tree_model_get(	GTK_TREE_MODEL(wgt->store),
 					&iter,
-					PLAYLIST_URI_COLUMN, &result,
+					PLAYLIST_ENTRY_COLUMN, &entry,
 					-1 );
+
+		if(entry)
+		{
+			result = g_strdup(entry->filename);
+
+			gmpv_playlist_entry_unref(entry);
+		}
 	}
 
 	return result;
 }
 
+static void search_changed_handler(GtkSearchEntry *entry, gpointer data)
+{
+	update_matches(data);
+}
+
+static void stop_search_handler(GtkSearchEntry *entry, gpointer data)
+{
+	gtk_entry_set_text(GTK_ENTRY(entry), "");
+}
+
+static gboolean filter_visible_func(	GtkTreeModel *model,
+					GtkTreeIter *iter,
+					gpointer data )
+{
+	GmpvPlaylistWidget *wgt = data;
+	gboolean visible = TRUE;
+
+	if(wgt->matches)
+	{
+		GmpvPlaylistEntry *entry = NULL;
+
+		gtk_tree_model_get(model, iter, PLAYLIST_ENTRY_COLUMN, &entry, -1);
+
+		visible = entry && g_hash_table_contains(wgt->matches, entry);
+
+		if(entry)
+		{
+			gmpv_playlist_entry_unref(entry);
+		}
+	}
+
+	return visible;
+}
+
+/* Returns the path of the row under the cursor in the unfiltered store */
+static GtkTreePath *get_selected_path(GmpvPlaylistWidget *wgt)
+{
+	GtkTreePath *path = NULL;
+	GtkTreePath *child_path = NULL;
+
+	gtk_tree_view_get_cursor(GTK_TREE_VIEW(wgt->tree_view), &path, NULL);
+
+	if(path)
+	{
+		child_path =	gtk_tree_model_filter_convert_path_to_child_path
+				(GTK_TREE_MODEL_FILTER(wgt->filter), path);
+
+		gtk_tree_path_free(path);
+	}
+
+	return child_path;
+}
+
+/* Returns the store indices of the selected rows in ascending order */
+static GArray *get_selected_indices(GmpvPlaylistWidget *wgt)
+{
+	GtkTreeView *tree_view = GTK_TREE_VIEW(wgt->tree_view);
+	GtkTreeSelection *selection = gtk_tree_view_get_selection(tree_view);
+	GList *rows = gtk_tree_selection_get_selected_rows(selection, NULL);
+	GArray *result = g_array_new(FALSE, FALSE, sizeof(guint));
+
+	for(GList *iter = rows; iter; iter = g_list_next(iter))
+	{
+		GtkTreePath *child_path;
+
+		child_path =	gtk_tree_model_filter_convert_path_to_child_path
+				(GTK_TREE_MODEL_FILTER(wgt->filter), iter->data);
+
+		if(child_path)
+		{
+			guint index = (guint)gtk_tree_path_get_indices(child_path)[0];
+
+			g_array_append_val(result, index);
+			gtk_tree_path_free(child_path);
+		}
+	}
+
+	g_list_free_full(rows, (GDestroyNotify)gtk_tree_path_free);
+
+	return result;
+}
+
+static GArray *parse_indices(const gchar *str)
+{
+	gchar **tokens = g_strsplit(str?:"", " ", -1);
+	GArray *result = g_array_new(FALSE, FALSE, sizeof(guint));
+
+	for(gint i = 0; tokens[i]; i++)
+	{
+		gchar *end = NULL;
+		guint64 index = g_ascii_strtoull(tokens[i], &end, 10);
+
+		if(end != tokens[i] && index <= G_MAXUINT)
+		{
+			guint value = (guint)index;
+
+			g_array_append_val(result, value);
+		}
+	}
+
+	g_strfreev(tokens);
+
+	return result;
+}
+
+static gchar *get_index_text(	GmpvPlaylistWidget *wgt,
+				GmpvPlaylistEntry *entry,
+				const gchar *name )
+{
+	GString *text = g_string_new(name);
+	GmpvMetadataCacheEntry *cache_entry = NULL;
+
+	g_string_append_c(text, '\n');
+	g_string_append(text, entry->filename);
+
+	cache_entry = gmpv_metadata_cache_peek(wgt->cache, entry->filename);
+
+	for(guint i = 0; cache_entry && i < cache_entry->tags->len; i++)
+	{
+		GmpvMetadataEntry *tag = g_ptr_array_index(cache_entry->tags, i);
+
+		g_string_append_c(text, '\n');
+		g_string_append(text, tag->value);
+	}
+
+	return g_string_free(text, FALSE);
+}
+
+static void index_entry(	GmpvPlaylistWidget *wgt,
+				GmpvPlaylistEntry *entry,
+				const gchar *name )
+{
+	gchar *text = get_index_text(wgt, entry, name);
+
+	gmpv_playlist_index_add(wgt->index, entry, text);
+
+	g_free(text);
+}
+
+static void unindex_row(GmpvPlaylistWidget *wgt, GtkTreeIter *iter)
+{
+	GmpvPlaylistEntry *entry = NULL;
+
+	gtk_tree_model_get(	GTK_TREE_MODEL(wgt->store),
+				iter,
+				PLAYLIST_ENTRY_COLUMN, &entry,
+				-1 );
+
+	if(entry)
+	{
+		gmpv_playlist_index_remove(wgt->index, entry);
+		gmpv_playlist_entry_unref(entry);
+	}
+}
+
+static void update_matches(GmpvPlaylistWidget *wgt)
+{
+	const gchar *query = gtk_entry_get_text(GTK_ENTRY(wgt->search_entry));
+	GtkTreeView *tree_view = GTK_TREE_VIEW(wgt->tree_view);
+
+	if(wgt->matches)
+	{
+		g_hash_table_unref(wgt->matches);
+	}
+
+	wgt->matches =	(query && *query)?
+			gmpv_playlist_index_query(wgt->index, query):
+			NULL;
+
+	/* Refiltering while the tree view is attached makes it process a
+	 * signal for every row that changes visibility.
+	 */
+	gtk_tree_view_set_model(tree_view, NULL);
+	gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(wgt->filter));
+	gtk_tree_view_set_model(tree_view, wgt->filter);
+}
+
+/* Positions are looked up when rows are drawn, so only the visible rows,
+ * rather than every row of the playlist, need to be updated.
+ */
+static void resume_changed_handler(	GmpvResumeDb *db,
+					const gchar *filename,
+					gpointer data )
+{
+	gtk_widget_queue_draw(GMPV_PLAYLIST_WIDGET(data)->tree_view);
+}
+
+static gchar *format_time(gdouble time)
+{
+	guint64 seconds = time > 0 ? (guint64)time : 0;
+
+	return	(seconds >= 3600)?
+		g_strdup_printf(	"%" G_GUINT64_FORMAT
+					":%02" G_GUINT64_FORMAT
+					":%02" G_GUINT64_FORMAT,
+					seconds/3600,
+					(seconds/60)%60,
+					seconds%60 ):
+		g_strdup_printf(	"%" G_GUINT64_FORMAT
+					":%02" G_GUINT64_FORMAT,
+					seconds/60,
+					seconds%60 );
+}
+
+static void resume_data_func(	GtkTreeViewColumn *column,
+				GtkCellRenderer *renderer,
+				GtkTreeModel *model,
+				GtkTreeIter *iter,
+				gpointer data )
+{
+	GmpvPlaylistWidget *wgt = data;
+	GmpvPlaylistEntry *entry = NULL;
+	gdouble position = 0;
+
+	gtk_tree_model_get(model, iter, PLAYLIST_ENTRY_COLUMN, &entry, -1);
+
+	if(entry)
+	{
+		position =	gmpv_resume_db_lookup
+				(wgt->resume_db, entry->filename);
+
+		gmpv_playlist_entry_unref(entry);
+	}
+
+	if(position > 0)
+	{
+		gchar *time = format_time(position);
+		gchar *text = NULL;
+
+		text = g_strdup_printf(_("Resume at %s"), time);
+
+		g_object_set(renderer, "text", text, "visible", TRUE, NULL);
+
+		g_free(text);
+		g_free(time);
+	}
+	else
+	{
+		g_object_set(renderer, "text", NULL, "visible", FALSE, NULL);
+	}
+}
+
+/* Flags the rows whose file has the same content as another row. Files
+ * whose fingerprint is not known yet are never flagged.
+ */
+static void update_duplicates(GmpvPlaylistWidget *wgt)
+{
+	GmpvFingerprintService *service = wgt->fingerprint_service;
+	GtkTreeModel *model = GTK_TREE_MODEL(wgt->store);
+	GHashTable *counts = g_hash_table_new(g_str_hash, g_str_equal);
+
+	/* Count every fingerprint first, then flag the rows in a second pass */
+	for(gint pass = 0; pass < 2; pass++)
+	{
+		GtkTreeIter iter;
+		gboolean rc = gtk_tree_model_get_iter_first(model, &iter);
+
+		while(rc)
+		{
+			GmpvPlaylistEntry *entry = NULL;
+			const gchar *fingerprint = NULL;
+			gint count = 0;
+
+			gtk_tree_model_get(	model,
+						&iter,
+						PLAYLIST_ENTRY_COLUMN, &entry,
+						-1 );
+
+			fingerprint =	entry?
+					gmpv_fingerprint_service_lookup
+					(service, entry->filename):
+					NULL;
+			count =	fingerprint?
+				GPOINTER_TO_INT
+				(g_hash_table_lookup(counts, fingerprint)):
+				0;
+
+			if(pass == 0 && fingerprint)
+			{
+				g_hash_table_replace(	counts,
+							(gpointer)fingerprint,
+							GINT_TO_POINTER(count+1) );
+			}
+			else if(pass == 1)
+			{
+				gboolean old_duplicate = FALSE;
+
+				gtk_tree_model_get(	model,
+							&iter,
+							PLAYLIST_DUPLICATE_COLUMN,
+							&old_duplicate,
+							-1 );
+
+				if(old_duplicate != (count > 1))
+				{
+					gtk_list_store_set
+						(	wgt->store,
+							&iter,
+							PLAYLIST_DUPLICATE_COLUMN,
+							count > 1,
+							-1 );
+				}
+			}
+
+			if(entry)
+			{
+				gmpv_playlist_entry_unref(entry);
+			}
+
+			rc = gtk_tree_model_iter_next(model, &iter);
+		}
+	}
+
+	g_hash_table_unref(counts);
+}
+
+static gboolean update_duplicates_handler(gpointer data)
+{
+	GmpvPlaylistWidget *wgt = data;
+
+	wgt->duplicates_source_id = 0;
+	update_duplicates(wgt);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Fingerprints arrive one file at a time, so the rows are only checked
+ * again once a batch has been processed.
+ */
+static void fingerprint_ready_handler(	GmpvFingerprintService *service,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvPlaylistWidget *wgt = data;
+
+	if(wgt->duplicates_source_id == 0)
+	{
+		wgt->duplicates_source_id =	g_idle_add
+						(update_duplicates_handler, wgt);
+	}
+}
+
 static void gmpv_playlist_widget_class_init(GmpvPlaylistWidgetClass *klass)
 {
 	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
 	GParamSpec *pspec = NULL;
 
 	obj_class->constructed = constructed;
+	obj_class->finalize = finalize;
 	obj_class->set_property = set_property;
 	obj_class->get_property = get_property;
 
@@ -634,23 +1277,42 @@ static void gmpv_playlist_widget_class_init(GmpvPlaylistWidgetClass *klass)
 			G_TYPE_NONE,
 			1,
 			G_TYPE_INT );
-	g_signal_new(	"rows-reordered",
+	g_signal_new(	"rows-deleted",
 			G_TYPE_FROM_CLASS(klass),
 			G_SIGNAL_RUN_FIRST,
 			0,
 			NULL,
 			NULL,
-			g_cclosure_gen_marshal_VOID__INT_INT,
+			g_cclosure_marshal_VOID__BOXED,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_ARRAY );
+	g_signal_new(	"rows-moved",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_gen_marshal_VOID__BOXED_INT,
 			G_TYPE_NONE,
 			2,
-			G_TYPE_INT,
+			G_TYPE_ARRAY,
 			G_TYPE_INT );
 }
 
 static void gmpv_playlist_widget_init(GmpvPlaylistWidget *wgt)
 {
 	wgt->playlist_count = 0;
+	wgt->filter = NULL;
+	wgt->index = gmpv_playlist_index_new();
+	wgt->matches = NULL;
+	wgt->cache = gmpv_metadata_cache_get_default();
+	wgt->resume_db = gmpv_resume_db_get_default();
+	wgt->fingerprint_service = gmpv_fingerprint_service_get_default();
+	wgt->duplicates_source_id = 0;
 	wgt->title_renderer = gtk_cell_renderer_text_new();
+	wgt->resume_renderer = gtk_cell_renderer_text_new();
+	wgt->duplicate_renderer = gtk_cell_renderer_text_new();
 	wgt->title_column
 		= gtk_tree_view_column_new_with_attributes
 			(	_("Playlist"),
@@ -659,11 +1321,39 @@ static void gmpv_playlist_widget_init(GmpvPlaylistWidget *wgt)
 				"weight", PLAYLIST_WEIGHT_COLUMN,
 				NULL );
 	wgt->dnd_delete = TRUE;
+	wgt->block_selection = FALSE;
+	wgt->dragging = FALSE;
 
 	gtk_widget_set_size_request
 		(GTK_WIDGET(wgt), PLAYLIST_MIN_WIDTH, -1);
 	gtk_tree_view_column_set_sizing
 		(wgt->title_column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+
+	g_object_set(	wgt->resume_renderer,
+			"scale", PANGO_SCALE_SMALL,
+			"style", PANGO_STYLE_ITALIC,
+			"xalign", 1.0f,
+			NULL );
+	gtk_tree_view_column_pack_end
+		(wgt->title_column, wgt->resume_renderer, FALSE);
+	gtk_tree_view_column_set_cell_data_func(	wgt->title_column,
+							wgt->resume_renderer,
+							resume_data_func,
+							wgt,
+							NULL );
+
+	g_object_set(	wgt->duplicate_renderer,
+			"text", _("Duplicate"),
+			"scale", PANGO_SCALE_SMALL,
+			"style", PANGO_STYLE_ITALIC,
+			"xalign", 1.0f,
+			NULL );
+	gtk_tree_view_column_pack_end
+		(wgt->title_column, wgt->duplicate_renderer, FALSE);
+	gtk_tree_view_column_add_attribute(	wgt->title_column,
+						wgt->duplicate_renderer,
+						"visible",
+						PLAYLIST_DUPLICATE_COLUMN );
 }
 
 GtkWidget *gmpv_playlist_widget_new()
@@ -703,25 +1393,75 @@ void gmpv_playlist_widget_set_indicator_pos(	GmpvPlaylistWidget *wgt,
 
 void gmpv_playlist_widget_remove_selected(GmpvPlaylistWidget *wgt)
 {
-	GtkTreePath *path = NULL;
+	GtkTreeModel *model = GTK_TREE_MODEL(wgt->store);
+	GArray *indices = get_selected_indices(wgt);
 
-	gtk_tree_view_get_cursor
-		(	GTK_TREE_VIEW(wgt->tree_view),
-			&path,
-			NULL );
+	g_signal_handlers_block_by_func(wgt->store, row_deleted_handler, wgt);
 
-	if(path)
+	/* Remove from the back so that the remaining indices stay valid */
+	for(guint i = indices->len; i > 0; i--)
 	{
+		guint index = g_array_index(indices, guint, i-1);
 		GtkTreeIter iter;
-		GtkTreeModel *model;
-
-		model = GTK_TREE_MODEL(wgt->store);
 
-		if(gtk_tree_model_get_iter(model, &iter, path))
+		if(gtk_tree_model_iter_nth_child(model, &iter, NULL, (gint)index))
 		{
+			unindex_row(wgt, &iter);
 			gtk_list_store_remove(wgt->store, &iter);
+
+			wgt->playlist_count--;
 		}
 	}
+
+	g_signal_handlers_unblock_by_func(wgt->store, row_deleted_handler, wgt);
+
+	if(indices->len > 0)
+	{
+		g_object_notify(G_OBJECT(wgt), "playlist-count");
+		g_signal_emit_by_name(wgt, "rows-deleted", indices);
+	}
+
+	g_array_free(indices, TRUE);
+}
+
+void gmpv_playlist_widget_set_duration(	GmpvPlaylistWidget *wgt,
+						gdouble duration,
+						gdouble remaining,
+						gboolean complete )
+{
+	const gchar *old_title = gtk_tree_view_column_get_title(wgt->title_column);
+	gchar *title = NULL;
+
+	if(duration > 0)
+	{
+		gchar *total = format_time(duration);
+		gchar *left = format_time(remaining);
+
+		/* Translators: The first time is the length of the whole
+		 * playlist and the second one is what is left to play. The
+		 * plus sign means that some lengths are not known yet.
+		 */
+		title =	complete?
+			g_strdup_printf(_("Playlist (%s, %s left)"), total, left):
+			g_strdup_printf(_("Playlist (%s+, %s+ left)"), total, left);
+
+		g_free(total);
+		g_free(left);
+	}
+	else
+	{
+		title = g_strdup(_("Playlist"));
+	}
+
+	/* This is called on every seek bar update. Avoid relayouts when the
+	 * displayed text does not change.
+	 */
+	if(g_strcmp0(old_title, title) != 0)
+	{
+		gtk_tree_view_column_set_title(wgt->title_column, title);
+	}
+
+	g_free(title);
 }
 
 void gmpv_playlist_widget_queue_draw(GmpvPlaylistWidget *wgt)
@@ -735,6 +1475,7 @@ void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 {
 	GtkListStore *store = wgt->store;
 	gboolean iter_end = FALSE;
+	gboolean changed = FALSE;
 	GtkTreeIter iter;
 
 	g_assert(playlist);
@@ -747,24 +1488,52 @@ void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 	for(guint i = 0; i < playlist->len; i++)
 	{
 		GmpvPlaylistEntry *entry= g_ptr_array_index(playlist, i);
-		gchar *uri = entry->filename;
-		gchar *title = entry->title;
-		gchar *name = title?g_strdup(title):get_name_from_path(uri);
+		GmpvPlaylistEntry *old_entry = NULL;
+		const gchar *uri = entry->filename;
+		const gchar *title = entry->title;
+		gchar *name = NULL;
+
+		if(!iter_end)
+		{
+			gtk_tree_model_get(	GTK_TREE_MODEL(store),
+						&iter,
+						PLAYLIST_ENTRY_COLUMN, &old_entry,
+						-1 );
+		}
+
+		/* Unchanged entries are shared between versions of the
+		 * playlist, so the row is already up to date if it holds the
+		 * same entry.
+		 */
+		if(old_entry && old_entry == entry)
+		{
+			iter_end =	!gtk_tree_model_iter_next
+					(GTK_TREE_MODEL(store), &iter);
+
+			gmpv_playlist_entry_unref(old_entry);
+
+			continue;
+		}
+
+		name = title?g_strdup(title):get_name_from_path(uri);
+		changed = TRUE;
 
 		/* Overwrite current entry if it doesn't match the new value */
 		if(!iter_end)
 		{
 			gchar *old_name =	NULL;
-			gchar *old_uri =	NULL;
+			const gchar *old_uri =	NULL;
 			gboolean name_update =	FALSE;
 			gboolean uri_update =	FALSE;
+			gboolean name_set =	FALSE;
 
 			gtk_tree_model_get(	GTK_TREE_MODEL(store),
 						&iter,
 						PLAYLIST_NAME_COLUMN, &old_name,
-						PLAYLIST_URI_COLUMN, &old_uri,
 						-1 );
 
+			old_uri = old_entry?old_entry->filename:NULL;
+
 			name_update =	(g_strcmp0(name, old_name) != 0);
 			uri_update =	(g_strcmp0(uri, old_uri) != 0);
 
@@ -773,7 +1542,10 @@ void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 			 * correct title if it becomes unavailable later such as
 			 * when restarting mpv.
 			 */
-			if(name_update && (!old_name || title || uri_update))
+			name_set =	name_update &&
+					(!old_name || title || uri_update);
+
+			if(name_set)
 			{
 				gtk_list_store_set(	store,
 							&iter,
@@ -782,20 +1554,23 @@ void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 							-1 );
 			}
 
-			if(uri_update)
+			gtk_list_store_set(	store,
+						&iter,
+						PLAYLIST_ENTRY_COLUMN,
+						entry,
+						-1 );
+
+			if(old_entry)
 			{
-				gtk_list_store_set(	store,
-							&iter,
-							PLAYLIST_URI_COLUMN,
-							uri,
-							-1 );
+				gmpv_playlist_index_remove(wgt->index, old_entry);
 			}
 
+			index_entry(wgt, entry, name_set?name:old_name);
+
 			iter_end =	!gtk_tree_model_iter_next
 					(GTK_TREE_MODEL(store), &iter);
 
 			g_free(old_name);
-			g_free(old_uri);
 		}
 		/* Append entries to the playlist if there are fewer entries in
 		 * the playlist widget than given playlist.
@@ -810,30 +1585,50 @@ void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 						-1 );
 			gtk_list_store_set(	store,
 						&iter,
-						PLAYLIST_URI_COLUMN,
-						uri,
+						PLAYLIST_ENTRY_COLUMN,
+						entry,
 						-1 );
+			index_entry(wgt, entry, name);
 
 			wgt->playlist_count++;
 		}
 
+		if(old_entry)
+		{
+			gmpv_playlist_entry_unref(old_entry);
+		}
+
 		g_free(name);
 	}
 
 	/* If there are more entries in the playlist widget than given playlist,
 	 * remove the excess entries from the playlist widget.
 	 */
-	if(!iter_end)
+	while(!iter_end)
 	{
-		while(gtk_list_store_remove(store, &iter))
-		{
-			wgt->playlist_count--;
-		}
+		unindex_row(wgt, &iter);
+
+		iter_end = !gtk_list_store_remove(store, &iter);
+		changed = TRUE;
+		wgt->playlist_count--;
+	}
+
+	if(changed)
+	{
+		update_duplicates(wgt);
 	}
 
 	g_signal_handlers_unblock_by_func(wgt->store, row_inserted_handler, wgt);
 	g_signal_handlers_unblock_by_func(wgt->store, row_deleted_handler, wgt);
 	g_object_notify(G_OBJECT(wgt), "playlist-count");
+
+	/* Matches are computed when the query changes, so new or replaced
+	 * entries need to be matched against the current query.
+	 */
+	if(changed && wgt->matches)
+	{
+		update_matches(wgt);
+	}
 }
 
 GPtrArray *gmpv_playlist_widget_get_contents(GmpvPlaylistWidget *wgt)
@@ -844,21 +1639,30 @@ GPtrArray *gmpv_playlist_widget_get_contents(GmpvPlaylistWidget *wgt)
 	GPtrArray *result = NULL;
 
 	rc = gtk_tree_model_get_iter_first(model, &iter);
-	result = g_ptr_array_new_full(	1,
-					(GDestroyNotify)
-					gmpv_playlist_entry_free );
+	result = gmpv_playlist_new(1);
 
 	while(rc)
 	{
-		gchar *uri = NULL;
+		GmpvPlaylistEntry *entry = NULL;
 		gchar *name = NULL;
 
 		gtk_tree_model_get(	model, &iter,
-					PLAYLIST_URI_COLUMN, &uri,
 					PLAYLIST_NAME_COLUMN, &name,
+					PLAYLIST_ENTRY_COLUMN, &entry,
 					-1 );
 
-		g_ptr_array_add(result, gmpv_playlist_entry_new(uri, name));
+		if(entry)
+		{
+			GmpvPlaylistEntry *copy =	gmpv_playlist_entry_new
+							(entry->filename, name);
+
+			copy->duration = entry->duration;
+
+			g_ptr_array_add(result, copy);
+			gmpv_playlist_entry_unref(entry);
+		}
+
+		g_free(name);
 
 		rc = gtk_tree_model_iter_next(model, &iter);
 	}
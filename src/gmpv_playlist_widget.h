@@ -30,13 +30,17 @@ G_BEGIN_DECLS
 
 #define GMPV_TYPE_PLAYLIST_WIDGET (gmpv_playlist_widget_get_type ())
 
-G_DECLARE_FINAL_TYPE(GmpvPlaylistWidget, gmpv_playlist_widget, GMPV, PLAYLIST_WIDGET, GtkScrolledWindow)
+G_DECLARE_FINAL_TYPE(GmpvPlaylistWidget, gmpv_playlist_widget, GMPV, PLAYLIST_WIDGET, GtkBox)
 
 GtkWidget *gmpv_playlist_widget_new(void);
 gboolean gmpv_playlist_widget_empty(GmpvPlaylistWidget *wgt);
 void gmpv_playlist_widget_set_indicator_pos(GmpvPlaylistWidget *wgt, gint pos);
 void gmpv_playlist_widget_remove_selected(GmpvPlaylistWidget *wgt);
 void gmpv_playlist_widget_queue_draw(GmpvPlaylistWidget *wgt);
+void gmpv_playlist_widget_set_duration(	GmpvPlaylistWidget *wgt,
+						gdouble duration,
+						gdouble remaining,
+						gboolean complete );
 void gmpv_playlist_widget_update_contents(	GmpvPlaylistWidget *wgt,
 						GPtrArray* playlist );
 GPtrArray *gmpv_playlist_widget_get_contents(GmpvPlaylistWidget *wgt);
@@ -329,6 +329,15 @@ static void gmpv_preferences_dialog_init(GmpvPreferencesDialog *dlg)
 			{_("Prefetch metadata"),
 			"prefetch-metadata",
 			ITEM_TYPE_CHECK_BOX},
+			{_("Restore previous session"),
+			"restore-session",
+			ITEM_TYPE_CHECK_BOX},
+			{_("Normalize loudness"),
+			"loudness-normalization",
+			ITEM_TYPE_CHECK_BOX},
+			{_("Show waveform in seek bar"),
+			"seek-bar-waveform",
+			ITEM_TYPE_CHECK_BOX},
 			{_("Enable MPRIS support"),
 			"mpris-enable",
 			ITEM_TYPE_CHECK_BOX},
@@ -0,0 +1,526 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "gmpv_resume_db.h"
+#include "gmpv_fingerprint_service.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+/* The log starts with RESUME_DB_MAGIC, followed by records made of a
+ * little-endian header and the filename, without a terminating NUL:
+ *
+ *   guint32 filename length
+ *   guint32 flags
+ *   gdouble position
+ *   gdouble duration
+ *
+ * Later records override earlier ones for the same filename. Positions are
+ * also recorded under the fingerprint of the file, prefixed by
+ * RESUME_DB_FINGERPRINT_PREFIX, so that they survive the file being moved
+ * or renamed.
+ */
+#define RESUME_DB_MAGIC "GMPVRDB1"
+#define RESUME_DB_MAGIC_SIZE (sizeof(RESUME_DB_MAGIC) - 1)
+#define RESUME_DB_HEADER_SIZE 24
+#define RESUME_DB_FLAG_REMOVED 1u
+#define RESUME_DB_FINGERPRINT_PREFIX "fingerprint:"
+
+typedef struct ResumeEntry ResumeEntry;
+
+struct ResumeEntry
+{
+	gdouble position;
+	gdouble duration;
+};
+
+struct _GmpvResumeDb
+{
+	GObject parent;
+	gchar *path;
+	GHashTable *table;
+	GOutputStream *log;
+	guint log_records;
+	gint64 compact_retry_time;
+	GmpvFingerprintService *fingerprint_service;
+};
+
+struct _GmpvResumeDbClass
+{
+	GObjectClass parent_class;
+};
+
+static GmpvResumeDb *default_db = NULL;
+
+static void finalize(GObject *object);
+static void append_uint32(GString *buf, guint32 value);
+static void append_double(GString *buf, gdouble value);
+static guint32 read_uint32(const gchar *data);
+static gdouble read_double(const gchar *data);
+static void append_record(	GString *buf,
+				const gchar *filename,
+				guint32 flags,
+				const ResumeEntry *entry );
+static gboolean load(GmpvResumeDb *db);
+static gchar *get_fingerprint_key(GmpvResumeDb *db, const gchar *filename);
+static gboolean update_entry(	GmpvResumeDb *db,
+				const gchar *key,
+				gdouble position,
+				gdouble duration );
+static gboolean remove_entry(GmpvResumeDb *db, const gchar *key);
+static void compact(GmpvResumeDb *db);
+static void write_record(	GmpvResumeDb *db,
+				const gchar *filename,
+				guint32 flags,
+				const ResumeEntry *entry );
+
+G_DEFINE_TYPE(GmpvResumeDb, gmpv_resume_db, G_TYPE_OBJECT)
+
+static void finalize(GObject *object)
+{
+	GmpvResumeDb *db = GMPV_RESUME_DB(object);
+
+	if(db->log)
+	{
+		g_output_stream_close(db->log, NULL, NULL);
+		g_object_unref(db->log);
+	}
+
+	g_object_unref(db->fingerprint_service);
+	g_free(db->path);
+	g_hash_table_unref(db->table);
+
+	G_OBJECT_CLASS(gmpv_resume_db_parent_class)->finalize(object);
+}
+
+static void append_uint32(GString *buf, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	g_string_append_len(buf, (const gchar *)&value, sizeof(value));
+}
+
+static void append_double(GString *buf, gdouble value)
+{
+	guint64 bits = 0;
+
+	memcpy(&bits, &value, sizeof(bits));
+	bits = GUINT64_TO_LE(bits);
+	g_string_append_len(buf, (const gchar *)&bits, sizeof(bits));
+}
+
+static guint32 read_uint32(const gchar *data)
+{
+	guint32 value = 0;
+
+	memcpy(&value, data, sizeof(value));
+
+	return GUINT32_FROM_LE(value);
+}
+
+static gdouble read_double(const gchar *data)
+{
+	guint64 bits = 0;
+	gdouble value = 0;
+
+	memcpy(&bits, data, sizeof(bits));
+	bits = GUINT64_FROM_LE(bits);
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+static void append_record(	GString *buf,
+				const gchar *filename,
+				guint32 flags,
+				const ResumeEntry *entry )
+{
+	gsize length = strlen(filename);
+
+	append_uint32(buf, (guint32)length);
+	append_uint32(buf, flags);
+	append_double(buf, entry?entry->position:0);
+	append_double(buf, entry?entry->duration:0);
+	g_string_append_len(buf, filename, (gssize)length);
+}
+
+/* Replays the log into the table. Returns FALSE if the log needs to be
+ * rewritten, either because it does not exist yet or because it ends with
+ * a partially written record.
+ */
+static gboolean load(GmpvResumeDb *db)
+{
+	GError *error = NULL;
+	GMappedFile *file = g_mapped_file_new(db->path, FALSE, &error);
+	const gchar *data = NULL;
+	gsize length = 0;
+	gsize offset = RESUME_DB_MAGIC_SIZE;
+
+	if(file)
+	{
+		data = g_mapped_file_get_contents(file);
+		length = g_mapped_file_get_length(file);
+	}
+	else if(!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+	{
+		g_warning(	"Failed to load resume database %s: %s",
+				db->path,
+				error->message );
+	}
+
+	if(	length < RESUME_DB_MAGIC_SIZE ||
+		memcmp(data, RESUME_DB_MAGIC, RESUME_DB_MAGIC_SIZE) != 0 )
+	{
+		offset = 0;
+	}
+
+	while(offset > 0 && length - offset >= RESUME_DB_HEADER_SIZE)
+	{
+		const gchar *record = data + offset;
+		guint32 filename_length = read_uint32(record);
+		guint32 flags = read_uint32(record + 4);
+		gchar *filename = NULL;
+
+		if(filename_length > length - offset - RESUME_DB_HEADER_SIZE)
+		{
+			break;
+		}
+
+		filename =	g_strndup
+				(	record + RESUME_DB_HEADER_SIZE,
+					filename_length );
+
+		if((flags&RESUME_DB_FLAG_REMOVED) != 0)
+		{
+			g_hash_table_remove(db->table, filename);
+			g_free(filename);
+		}
+		else
+		{
+			ResumeEntry *entry = g_new(ResumeEntry, 1);
+
+			entry->position = read_double(record + 8);
+			entry->duration = read_double(record + 16);
+
+			g_hash_table_replace(db->table, filename, entry);
+		}
+
+		offset += RESUME_DB_HEADER_SIZE + filename_length;
+		db->log_records++;
+	}
+
+	if(file)
+	{
+		g_mapped_file_unref(file);
+	}
+
+	g_clear_error(&error);
+
+	return offset > 0 && offset == length;
+}
+
+/* Rewrites the log with one record per file. The new log replaces the old
+ * one atomically, so a crash never leaves a truncated database behind. If
+ * that fails, the old log is kept open for appending, and compaction is
+ * not attempted again for RESUME_DB_COMPACT_RETRY_DELAY seconds.
+ */
+static void compact(GmpvResumeDb *db)
+{
+	GString *buf = g_string_new(RESUME_DB_MAGIC);
+	gchar *dir = g_path_get_dirname(db->path);
+	GError *error = NULL;
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+
+	g_hash_table_iter_init(&iter, db->table);
+
+	while(g_hash_table_iter_next(&iter, &key, &value))
+	{
+		append_record(buf, key, 0, value);
+	}
+
+	g_mkdir_with_parents(dir, 0755);
+
+	if(g_file_set_contents(db->path, buf->str, (gssize)buf->len, &error))
+	{
+		GFile *file = g_file_new_for_path(db->path);
+
+		if(db->log)
+		{
+			g_output_stream_close(db->log, NULL, NULL);
+			g_clear_object(&db->log);
+		}
+
+		db->log_records = g_hash_table_size(db->table);
+		db->log =	G_OUTPUT_STREAM(g_file_append_to
+				(	file,
+					G_FILE_CREATE_PRIVATE,
+					NULL,
+					&error ));
+
+		g_object_unref(file);
+	}
+
+	if(error)
+	{
+		g_warning(	"Failed to write resume database %s: %s",
+				db->path,
+				error->message );
+
+		db->compact_retry_time =	g_get_monotonic_time()+
+						RESUME_DB_COMPACT_RETRY_DELAY*
+						G_TIME_SPAN_SECOND;
+
+		g_error_free(error);
+	}
+
+	g_string_free(buf, TRUE);
+	g_free(dir);
+}
+
+/* Must be called after the table has been updated, since the log may be
+ * rewritten from the table instead.
+ */
+static void write_record(	GmpvResumeDb *db,
+				const gchar *filename,
+				guint32 flags,
+				const ResumeEntry *entry )
+{
+	if(db->log)
+	{
+		GString *buf = g_string_sized_new(RESUME_DB_HEADER_SIZE + 256);
+		GError *error = NULL;
+
+		append_record(buf, filename, flags, entry);
+
+		if(!g_output_stream_write_all(	db->log,
+						buf->str,
+						buf->len,
+						NULL,
+						NULL,
+						&error ))
+		{
+			g_warning(	"Failed to write resume database %s: %s",
+					db->path,
+					error->message );
+
+			g_error_free(error);
+		}
+
+		db->log_records++;
+		g_string_free(buf, TRUE);
+	}
+
+	if(	g_get_monotonic_time() >= db->compact_retry_time &&
+		(!db->log ||
+		(db->log_records > RESUME_DB_COMPACT_MIN_RECORDS &&
+		db->log_records > 2*g_hash_table_size(db->table))) )
+	{
+		compact(db);
+	}
+}
+
+static gchar *get_fingerprint_key(GmpvResumeDb *db, const gchar *filename)
+{
+	const gchar *fingerprint = NULL;
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(db->fingerprint_service, filename);
+
+	return	fingerprint?
+		g_strconcat(RESUME_DB_FINGERPRINT_PREFIX, fingerprint, NULL):
+		NULL;
+}
+
+static gboolean update_entry(	GmpvResumeDb *db,
+				const gchar *key,
+				gdouble position,
+				gdouble duration )
+{
+	ResumeEntry *entry = g_hash_table_lookup(db->table, key);
+	gboolean changed =	!entry ||
+				entry->position != position ||
+				entry->duration != duration;
+
+	if(changed)
+	{
+		if(!entry)
+		{
+			entry = g_new(ResumeEntry, 1);
+
+			g_hash_table_insert(db->table, g_strdup(key), entry);
+		}
+
+		entry->position = position;
+		entry->duration = duration;
+
+		write_record(db, key, 0, entry);
+	}
+
+	return changed;
+}
+
+static gboolean remove_entry(GmpvResumeDb *db, const gchar *key)
+{
+	gboolean removed = g_hash_table_remove(db->table, key);
+
+	if(removed)
+	{
+		write_record(db, key, RESUME_DB_FLAG_REMOVED, NULL);
+	}
+
+	return removed;
+}
+
+static void gmpv_resume_db_class_init(GmpvResumeDbClass *klass)
+{
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->finalize = finalize;
+
+	g_signal_new(	"changed",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__STRING,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_STRING );
+}
+
+static void gmpv_resume_db_init(GmpvResumeDb *db)
+{
+	gchar *config_dir = get_config_dir_path();
+
+	db->path = g_build_filename(config_dir, RESUME_DB_FILENAME, NULL);
+	db->table =	g_hash_table_new_full
+			(g_str_hash, g_str_equal, g_free, g_free);
+	db->log = NULL;
+	db->log_records = 0;
+	db->compact_retry_time = 0;
+	db->fingerprint_service = gmpv_fingerprint_service_get_default();
+
+	/* The log is only opened when the first record is written, so that
+	 * the file is not created until there is something to remember.
+	 */
+	if(load(db) && db->log_records > 0)
+	{
+		GFile *file = g_file_new_for_path(db->path);
+
+		db->log =	G_OUTPUT_STREAM(g_file_append_to
+				(	file,
+					G_FILE_CREATE_PRIVATE,
+					NULL,
+					NULL ));
+
+		g_object_unref(file);
+	}
+
+	g_free(config_dir);
+}
+
+GmpvResumeDb *gmpv_resume_db_get_default(void)
+{
+	if(default_db)
+	{
+		g_object_ref(default_db);
+	}
+	else
+	{
+		default_db = g_object_new(gmpv_resume_db_get_type(), NULL);
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_db), (gpointer *)&default_db);
+	}
+
+	return default_db;
+}
+
+gdouble gmpv_resume_db_lookup(GmpvResumeDb *db, const gchar *filename)
+{
+	ResumeEntry *entry =	filename?
+				g_hash_table_lookup(db->table, filename):
+				NULL;
+
+	/* Fall back to the content of the file in case it has been moved */
+	if(!entry && filename)
+	{
+		gchar *key = get_fingerprint_key(db, filename);
+
+		entry = key?g_hash_table_lookup(db->table, key):NULL;
+
+		g_free(key);
+	}
+
+	return entry?entry->position:0;
+}
+
+void gmpv_resume_db_update(	GmpvResumeDb *db,
+				const gchar *filename,
+				gdouble position,
+				gdouble duration )
+{
+	/* Positions close to either end are not worth resuming from */
+	if(	position < RESUME_DB_MIN_POSITION ||
+		(duration > 0 && duration - position < RESUME_DB_END_MARGIN) )
+	{
+		gmpv_resume_db_remove(db, filename);
+	}
+	else
+	{
+		gchar *key = get_fingerprint_key(db, filename);
+
+		/* The fingerprint may not be known yet on the first update,
+		 * but positions are updated often enough for a later one to
+		 * record it.
+		 */
+		gmpv_fingerprint_service_request
+			(db->fingerprint_service, filename);
+
+		if(key)
+		{
+			update_entry(db, key, position, duration);
+		}
+
+		if(update_entry(db, filename, position, duration))
+		{
+			g_signal_emit_by_name(db, "changed", filename);
+		}
+
+		g_free(key);
+	}
+}
+
+void gmpv_resume_db_remove(GmpvResumeDb *db, const gchar *filename)
+{
+	gchar *key = get_fingerprint_key(db, filename);
+	gboolean removed = key && remove_entry(db, key);
+
+	if(remove_entry(db, filename) || removed)
+	{
+		g_signal_emit_by_name(db, "changed", filename);
+	}
+
+	g_free(key);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESUME_DB_H
+#define RESUME_DB_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GMPV_TYPE_RESUME_DB (gmpv_resume_db_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvResumeDb, gmpv_resume_db, GMPV, RESUME_DB, GObject)
+
+/* Remembers where playback of each file was left off. The positions are
+ * kept in memory and persisted to an append-only log in the config
+ * directory, which is memory-mapped and replayed once on startup. Every
+ * update appends a single record, and the log is rewritten without the
+ * stale records once they make up most of it.
+ *
+ * Lookups never touch the filesystem. The changed signal is emitted with
+ * the filename whenever its position is updated or removed.
+ */
+GmpvResumeDb *gmpv_resume_db_get_default(void);
+gdouble gmpv_resume_db_lookup(GmpvResumeDb *db, const gchar *filename);
+void gmpv_resume_db_update(	GmpvResumeDb *db,
+				const gchar *filename,
+				gdouble position,
+				gdouble duration );
+void gmpv_resume_db_remove(GmpvResumeDb *db, const gchar *filename);
+
+G_END_DECLS
+
+#endif
@@ -22,6 +22,7 @@
 #include <gtk/gtk.h>
 
 #include "gmpv_seek_bar.h"
+#include "gmpv_def.h"
 
 struct _GmpvSeekBar
 {
@@ -30,6 +31,10 @@ struct _GmpvSeekBar
 	GtkWidget *label;
 	gdouble pos;
 	gdouble duration;
+	GBytes *waveform;
+	cairo_surface_t *waveform_surface;
+	gint waveform_width;
+	gint waveform_height;
 };
 
 struct _GmpvSeekBarClass
@@ -37,14 +42,29 @@ struct _GmpvSeekBarClass
 	GtkBoxClass parent_class;
 };
 
+static void finalize(GObject *object);
 static void change_value_handler(	GtkWidget *widget,
 					GtkScrollType scroll,
 					gdouble value,
 					gpointer data );
+static gboolean draw_handler(GtkWidget *widget, cairo_t *cr, gpointer data);
+static void style_updated_handler(GtkWidget *widget, gpointer data);
+static void render_waveform(GmpvSeekBar *bar, gint width, gint height);
+static void invalidate_waveform(GmpvSeekBar *bar);
 static void update_label(GmpvSeekBar *bar);
 
 G_DEFINE_TYPE(GmpvSeekBar, gmpv_seek_bar, GTK_TYPE_BOX)
 
+static void finalize(GObject *object)
+{
+	GmpvSeekBar *bar = GMPV_SEEK_BAR(object);
+
+	invalidate_waveform(bar);
+	g_clear_pointer(&bar->waveform, g_bytes_unref);
+
+	G_OBJECT_CLASS(gmpv_seek_bar_parent_class)->finalize(object);
+}
+
 static void change_value_handler(	GtkWidget *widget,
 					GtkScrollType scroll,
 					gdouble value,
@@ -59,6 +79,118 @@ static void change_value_handler(	GtkWidget *widget,
 	}
 }
 
+/* Runs before the scale draws itself, so the waveform ends up behind the
+ * trough and the slider. Only the cached surface is painted here, and it
+ * is only rendered again when the size or the waveform changes.
+ */
+static gboolean draw_handler(GtkWidget *widget, cairo_t *cr, gpointer data)
+{
+	GmpvSeekBar *bar = data;
+
+	if(bar->waveform && bar->duration > 0)
+	{
+		GdkRectangle rect;
+		gint slider_start = 0;
+		gint slider_end = 0;
+		gint inset = 0;
+		gint width = 0;
+		gint height = gtk_widget_get_allocated_height(widget);
+
+		/* The slider is centered on the position, so the time range
+		 * only covers the trough minus half a slider on each side.
+		 */
+		gtk_range_get_range_rect(GTK_RANGE(widget), &rect);
+		gtk_range_get_slider_range
+			(GTK_RANGE(widget), &slider_start, &slider_end);
+
+		inset = (slider_end-slider_start)/2;
+		width = rect.width-2*inset;
+
+		if(width > 0 && height > 0)
+		{
+			if(	!bar->waveform_surface ||
+				bar->waveform_width != width ||
+				bar->waveform_height != height )
+			{
+				render_waveform(bar, width, height);
+			}
+
+			cairo_set_source_surface
+				(cr, bar->waveform_surface, rect.x+inset, 0);
+			cairo_paint(cr);
+		}
+	}
+
+	return FALSE;
+}
+
+static void style_updated_handler(GtkWidget *widget, gpointer data)
+{
+	invalidate_waveform(data);
+}
+
+static void render_waveform(GmpvSeekBar *bar, gint width, gint height)
+{
+	GtkStyleContext *context = gtk_widget_get_style_context(bar->seek_bar);
+	gsize size = 0;
+	const gint8 *peaks = g_bytes_get_data(bar->waveform, &size);
+	guint count = (guint)(size/2);
+	gdouble scale = height/2.0/128.0;
+	GdkRGBA color;
+	cairo_t *cr = NULL;
+
+	invalidate_waveform(bar);
+
+	bar->waveform_surface =	gdk_window_create_similar_surface
+				(	gtk_widget_get_window(bar->seek_bar),
+					CAIRO_CONTENT_COLOR_ALPHA,
+					width,
+					height );
+	bar->waveform_width = width;
+	bar->waveform_height = height;
+
+	gtk_style_context_get_color
+		(context, gtk_style_context_get_state(context), &color);
+
+	cr = cairo_create(bar->waveform_surface);
+
+	cairo_set_source_rgba
+		(cr, color.red, color.green, color.blue, color.alpha*WAVEFORM_ALPHA);
+
+	/* Every column covers the buckets that fall under it, or repeats the
+	 * closest one when there are more columns than buckets.
+	 */
+	for(gint x = 0; count > 0 && x < width; x++)
+	{
+		guint start = (guint)((guint64)x*count/(guint)width);
+		guint end = (guint)((guint64)(x+1)*count/(guint)width);
+		gint min = G_MAXINT8;
+		gint max = G_MININT8;
+
+		end = MAX(end, start+1);
+
+		for(guint i = start; i < end; i++)
+		{
+			min = MIN(min, peaks[2*i]);
+			max = MAX(max, peaks[2*i+1]);
+		}
+
+		cairo_rectangle(	cr,
+					x,
+					height/2.0-(max+1)*scale,
+					1,
+					MAX((max-min+1)*scale, 1) );
+	}
+
+	cairo_fill(cr);
+	cairo_destroy(cr);
+}
+
+static void invalidate_waveform(GmpvSeekBar *bar)
+{
+	g_clear_pointer(&bar->waveform_surface, cairo_surface_destroy);
+}
+
 static void update_label(GmpvSeekBar *bar)
 {
 	gint sec = (gint)bar->pos;
@@ -96,6 +228,10 @@ static void update_label(GmpvSeekBar *bar)
 
 static void gmpv_seek_bar_class_init(GmpvSeekBarClass *klass)
 {
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->finalize = finalize;
+
 	g_signal_new(	"seek",
 			G_TYPE_FROM_CLASS(klass),
 			G_SIGNAL_RUN_FIRST,
@@ -114,6 +250,10 @@ static void gmpv_seek_bar_init(GmpvSeekBar *bar)
 	bar->label = gtk_label_new("");
 	bar->duration = 0;
 	bar->pos = 0;
+	bar->waveform = NULL;
+	bar->waveform_surface = NULL;
+	bar->waveform_width = 0;
+	bar->waveform_height = 0;
 
 	update_label(bar);
 	gtk_scale_set_draw_value(GTK_SCALE(bar->seek_bar), FALSE);
@@ -124,6 +264,14 @@ static void gmpv_seek_bar_init(GmpvSeekBar *bar)
 				"change-value",
 				G_CALLBACK(change_value_handler),
 				bar );
+	g_signal_connect(	bar->seek_bar,
+				"draw",
+				G_CALLBACK(draw_handler),
+				bar );
+	g_signal_connect(	bar->seek_bar,
+				"style-updated",
+				G_CALLBACK(style_updated_handler),
+				bar );
 
 	gtk_box_pack_start(GTK_BOX(bar), bar->seek_bar, TRUE, TRUE, 0);
 	gtk_box_pack_end(GTK_BOX(bar), bar->label, FALSE, FALSE, 0);
@@ -155,3 +303,24 @@ void gmpv_seek_bar_set_pos(GmpvSeekBar *bar, gdouble pos)
 		update_label(bar);
 	}
 }
+
+void gmpv_seek_bar_set_waveform(GmpvSeekBar *bar, GBytes *waveform)
+{
+	if(waveform != bar->waveform)
+	{
+		if(waveform)
+		{
+			g_bytes_ref(waveform);
+		}
+
+		if(bar->waveform)
+		{
+			g_bytes_unref(bar->waveform);
+		}
+
+		bar->waveform = waveform;
+
+		invalidate_waveform(bar);
+		gtk_widget_queue_draw(bar->seek_bar);
+	}
+}
@@ -34,6 +34,11 @@ GtkWidget *gmpv_seek_bar_new(void);
 void gmpv_seek_bar_set_duration(GmpvSeekBar *bar, gdouble duration);
 void gmpv_seek_bar_set_pos(GmpvSeekBar *bar, gdouble pos);
 
+/* Draws an amplitude overview behind the track, made of pairs of minimum
+ * and maximum as built by GmpvWaveformService. NULL removes it.
+ */
+void gmpv_seek_bar_set_waveform(GmpvSeekBar *bar, GBytes *waveform);
+
 G_END_DECLS
 
 #endif
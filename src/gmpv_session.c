@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gmpv_session.h"
+#include "gmpv_common.h"
+#include "gmpv_def.h"
+
+/* The session is split in two files, so that the playlist, which can be
+ * large, is only rewritten when it changes rather than whenever playback
+ * moves on.
+ *
+ * The playlist file starts with SESSION_MAGIC, followed by a GVariant of
+ * type SESSION_FORMAT holding the filename, title and duration of every
+ * entry. The position file starts with SESSION_POSITION_MAGIC, followed by
+ * a GVariant of type SESSION_POSITION_FORMAT holding the checksum of the
+ * playlist it belongs to, the playlist position and the time position.
+ * Both magics are 8 bytes long, so the GVariants stay aligned when the
+ * files are mapped.
+ *
+ * The playlist is always written before the position. If the position
+ * does not belong to the playlist, such as after a crash between the two,
+ * it is ignored and the playlist is restored from the start.
+ */
+#define SESSION_MAGIC "GMPVSES2"
+#define SESSION_FORMAT "a(smsd)"
+#define SESSION_POSITION_MAGIC "GMPVPOS2"
+#define SESSION_POSITION_FORMAT "(sxd)"
+#define MAGIC_SIZE 8
+
+/* Last snapshots written or read, used to skip saving unchanged files */
+static GBytes *saved_playlist = NULL;
+static GBytes *saved_position = NULL;
+static gchar *saved_checksum = NULL;
+
+static gchar *get_session_path(const gchar *filename);
+static GBytes *read_file(	const gchar *filename,
+				const gchar *magic,
+				GError **error );
+static gboolean write_file(	const gchar *filename,
+				const gchar *magic,
+				GVariant *value,
+				GBytes **saved,
+				GError **error );
+static gchar *get_checksum(GBytes *bytes);
+static GVariant *serialize_playlist(const GmpvSession *session);
+static GPtrArray *deserialize_playlist(GVariant *value);
+
+static gchar *get_session_path(const gchar *filename)
+{
+	gchar *config_dir = get_config_dir_path();
+	gchar *path = g_build_filename(config_dir, filename, NULL);
+
+	g_free(config_dir);
+
+	return path;
+}
+
+/* Returns what follows the magic, or NULL without setting error if the file
+ * does not exist.
+ */
+static GBytes *read_file(	const gchar *filename,
+				const gchar *magic,
+				GError **error )
+{
+	gchar *path = get_session_path(filename);
+	GMappedFile *file = NULL;
+	GBytes *body = NULL;
+	GError *tmp_error = NULL;
+
+	file = g_mapped_file_new(path, FALSE, &tmp_error);
+
+	if(file)
+	{
+		GBytes *bytes = g_mapped_file_get_bytes(file);
+		gsize size = g_bytes_get_size(bytes);
+		const gchar *data = g_bytes_get_data(bytes, NULL);
+
+		if(size >= MAGIC_SIZE && memcmp(data, magic, MAGIC_SIZE) == 0)
+		{
+			body =	g_bytes_new_from_bytes
+				(bytes, MAGIC_SIZE, size - MAGIC_SIZE);
+		}
+		else
+		{
+			g_set_error(	error,
+					G_FILE_ERROR,
+					G_FILE_ERROR_INVAL,
+					"%s is not a valid session file",
+					path );
+		}
+
+		g_bytes_unref(bytes);
+		g_mapped_file_unref(file);
+	}
+	else if(g_error_matches(tmp_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+	{
+		g_error_free(tmp_error);
+	}
+	else
+	{
+		g_propagate_error(error, tmp_error);
+	}
+
+	g_free(path);
+
+	return body;
+}
+
+/* Writes value unless it is the same as saved, which is updated on
+ * success.
+ */
+static gboolean write_file(	const gchar *filename,
+				const gchar *magic,
+				GVariant *value,
+				GBytes **saved,
+				GError **error )
+{
+	GBytes *body = g_variant_get_data_as_bytes(value);
+	gboolean rc = TRUE;
+
+	if(!*saved || !g_bytes_equal(body, *saved))
+	{
+		gchar *path = get_session_path(filename);
+		gchar *dir = g_path_get_dirname(path);
+		gsize body_size = g_bytes_get_size(body);
+		gsize size = MAGIC_SIZE + body_size;
+		gchar *buf = g_malloc(size);
+
+		memcpy(buf, magic, MAGIC_SIZE);
+		memcpy(	buf + MAGIC_SIZE,
+			g_bytes_get_data(body, NULL),
+			body_size );
+
+		g_mkdir_with_parents(dir, 0755);
+
+		rc = g_file_set_contents(path, buf, (gssize)size, error);
+
+		if(rc)
+		{
+			if(*saved)
+			{
+				g_bytes_unref(*saved);
+			}
+
+			*saved = g_bytes_ref(body);
+		}
+
+		g_free(buf);
+		g_free(dir);
+		g_free(path);
+	}
+
+	g_bytes_unref(body);
+
+	return rc;
+}
+
+static gchar *get_checksum(GBytes *bytes)
+{
+	gsize size = 0;
+	gconstpointer data = g_bytes_get_data(bytes, &size);
+
+	return g_compute_checksum_for_data(G_CHECKSUM_SHA1, data, size);
+}
+
+static GVariant *serialize_playlist(const GmpvSession *session)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE(SESSION_FORMAT));
+
+	for(guint i = 0; i < session->playlist->len; i++)
+	{
+		GmpvPlaylistEntry *entry =	g_ptr_array_index
+						(session->playlist, i);
+
+		g_variant_builder_add(	&builder,
+					"(smsd)",
+					entry->filename,
+					entry->title,
+					entry->duration );
+	}
+
+	return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+/* Entries are read one at a time straight from the serialized data, so
+ * only the resulting playlist is allocated.
+ */
+static GPtrArray *deserialize_playlist(GVariant *value)
+{
+	gsize count = g_variant_n_children(value);
+	GPtrArray *playlist = gmpv_playlist_new((guint)count);
+
+	for(gsize i = 0; i < count; i++)
+	{
+		GVariant *child = g_variant_get_child_value(value, i);
+		GmpvPlaylistEntry *entry = NULL;
+		const gchar *filename = NULL;
+		const gchar *title = NULL;
+		gdouble duration = 0;
+
+		g_variant_get(child, "(&sm&sd)", &filename, &title, &duration);
+
+		/* Untrusted data reads back as empty strings when invalid */
+		if(*filename)
+		{
+			entry = gmpv_playlist_entry_new(filename, title);
+			entry->duration = duration;
+
+			g_ptr_array_add(playlist, entry);
+		}
+
+		g_variant_unref(child);
+	}
+
+	return playlist;
+}
+
+GmpvSession *gmpv_session_new(	GPtrArray *playlist,
+				gint64 position,
+				gdouble time_pos )
+{
+	GmpvSession *session = g_new(GmpvSession, 1);
+
+	session->playlist = playlist?g_ptr_array_ref(playlist):NULL;
+	session->position = position;
+	session->time_pos = time_pos;
+
+	return session;
+}
+
+void gmpv_session_free(GmpvSession *session)
+{
+	if(session)
+	{
+		if(session->playlist)
+		{
+			g_ptr_array_unref(session->playlist);
+		}
+
+		g_free(session);
+	}
+}
+
+/* A missing or invalid position file only loses the position, so the
+ * playlist is restored from the start in that case.
+ */
+GmpvSession *gmpv_session_load(GError **error)
+{
+	GmpvSession *session = NULL;
+	GBytes *body = NULL;
+	gint64 position = 0;
+	gdouble time_pos = 0;
+
+	body = read_file(SESSION_FILENAME, SESSION_MAGIC, error);
+
+	if(body)
+	{
+		GVariant *value = NULL;
+		GPtrArray *playlist = NULL;
+		const gchar *checksum = NULL;
+
+		value =	g_variant_new_from_bytes
+			(G_VARIANT_TYPE(SESSION_FORMAT), body, FALSE);
+
+		g_variant_ref_sink(value);
+		playlist = deserialize_playlist(value);
+
+		if(saved_playlist)
+		{
+			g_bytes_unref(saved_playlist);
+		}
+
+		g_free(saved_checksum);
+
+		saved_playlist = body;
+		saved_checksum = get_checksum(body);
+
+		g_variant_unref(value);
+
+		body =	read_file
+			(SESSION_POSITION_FILENAME, SESSION_POSITION_MAGIC, NULL);
+
+		if(body)
+		{
+			value =	g_variant_new_from_bytes
+				(	G_VARIANT_TYPE(SESSION_POSITION_FORMAT),
+					body,
+					FALSE );
+
+			g_variant_ref_sink(value);
+			g_variant_get(	value,
+					"(&sxd)",
+					&checksum,
+					&position,
+					&time_pos );
+
+			if(g_strcmp0(checksum, saved_checksum) != 0)
+			{
+				position = 0;
+				time_pos = 0;
+			}
+
+			if(saved_position)
+			{
+				g_bytes_unref(saved_position);
+			}
+
+			saved_position = body;
+
+			g_variant_unref(value);
+		}
+
+		session = gmpv_session_new(playlist, position, time_pos);
+
+		g_ptr_array_unref(playlist);
+	}
+
+	return session;
+}
+
+gboolean gmpv_session_save(const GmpvSession *session, GError **error)
+{
+	gboolean rc = TRUE;
+
+	if(session->playlist)
+	{
+		GVariant *playlist = serialize_playlist(session);
+
+		rc =	write_file
+			(	SESSION_FILENAME,
+				SESSION_MAGIC,
+				playlist,
+				&saved_playlist,
+				error );
+
+		if(rc)
+		{
+			g_free(saved_checksum);
+
+			saved_checksum = get_checksum(saved_playlist);
+		}
+
+		g_variant_unref(playlist);
+	}
+
+	/* Without a saved playlist, there is nothing to resume */
+	if(rc && saved_checksum)
+	{
+		GVariant *position = NULL;
+
+		position =	g_variant_ref_sink(g_variant_new
+				(	SESSION_POSITION_FORMAT,
+					saved_checksum,
+					session->position,
+					session->time_pos ));
+
+		rc =	write_file
+			(	SESSION_POSITION_FILENAME,
+				SESSION_POSITION_MAGIC,
+				position,
+				&saved_position,
+				error );
+
+		g_variant_unref(position);
+	}
+
+	return rc;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GmpvSession GmpvSession;
+
+/* State needed to bring the player back to where it was left. The playlist
+ * is created by gmpv_playlist_new(), with the titles and durations that
+ * were known when the session was saved. When saving, it may be NULL if it
+ * did not change since the last save, in which case only the position is
+ * saved.
+ */
+struct _GmpvSession
+{
+	GPtrArray *playlist;
+	gint64 position;
+	gdouble time_pos;
+};
+
+/* Sessions are stored as serialized GVariants, which are mapped and read in
+ * place when loading. The playlist and the position are kept in separate
+ * files, and saving only rewrites the ones that changed since they were
+ * last saved or loaded.
+ *
+ * gmpv_session_load() returns NULL without setting error if no session has
+ * been saved yet.
+ */
+GmpvSession *gmpv_session_new(	GPtrArray *playlist,
+				gint64 position,
+				gdouble time_pos );
+void gmpv_session_free(GmpvSession *session);
+GmpvSession *gmpv_session_load(GError **error);
+gboolean gmpv_session_save(const GmpvSession *session, GError **error);
+
+G_END_DECLS
+
+#endif
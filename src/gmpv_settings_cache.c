@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "gmpv_settings_cache.h"
+#include "gmpv_def.h"
+
+static GSettings *cache_settings = NULL;
+static GmpvSettingsCache cache = {0};
+
+static void changed_handler(	GSettings *settings,
+				const gchar *key,
+				gpointer data );
+
+static void changed_handler(	GSettings *settings,
+				const gchar *key,
+				gpointer data )
+{
+	g_debug("Setting %s changed; refreshing settings cache", key);
+	gmpv_settings_cache_refresh();
+}
+
+const GmpvSettingsCache *gmpv_settings_cache_get(void)
+{
+	if(!cache_settings)
+	{
+		cache_settings = g_settings_new(CONFIG_ROOT);
+
+		g_signal_connect(	cache_settings,
+					"changed",
+					G_CALLBACK(changed_handler),
+					NULL );
+
+		gmpv_settings_cache_refresh();
+	}
+
+	return &cache;
+}
+
+void gmpv_settings_cache_refresh(void)
+{
+	GSettings *settings = cache_settings;
+
+	if(!settings)
+	{
+		/* Populating the cache for the first time refreshes it */
+		gmpv_settings_cache_get();
+	}
+	else
+	{
+		g_free(cache.mpv_options);
+		g_free(cache.mpv_config_file);
+		g_free(cache.mpv_input_config_file);
+
+		cache.last_folder_enable
+			= g_settings_get_boolean(settings, "last-folder-enable");
+		cache.always_open_new_window
+			= g_settings_get_boolean(settings, "always-open-new-window");
+		cache.mpv_options
+			= g_settings_get_string(settings, "mpv-options");
+		cache.mpv_config_file
+			= g_settings_get_string(settings, "mpv-config-file");
+		cache.mpv_config_enable
+			= g_settings_get_boolean(settings, "mpv-config-enable");
+		cache.mpv_input_config_file
+			= g_settings_get_string(settings, "mpv-input-config-file");
+		cache.mpv_input_config_enable
+			= g_settings_get_boolean(settings, "mpv-input-config-enable");
+		cache.prefetch_metadata
+			= g_settings_get_boolean(settings, "prefetch-metadata");
+		cache.restore_session
+			= g_settings_get_boolean(settings, "restore-session");
+		cache.loudness_normalization
+			= g_settings_get_boolean(settings, "loudness-normalization");
+	}
+}
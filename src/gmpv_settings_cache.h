@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SETTINGS_CACHE_H
+#define SETTINGS_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GmpvSettingsCache GmpvSettingsCache;
+
+/* Snapshot of the keys in CONFIG_ROOT that are read on frequently used code
+ * paths. It is kept up to date using the "changed" signal, so reading it
+ * does not involve GSettings at all. Strings are owned by the snapshot and
+ * are only valid until the next refresh, so copy them if they need to be
+ * kept around. The snapshot must only be used from the main thread.
+ */
+struct _GmpvSettingsCache
+{
+	gboolean last_folder_enable;
+	gboolean always_open_new_window;
+	gchar *mpv_options;
+	gchar *mpv_config_file;
+	gboolean mpv_config_enable;
+	gchar *mpv_input_config_file;
+	gboolean mpv_input_config_enable;
+	gboolean prefetch_metadata;
+	gboolean restore_session;
+	gboolean loudness_normalization;
+};
+
+const GmpvSettingsCache *gmpv_settings_cache_get(void);
+void gmpv_settings_cache_refresh(void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "gmpv_uri_classifier.h"
+
+#define FNV_OFFSET G_GUINT64_CONSTANT(0xcbf29ce484222325)
+#define FNV_PRIME G_GUINT64_CONSTANT(0x100000001b3)
+
+typedef struct UriTableEntry UriTableEntry;
+
+struct UriTableEntry
+{
+	const gchar *key;
+	gsize length;
+	UriClass value;
+};
+
+/* Must be included after UriTableEntry is defined */
+#include "gmpv_uri_tables.h"
+
+static inline guint64 hash_char(guint64 hash, gchar c);
+static inline guint32 mix(guint32 value);
+static UriClass lookup(	const UriTableEntry *table,
+			const guint32 *seeds,
+			guint32 bucket_mask,
+			guint32 table_mask,
+			guint64 hash,
+			const gchar *key,
+			gsize length );
+
+static inline guint64 hash_char(guint64 hash, gchar c)
+{
+	return (hash^(guchar)g_ascii_tolower(c))*FNV_PRIME;
+}
+
+/* Must match mix() in generate_uri_tables.py */
+static inline guint32 mix(guint32 value)
+{
+	value ^= value >> 16;
+	value *= 0x85ebca6bu;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35u;
+	value ^= value >> 16;
+
+	return value;
+}
+
+static UriClass lookup(	const UriTableEntry *table,
+			const guint32 *seeds,
+			guint32 bucket_mask,
+			guint32 table_mask,
+			guint64 hash,
+			const gchar *key,
+			gsize length )
+{
+	guint32 seed = seeds[(guint32)(hash >> 32)&bucket_mask];
+	const UriTableEntry *entry = &table[mix((guint32)hash^seed)&table_mask];
+
+	/* Keys that are not in the table still land on some slot, so the
+	 * key stored there has to be compared.
+	 */
+	return	(entry->key &&
+		entry->length == length &&
+		g_ascii_strncasecmp(entry->key, key, length) == 0)?
+		entry->value:
+		URI_CLASS_UNSUPPORTED;
+}
+
+UriClass gmpv_uri_classify(const gchar *uri)
+{
+	guint64 scheme_hash = FNV_OFFSET;
+	guint64 ext_hash = FNV_OFFSET;
+	const gchar *ext = NULL;
+	gsize ext_length = 0;
+	gsize scheme_length = 0;
+	gboolean in_scheme = g_ascii_isalpha(uri[0]);
+	gboolean has_scheme = FALSE;
+	gboolean done = FALSE;
+	UriClass result = URI_CLASS_UNSUPPORTED;
+
+	for(const gchar *iter = uri; *iter && !done; iter++)
+	{
+		const gchar c = *iter;
+
+		if(in_scheme)
+		{
+			if(g_ascii_isalnum(c) || c == '+' || c == '-' || c == '.')
+			{
+				scheme_hash = hash_char(scheme_hash, c);
+				scheme_length++;
+			}
+			else
+			{
+				/* Single letters followed by a colon are
+				 * drive letters rather than schemes.
+				 */
+				has_scheme = (c == ':' && scheme_length > 1);
+				in_scheme = FALSE;
+			}
+		}
+
+		if(c == '.')
+		{
+			ext = iter + 1;
+			ext_hash = FNV_OFFSET;
+			ext_length = 0;
+		}
+		else if(c == '/' || c == '\\')
+		{
+			ext = NULL;
+		}
+		else if(has_scheme && (c == '?' || c == '#'))
+		{
+			done = TRUE;
+		}
+		else if(ext)
+		{
+			ext_hash = hash_char(ext_hash, c);
+			ext_length++;
+		}
+	}
+
+	if(ext && ext_length > 0)
+	{
+		result = lookup(	extension_table,
+					extension_seeds,
+					EXTENSION_BUCKET_MASK,
+					EXTENSION_TABLE_MASK,
+					ext_hash,
+					ext,
+					ext_length );
+	}
+
+	if(result == URI_CLASS_UNSUPPORTED)
+	{
+		result =	has_scheme?
+				lookup(	protocol_table,
+					protocol_seeds,
+					PROTOCOL_BUCKET_MASK,
+					PROTOCOL_TABLE_MASK,
+					scheme_hash,
+					uri,
+					scheme_length ):
+				URI_CLASS_MEDIA;
+	}
+
+	return result;
+}
+
+gboolean gmpv_uri_is_supported_mime_type(const gchar *mime_type)
+{
+	guint64 hash = FNV_OFFSET;
+	gsize length = 0;
+
+	for(const gchar *iter = mime_type; *iter; iter++)
+	{
+		hash = hash_char(hash, *iter);
+		length++;
+	}
+
+	return lookup(	mime_type_table,
+			mime_type_seeds,
+			MIME_TYPE_BUCKET_MASK,
+			MIME_TYPE_TABLE_MASK,
+			hash,
+			mime_type,
+			length ) != URI_CLASS_UNSUPPORTED;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef URI_CLASSIFIER_H
+#define URI_CLASSIFIER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum UriClass UriClass;
+
+enum UriClass
+{
+	URI_CLASS_UNSUPPORTED,
+	URI_CLASS_MEDIA,
+	URI_CLASS_SUBTITLE,
+	URI_CLASS_AUDIO_TRACK,
+	URI_CLASS_PLAYLIST,
+	URI_CLASS_N
+};
+
+/* Classifies uri by its extension and, failing that, by its scheme, using
+ * perfect hash tables generated at build time from the lists in
+ * gmpv_def.h. The string is only read once and nothing is allocated.
+ * Extensions and schemes are compared case-insensitively. Paths without a
+ * scheme are assumed to be local media files.
+ */
+UriClass gmpv_uri_classify(const gchar *uri);
+gboolean gmpv_uri_is_supported_mime_type(const gchar *mime_type);
+
+G_END_DECLS
+
+#endif
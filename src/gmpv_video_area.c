@@ -47,6 +47,8 @@ struct _GmpvVideoArea
 	GtkWidget *header_bar;
 	GtkWidget *control_box_revealer;
 	GtkWidget *header_bar_revealer;
+	GdkCursor *default_cursor;
+	GdkCursor *blank_cursor;
 	guint timeout_tag;
 	gboolean fullscreen;
 	gboolean fs_control_hover;
@@ -126,28 +128,46 @@ static void destroy(GtkWidget *widget)
 		g_source_remove(area->timeout_tag);
 		area->timeout_tag = 0;
 	}
+
+	g_clear_object(&area->default_cursor);
+	g_clear_object(&area->blank_cursor);
 }
 
 static void set_cursor_visible(GmpvVideoArea *area, gboolean visible)
 {
-	GdkWindow *window;
-	GdkCursor *cursor;
-
-	window = gtk_widget_get_window(GTK_WIDGET(area));
+	GdkWindow *window = gtk_widget_get_window(GTK_WIDGET(area));
+	GdkCursor *cursor = NULL;
 
+	/* This is called on every motion event, so the cursors are only
+	 * created once and only set when they change.
+	 */
 	if(visible)
 	{
-		cursor =	gdk_cursor_new_from_name
-				(gdk_display_get_default(), "default");
+		if(!area->default_cursor)
+		{
+			area->default_cursor =	gdk_cursor_new_from_name
+						(gdk_display_get_default(),
+						"default");
+		}
+
+		cursor = area->default_cursor;
 	}
 	else
 	{
-		cursor =	gdk_cursor_new_for_display
-				(gdk_display_get_default(), GDK_BLANK_CURSOR);
+		if(!area->blank_cursor)
+		{
+			area->blank_cursor =	gdk_cursor_new_for_display
+						(gdk_display_get_default(),
+						GDK_BLANK_CURSOR);
+		}
+
+		cursor = area->blank_cursor;
 	}
 
-	gdk_window_set_cursor(window, cursor);
-	g_object_unref(cursor);
+	if(window && gdk_window_get_cursor(window) != cursor)
+	{
+		gdk_window_set_cursor(window, cursor);
+	}
 }
 
 static gboolean timeout_handler(gpointer data)
@@ -185,10 +205,8 @@ static gboolean timeout_handler(gpointer data)
 static gboolean motion_notify_event(GtkWidget *widget, GdkEventMotion *event)
 {
 	GmpvVideoArea *area = GMPV_VIDEO_AREA(widget);
-	GdkCursor *cursor;
 
-	cursor = gdk_cursor_new_from_name(gdk_display_get_default(), "default");
-	gdk_window_set_cursor(gtk_widget_get_window(widget), cursor);
+	set_cursor_visible(area, TRUE);
 
 	if(area->control_box)
 	{
@@ -303,6 +321,8 @@ static void gmpv_video_area_init(GmpvVideoArea *area)
 	area->header_bar = gmpv_header_bar_new();
 	area->control_box_revealer = gtk_revealer_new();
 	area->header_bar_revealer = gtk_revealer_new();
+	area->default_cursor = NULL;
+	area->blank_cursor = NULL;
 	area->timeout_tag = 0;
 	area->fullscreen = FALSE;
 	area->fs_control_hover = FALSE;
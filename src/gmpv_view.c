@@ -22,6 +22,7 @@
 #include "gmpv_view.h"
 #include "gmpv_file_chooser.h"
 #include "gmpv_open_location_dialog.h"
+#include "gmpv_playlist_export.h"
 #include "gmpv_preferences_dialog.h"
 #include "gmpv_shortcuts_window.h"
 #include "gmpv_authors.h"
@@ -43,9 +44,21 @@ enum
 	PROP_TRACK_LIST,
 	PROP_CHAPTERS_ENABLED,
 	PROP_FULLSCREEN,
+	PROP_WINDOW_VISIBLE,
 	N_PROPERTIES
 };
 
+typedef struct ExportContext ExportContext;
+
+struct ExportContext
+{
+	GmpvView *view;
+	GCancellable *cancellable;
+	GtkWidget *dialog;
+	GtkWidget *progress_bar;
+	guint dialog_source_id;
+};
+
 struct _GmpvView
 {
 	GObject parent;
@@ -62,6 +75,11 @@ struct _GmpvView
 	gboolean chapters_enabled;
 	gboolean control_box_enabled;
 	gboolean fullscreen;
+	gboolean window_visible;
+	gboolean iconified;
+	gboolean render_stalled;
+	gint64 render_queued_time;
+	ExportContext *export_context;
 };
 
 struct _GmpvViewClass
@@ -83,7 +101,15 @@ static void get_property(	GObject *object,
 static void dispose(GObject * object);
 static void finalize(GObject * object);
 static void load_css(GmpvView *view);
-static void save_playlist(GmpvView *view, GFile *file, GError **error);
+static void save_playlist(GmpvView *view, GFile *file);
+static gboolean show_export_dialog(gpointer data);
+static void export_progress_handler(guint written, guint total, gpointer data);
+static void export_dialog_response_handler(	GtkDialog *dialog,
+						gint response_id,
+						gpointer data );
+static void export_ready_handler(	GObject *source_object,
+					GAsyncResult *result,
+					gpointer data );
 static void show_message_dialog(	GmpvMainWindow *wnd,
 					GtkMessageType type,
 					const gchar *title,
@@ -146,6 +172,7 @@ static void drag_data_handler(	GtkWidget *widget,
 static gboolean window_state_handler(	GtkWidget *widget,
 					GdkEvent *event,
 					gpointer data );
+static void update_window_visible(GmpvView *view);
 static void grab_handler(GtkWidget *widget, gboolean was_grabbed, gpointer data);
 static gboolean delete_handler(	GtkWidget *widget,
 				GdkEvent *event,
@@ -159,8 +186,11 @@ static void playlist_row_inserted_handler(	GmpvPlaylistWidget *widget,
 static void playlist_row_deleted_handler(	GmpvPlaylistWidget *widget,
 						gint pos,
 						gpointer data );
-static void playlist_row_reordered_handler(	GmpvPlaylistWidget *widget,
-						gint src,
+static void playlist_rows_deleted_handler(	GmpvPlaylistWidget *widget,
+						GArray *indices,
+						gpointer data );
+static void playlist_rows_moved_handler(	GmpvPlaylistWidget *widget,
+						GArray *indices,
 						gint dest,
 						gpointer data );
 
@@ -289,8 +319,12 @@ static void constructed(GObject *object)
 				G_CALLBACK(playlist_row_deleted_handler),
 				view );
 	g_signal_connect(	playlist,
-				"rows-reordered",
-				G_CALLBACK(playlist_row_reordered_handler),
+				"rows-deleted",
+				G_CALLBACK(playlist_rows_deleted_handler),
+				view );
+	g_signal_connect(	playlist,
+				"rows-moved",
+				G_CALLBACK(playlist_rows_moved_handler),
 				view );
 
 	G_OBJECT_CLASS(gmpv_view_parent_class)->constructed(object);
@@ -366,6 +400,10 @@ static void set_property(	GObject *object,
 		gmpv_main_window_set_fullscreen(self->wnd, self->fullscreen);
 		break;
 
+		case PROP_WINDOW_VISIBLE:
+		self->window_visible = g_value_get_boolean(value);
+		break;
+
 		default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
@@ -421,6 +459,10 @@ static void get_property(	GObject *object,
 		g_value_set_boolean(value, self->fullscreen);
 		break;
 
+		case PROP_WINDOW_VISIBLE:
+		g_value_set_boolean(value, self->window_visible);
+		break;
+
 		default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
@@ -431,6 +473,14 @@ static void dispose(GObject *object)
 {
 	GmpvView *view = GMPV_VIEW(object);
 
+	if(view->export_context)
+	{
+		/* The context is freed when the export finishes */
+		g_cancellable_cancel(view->export_context->cancellable);
+		view->export_context->view = NULL;
+		view->export_context = NULL;
+	}
+
 	if(view->wnd)
 	{
 		gtk_widget_destroy(GTK_WIDGET(view->wnd));
@@ -471,47 +521,150 @@ static void load_css(GmpvView *view)
 	g_object_unref(style_provider);
 }
 
-static void save_playlist(GmpvView *view, GFile *file, GError **error)
+static void save_playlist(GmpvView *view, GFile *file)
 {
 	GmpvPlaylistWidget *wgt = gmpv_main_window_get_playlist(view->wnd);
 	GPtrArray *playlist = gmpv_playlist_widget_get_contents(wgt);
-	gboolean rc = TRUE;
-	GOutputStream *dest_stream = NULL;
+	GmpvMetadataCache *cache = gmpv_metadata_cache_get_default();
+	ExportContext *ctx = g_new0(ExportContext, 1);
 
-	if(file)
+	if(view->export_context)
 	{
-		GFileOutputStream *file_stream;
+		g_cancellable_cancel(view->export_context->cancellable);
+		view->export_context->view = NULL;
+	}
 
-		file_stream = g_file_replace(	file,
-						NULL,
-						FALSE,
-						G_FILE_CREATE_NONE,
-						NULL,
-						error );
-		dest_stream = G_OUTPUT_STREAM(file_stream);
-		rc = !!dest_stream;
+	ctx->view = view;
+	ctx->cancellable = g_cancellable_new();
+	ctx->dialog = NULL;
+	ctx->progress_bar = NULL;
+
+	/* Only show the progress dialog if saving takes long enough to be
+	 * noticeable.
+	 */
+	ctx->dialog_source_id =	g_timeout_add
+				(	PLAYLIST_EXPORT_DIALOG_DELAY,
+					show_export_dialog,
+					ctx );
+	view->export_context = ctx;
+
+	gmpv_playlist_export_async
+		(	file,
+			playlist,
+			cache,
+			gmpv_playlist_export_format_from_file(file),
+			ctx->cancellable,
+			export_progress_handler,
+			ctx,
+			export_ready_handler,
+			ctx );
+
+	g_object_unref(cache);
+	g_ptr_array_unref(playlist);
+}
+
+static gboolean show_export_dialog(gpointer data)
+{
+	ExportContext *ctx = data;
+	GtkWidget *msg_area = NULL;
+
+	ctx->dialog_source_id = 0;
+
+	if(ctx->view)
+	{
+		ctx->dialog =	gtk_message_dialog_new
+				(	GTK_WINDOW(ctx->view->wnd),
+					GTK_DIALOG_DESTROY_WITH_PARENT,
+					GTK_MESSAGE_OTHER,
+					GTK_BUTTONS_CANCEL,
+					"%s",
+					_("Saving playlist…") );
+		ctx->progress_bar = gtk_progress_bar_new();
+		msg_area =	gtk_message_dialog_get_message_area
+				(GTK_MESSAGE_DIALOG(ctx->dialog));
+
+		gtk_box_pack_start
+			(GTK_BOX(msg_area), ctx->progress_bar, FALSE, FALSE, 0);
+
+		/* The dialog may be destroyed together with the main window
+		 * before the export finishes.
+		 */
+		g_signal_connect(	ctx->dialog,
+					"destroy",
+					G_CALLBACK(gtk_widget_destroyed),
+					&ctx->dialog );
+		g_signal_connect(	ctx->dialog,
+					"response",
+					G_CALLBACK(export_dialog_response_handler),
+					ctx );
+
+		gtk_window_set_title(GTK_WINDOW(ctx->dialog), _("Save Playlist"));
+		gtk_widget_show_all(ctx->dialog);
 	}
 
-	for(guint i = 0; rc && i < playlist->len; i++)
+	return FALSE;
+}
+
+static void export_progress_handler(guint written, guint total, gpointer data)
+{
+	ExportContext *ctx = data;
+
+	if(ctx->dialog)
 	{
-		gsize written;
+		gtk_progress_bar_set_fraction
+			(	GTK_PROGRESS_BAR(ctx->progress_bar),
+				(gdouble)written/total );
+	}
+}
 
-		GmpvPlaylistEntry *entry = g_ptr_array_index(playlist, i);
+static void export_dialog_response_handler(	GtkDialog *dialog,
+						gint response_id,
+						gpointer data )
+{
+	ExportContext *ctx = data;
 
-		rc = g_output_stream_printf(	dest_stream,
-						&written,
-						NULL,
-						NULL,
-						"%s\n",
-						entry->filename);
+	g_cancellable_cancel(ctx->cancellable);
+	gtk_widget_set_sensitive(GTK_WIDGET(dialog), FALSE);
+}
+
+static void export_ready_handler(	GObject *source_object,
+					GAsyncResult *result,
+					gpointer data )
+{
+	ExportContext *ctx = data;
+	GError *error = NULL;
+
+	gmpv_playlist_export_finish(result, &error);
+
+	if(	ctx->view &&
+		error &&
+		!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED) )
+	{
+		show_message_dialog(	ctx->view->wnd,
+					GTK_MESSAGE_ERROR,
+					_("Error"),
+					NULL,
+					error->message );
 	}
 
-	if(dest_stream)
+	if(ctx->view)
 	{
-		g_output_stream_close(dest_stream, NULL, error);
+		ctx->view->export_context = NULL;
 	}
 
-	g_ptr_array_free(playlist, TRUE);
+	if(ctx->dialog_source_id > 0)
+	{
+		g_source_remove(ctx->dialog_source_id);
+	}
+
+	if(ctx->dialog)
+	{
+		gtk_widget_destroy(ctx->dialog);
+	}
+
+	g_clear_error(&error);
+	g_object_unref(ctx->cancellable);
+	g_free(ctx);
 }
 
 void show_message_dialog(	GmpvMainWindow *wnd,
@@ -767,6 +920,16 @@ static void scroll_handler(	GmpvMainWindow *wnd,
 
 static void render_handler(GmpvVideoArea *area, gpointer data)
 {
+	GmpvView *view = data;
+
+	view->render_queued_time = 0;
+
+	if(view->render_stalled)
+	{
+		view->render_stalled = FALSE;
+		update_window_visible(view);
+	}
+
 	g_signal_emit_by_name(data, "render");
 }
 
@@ -856,9 +1019,29 @@ static gboolean window_state_handler(	GtkWidget *widget,
 		g_object_notify(data, "fullscreen");
 	}
 
+	if(state->changed_mask&(GDK_WINDOW_STATE_ICONIFIED|GDK_WINDOW_STATE_WITHDRAWN))
+	{
+		view->iconified =	state->new_window_state&
+					(	GDK_WINDOW_STATE_ICONIFIED|
+						GDK_WINDOW_STATE_WITHDRAWN );
+
+		update_window_visible(view);
+	}
+
 	return FALSE;
 }
 
+static void update_window_visible(GmpvView *view)
+{
+	gboolean visible = !view->iconified && !view->render_stalled;
+
+	if(visible != view->window_visible)
+	{
+		g_debug("Window is now %s", visible?"visible":"hidden");
+		g_object_set(view, "window-visible", visible, NULL);
+	}
+}
+
 static void grab_handler(GtkWidget *widget, gboolean was_grabbed, gpointer data)
 {
 	g_signal_emit_by_name(data, "grab-notify", was_grabbed);
@@ -904,12 +1087,24 @@ static void playlist_row_deleted_handler(	GmpvPlaylistWidget *widget,
 	g_signal_emit_by_name(data, "playlist-item-deleted", pos);
 }
 
-static void playlist_row_reordered_handler(	GmpvPlaylistWidget *widget,
-						gint src,
+static void playlist_rows_deleted_handler(	GmpvPlaylistWidget *widget,
+						GArray *indices,
+						gpointer data )
+{
+	if(gmpv_playlist_widget_empty(widget))
+	{
+		gmpv_view_reset(data);
+	}
+
+	g_signal_emit_by_name(data, "playlist-items-deleted", indices);
+}
+
+static void playlist_rows_moved_handler(	GmpvPlaylistWidget *widget,
+						GArray *indices,
 						gint dest,
 						gpointer data )
 {
-	g_signal_emit_by_name(data, "playlist-reordered", src, dest);
+	g_signal_emit_by_name(data, "playlist-items-moved", indices, dest);
 }
 
 static void gmpv_view_class_init(GmpvViewClass *klass)
@@ -1009,6 +1204,14 @@ static void gmpv_view_class_init(GmpvViewClass *klass)
 			G_PARAM_READWRITE );
 	g_object_class_install_property(object_class, PROP_FULLSCREEN, pspec);
 
+	pspec = g_param_spec_boolean
+		(	"window-visible",
+			"Window visible",
+			"Whether or not the content of the window can be seen",
+			TRUE,
+			G_PARAM_READWRITE );
+	g_object_class_install_property(object_class, PROP_WINDOW_VISIBLE, pspec);
+
 	/* Controls-related signals */
 	g_signal_new(	"button-clicked",
 			G_TYPE_FROM_CLASS(klass),
@@ -1209,16 +1412,26 @@ static void gmpv_view_class_init(GmpvViewClass *klass)
 			G_TYPE_NONE,
 			1,
 			G_TYPE_INT );
-	g_signal_new(	"playlist-reordered",
+	g_signal_new(	"playlist-items-deleted",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__BOXED,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_ARRAY );
+	g_signal_new(	"playlist-items-moved",
 			G_TYPE_FROM_CLASS(klass),
 			G_SIGNAL_RUN_FIRST,
 			0,
 			NULL,
 			NULL,
-			g_cclosure_gen_marshal_VOID__INT_INT,
+			g_cclosure_gen_marshal_VOID__BOXED_INT,
 			G_TYPE_NONE,
 			2,
-			G_TYPE_INT,
+			G_TYPE_ARRAY,
 			G_TYPE_INT );
 }
 
@@ -1233,6 +1446,11 @@ static void gmpv_view_init(GmpvView *view)
 	view->playlist_pos = 0;
 	view->chapters_enabled = FALSE;
 	view->fullscreen = FALSE;
+	view->window_visible = TRUE;
+	view->iconified = FALSE;
+	view->render_stalled = FALSE;
+	view->render_queued_time = 0;
+	view->export_context = NULL;
 }
 
 GmpvView *gmpv_view_new(GmpvApplication *app, gboolean always_floating)
@@ -1367,7 +1585,6 @@ void gmpv_view_show_save_playlist_dialog(GmpvView *view)
 	GFile *dest_file;
 	GmpvFileChooser *file_chooser;
 	GtkFileChooser *gtk_chooser;
-	GError *error;
 
 	dest_file = NULL;
 	file_chooser =	gmpv_file_chooser_new
@@ -1375,7 +1592,6 @@ void gmpv_view_show_save_playlist_dialog(GmpvView *view)
 				GTK_WINDOW(view->wnd),
 				GTK_FILE_CHOOSER_ACTION_SAVE );
 	gtk_chooser = GTK_FILE_CHOOSER(file_chooser);
-	error = NULL;
 
 	gtk_file_chooser_set_current_name(gtk_chooser, "playlist.m3u");
 
@@ -1389,20 +1605,9 @@ void gmpv_view_show_save_playlist_dialog(GmpvView *view)
 
 	if(dest_file)
 	{
-		save_playlist(view, dest_file, &error);
+		save_playlist(view, dest_file);
 		g_object_unref(dest_file);
 	}
-
-	if(error)
-	{
-		show_message_dialog(	view->wnd,
-					GTK_MESSAGE_ERROR,
-					_("Error"),
-					NULL,
-					error->message );
-
-		g_error_free(error);
-	}
 }
 
 void gmpv_view_show_preferences_dialog(GmpvView *view)
@@ -1477,6 +1682,22 @@ void gmpv_view_reset(GmpvView *view)
 void gmpv_view_queue_render(GmpvView *view)
 {
 	GmpvVideoArea *area = gmpv_main_window_get_video_area(view->wnd);
+	gint64 now = g_get_monotonic_time();
+
+	/* The frame clock stops ticking when the compositor decides that the
+	 * window can't be seen, so frames that stay queued for too long mean
+	 * that the video area is hidden even if the window is not iconified.
+	 */
+	if(view->render_queued_time == 0)
+	{
+		view->render_queued_time = now;
+	}
+	else if(	!view->render_stalled &&
+			now-view->render_queued_time > RENDER_STALL_TIMEOUT*1000 )
+	{
+		view->render_stalled = TRUE;
+		update_window_visible(view);
+	}
 
 	gmpv_video_area_queue_render(area);
 }
@@ -1574,6 +1795,14 @@ void gmpv_view_set_time_position(GmpvView *view, gdouble position)
 	g_object_set(control_box, "time-position", position, NULL);
 }
 
+void gmpv_view_set_waveform(GmpvView *view, GBytes *waveform)
+{
+	GmpvControlBox *control_box;
+
+	control_box = gmpv_main_window_get_control_box(view->wnd);
+	gmpv_control_box_set_seek_bar_waveform(control_box, waveform);
+}
+
 void gmpv_view_update_playlist(GmpvView *view, GPtrArray *playlist)
 {
 	GmpvPlaylistWidget *wgt = gmpv_main_window_get_playlist(view->wnd);
@@ -1581,6 +1810,17 @@ void gmpv_view_update_playlist(GmpvView *view, GPtrArray *playlist)
 	gmpv_playlist_widget_update_contents(wgt, playlist);
 }
 
+void gmpv_view_set_playlist_duration(	GmpvView *view,
+					gdouble duration,
+					gdouble position,
+					gboolean complete )
+{
+	GmpvPlaylistWidget *wgt = gmpv_main_window_get_playlist(view->wnd);
+
+	gmpv_playlist_widget_set_duration
+		(wgt, duration, MAX(0, duration-position), complete);
+}
+
 void gmpv_view_set_playlist_pos(GmpvView *view, gint64 pos)
 {
 	g_object_set(view, "playlist-pos", pos, NULL);
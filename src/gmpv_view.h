@@ -61,7 +61,12 @@ void gmpv_view_move(	GmpvView *view,
 void gmpv_view_resize_video_area(GmpvView *view, gint width, gint height);
 void gmpv_view_set_fullscreen(GmpvView *view, gboolean fullscreen);
 void gmpv_view_set_time_position(GmpvView *view, gdouble position);
+void gmpv_view_set_waveform(GmpvView *view, GBytes *waveform);
 void gmpv_view_update_playlist(GmpvView *view, GPtrArray *playlist);
+void gmpv_view_set_playlist_duration(	GmpvView *view,
+					gdouble duration,
+					gdouble position,
+					gboolean complete );
 void gmpv_view_set_playlist_pos(GmpvView *view, gint64 pos);
 void gmpv_view_set_playlist_visible(GmpvView *view, gboolean visible);
 gboolean gmpv_view_get_playlist_visible(GmpvView *view);
@@ -0,0 +1,638 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "gmpv_waveform_service.h"
+#include "gmpv_fingerprint_service.h"
+#include "gmpv_mpv.h"
+#include "gmpv_mpv_wrapper.h"
+#include "gmpv_def.h"
+
+/* Cache files start with WAVEFORM_CACHE_MAGIC, followed by the minimum and
+ * maximum of every bucket.
+ */
+#define WAVEFORM_CACHE_MAGIC "GMPVWAV1"
+#define WAVEFORM_CACHE_MAGIC_SIZE (sizeof(WAVEFORM_CACHE_MAGIC) - 1)
+#define WAVEFORM_PEAKS_SIZE (2*WAVEFORM_BUCKET_COUNT)
+#define WAVEFORM_PIPE_NAME "pcm"
+
+typedef struct WaveformJob WaveformJob;
+
+/* Everything but cancelled and peaks belongs to the main thread. The worker
+ * thread only sets peaks, and hands the job back to the main thread once it
+ * is done with it.
+ */
+struct WaveformJob
+{
+	GmpvWaveformService *service;
+	gchar *uri;
+	gchar *fingerprint;
+	gchar *dir;
+	gchar *pipe_path;
+	gint read_fd;
+	gint keepalive_fd;
+	GmpvMpv *decoder;
+	gint cancelled;
+	GBytes *peaks;
+};
+
+struct _GmpvWaveformService
+{
+	GObject parent;
+	gchar *cache_dir;
+	GHashTable *waveforms;
+	gchar *current_uri;
+	GmpvFingerprintService *fingerprint_service;
+	WaveformJob *job;
+};
+
+struct _GmpvWaveformServiceClass
+{
+	GObjectClass parent_class;
+};
+
+static GmpvWaveformService *default_service = NULL;
+
+static void dispose(GObject *object);
+static void finalize(GObject *object);
+static void fingerprint_ready_handler(	GmpvFingerprintService *fingerprint_service,
+					const gchar *uri,
+					gpointer data );
+static void shutdown_handler(GmpvMpv *mpv, gpointer data);
+static GBytes *load_cache(GmpvWaveformService *service, const gchar *fingerprint);
+static void save_cache(	GmpvWaveformService *service,
+			const gchar *fingerprint,
+			GBytes *peaks );
+static void set_waveform(	GmpvWaveformService *service,
+				const gchar *uri,
+				const gchar *fingerprint,
+				GBytes *peaks );
+static void stop_decoder(WaveformJob *job);
+static void free_job(WaveformJob *job);
+static void cancel_job(GmpvWaveformService *service);
+static GBytes *make_peaks(const gint8 *blocks, guint count);
+#ifdef G_OS_UNIX
+static gpointer decode_thread(gpointer data);
+#endif
+static gboolean job_done_handler(gpointer data);
+static void start_job(	GmpvWaveformService *service,
+			const gchar *uri,
+			const gchar *fingerprint );
+static void process(	GmpvWaveformService *service,
+			const gchar *uri,
+			const gchar *fingerprint );
+
+G_DEFINE_TYPE(GmpvWaveformService, gmpv_waveform_service, G_TYPE_OBJECT)
+
+static void dispose(GObject *object)
+{
+	GmpvWaveformService *service = GMPV_WAVEFORM_SERVICE(object);
+
+	cancel_job(service);
+
+	if(service->fingerprint_service)
+	{
+		g_signal_handlers_disconnect_by_data
+			(service->fingerprint_service, service);
+		g_clear_object(&service->fingerprint_service);
+	}
+
+	G_OBJECT_CLASS(gmpv_waveform_service_parent_class)->dispose(object);
+}
+
+static void finalize(GObject *object)
+{
+	GmpvWaveformService *service = GMPV_WAVEFORM_SERVICE(object);
+
+	g_hash_table_unref(service->waveforms);
+	g_free(service->current_uri);
+	g_free(service->cache_dir);
+
+	G_OBJECT_CLASS(gmpv_waveform_service_parent_class)->finalize(object);
+}
+
+static void fingerprint_ready_handler(	GmpvFingerprintService *fingerprint_service,
+					const gchar *uri,
+					gpointer data )
+{
+	GmpvWaveformService *service = data;
+
+	if(g_strcmp0(uri, service->current_uri) == 0)
+	{
+		const gchar *fingerprint =	gmpv_fingerprint_service_lookup
+						(fingerprint_service, uri);
+
+		if(fingerprint)
+		{
+			process(service, uri, fingerprint);
+		}
+	}
+}
+
+/* mpv does not open the pipe anymore once it is shutting down, so closing
+ * the write end kept by the job lets the worker thread see the end of the
+ * stream as soon as mpv closes its own.
+ */
+static void shutdown_handler(GmpvMpv *mpv, gpointer data)
+{
+	WaveformJob *job = data;
+
+	stop_decoder(job);
+}
+
+static GBytes *load_cache(GmpvWaveformService *service, const gchar *fingerprint)
+{
+	gchar *path = g_build_filename(service->cache_dir, fingerprint, NULL);
+	gchar *contents = NULL;
+	gsize size = 0;
+	GBytes *peaks = NULL;
+
+	if(	g_file_get_contents(path, &contents, &size, NULL) &&
+		size == WAVEFORM_CACHE_MAGIC_SIZE+WAVEFORM_PEAKS_SIZE &&
+		memcmp(	contents,
+			WAVEFORM_CACHE_MAGIC,
+			WAVEFORM_CACHE_MAGIC_SIZE ) == 0 )
+	{
+		peaks =	g_bytes_new
+			(	contents+WAVEFORM_CACHE_MAGIC_SIZE,
+				WAVEFORM_PEAKS_SIZE );
+	}
+
+	g_free(contents);
+	g_free(path);
+
+	return peaks;
+}
+
+static void save_cache(	GmpvWaveformService *service,
+			const gchar *fingerprint,
+			GBytes *peaks )
+{
+	gchar *path = g_build_filename(service->cache_dir, fingerprint, NULL);
+	GString *buf = g_string_new(WAVEFORM_CACHE_MAGIC);
+	gsize size = 0;
+	const gchar *data = g_bytes_get_data(peaks, &size);
+	GError *error = NULL;
+
+	g_string_append_len(buf, data, (gssize)size);
+	g_mkdir_with_parents(service->cache_dir, 0755);
+
+	if(!g_file_set_contents(path, buf->str, (gssize)buf->len, &error))
+	{
+		g_warning(	"Failed to save waveform cache %s: %s",
+				path,
+				error->message );
+
+		g_error_free(error);
+	}
+
+	g_string_free(buf, TRUE);
+	g_free(path);
+}
+
+static void set_waveform(	GmpvWaveformService *service,
+				const gchar *uri,
+				const gchar *fingerprint,
+				GBytes *peaks )
+{
+	g_hash_table_replace
+		(service->waveforms, g_strdup(fingerprint), g_bytes_ref(peaks));
+	g_signal_emit_by_name(service, "ready", uri);
+}
+
+static void stop_decoder(WaveformJob *job)
+{
+	if(job->decoder)
+	{
+		g_signal_handlers_disconnect_by_data(job->decoder, job);
+		g_clear_object(&job->decoder);
+	}
+
+	if(job->keepalive_fd >= 0)
+	{
+		g_close(job->keepalive_fd, NULL);
+		job->keepalive_fd = -1;
+	}
+}
+
+static void free_job(WaveformJob *job)
+{
+	stop_decoder(job);
+
+	if(job->read_fd >= 0)
+	{
+		g_close(job->read_fd, NULL);
+	}
+
+	if(job->peaks)
+	{
+		g_bytes_unref(job->peaks);
+	}
+
+	if(job->dir)
+	{
+		g_unlink(job->pipe_path);
+		g_rmdir(job->dir);
+	}
+
+	g_free(job->pipe_path);
+	g_free(job->dir);
+	g_free(job->fingerprint);
+	g_free(job->uri);
+	g_free(job);
+}
+
+/* The decoder is asked to quit rather than destroyed, so that the last
+ * writer of the pipe is only closed once mpv can no longer open it. The
+ * worker thread keeps reading until then, so mpv never blocks on a full
+ * pipe, and the job is freed once it is done.
+ */
+static void cancel_job(GmpvWaveformService *service)
+{
+	WaveformJob *job = service->job;
+
+	if(job)
+	{
+		g_atomic_int_set(&job->cancelled, TRUE);
+
+		if(job->decoder)
+		{
+			gmpv_mpv_command_string(job->decoder, "quit");
+		}
+
+		job->service = NULL;
+		service->job = NULL;
+	}
+}
+
+static GBytes *make_peaks(const gint8 *blocks, guint count)
+{
+	gint8 *peaks = g_malloc(WAVEFORM_PEAKS_SIZE);
+
+	for(guint i = 0; i < WAVEFORM_BUCKET_COUNT; i++)
+	{
+		guint start = (guint)((guint64)i*count/WAVEFORM_BUCKET_COUNT);
+		guint end = (guint)((guint64)(i+1)*count/WAVEFORM_BUCKET_COUNT);
+		gint min = G_MAXINT8;
+		gint max = G_MININT8;
+
+		/* Files shorter than the number of buckets repeat blocks */
+		end = MAX(end, start+1);
+
+		for(guint j = start; j < end; j++)
+		{
+			min = MIN(min, blocks[2*j]);
+			max = MAX(max, blocks[2*j+1]);
+		}
+
+		peaks[2*i] = (gint8)min;
+		peaks[2*i+1] = (gint8)max;
+	}
+
+	return g_bytes_new_take(peaks, WAVEFORM_PEAKS_SIZE);
+}
+
+#ifdef G_OS_UNIX
+static gpointer decode_thread(gpointer data)
+{
+	WaveformJob *job = data;
+	GArray *blocks = g_array_new(FALSE, FALSE, sizeof(gint8));
+	guint8 *buf = g_malloc(WAVEFORM_READ_SIZE);
+	gsize fill = 0;
+	gint min = G_MAXINT16;
+	gint max = G_MININT16;
+	guint samples = 0;
+	gssize count = 0;
+
+	/* Samples are native signed 16-bit integers. The pipe gives no
+	 * guarantee that reads end on a sample boundary, so an odd byte is
+	 * carried over to the next read.
+	 */
+	while((count = read(	job->read_fd,
+				buf+fill,
+				WAVEFORM_READ_SIZE-fill )) != 0)
+	{
+		gsize i = 0;
+
+		if(count < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		fill += (gsize)count;
+
+		for(i = 0; i+1 < fill; i += 2)
+		{
+			gint16 sample = 0;
+
+			memcpy(&sample, buf+i, sizeof(sample));
+
+			min = MIN(min, sample);
+			max = MAX(max, sample);
+
+			if(++samples == WAVEFORM_BLOCK_SIZE)
+			{
+				gint8 block[] = {(gint8)(min/256), (gint8)(max/256)};
+
+				g_array_append_vals(blocks, block, 2);
+
+				min = G_MAXINT16;
+				max = G_MININT16;
+				samples = 0;
+			}
+		}
+
+		if(i < fill)
+		{
+			buf[0] = buf[i];
+		}
+
+		fill -= i;
+	}
+
+	close(job->read_fd);
+	job->read_fd = -1;
+
+	if(!g_atomic_int_get(&job->cancelled) && blocks->len > 0)
+	{
+		job->peaks =	make_peaks
+				((gint8 *)blocks->data, blocks->len/2);
+	}
+
+	g_array_free(blocks, TRUE);
+	g_free(buf);
+
+	g_main_context_invoke_full(	NULL,
+					G_PRIORITY_DEFAULT_IDLE,
+					job_done_handler,
+					job,
+					NULL );
+
+	return NULL;
+}
+#endif
+
+static gboolean job_done_handler(gpointer data)
+{
+	WaveformJob *job = data;
+	GmpvWaveformService *service = job->service;
+
+	if(service && !g_atomic_int_get(&job->cancelled))
+	{
+		service->job = NULL;
+
+		if(job->peaks)
+		{
+			g_debug("Built waveform of %s", job->uri);
+
+			save_cache(service, job->fingerprint, job->peaks);
+			set_waveform(	service,
+					job->uri,
+					job->fingerprint,
+					job->peaks );
+		}
+		else
+		{
+			g_debug("Failed to build waveform of %s", job->uri);
+		}
+	}
+
+	free_job(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* The samples are read from a named pipe, so waveforms are only built where
+ * there are named pipes. Elsewhere, the seek bar simply has no waveform.
+ */
+static void start_job(	GmpvWaveformService *service,
+			const gchar *uri,
+			const gchar *fingerprint )
+{
+#ifdef G_OS_UNIX
+	WaveformJob *job = g_new0(WaveformJob, 1);
+	GError *error = NULL;
+
+	job->service = service;
+	job->uri = g_strdup(uri);
+	job->fingerprint = g_strdup(fingerprint);
+	job->dir = g_dir_make_tmp("gnome-mpv-XXXXXX", &error);
+	job->pipe_path =	job->dir?
+				g_build_filename(job->dir, WAVEFORM_PIPE_NAME, NULL):
+				NULL;
+	job->read_fd = -1;
+	job->keepalive_fd = -1;
+	job->decoder = NULL;
+	job->cancelled = FALSE;
+	job->peaks = NULL;
+
+	/* The read end is opened without blocking since nothing writes to the
+	 * pipe yet. The write end kept here stops the worker thread from
+	 * seeing the end of the stream before mpv opens the pipe.
+	 */
+	if(	!job->dir ||
+		mkfifo(job->pipe_path, 0600) != 0 ||
+		(job->read_fd = open(	job->pipe_path,
+					O_RDONLY|O_NONBLOCK|O_CLOEXEC )) < 0 ||
+		fcntl(job->read_fd, F_SETFL, 0) != 0 ||
+		(job->keepalive_fd = open(	job->pipe_path,
+						O_WRONLY|O_NONBLOCK|O_CLOEXEC )) < 0 )
+	{
+		g_warning(	"Failed to create pipe for waveform: %s",
+				error?error->message:g_strerror(errno) );
+
+		g_clear_error(&error);
+		free_job(job);
+
+		return;
+	}
+
+	job->decoder = gmpv_mpv_new(0);
+
+	g_signal_connect(	job->decoder,
+				"shutdown",
+				G_CALLBACK(shutdown_handler),
+				job );
+
+	/* ao-pcm writes as fast as the audio can be decoded. ao=null would
+	 * decode just as fast, but throws the samples away.
+	 */
+	gmpv_mpv_set_option_string(job->decoder, "ao", "pcm");
+	gmpv_mpv_set_option_string(job->decoder, "ao-pcm-file", job->pipe_path);
+	gmpv_mpv_set_option_string(job->decoder, "ao-pcm-waveheader", "no");
+	gmpv_mpv_set_option_string(job->decoder, "audio-format", "s16");
+	gmpv_mpv_set_option_string(job->decoder, "audio-channels", "mono");
+	gmpv_mpv_set_option_string
+		(job->decoder, "audio-samplerate", G_STRINGIFY(WAVEFORM_SAMPLE_RATE));
+	gmpv_mpv_set_option_string(job->decoder, "vo", "null");
+	gmpv_mpv_set_option_string(job->decoder, "vid", "no");
+	gmpv_mpv_set_option_string(job->decoder, "sid", "no");
+	gmpv_mpv_set_option_string(job->decoder, "audio-display", "no");
+	gmpv_mpv_set_option_string(job->decoder, "idle", "once");
+	gmpv_mpv_set_option_string(job->decoder, "ytdl", "no");
+	gmpv_mpv_initialize(job->decoder);
+
+	g_thread_unref(g_thread_new("waveform", decode_thread, job));
+
+	g_debug("Building waveform of %s", uri);
+	gmpv_mpv_load_file(job->decoder, uri, FALSE);
+
+	service->job = job;
+#else
+	g_debug("Waveforms are not supported on this platform");
+#endif
+}
+
+static void process(	GmpvWaveformService *service,
+			const gchar *uri,
+			const gchar *fingerprint )
+{
+	GBytes *peaks = g_hash_table_lookup(service->waveforms, fingerprint);
+
+	if(peaks)
+	{
+		set_waveform(service, uri, fingerprint, peaks);
+	}
+	else if((peaks = load_cache(service, fingerprint)))
+	{
+		set_waveform(service, uri, fingerprint, peaks);
+		g_bytes_unref(peaks);
+	}
+	else if(	!service->job ||
+			g_strcmp0(service->job->fingerprint, fingerprint) != 0 )
+	{
+		cancel_job(service);
+		start_job(service, uri, fingerprint);
+	}
+}
+
+static void gmpv_waveform_service_class_init(GmpvWaveformServiceClass *klass)
+{
+	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
+
+	obj_class->dispose = dispose;
+	obj_class->finalize = finalize;
+
+	g_signal_new(	"ready",
+			G_TYPE_FROM_CLASS(klass),
+			G_SIGNAL_RUN_FIRST,
+			0,
+			NULL,
+			NULL,
+			g_cclosure_marshal_VOID__STRING,
+			G_TYPE_NONE,
+			1,
+			G_TYPE_STRING );
+}
+
+static void gmpv_waveform_service_init(GmpvWaveformService *service)
+{
+	service->cache_dir =	g_build_filename
+				(	g_get_user_cache_dir(),
+					CONFIG_DIR,
+					WAVEFORM_DIRNAME,
+					NULL );
+	service->waveforms =	g_hash_table_new_full
+				(	g_str_hash,
+					g_str_equal,
+					g_free,
+					(GDestroyNotify)g_bytes_unref );
+	service->current_uri = NULL;
+	service->fingerprint_service = gmpv_fingerprint_service_get_default();
+	service->job = NULL;
+
+	g_signal_connect(	service->fingerprint_service,
+				"ready",
+				G_CALLBACK(fingerprint_ready_handler),
+				service );
+}
+
+GmpvWaveformService *gmpv_waveform_service_get_default(void)
+{
+	if(default_service)
+	{
+		g_object_ref(default_service);
+	}
+	else
+	{
+		default_service =	g_object_new
+					(gmpv_waveform_service_get_type(), NULL);
+
+		g_object_add_weak_pointer
+			(G_OBJECT(default_service), (gpointer *)&default_service);
+	}
+
+	return default_service;
+}
+
+void gmpv_waveform_service_request(	GmpvWaveformService *service,
+					const gchar *uri )
+{
+	const gchar *fingerprint = NULL;
+
+	if(!uri || g_strcmp0(uri, service->current_uri) == 0)
+	{
+		return;
+	}
+
+	g_free(service->current_uri);
+	service->current_uri = g_strdup(uri);
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(service->fingerprint_service, uri);
+
+	/* Files that are not fingerprinted yet are processed once they are */
+	if(fingerprint)
+	{
+		process(service, uri, fingerprint);
+	}
+
+	gmpv_fingerprint_service_request(service->fingerprint_service, uri);
+}
+
+GBytes *gmpv_waveform_service_lookup(	GmpvWaveformService *service,
+					const gchar *uri )
+{
+	const gchar *fingerprint = NULL;
+	GBytes *peaks = NULL;
+
+	fingerprint =	gmpv_fingerprint_service_lookup
+			(service->fingerprint_service, uri);
+
+	if(fingerprint)
+	{
+		peaks = g_hash_table_lookup(service->waveforms, fingerprint);
+	}
+
+	return peaks?g_bytes_ref(peaks):NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAVEFORM_SERVICE_H
+#define WAVEFORM_SERVICE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GMPV_TYPE_WAVEFORM_SERVICE (gmpv_waveform_service_get_type())
+
+G_DECLARE_FINAL_TYPE(GmpvWaveformService, gmpv_waveform_service, GMPV, WAVEFORM_SERVICE, GObject)
+
+/* Builds amplitude overviews of local files. The audio is decoded by a
+ * headless instance of mpv as fast as it can go, downmixed to mono and
+ * written to a pipe that is read by a worker thread, which keeps the
+ * minimum and maximum of every block of samples. The overview is made of
+ * WAVEFORM_BUCKET_COUNT pairs of minimum and maximum, scaled to the range
+ * of gint8, regardless of the duration of the file.
+ *
+ * Overviews are cached in the user cache directory under the fingerprint
+ * of the file, so they survive renames and are only built once. Only the
+ * last requested file is decoded, and requesting another one cancels it.
+ *
+ * Lookups never touch the filesystem and return a new reference to the
+ * overview, or NULL if it is not known yet. The ready signal is emitted
+ * with the URI once it becomes known.
+ */
+GmpvWaveformService *gmpv_waveform_service_get_default(void);
+void gmpv_waveform_service_request(	GmpvWaveformService *service,
+					const gchar *uri );
+GBytes *gmpv_waveform_service_lookup(	GmpvWaveformService *service,
+					const gchar *uri );
+
+G_END_DECLS
+
+#endif
@@ -27,6 +27,7 @@
 #include "gmpv_mpris.h"
 #include "gmpv_mpris_base.h"
 #include "gmpv_mpris_player.h"
+#include "gmpv_mpris_playlist.h"
 #include "gmpv_mpris_track_list.h"
 #include "gmpv_def.h"
 
@@ -44,6 +45,7 @@ struct _GmpvMpris
 	GmpvMprisModule *base;
 	GmpvMprisModule *player;
 	GmpvMprisModule *track_list;
+	GmpvMprisModule *playlist;
 	guint name_id;
 	GDBusConnection *session_bus_conn;
 };
@@ -109,6 +111,7 @@ static void dispose(GObject *object)
 	g_clear_object(&self->base);
 	g_clear_object(&self->player);
 	g_clear_object(&self->track_list);
+	g_clear_object(&self->playlist);
 	g_bus_unown_name(self->name_id);
 
 	G_OBJECT_CLASS(gmpv_mpris_parent_class)->dispose(object);
@@ -164,10 +167,12 @@ static void name_acquired_handler(	GDBusConnection *connection,
 	self->base = gmpv_mpris_base_new(self->controller, connection);
 	self->player = gmpv_mpris_player_new(self->controller, connection);
 	self->track_list = gmpv_mpris_track_list_new(self->controller, connection);
+	self->playlist = gmpv_mpris_playlist_new(self->controller, connection);
 
 	gmpv_mpris_module_register(self->base);
 	gmpv_mpris_module_register(self->player);
 	gmpv_mpris_module_register(self->track_list);
+	gmpv_mpris_module_register(self->playlist);
 }
 
 static void name_lost_handler(	GDBusConnection *connection,
@@ -182,6 +187,7 @@ static void unregister(GmpvMpris *mpris)
 	gmpv_mpris_module_unregister(mpris->base);
 	gmpv_mpris_module_unregister(mpris->player);
 	gmpv_mpris_module_unregister(mpris->track_list);
+	gmpv_mpris_module_unregister(mpris->playlist);
 }
 
 static void gmpv_mpris_init(GmpvMpris *mpris)
@@ -190,6 +196,7 @@ static void gmpv_mpris_init(GmpvMpris *mpris)
 	mpris->base = NULL;
 	mpris->player = NULL;
 	mpris->track_list = NULL;
+	mpris->playlist = NULL;
 	mpris->name_id = 0;
 	mpris->session_bus_conn = NULL;
 }
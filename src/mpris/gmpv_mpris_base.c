@@ -108,18 +108,24 @@ static void register_interface(GmpvMprisModule *module)
 
 	g_object_get(module, "conn", &conn, "iface", &iface, NULL);
 
-	gmpv_mpris_module_connect_signal
-		(	module,
-			view,
-			"notify::fullscreen",
-			G_CALLBACK(fullscreen_handler),
-			module );
+	/* There is no window to raise or to make fullscreen in headless
+	 * mode.
+	 */
+	if(view)
+	{
+		gmpv_mpris_module_connect_signal
+			(	module,
+				view,
+				"notify::fullscreen",
+				G_CALLBACK(fullscreen_handler),
+				module );
+	}
 
 	gmpv_mpris_module_set_properties
 		(	module,
 			"CanQuit", g_variant_new_boolean(TRUE),
-			"CanSetFullscreen", g_variant_new_boolean(TRUE),
-			"CanRaise", g_variant_new_boolean(TRUE),
+			"CanSetFullscreen", g_variant_new_boolean(!!view),
+			"CanRaise", g_variant_new_boolean(!!view),
 			"Fullscreen", g_variant_new_boolean(FALSE),
 			"HasTrackList", g_variant_new_boolean(TRUE),
 			"Identity", g_variant_new_string(g_get_application_name()),
@@ -204,7 +210,7 @@ static void method_handler(	GDBusConnection *connection,
 
 	if(g_strcmp0(method_name, "Raise") == 0)
 	{
-		gmpv_view_present(gmpv_controller_get_view(base->controller));
+		gmpv_controller_present(base->controller);
 	}
 	else if(g_strcmp0(method_name, "Quit") == 0)
 	{
@@ -245,7 +251,11 @@ static gboolean set_prop_handler(	GDBusConnection *connection,
 	{
 		GmpvView *view = gmpv_controller_get_view(base->controller);
 
-		gmpv_view_set_fullscreen(view, g_variant_get_boolean(value));
+		if(view)
+		{
+			gmpv_view_set_fullscreen
+				(view, g_variant_get_boolean(value));
+		}
 	}
 	else
 	{
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2017 gnome-mpv
+ *
+ * This file is part of GNOME MPV.
+ *
+ * GNOME MPV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GNOME MPV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNOME MPV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gmpv_mpris_playlist.h"
+#include "gmpv_mpris_gdbus.h"
+#include "gmpv_def.h"
+
+enum
+{
+	PROP_0,
+	PROP_CONTROLLER,
+	N_PROPERTIES
+};
+
+struct _GmpvMprisPlaylist
+{
+	GmpvMprisModule parent;
+	GmpvController *controller;
+	guint reg_id;
+};
+
+struct _GmpvMprisPlaylistClass
+{
+	GmpvMprisModuleClass parent_class;
+};
+
+static void register_interface(GmpvMprisModule *module);
+static void unregister_interface(GmpvMprisModule *module);
+
+static void set_property(	GObject *object,
+				guint property_id,
+				const GValue *value,
+				GParamSpec *pspec );
+static void get_property(	GObject *object,
+				guint property_id,
+				GValue *value,
+				GParamSpec *pspec );
+static void method_handler(	GDBusConnection *connection,
+				const gchar *sender,
+				const gchar *object_path,
+				const gchar *interface_name,
+				const gchar *method_name,
+				GVariant *parameters,
+				GDBusMethodInvocation *invocation,
+				gpointer data );
+static GVariant *get_prop_handler(	GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *property_name,
+					GError **error,
+					gpointer data );
+static gboolean set_prop_handler(	GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *property_name,
+					GVariant *value,
+					GError **error,
+					gpointer data );
+static void playlist_handler(	GObject *object,
+				GParamSpec *pspec,
+				gpointer data );
+static void update_duration(GmpvMprisPlaylist *playlist);
+static void gmpv_mpris_playlist_class_init(GmpvMprisPlaylistClass *klass);
+static void gmpv_mpris_playlist_init(GmpvMprisPlaylist *playlist);
+
+G_DEFINE_TYPE(GmpvMprisPlaylist, gmpv_mpris_playlist, GMPV_TYPE_MPRIS_MODULE);
+
+static void register_interface(GmpvMprisModule *module)
+{
+	GmpvMprisPlaylist *playlist = GMPV_MPRIS_PLAYLIST(module);
+	GmpvModel *model = gmpv_controller_get_model(playlist->controller);
+	GDBusConnection *conn;
+	GDBusInterfaceInfo *iface;
+	GDBusInterfaceVTable vtable;
+
+	g_object_get(module, "conn", &conn, "iface", &iface, NULL);
+
+	gmpv_mpris_module_connect_signal(	module,
+						model,
+						"notify::playlist",
+						G_CALLBACK(playlist_handler),
+						module );
+
+	gmpv_mpris_module_set_properties
+		(	module,
+			"Duration", g_variant_new_int64(0),
+			"DurationComplete", g_variant_new_boolean(TRUE),
+			NULL );
+
+	vtable.method_call = (GDBusInterfaceMethodCallFunc)method_handler;
+	vtable.get_property = (GDBusInterfaceGetPropertyFunc)get_prop_handler;
+	vtable.set_property = (GDBusInterfaceSetPropertyFunc)set_prop_handler;
+
+	playlist->reg_id = g_dbus_connection_register_object
+				(	conn,
+					MPRIS_OBJ_ROOT_PATH,
+					iface,
+					&vtable,
+					module,
+					NULL,
+					NULL );
+
+	update_duration(playlist);
+}
+
+static void unregister_interface(GmpvMprisModule *module)
+{
+	GmpvMprisPlaylist *playlist = GMPV_MPRIS_PLAYLIST(module);
+	GDBusConnection *conn = NULL;
+
+	g_object_get(module, "conn", &conn, NULL);
+	g_dbus_connection_unregister_object(conn, playlist->reg_id);
+}
+
+static void set_property(	GObject *object,
+				guint property_id,
+				const GValue *value,
+				GParamSpec *pspec )
+{
+	GmpvMprisPlaylist *self = GMPV_MPRIS_PLAYLIST(object);
+
+	switch(property_id)
+	{
+		case PROP_CONTROLLER:
+		self->controller = g_value_get_pointer(value);
+		break;
+
+		default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void get_property(	GObject *object,
+				guint property_id,
+				GValue *value,
+				GParamSpec *pspec )
+{
+	GmpvMprisPlaylist *self = GMPV_MPRIS_PLAYLIST(object);
+
+	switch(property_id)
+	{
+		case PROP_CONTROLLER:
+		g_value_set_pointer(value, self->controller);
+		break;
+
+		default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void method_handler(	GDBusConnection *connection,
+				const gchar *sender,
+				const gchar *object_path,
+				const gchar *interface_name,
+				const gchar *method_name,
+				GVariant *parameters,
+				GDBusMethodInvocation *invocation,
+				gpointer data )
+{
+	GmpvMprisPlaylist *playlist = data;
+	GmpvModel *model = gmpv_controller_get_model(playlist->controller);
+
+	if(g_strcmp0(method_name, "Seek") == 0)
+	{
+		gint64 position = 0;
+
+		g_variant_get(parameters, "(x)", &position);
+
+		if(!gmpv_model_seek_playlist(model, (gdouble)position/1e6))
+		{
+			g_warning(	"The Seek method of the playlist interface "
+					"was called with a position past the end: "
+					"%" G_GINT64_FORMAT,
+					position );
+		}
+	}
+	else
+	{
+		g_critical("Attempted to call unknown method: %s", method_name);
+	}
+
+	g_dbus_method_invocation_return_value
+		(invocation, g_variant_new("()", NULL));
+}
+
+static GVariant *get_prop_handler(	GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *property_name,
+					GError **error,
+					gpointer data )
+{
+	GmpvMprisPlaylist *playlist = data;
+	GVariant *value = NULL;
+
+	/* Like the Position property of the player interface, this changes
+	 * continuously, so it is computed on demand.
+	 */
+	if(g_strcmp0(property_name, "Position") == 0)
+	{
+		GmpvModel *model;
+		gdouble position;
+
+		model = gmpv_controller_get_model(playlist->controller);
+		position = gmpv_model_get_playlist_time_position(model);
+		value = g_variant_new_int64((gint64)(position*1e6));
+	}
+	else
+	{
+		gmpv_mpris_module_get_properties(	GMPV_MPRIS_MODULE(data),
+							property_name, &value,
+							NULL );
+	}
+
+	return value?g_variant_ref(value):NULL;
+}
+
+static gboolean set_prop_handler(	GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *property_name,
+					GVariant *value,
+					GError **error,
+					gpointer data )
+{
+	g_warning(	"Attempted to set property %s in "
+			"io.github.GnomeMpv.Playlist, but the interface "
+			"only has read-only properties.",
+			property_name );
+
+	/* Always fail since the interface only has read-only properties */
+	return FALSE;
+}
+
+static void playlist_handler(	GObject *object,
+				GParamSpec *pspec,
+				gpointer data )
+{
+	update_duration(data);
+}
+
+static void update_duration(GmpvMprisPlaylist *playlist)
+{
+	GmpvModel *model = gmpv_controller_get_model(playlist->controller);
+	gboolean complete = FALSE;
+	gdouble duration = 0;
+	gint64 new_duration = 0;
+	GVariant *old_duration = NULL;
+	GVariant *old_complete = NULL;
+
+	duration = gmpv_model_get_playlist_duration(model, &complete);
+	new_duration = (gint64)(duration*1e6);
+
+	gmpv_mpris_module_get_properties(	GMPV_MPRIS_MODULE(playlist),
+						"Duration", &old_duration,
+						"DurationComplete", &old_complete,
+						NULL );
+
+	/* The playlist is republished whenever any entry changes, so only
+	 * signal actual changes.
+	 */
+	if(	!old_duration || !old_complete ||
+		g_variant_get_int64(old_duration) != new_duration ||
+		g_variant_get_boolean(old_complete) != complete )
+	{
+		gmpv_mpris_module_set_properties
+			(	GMPV_MPRIS_MODULE(playlist),
+				"Duration", g_variant_new_int64(new_duration),
+				"DurationComplete", g_variant_new_boolean(complete),
+				NULL );
+	}
+}
+
+static void gmpv_mpris_playlist_class_init(GmpvMprisPlaylistClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+	GmpvMprisModuleClass *module_class = GMPV_MPRIS_MODULE_CLASS(klass);
+	GParamSpec *pspec = NULL;
+
+	object_class->set_property = set_property;
+	object_class->get_property = get_property;
+	module_class->register_interface = register_interface;
+	module_class->unregister_interface = unregister_interface;
+
+	pspec = g_param_spec_pointer
+		(	"controller",
+			"Controller",
+			"The GmpvController to use",
+			G_PARAM_CONSTRUCT_ONLY|G_PARAM_READWRITE );
+	g_object_class_install_property(object_class, PROP_CONTROLLER, pspec);
+}
+
+static void gmpv_mpris_playlist_init(GmpvMprisPlaylist *playlist)
+{
+	playlist->controller = NULL;
+	playlist->reg_id = 0;
+}
+
+GmpvMprisModule *gmpv_mpris_playlist_new(	GmpvController *controller,
+						GDBusConnection *conn )
+{
+	GDBusInterfaceInfo *iface;
+	GObject *object;
+
+	iface = gmpv_mpris_io_github_gnome_mpv_playlist_interface_info();
+	object = g_object_new(	gmpv_mpris_playlist_get_type(),
+				"controller", controller,
+				"conn", conn,
+				"iface", iface,
+				NULL );
+
+	return GMPV_MPRIS_MODULE(object);
+}
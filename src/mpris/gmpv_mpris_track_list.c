@@ -469,6 +469,15 @@ static GVariant *playlist_entry_to_variant(	GmpvPlaylistEntry *entry,
 				g_variant_new_string(uri) );
 	g_variant_builder_add_value(&builder, elem_value);
 
+	if(entry->duration > 0)
+	{
+		elem_value =	g_variant_new
+				(	"{sv}",
+					"mpris:length",
+					g_variant_new_int64
+					((gint64)(entry->duration*1e6)) );
+		g_variant_builder_add_value(&builder, elem_value);
+	}
 
 	g_free(track_id);
 	g_free(title);